@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -40,6 +40,7 @@
 #include "app/resource_finder.h"
 #include "app/send_crash.h"
 #include "app/site.h"
+#include "app/task_scheduler.h"
 #include "app/tools/active_tool.h"
 #include "app/tools/tool_box.h"
 #include "app/ui/backup_indicator.h"
@@ -60,6 +61,7 @@
 #include "base/platform.h"
 #include "base/replace_string.h"
 #include "base/split_string.h"
+#include "doc/parallel_for.h"
 #include "doc/sprite.h"
 #include "fmt/format.h"
 #include "os/error.h"
@@ -233,6 +235,7 @@ App* App::m_instance = nullptr;
 
 App::App(AppMod* mod)
   : m_mod(mod)
+  , m_taskScheduler(std::make_unique<TaskScheduler>(TaskScheduler::defaultWorkers()))
   , m_coreModules(nullptr)
   , m_modules(nullptr)
   , m_legacy(nullptr)
@@ -245,6 +248,19 @@ App::App(AppMod* mod)
 {
   ASSERT(m_instance == nullptr);
   m_instance = this;
+
+  TaskScheduler::setInstance(m_taskScheduler.get());
+
+  // Parallel loops of doc/render libraries use the same workers
+  doc::set_parallel_for(
+    [](const int n, const std::function<void(int)>& func) {
+      TaskGroup tasks(TaskPriority::Interactive);
+      for (int i = 1; i < n; ++i)
+        tasks.execute([&func, i] { func(i); });
+      func(0);
+      tasks.wait();
+    },
+    m_taskScheduler->workers());
 }
 
 int App::initialize(const AppOptions& options)
@@ -651,6 +667,11 @@ App::~App()
     // no re-throw
   }
 
+  // Finish the pending tasks before destroying the rest of members
+  doc::set_parallel_for(nullptr, 1);
+  TaskScheduler::setInstance(nullptr);
+  m_taskScheduler.reset();
+
   m_instance = nullptr;
 }
 
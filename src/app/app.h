@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -48,6 +48,7 @@ class LoggerModule;
 class MainWindow;
 class Preferences;
 class RecentFiles;
+class TaskScheduler;
 class Timeline;
 class Workspace;
 
@@ -132,6 +133,8 @@ private:
   static App* m_instance;
 
   AppMod* m_mod;
+  // Destroyed at the end, after all the modules that can use it
+  std::unique_ptr<TaskScheduler> m_taskScheduler;
   std::unique_ptr<ui::UISystem> m_uiSystem;
   std::unique_ptr<CoreModules> m_coreModules;
   std::unique_ptr<Modules> m_modules;
@@ -0,0 +1,87 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif
+
+#include "app/util/cel_ops.h"
+#include "doc/image.h"
+#include "doc/image_ref.h"
+#include "doc/primitives.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+using namespace app;
+using namespace doc;
+
+// Two images with "changes" scattered pixels of difference.
+void BM_RegionWithDifferences(benchmark::State& state)
+{
+  const PixelFormat pixelFormat = (PixelFormat)state.range(0);
+  const int w = state.range(1);
+  const int h = state.range(2);
+  const int changes = state.range(3);
+
+  ImageRef a(Image::create(pixelFormat, w, h));
+  ImageRef b(Image::create(pixelFormat, w, h));
+  clear_image(a.get(), 0);
+  clear_image(b.get(), 0);
+
+  std::mt19937 rng(1);
+  for (int i = 0; i < changes; ++i)
+    put_pixel(b.get(), rng() % w, rng() % h, 1);
+
+  while (state.KeepRunning()) {
+    gfx::Region rgn;
+    create_region_with_differences(a.get(), b.get(), a->bounds(), rgn);
+    benchmark::DoNotOptimize(rgn);
+  }
+}
+
+// Two images with a big rectangle of difference.
+void BM_RegionWithDifferencesRect(benchmark::State& state)
+{
+  const PixelFormat pixelFormat = (PixelFormat)state.range(0);
+  const int w = state.range(1);
+  const int h = state.range(2);
+
+  ImageRef a(Image::create(pixelFormat, w, h));
+  ImageRef b(Image::create(pixelFormat, w, h));
+  clear_image(a.get(), 0);
+  clear_image(b.get(), 0);
+  fill_rect(b.get(), w / 4, h / 4, 3 * w / 4, 3 * h / 4, 1);
+
+  while (state.KeepRunning()) {
+    gfx::Region rgn;
+    create_region_with_differences(a.get(), b.get(), a->bounds(), rgn);
+    benchmark::DoNotOptimize(rgn);
+  }
+}
+
+BENCHMARK(BM_RegionWithDifferences)
+  ->Args({ IMAGE_RGB, 16, 16, 8 })
+  ->Args({ IMAGE_RGB, 256, 256, 100 })
+  ->Args({ IMAGE_RGB, 2048, 2048, 0 })
+  ->Args({ IMAGE_RGB, 2048, 2048, 1000 })
+  ->Args({ IMAGE_RGB, 2048, 2048, 10000 })
+  ->Args({ IMAGE_GRAYSCALE, 2048, 2048, 10000 })
+  ->Args({ IMAGE_INDEXED, 2048, 2048, 10000 })
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_RegionWithDifferencesRect)
+  ->Args({ IMAGE_RGB, 256, 256 })
+  ->Args({ IMAGE_RGB, 2048, 2048 })
+  ->Args({ IMAGE_INDEXED, 2048, 2048 })
+  ->Unit(benchmark::kMillisecond);
+
+int app_main(int argc, char* argv[])
+{
+  ::benchmark::Initialize(&argc, argv);
+  return ::benchmark::RunSpecifiedBenchmarks();
+}
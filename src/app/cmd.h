@@ -1,4 +1,5 @@
 // Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -32,6 +33,11 @@ public:
   std::string label() const;
   size_t memSize() const;
 
+  // Compresses the data used to undo/redo this command to reduce its
+  // memSize(). It's called from a background thread for commands
+  // that are not going to be undone/redone soon (see DocUndo).
+  void compress();
+
   Context* context() const { return m_ctx; }
 
 protected:
@@ -41,6 +47,7 @@ protected:
   virtual void onFireNotifications();
   virtual std::string onLabel() const;
   virtual size_t onMemSize() const;
+  virtual void onCompress();
 
 private:
   Context* m_ctx;
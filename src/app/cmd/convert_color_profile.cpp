@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2021  Igara Studio S.A.
+// Copyright (C) 2018-2025  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -141,6 +141,7 @@ void convert_color_profile(doc::Image* image,
         ImageRef newImage = convert_image_color_space(image, newCS, conversion.get());
 
         image->copy(newImage.get(), gfx::Clip(image->bounds()));
+        image->incrementVersion();
         break;
       }
 
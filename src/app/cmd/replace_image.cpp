@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2023  Igara Studio S.A.
+// Copyright (C) 2023-2025  Igara Studio S.A.
 // Copyright (C) 2001-2015  David Capello
 //
 // This program is distributed under the terms of
@@ -20,6 +20,8 @@
 #include "doc/subobjects_io.h"
 #include "doc/tilesets.h"
 
+#include <algorithm>
+
 namespace app { namespace cmd {
 
 using namespace doc;
@@ -47,6 +49,8 @@ void ReplaceImage::onExecute()
 
 void ReplaceImage::onUndo()
 {
+  decompressCopy();
+
   ImageRef newImage = sprite()->getImageRef(m_newImageId);
   ASSERT(newImage);
   ASSERT(!sprite()->getImageRef(m_oldImageId));
@@ -58,6 +62,8 @@ void ReplaceImage::onUndo()
 
 void ReplaceImage::onRedo()
 {
+  decompressCopy();
+
   ImageRef oldImage = sprite()->getImageRef(m_oldImageId);
   ASSERT(oldImage);
   ASSERT(!sprite()->getImageRef(m_newImageId));
@@ -67,6 +73,48 @@ void ReplaceImage::onRedo()
   m_copy.reset(Image::createCopy(oldImage.get()));
 }
 
+// Called from a background thread, DocUndo doesn't undo/redo this
+// command while it's being compressed.
+void ReplaceImage::onCompress()
+{
+  if (!m_copy)
+    return;
+
+  const int rowBytes = m_copy->widthBytes();
+  base::buffer& buffer = m_compressedCopy.buffer();
+  buffer.resize(size_t(rowBytes) * m_copy->height());
+  for (int y = 0; y < m_copy->height(); ++y) {
+    const uint8_t* row = m_copy->getPixelAddress(0, y);
+    std::copy(row, row + rowBytes, buffer.data() + size_t(y) * rowBytes);
+  }
+
+  m_compressedCopy.compress();
+  if (!m_compressedCopy.isCompressed()) {
+    // Keep the image as it is (it's not worth to compress it)
+    m_compressedCopy.buffer() = base::buffer();
+    return;
+  }
+
+  m_copySpec = m_copy->spec();
+  m_copy.reset();
+}
+
+void ReplaceImage::decompressCopy()
+{
+  if (m_copy || !m_copySpec)
+    return;
+
+  m_copy.reset(Image::create(*m_copySpec));
+  const base::buffer& buffer = m_compressedCopy.buffer();
+  const int rowBytes = m_copy->widthBytes();
+  for (int y = 0; y < m_copy->height(); ++y) {
+    const uint8_t* row = buffer.data() + size_t(y) * rowBytes;
+    std::copy(row, row + rowBytes, m_copy->getPixelAddress(0, y));
+  }
+  m_compressedCopy.buffer() = base::buffer();
+  m_copySpec.reset();
+}
+
 void ReplaceImage::replaceImage(ObjectId oldId, const ImageRef& newImage)
 {
   Sprite* spr = sprite();
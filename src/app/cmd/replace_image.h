@@ -1,4 +1,5 @@
 // Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
 // Copyright (C) 2001-2015  David Capello
 //
 // This program is distributed under the terms of
@@ -10,8 +11,11 @@
 
 #include "app/cmd.h"
 #include "app/cmd/with_sprite.h"
+#include "app/util/compressed_buffer.h"
 #include "doc/image_ref.h"
+#include "doc/image_spec.h"
 
+#include <optional>
 #include <sstream>
 
 namespace app { namespace cmd {
@@ -26,11 +30,18 @@ protected:
   void onExecute() override;
   void onUndo() override;
   void onRedo() override;
-  size_t onMemSize() const override { return sizeof(*this) + (m_copy ? m_copy->getMemSize() : 0); }
+  void onCompress() override;
+  size_t onMemSize() const override
+  {
+    return sizeof(*this) + (m_copy ? m_copy->getMemSize() : m_compressedCopy.memSize());
+  }
 
 private:
   void replaceImage(ObjectId oldId, const ImageRef& newImage);
 
+  // Restores m_copy if it was compressed.
+  void decompressCopy();
+
   ObjectId m_oldImageId;
   ObjectId m_newImageId;
 
@@ -39,6 +50,10 @@ private:
   // Then the reference is not used anymore.
   ImageRef m_newImage;
   ImageRef m_copy;
+
+  // Pixels of m_copy when it's compressed (m_copy is nullptr).
+  std::optional<ImageSpec> m_copySpec;
+  CompressedBuffer m_compressedCopy;
 };
 
 }} // namespace app::cmd
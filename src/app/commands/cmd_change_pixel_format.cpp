@@ -22,6 +22,7 @@
 #include "app/modules/gui.h"
 #include "app/modules/palettes.h"
 #include "app/sprite_job.h"
+#include "app/task.h"
 #include "app/transaction.h"
 #include "app/ui/best_fit_criteria_selector.h"
 #include "app/ui/dithering_selector.h"
@@ -46,7 +47,6 @@
 #include "color_mode.xml.h"
 
 #include <string>
-#include <thread>
 
 namespace app {
 
@@ -64,37 +64,32 @@ rgba_to_graya_func get_gray_func(gen::ToGrayAlgorithm toGray)
   return nullptr;
 }
 
-class ConvertThread : public render::TaskDelegate {
+class ConvertTask : public render::TaskDelegate {
 public:
-  ConvertThread(const doc::ImageRef& dstImage,
-                const doc::Sprite* sprite,
-                const doc::frame_t frame,
-                const doc::PixelFormat pixelFormat,
-                const render::Dithering& dithering,
-                const gen::ToGrayAlgorithm toGray,
-                const gfx::Point& pos,
-                const bool newBlend)
+  ConvertTask(const doc::ImageRef& dstImage,
+              const doc::Sprite* sprite,
+              const doc::frame_t frame,
+              const doc::PixelFormat pixelFormat,
+              const render::Dithering& dithering,
+              const gen::ToGrayAlgorithm toGray,
+              const gfx::Point& pos,
+              const bool newBlend)
     : m_image(dstImage)
     , m_pos(pos)
     , m_running(true)
     , m_stopFlag(false)
     , m_progress(0.0)
-    , m_thread([this,
-                sprite,
-                frame,
-                pixelFormat,
-                dithering,
-                toGray,
-                newBlend]() { // Copy the matrix
-      run(sprite, frame, pixelFormat, dithering, toGray, newBlend);
-    })
   {
+    m_task.run([this, sprite, frame, pixelFormat, dithering, toGray, newBlend](
+                 base::task_token&) { // Copy the matrix
+      run(sprite, frame, pixelFormat, dithering, toGray, newBlend);
+    });
   }
 
   void stop()
   {
     m_stopFlag = true;
-    m_thread.join();
+    m_task.wait();
   }
 
   bool isRunning() const { return m_running; }
@@ -143,7 +138,7 @@ private:
   bool m_running;
   bool m_stopFlag;
   double m_progress;
-  std::thread m_thread;
+  Task m_task;
 };
 
 class ConversionItem : public ListItem {
@@ -334,9 +329,9 @@ private:
     m_editor->invalidate();
 
     m_timer.stop();
-    if (m_bgThread) {
-      m_bgThread->stop();
-      m_bgThread.reset(nullptr);
+    if (m_bgTask) {
+      m_bgTask->stop();
+      m_bgTask.reset(nullptr);
     }
   }
 
@@ -392,7 +387,7 @@ private:
     progress()->setVisible(false);
     layout();
 
-    m_bgThread.reset(new ConvertThread(m_image,
+    m_bgTask.reset(new ConvertTask(m_image,
                                        m_editor->sprite(),
                                        m_editor->frame(),
                                        dstPixelFormat,
@@ -420,20 +415,20 @@ private:
 
   void onMonitorProgress()
   {
-    ASSERT(m_bgThread);
-    if (!m_bgThread)
+    ASSERT(m_bgTask);
+    if (!m_bgTask)
       return;
 
-    if (!m_bgThread->isRunning()) {
+    if (!m_bgTask->isRunning()) {
       m_timer.stop();
-      m_bgThread->stop();
-      m_bgThread.reset(nullptr);
+      m_bgTask->stop();
+      m_bgTask.reset(nullptr);
 
       progress()->setVisible(false);
       layout();
     }
     else {
-      int v = int(100 * m_bgThread->progress());
+      int v = int(100 * m_bgTask->progress());
       if (v > 0) {
         progress()->setValue(v);
         if (!progress()->isVisible()) {
@@ -450,7 +445,7 @@ private:
   Editor* m_editor;
   doc::ImageRef m_image;
   doc::ImageBufferPtr m_imageBuffer;
-  std::unique_ptr<ConvertThread> m_bgThread;
+  std::unique_ptr<ConvertTask> m_bgTask;
   ConversionItem* m_selectedItem;
   DitheringSelector* m_ditheringSelector;
   RgbMapAlgorithmSelector* m_mapAlgorithmSelector;
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2024  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -36,7 +36,6 @@
 #include "base/convert_to.h"
 #include "base/fs.h"
 #include "base/string.h"
-#include "base/thread.h"
 #include "doc/layer.h"
 #include "doc/layer_tilemap.h"
 #include "doc/tag.h"
@@ -1132,10 +1131,7 @@ private:
   void waitGenTaskAndDelete()
   {
     if (m_genTask) {
-      if (!m_genTask->completed()) {
-        while (!m_genTask->completed())
-          base::this_thread::sleep_for(0.01);
-      }
+      m_genTask->wait();
       m_genTask.reset();
     }
   }
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -559,6 +559,10 @@ public:
       keepClosedSpriteOnMemoryFor()->findItemIndexByValue(
         base::convert_to<std::string>(m_pref.general.keepClosedSpriteOnMemoryFor())));
 
+    asepriteCompressionLevel()->setSelectedItemIndex(
+      asepriteCompressionLevel()->findItemIndexByValue(
+        base::convert_to<std::string>(m_pref.saveFile.asepriteCompressionLevel())));
+
     zoomFromCenterWithWheel()->setSelected(m_pref.editor.zoomFromCenterWithWheel());
     zoomFromCenterWithKeys()->setSelected(m_pref.editor.zoomFromCenterWithKeys());
     autoOpaque()->setSelected(m_pref.selection.autoOpaque());
@@ -671,6 +675,10 @@ public:
     m_globPref.timeline.firstFrame(firstFrame()->textInt());
     m_pref.general.showFullPath(showFullPath()->isSelected());
     m_pref.saveFile.defaultExtension(getExtension(defaultExtension()));
+    if (asepriteCompressionLevel()->getSelectedItemIndex() >= 0) {
+      m_pref.saveFile.asepriteCompressionLevel(
+        base::convert_to<int>(asepriteCompressionLevel()->getValue()));
+    }
     m_pref.exportFile.imageDefaultExtension(getExtension(exportImageDefaultExtension()));
     m_pref.exportFile.animationDefaultExtension(getExtension(exportAnimationDefaultExtension()));
     m_pref.spriteSheet.defaultExtension(getExtension(exportSpriteSheetDefaultExtension()));
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -21,6 +21,7 @@
 #include "app/ini_file.h"
 #include "app/modules/palettes.h"
 #include "app/site.h"
+#include "app/task_scheduler.h"
 #include "app/transaction.h"
 #include "app/ui/color_bar.h"
 #include "app/ui/editor/editor.h"
@@ -35,12 +36,14 @@
 #include "doc/image.h"
 #include "doc/layer.h"
 #include "doc/mask.h"
+#include "doc/primitives_fast.h"
 #include "doc/sprite.h"
 #include "filters/filter.h"
 #include "ui/manager.h"
 #include "ui/view.h"
 #include "ui/widget.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <set>
@@ -50,6 +53,55 @@ namespace app {
 using namespace std;
 using namespace ui;
 
+// FilterManager used to apply a filter to one specific row. Filters
+// that can be applied to several rows in parallel (see
+// Filter::canApplyToRowsInParallel()) receive one of these for each
+// row, so each thread has its own row context (row index and mask
+// position) instead of the shared FilterManagerImpl state.
+class FilterManagerImpl::RowContext : public FilterManager {
+public:
+  RowContext(FilterManagerImpl* mgr, const int row) : m_mgr(mgr), m_row(row)
+  {
+    if (mgr->m_mask && mgr->m_mask->bitmap()) {
+      m_maskBitmap = mgr->m_mask->bitmap();
+      m_maskX = mgr->m_bounds.x - mgr->m_mask->bounds().x;
+      m_maskY = mgr->m_bounds.y - mgr->m_mask->bounds().y + row;
+    }
+  }
+
+  doc::PixelFormat pixelFormat() const override { return m_mgr->pixelFormat(); }
+  const void* getSourceAddress() override
+  {
+    return m_mgr->m_src->getPixelAddress(m_mgr->m_bounds.x, y());
+  }
+  void* getDestinationAddress() override
+  {
+    return m_mgr->m_dst->getPixelAddress(m_mgr->m_bounds.x, y());
+  }
+  int getWidth() override { return m_mgr->m_bounds.w; }
+  Target getTarget() override { return m_mgr->m_target; }
+  FilterIndexedData* getIndexedData() override { return m_mgr; }
+  bool skipPixel() override
+  {
+    if (!m_maskBitmap)
+      return false;
+    return !get_pixel_fast<BitmapTraits>(m_maskBitmap, m_maskX++, m_maskY);
+  }
+  const doc::Image* getSourceImage() override { return m_mgr->m_src.get(); }
+  int x() const override { return m_mgr->m_bounds.x; }
+  int y() const override { return m_mgr->m_bounds.y + m_row; }
+  bool isFirstRow() const override { return m_row == 0; }
+  bool isMaskActive() const override { return m_mgr->isMaskActive(); }
+  base::task_token& taskToken() const override { return m_mgr->taskToken(); }
+
+private:
+  FilterManagerImpl* m_mgr;
+  int m_row;
+  const doc::Image* m_maskBitmap = nullptr;
+  int m_maskX = 0;
+  int m_maskY = 0;
+};
+
 FilterManagerImpl::FilterManagerImpl(Context* context, Filter* filter)
   : m_reader(context)
   , m_site(*const_cast<Site*>(m_reader.site()))
@@ -65,6 +117,7 @@ FilterManagerImpl::FilterManagerImpl(Context* context, Filter* filter)
   , m_celsTarget(CelsTarget::Selected)
   , m_oldPalette(nullptr)
   , m_taskToken(&m_noToken)
+  , m_nthreads(TaskScheduler::instance()->workers())
   , m_progressDelegate(nullptr)
 {
   int x, y;
@@ -170,6 +223,14 @@ bool FilterManagerImpl::applyStep()
   if (m_row < 0 || m_row >= m_bounds.h)
     return false;
 
+  if (canApplyToRowsInParallel()) {
+    if (m_row == 0)
+      applyToPaletteIfNeeded();
+
+    applyToRowsInParallel();
+    return true;
+  }
+
   if (m_mask && m_mask->bitmap()) {
     int x = m_bounds.x - m_mask->bounds().x;
     int y = m_bounds.y - m_mask->bounds().y + m_row;
@@ -197,6 +258,41 @@ bool FilterManagerImpl::applyStep()
   return true;
 }
 
+bool FilterManagerImpl::canApplyToRowsInParallel() const
+{
+  // Indexed images are filtered row by row because the RgbMap
+  // generates its entries lazily (it's not thread-safe).
+  return (m_nthreads > 1 && m_filter->canApplyToRowsInParallel() &&
+          m_site.sprite()->pixelFormat() != IMAGE_INDEXED);
+}
+
+// Applies the filter to the next rows (a few rows for each thread),
+// and advances m_row to the next row to be processed. This way
+// applyStep() still returns often enough to report the progress,
+// cancel the operation, or flush the preview.
+void FilterManagerImpl::applyToRowsInParallel()
+{
+  TaskGroup tasks(TaskPriority::Interactive);
+
+  const int kRowsPerThread = 8;
+  const int rows = std::min(m_nthreads * kRowsPerThread, m_bounds.h - m_row);
+  const PixelFormat pixelFormat = m_site.sprite()->pixelFormat();
+
+  for (int row = m_row; row < m_row + rows; ++row) {
+    tasks.execute([this, row, pixelFormat] {
+      RowContext ctx(this, row);
+      switch (pixelFormat) {
+        case IMAGE_RGB:       m_filter->applyToRgba(&ctx); break;
+        case IMAGE_GRAYSCALE: m_filter->applyToGrayscale(&ctx); break;
+        case IMAGE_INDEXED:   m_filter->applyToIndexed(&ctx); break;
+      }
+    });
+  }
+  tasks.wait();
+
+  m_row += rows;
+}
+
 void FilterManagerImpl::apply()
 {
   CommandResult result;
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -130,8 +130,12 @@ public:
   doc::PalettePicks getPalettePicks() override;
 
 private:
+  class RowContext;
+
   void init(doc::Cel* cel);
   void apply();
+  bool canApplyToRowsInParallel() const;
+  void applyToRowsInParallel();
   void applyToCel(doc::Cel* cel);
   bool updateBounds(doc::Mask* mask);
 
@@ -165,6 +169,10 @@ private:
   base::task_token m_noToken;
   base::task_token* m_taskToken;
 
+  // Number of workers to apply the filter to several rows at the
+  // same time (only for filters that support it)
+  int m_nthreads;
+
   // Hooks
   float m_progressBase;
   float m_progressWidth;
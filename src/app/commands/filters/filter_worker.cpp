@@ -15,6 +15,7 @@
 #include "app/i18n/strings.h"
 #include "app/ini_file.h"
 #include "app/modules/gui.h"
+#include "app/task.h"
 #include "app/ui/editor/editor.h"
 #include "app/ui/status_bar.h"
 #include "base/thread.h"
@@ -25,7 +26,6 @@
 #include <cstring>
 #include <functional>
 #include <mutex>
-#include <thread>
 
 namespace app {
 
@@ -67,7 +67,7 @@ private:
 
 } // anonymous namespace
 
-// Applies filters in two threads: a background worker thread to
+// Applies filters in two threads: a task in a TaskScheduler worker to
 // modify the sprite, and the main thread to monitoring the progress
 // (and given to the user the possibility to cancel the process).
 
@@ -121,11 +121,11 @@ void FilterWorker::run()
   // Initialize writting transaction
   m_filterMgr->initTransaction();
 
-  std::thread thread;
+  Task task;
   // Open the alert window in foreground (this is modal, locks the main thread)
   if (m_alert) {
-    // Launch the thread to apply the effect in background
-    thread = std::thread([this] { applyFilterInBackground(); });
+    // Launch the task to apply the effect in background
+    task.run([this](base::task_token&) { applyFilterInBackground(); });
     m_alert->openAndWait();
   }
   else {
@@ -141,9 +141,8 @@ void FilterWorker::run()
       m_cancelled = true;
   }
 
-  // Wait the `effect_bg' thread
-  if (thread.joinable())
-    thread.join();
+  // Wait the background task
+  task.wait();
 
   if (!m_error.empty()) {
     Console console;
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -44,6 +44,13 @@ DataRecovery::DataRecovery(Context* ctx)
   else
     m_config.keepEditedSpriteDataFor = 0;
 
+  switch (pref.general.dataRecoveryImageCodec()) {
+    case gen::DataRecoveryImageCodec::RAW: m_config.imageCodec = doc::ImageCodec::Raw; break;
+    case gen::DataRecoveryImageCodec::RLE: m_config.imageCodec = doc::ImageCodec::Rle; break;
+    case gen::DataRecoveryImageCodec::ZLIB: m_config.imageCodec = doc::ImageCodec::Zlib; break;
+  }
+  m_config.imageCompressionLevel = std::clamp(pref.general.dataRecoveryCompressionLevel(), 1, 9);
+
   ResourceFinder rf;
   rf.includeUserDir(base::join_path("sessions", ".").c_str());
   m_sessionsDir = rf.getFirstOrCreateDefault();
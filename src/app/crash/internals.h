@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2024  Igara Studio S.A.
+// Copyright (C) 2024-2025  Igara Studio S.A.
 // Copyright (C) 2001-2015  David Capello
 //
 // This program is distributed under the terms of
@@ -19,6 +19,27 @@ namespace app { namespace crash {
 
 const uint32_t MAGIC_NUMBER = 0x454E4946; // 'FINE' in ASCII
 
+// All versions of the objects of a document are appended to this
+// file. Each record contains:
+//
+//   uint32    Size of the rest of the record (in bytes)
+//   uint32    Object ID
+//   uint32    Object version
+//   string    Object type prefix ("img", "cel", "lay", etc.)
+//   uint32    MAGIC_NUMBER
+//   ...       Object data
+//   uint32    MAGIC_NUMBER
+//
+// Old sessions have one file per object version instead (named
+// "<prefix>-<id>.<version>", with the MAGIC_NUMBER + object data),
+// and they can still be restored.
+const char* const kPackFilename = "objects.pack";
+
+// Temporary file used to compact the pack file (when it has too
+// many old versions of objects). If we crash in the middle of the
+// compaction, the objects of both files are used.
+const char* const kCompactPackFilename = "objects.pack.new";
+
 class ObjVersions {
 public:
   ObjVersions()
@@ -0,0 +1,172 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "app/crash/internals.h"
+#include "app/crash/test_backup.h"
+#include "base/convert_to.h"
+
+#include <algorithm>
+#include <fstream>
+
+using namespace app;
+using namespace app::crash;
+using namespace doc;
+
+TEST(ObjectsPack, RoundTrip)
+{
+  check_backup_round_trip(nullptr);
+  EXPECT_FALSE(base::is_directory(kTestBackupDir));
+}
+
+TEST(ObjectsPack, AppendNewVersions)
+{
+  delete_test_backup_dir();
+
+  TestContext ctx;
+  std::unique_ptr<Doc> doc = make_test_backup_doc(ctx, 32, 32);
+  const std::string packFn = base::join_path(kTestBackupDir, kPackFilename);
+  write_test_backup(doc.get(), nullptr);
+  ASSERT_TRUE(base::is_file(packFn));
+  const size_t packSize = base::file_size(packFn);
+
+  // Nothing changed, nothing is appended
+  write_test_backup(doc.get(), nullptr);
+  EXPECT_EQ(packSize, base::file_size(packFn));
+
+  // Modify an image and the sprite, only the new versions of those
+  // objects are appended
+  Sprite* sprite = doc->sprite();
+  Image* image = sprite->root()->firstLayer()->cel(0)->image();
+  fill_rect(image, 4, 4, 20, 12, rgba(255, 0, 0, 255));
+  image->incrementVersion();
+  sprite->setTotalFrames(4);
+  sprite->incrementVersion();
+  write_test_backup(doc.get(), nullptr);
+  EXPECT_LT(packSize, base::file_size(packFn));
+
+  expect_same_backup_docs(doc.get(), read_test_backup().get());
+
+  delete_document_internals(doc.get());
+  doc->close();
+  delete_test_backup_dir();
+}
+
+TEST(ObjectsPack, Compact)
+{
+  delete_test_backup_dir();
+
+  // Raw images of 1MB, so the pack file is compacted after some
+  // versions (only the last 3 versions of each object are kept)
+  TestContext ctx;
+  std::unique_ptr<Doc> doc = make_test_backup_doc(ctx, 512, 512);
+  RecoveryConfig config;
+  config.imageCodec = ImageCodec::Raw;
+
+  const std::string packFn = base::join_path(kTestBackupDir, kPackFilename);
+  Image* image = doc->sprite()->root()->firstLayer()->cel(0)->image();
+  size_t packSize = 0;
+  bool compacted = false;
+  for (int i = 0; i < 10 && !compacted; ++i) {
+    fill_rect(image, i, i, i + 100, i + 50, rgba(i * 20, 0, 255, 255));
+    image->incrementVersion();
+    write_test_backup(doc.get(), &config);
+
+    const size_t newPackSize = base::file_size(packFn);
+    compacted = (newPackSize < packSize);
+    packSize = newPackSize;
+  }
+
+  EXPECT_TRUE(compacted);
+  EXPECT_LT(packSize, size_t(4 * image->rowBytes() * image->height()));
+  EXPECT_FALSE(base::is_file(base::join_path(kTestBackupDir, kCompactPackFilename)));
+
+  expect_same_backup_docs(doc.get(), read_test_backup().get());
+
+  delete_document_internals(doc.get());
+  doc->close();
+  delete_test_backup_dir();
+}
+
+TEST(ObjectsPack, SkipCorruptedRecord)
+{
+  delete_test_backup_dir();
+
+  TestContext ctx;
+  std::unique_ptr<Doc> doc = make_test_backup_doc(ctx, 32, 32);
+  const std::string packFn = base::join_path(kTestBackupDir, kPackFilename);
+  write_test_backup(doc.get(), nullptr);
+
+  Sprite* sprite = doc->sprite();
+  Image* image = sprite->root()->firstLayer()->cel(0)->image();
+  fill_rect(image, 4, 4, 20, 12, rgba(255, 0, 0, 255));
+  image->incrementVersion();
+  sprite->setTotalFrames(4);
+  sprite->incrementVersion();
+  write_test_backup(doc.get(), nullptr);
+
+  // Change the size of the first version of the image so it points
+  // to the middle of the next record (as if the record was partially
+  // written and the next records were appended after it)
+  const std::vector<TestPackRecord> records = read_test_pack_records(packFn);
+  auto it = std::find_if(records.begin(), records.end(), [image](const TestPackRecord& record) {
+    return (record.prefix == "img" && record.id == image->id());
+  });
+  ASSERT_TRUE(it != records.end());
+  ASSERT_TRUE(it + 1 != records.end());
+  {
+    std::fstream f(FSTREAM_PATH(packFn), std::ios::binary | std::ios::in | std::ios::out);
+    f.seekp(it->offset);
+    base::serialization::little_endian::write32(f, uint32_t(it->size - 4 + 8));
+  }
+
+  // The records after the corrupted one are still restored
+  expect_same_backup_docs(doc.get(), read_test_backup().get());
+
+  delete_document_internals(doc.get());
+  doc->close();
+  delete_test_backup_dir();
+}
+
+TEST(ObjectsPack, RestoreOldSessionFiles)
+{
+  delete_test_backup_dir();
+
+  TestContext ctx;
+  std::unique_ptr<Doc> doc = make_test_backup_doc(ctx, 32, 32);
+  const std::string packFn = base::join_path(kTestBackupDir, kPackFilename);
+  write_test_backup(doc.get(), nullptr);
+
+  // Convert the pack file to the old layout of sessions, one
+  // "<prefix>-<id>.<version>" file per object with the MAGIC_NUMBER
+  // and the object data.
+  const std::vector<TestPackRecord> records = read_test_pack_records(packFn);
+  ASSERT_FALSE(records.empty());
+  {
+    std::ifstream src(FSTREAM_PATH(packFn), std::ifstream::binary);
+    for (const TestPackRecord& record : records) {
+      std::string data(record.offset + record.size - 4 - record.dataOffset, 0);
+      src.seekg(record.dataOffset);
+      ASSERT_TRUE(src.read(data.data(), data.size()));
+
+      const std::string fn = base::join_path(kTestBackupDir,
+                                             record.prefix + "-" +
+                                               base::convert_to<std::string>(int(record.id)) +
+                                               "." +
+                                               base::convert_to<std::string>(int(record.ver)));
+      std::ofstream dst(FSTREAM_PATH(fn), std::ofstream::binary);
+      dst.write(data.data(), data.size());
+    }
+  }
+  base::delete_file(packFn);
+
+  expect_same_backup_docs(doc.get(), read_test_backup().get());
+
+  delete_document_internals(doc.get());
+  doc->close();
+  delete_test_backup_dir();
+}
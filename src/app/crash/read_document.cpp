@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -48,6 +48,10 @@
 
 #include <fstream>
 #include <map>
+#include <memory>
+#include <sstream>
+#include <utility>
+#include <vector>
 
 namespace app { namespace crash {
 
@@ -67,6 +71,14 @@ bool check_magic_number(const std::string& fn)
 
 class Reader : public SubObjectsIO {
 public:
+  // Where a specific version of an object is saved
+  struct ObjLocation {
+    std::string prefix;
+    std::string file;  // Pack file or old "<prefix>-<id>.<version>" file
+    size_t offset = 0; // Offset of the MAGIC_NUMBER + object data in the pack file
+    size_t size = 0;   // Size of MAGIC_NUMBER + object data in the pack file (0 for old files)
+  };
+
   Reader(const std::string& dir, base::task_token* t)
     : m_serial(SerialFormat::Ver0)
     , m_sprite(nullptr)
@@ -99,19 +111,17 @@ public:
         continue;
       }
 
-      ObjVersions& versions = m_objVersions[id];
-      versions.add(ver);
-
-      if (fn.compare(0, 3, "doc") == 0) {
-        if (!m_docId)
-          m_docId = id;
-        else {
-          ASSERT(m_docId == id);
-        }
-
-        m_docVersions = &versions;
-      }
+      ObjLocation location;
+      location.prefix = fn.substr(0, i - 1);
+      location.file = base::join_path(m_dir, fn);
+      addObject(id, ver, std::move(location));
     }
+
+    // New sessions save all objects in a pack file (we read the
+    // temporary compacted file too in case that we crashed in the
+    // middle of the compaction)
+    readPackIndex(base::join_path(m_dir, kCompactPackFilename));
+    readPackIndex(base::join_path(m_dir, kPackFilename));
   }
 
   Doc* loadDocument()
@@ -130,9 +140,134 @@ public:
     return loadObject<Doc*>("doc", m_docId, &Reader::readDocument) == (Doc*)1;
   }
 
+  // Returns all saved versions of objects with the given prefix.
+  std::vector<const ObjLocation*> locationsWithPrefix(const char* prefix) const
+  {
+    std::vector<const ObjLocation*> result;
+    for (const auto& item : m_locations) {
+      if (item.second.prefix == prefix)
+        result.push_back(&item.second);
+    }
+    return result;
+  }
+
+  // Returns a stream to read the MAGIC_NUMBER + object data of the
+  // given location.
+  std::unique_ptr<std::istream> openObject(const ObjLocation& location) const
+  {
+    auto s = std::make_unique<std::ifstream>(FSTREAM_PATH(location.file), std::ifstream::binary);
+    if (!*s)
+      return nullptr;
+
+    if (location.size == 0)
+      return s;
+
+    // Objects in the pack file are read in memory so the stream
+    // ends with the object data (some readers check eof() to know
+    // if there are more fields available).
+    std::string data(location.size, 0);
+    s->seekg(location.offset);
+    if (!s->read(data.data(), data.size()))
+      return nullptr;
+    return std::make_unique<std::istringstream>(std::move(data));
+  }
+
 private:
   const ObjectVersion docId() const { return m_docId; }
 
+  void addObject(const ObjectId id, const ObjectVersion ver, ObjLocation&& location)
+  {
+    ObjVersions& versions = m_objVersions[id];
+    versions.add(ver);
+
+    if (location.prefix == "doc") {
+      if (!m_docId)
+        m_docId = id;
+      else {
+        ASSERT(m_docId == id);
+      }
+
+      m_docVersions = &versions;
+    }
+
+    m_locations[std::make_pair(id, ver)] = std::move(location);
+  }
+
+  // Adds all the objects that were completely saved in the given
+  // pack file (see internals.h for the format of the records).
+  void readPackIndex(const std::string& fn)
+  {
+    if (!base::is_file(fn))
+      return;
+
+    std::ifstream s(FSTREAM_PATH(fn), std::ifstream::binary);
+    const size_t fileSize = base::file_size(fn);
+    size_t pos = 0;
+    bool skipping = false;
+    while (s.is_open() && pos + 4 <= fileSize) {
+      ObjectId id;
+      ObjectVersion ver;
+      ObjLocation location;
+      size_t end;
+      if (readPackRecord(s, fn, pos, fileSize, id, ver, location, end)) {
+        addObject(id, ver, std::move(location));
+        skipping = false;
+        pos = end;
+        continue;
+      }
+
+      // The size of an invalid record cannot be used to jump to the
+      // next one (e.g. the record was partially written and other
+      // records were appended after it), so we look for the next
+      // valid record byte by byte.
+      if (!skipping) {
+        RECO_TRACE("RECO: Ignoring invalid record in %s at %d\n", fn.c_str(), int(pos));
+        skipping = true;
+      }
+      ++pos;
+    }
+  }
+
+  // Reads the header of the record at the given position of the pack
+  // file. Returns false if it's not a complete record.
+  bool readPackRecord(std::ifstream& s,
+                      const std::string& fn,
+                      const size_t pos,
+                      const size_t fileSize,
+                      ObjectId& id,
+                      ObjectVersion& ver,
+                      ObjLocation& location,
+                      size_t& end)
+  {
+    s.clear();
+    s.seekg(pos);
+    const size_t size = read32(s);
+    end = pos + 4 + size;
+    if (!s || size < 18 || end > fileSize)
+      return false; // Incomplete record (or zeros at the end of the file)
+
+    id = read32(s);
+    ver = read32(s);
+    std::string prefix = read_string(s);
+    const size_t dataPos = size_t(s.tellg());
+    if (!s || !id || !ver || prefix.empty() || dataPos + 8 > end)
+      return false;
+
+    // Both magic numbers are checked, the last one is used to know
+    // if the record was completely saved.
+    if (read32(s) != MAGIC_NUMBER)
+      return false;
+    s.seekg(end - 4);
+    if (read32(s) != MAGIC_NUMBER || !s)
+      return false;
+
+    location.prefix = std::move(prefix);
+    location.file = fn;
+    location.offset = dataPos;
+    location.size = end - 4 - dataPos;
+    return true;
+  }
+
   const ObjVersions* docVersions() const { return m_docVersions; }
 
   Sprite* loadSprite(ObjectId sprId)
@@ -159,7 +294,7 @@ private:
   }
 
   template<typename T>
-  T loadObject(const char* prefix, ObjectId id, T (Reader::*readMember)(std::ifstream&))
+  T loadObject(const char* prefix, ObjectId id, T (Reader::*readMember)(std::istream&))
   {
     const ObjVersions& versions = m_objVersions[id];
 
@@ -168,18 +303,16 @@ private:
       if (!ver)
         continue;
 
-      RECO_TRACE("RECO: Restoring %s #%d v%d\n", prefix, id, ver);
+      auto it = m_locations.find(std::make_pair(id, ver));
+      if (it == m_locations.end() || it->second.prefix != prefix)
+        continue;
 
-      std::string fn = prefix;
-      fn.push_back('-');
-      fn += base::convert_to<std::string>(id);
-      fn.push_back('.');
-      fn += base::convert_to<std::string>(ver);
+      RECO_TRACE("RECO: Restoring %s #%d v%d\n", prefix, id, ver);
 
-      std::ifstream s(FSTREAM_PATH(base::join_path(m_dir, fn)), std::ifstream::binary);
+      std::unique_ptr<std::istream> s = openObject(it->second);
       T obj = nullptr;
-      if (read32(s) == MAGIC_NUMBER)
-        obj = (this->*readMember)(s);
+      if (s && read32(*s) == MAGIC_NUMBER)
+        obj = (this->*readMember)(*s);
 
       if (obj) {
         RECO_TRACE("RECO: %s #%d v%d restored successfully\n", prefix, id, ver);
@@ -197,7 +330,7 @@ private:
     return nullptr;
   }
 
-  Doc* readDocument(std::ifstream& s)
+  Doc* readDocument(std::istream& s)
   {
     ObjectId sprId = read32(s);
     std::string filename = read_string(s);
@@ -226,7 +359,7 @@ private:
     }
   }
 
-  Sprite* readSprite(std::ifstream& s)
+  Sprite* readSprite(std::istream& s)
   {
     // Header
     ColorMode mode = (ColorMode)read8(s);
@@ -409,7 +542,7 @@ private:
     return spr.release();
   }
 
-  gfx::ColorSpaceRef readColorSpace(std::ifstream& s)
+  gfx::ColorSpaceRef readColorSpace(std::istream& s)
   {
     const gfx::ColorSpace::Type type = (gfx::ColorSpace::Type)read16(s);
     const gfx::ColorSpace::Flag flags = (gfx::ColorSpace::Flag)read16(s);
@@ -431,7 +564,7 @@ private:
     return colorSpace;
   }
 
-  gfx::Rect readGridBounds(std::ifstream& s)
+  gfx::Rect readGridBounds(std::istream& s)
   {
     gfx::Rect grid;
     grid.x = (int16_t)read16(s);
@@ -442,7 +575,7 @@ private:
   }
 
   // TODO could we use doc::read_layer() here?
-  Layer* readLayer(std::ifstream& s)
+  Layer* readLayer(std::istream& s)
   {
     LayerFlags flags = (LayerFlags)read32(s);
     ObjectType type = (ObjectType)read16(s);
@@ -504,15 +637,15 @@ private:
       return nullptr;
   }
 
-  Cel* readCel(std::ifstream& s) { return read_cel(s, this, false); }
+  Cel* readCel(std::istream& s) { return read_cel(s, this, false); }
 
-  CelData* readCelData(std::ifstream& s) { return read_celdata(s, this, false, m_serial); }
+  CelData* readCelData(std::istream& s) { return read_celdata(s, this, false, m_serial); }
 
-  Image* readImage(std::ifstream& s) { return read_image(s, false); }
+  Image* readImage(std::istream& s) { return read_image(s, false); }
 
-  Palette* readPalette(std::ifstream& s) { return read_palette(s); }
+  Palette* readPalette(std::istream& s) { return read_palette(s); }
 
-  Tileset* readTileset(std::ifstream& s)
+  Tileset* readTileset(std::istream& s)
   {
     TilesetSerialFormat tilesetVer = TilesetSerialFormat::Ver0;
     Tileset* tileset = read_tileset(s, m_sprite, false, &tilesetVer, m_serial);
@@ -521,9 +654,9 @@ private:
     return tileset;
   }
 
-  Tag* readTag(std::ifstream& s) { return read_tag(s, false, m_serial); }
+  Tag* readTag(std::istream& s) { return read_tag(s, false, m_serial); }
 
-  Slice* readSlice(std::ifstream& s) { return read_slice(s, false, m_serial); }
+  Slice* readSlice(std::istream& s) { return read_slice(s, false, m_serial); }
 
   // Fix issues that the restoration process could produce.
   void fixUndetectedDocumentIssues(Doc* doc)
@@ -579,6 +712,7 @@ private:
   std::string m_dir;
   ObjectVersion m_docId;
   ObjVersionsMap m_objVersions;
+  std::map<std::pair<ObjectId, ObjectVersion>, ObjLocation> m_locations;
   ObjVersions* m_docVersions;
   DocumentInfo* m_loadInfo;
   std::vector<std::pair<ObjectId, ObjectId>> m_celsToLoad;
@@ -626,21 +760,18 @@ Doc* read_document_with_raw_images(const std::string& dir, RawImagesAs as, base:
 
   int i = 0;
   frame_t frame = 0;
-  auto fns = base::list_files(dir);
-  for (const auto& fn : fns) {
+  const auto locations = reader.locationsWithPrefix("img");
+  for (const auto* location : locations) {
     if (t)
-      t->set_progress((i++) / fns.size());
-
-    if (fn.compare(0, 3, "img") != 0)
-      continue;
+      t->set_progress(float(i++) / locations.size());
 
-    std::ifstream s(FSTREAM_PATH(base::join_path(dir, fn)), std::ifstream::binary);
+    std::unique_ptr<std::istream> s = reader.openObject(*location);
     if (!s)
       continue;
 
     ImageRef img;
-    if (read32(s) == MAGIC_NUMBER)
-      img.reset(read_image(s, false));
+    if (read32(*s) == MAGIC_NUMBER)
+      img.reset(read_image(*s, false));
 
     if (img) {
       lay->addCel(new Cel(frame, img));
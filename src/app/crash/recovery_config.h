@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -8,13 +8,23 @@
 #define APP_CRASH_RECOVERY_CONFIG_H_INCLUDED
 #pragma once
 
+#include "doc/image_io.h"
+
 namespace app { namespace crash {
 
+// Default codec used to save images in the backups (faster codecs
+// reduce the time the document is locked by the backup thread). It
+// must match the defaults in data/pref.xml.
+constexpr doc::ImageCodec kDefaultImageCodec = doc::ImageCodec::Rle;
+constexpr int kDefaultImageCompressionLevel = 1;
+
 // Structure to store the configuration from Preferences instance to
 // avoid accessing to Preferences from a non-UI thread.
 struct RecoveryConfig {
   double dataRecoveryPeriod;
   int keepEditedSpriteDataFor;
+  doc::ImageCodec imageCodec = kDefaultImageCodec;
+  int imageCompressionLevel = kDefaultImageCompressionLevel;
 };
 
 }} // namespace app::crash
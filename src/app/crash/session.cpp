@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2024  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -21,6 +21,7 @@
 #include "app/doc_access.h"
 #include "app/file/file.h"
 #include "app/ui_context.h"
+#include "base/chrono.h"
 #include "base/convert_to.h"
 #include "base/fs.h"
 #include "base/fstream_path.h"
@@ -248,30 +249,41 @@ public:
 
 bool Session::saveDocumentChanges(Doc* doc)
 {
-  CustomWeakDocReader reader(doc);
-  if (!reader.isLocked())
-    return false;
-
-  app::Context ctx;
-  std::string dir = base::join_path(m_path, base::convert_to<std::string>(doc->id()));
-  RECO_TRACE("RECO: Saving document '%s'...\n", dir.c_str());
-
-  // Create directory for document
-  if (!base::is_directory(dir))
-    base::make_directory(dir);
-
-  // Create "open" file to indicate that the document is open in this session
+  const doc::ObjectId docId = doc->id();
+  DocSnapshotPtr snapshot;
   {
-    std::string openfile = base::join_path(dir, kOpenFilename);
-    if (!base::is_file(openfile)) {
-      std::ofstream of(FSTREAM_PATH(openfile));
-      if (of)
-        of << "open";
+    CustomWeakDocReader reader(doc);
+    if (!reader.isLocked())
+      return false;
+
+    app::Context ctx;
+    std::string dir = base::join_path(m_path, base::convert_to<std::string>(docId));
+    RECO_TRACE("RECO: Saving document '%s'...\n", dir.c_str());
+
+    // Create directory for document
+    if (!base::is_directory(dir))
+      base::make_directory(dir);
+
+    // Create "open" file to indicate that the document is open in this session
+    {
+      std::string openfile = base::join_path(dir, kOpenFilename);
+      if (!base::is_file(openfile)) {
+        std::ofstream of(FSTREAM_PATH(openfile));
+        if (of)
+          of << "open";
+      }
     }
+
+    // Copy the modified objects with the document locked
+    base::Chrono chrono;
+    snapshot = take_document_snapshot(dir, doc, &reader, m_config);
+    RECO_TRACE("RECO: Document '%d' was locked for %.16g seconds\n", docId, chrono.elapsed());
+    if (!snapshot)
+      return false;
   }
 
-  // Save document information
-  return write_document(dir, doc, &reader);
+  // Save document information (the document can be modified meanwhile)
+  return write_document_snapshot(*snapshot);
 }
 
 void Session::removeDocument(Doc* doc)
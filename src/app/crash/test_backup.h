@@ -0,0 +1,226 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_CRASH_TEST_BACKUP_H_INCLUDED
+#define APP_CRASH_TEST_BACKUP_H_INCLUDED
+#pragma once
+
+#include "app/crash/internals.h"
+#include "app/crash/read_document.h"
+#include "app/crash/recovery_config.h"
+#include "app/crash/write_document.h"
+#include "app/doc.h"
+#include "app/test_context.h"
+#include "base/fs.h"
+#include "base/fstream_path.h"
+#include "base/serialization.h"
+#include "base/task.h"
+#include "doc/cel.h"
+#include "doc/grid.h"
+#include "doc/image.h"
+#include "doc/image_ref.h"
+#include "doc/layer.h"
+#include "doc/layer_tilemap.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+#include "doc/string_io.h"
+#include "doc/tileset.h"
+#include "doc/tilesets.h"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace app { namespace crash {
+
+// Functions used in tests to save backups of a document and read
+// them back.
+
+const char* const kTestBackupDir = "_test_backup";
+
+inline void delete_test_backup_dir()
+{
+  if (!base::is_directory(kTestBackupDir))
+    return;
+  for (const auto& fn : base::list_files(kTestBackupDir, base::ItemType::Files))
+    base::delete_file(base::join_path(kTestBackupDir, fn));
+  base::remove_directory(kTestBackupDir);
+}
+
+// Creates a sprite with two layers, a tilemap layer, some frames,
+// and linked cels.
+inline std::unique_ptr<Doc> make_test_backup_doc(Context& ctx, const int w, const int h)
+{
+  using namespace doc;
+
+  std::unique_ptr<Doc> doc(ctx.documents().add(w, h));
+  doc->setFilename("_test_backup.ase");
+
+  Sprite* sprite = doc->sprite();
+  sprite->setTotalFrames(3);
+  sprite->setFrameDuration(1, 200);
+
+  LayerImage* layer1 = static_cast<LayerImage*>(sprite->root()->firstLayer());
+  layer1->setName("Background");
+  Image* image1 = layer1->cel(0)->image();
+  for (int y = 0; y < h; ++y)
+    for (int x = 0; x < w; ++x)
+      put_pixel(image1, x, y, rgba(x & 0xff, y & 0xff, (x / 4 + y) & 0xff, (x & 8 ? 255 : 0)));
+
+  LayerImage* layer2 = new LayerImage(sprite);
+  layer2->setName("Layer 2");
+  sprite->root()->addLayer(layer2);
+
+  ImageRef image2(Image::create(IMAGE_RGB, 8, 6));
+  clear_image(image2.get(), rgba(0, 255, 0, 255));
+  put_pixel(image2.get(), 3, 2, rgba(255, 255, 255, 128));
+  Cel* cel = new Cel(0, image2);
+  cel->setPosition(5, -2);
+  layer2->addCel(cel);
+  layer2->addCel(Cel::MakeLink(2, cel));
+
+  auto tileset = new Tileset(sprite, Grid(gfx::Size(8, 8)), 1);
+  for (int i = 1; i < 4; ++i) {
+    ImageRef tile(tileset->makeEmptyTile());
+    fill_rect(tile.get(), i, 0, 7, 2 * i, rgba(64 * i, 0, 255 - 32 * i, 255));
+    tileset->add(tile);
+  }
+  sprite->tilesets()->add(tileset);
+
+  LayerTilemap* layer3 = new LayerTilemap(sprite, 0);
+  layer3->setName("Tilemap");
+  sprite->root()->addLayer(layer3);
+
+  ImageRef tilemap(Image::create(IMAGE_TILEMAP, 3, 2));
+  for (int i = 0; i < 6; ++i)
+    put_pixel(tilemap.get(), i % 3, i / 3, i % 4);
+  layer3->addCel(new Cel(1, tilemap));
+  return doc;
+}
+
+inline void expect_same_backup_docs(Doc* expected, Doc* doc)
+{
+  using namespace doc;
+
+  ASSERT_TRUE(doc != nullptr);
+  EXPECT_EQ(expected->filename(), doc->filename());
+
+  const Sprite* a = expected->sprite();
+  const Sprite* b = doc->sprite();
+  ASSERT_EQ(a->colorMode(), b->colorMode());
+  ASSERT_EQ(a->size(), b->size());
+  ASSERT_EQ(a->totalFrames(), b->totalFrames());
+  for (frame_t fr = 0; fr < a->totalFrames(); ++fr)
+    EXPECT_EQ(a->frameDuration(fr), b->frameDuration(fr));
+
+  ASSERT_EQ(a->hasTilesets(), b->hasTilesets());
+  if (a->hasTilesets()) {
+    ASSERT_EQ(a->tilesets()->size(), b->tilesets()->size());
+    for (tileset_index tsi = 0; tsi < a->tilesets()->size(); ++tsi) {
+      const Tileset* tsA = a->tilesets()->get(tsi);
+      const Tileset* tsB = b->tilesets()->get(tsi);
+      ASSERT_EQ(tsA->size(), tsB->size());
+      for (tile_index ti = 0; ti < tsA->size(); ++ti)
+        EXPECT_TRUE(is_same_image(tsA->get(ti).get(), tsB->get(ti).get())) << "tile " << ti;
+    }
+  }
+
+  const LayerList layersA = a->allLayers();
+  const LayerList layersB = b->allLayers();
+  ASSERT_EQ(layersA.size(), layersB.size());
+  for (size_t i = 0; i < layersA.size(); ++i) {
+    EXPECT_EQ(layersA[i]->name(), layersB[i]->name());
+    for (frame_t fr = 0; fr < a->totalFrames(); ++fr) {
+      const Cel* celA = layersA[i]->cel(fr);
+      const Cel* celB = layersB[i]->cel(fr);
+      ASSERT_EQ(celA == nullptr, celB == nullptr) << "layer " << i << " frame " << fr;
+      if (!celA)
+        continue;
+
+      EXPECT_EQ(celA->position(), celB->position());
+      EXPECT_EQ(celA->link() == nullptr, celB->link() == nullptr);
+      EXPECT_TRUE(is_same_image(celA->image(), celB->image()))
+        << "layer " << i << " frame " << fr;
+    }
+  }
+}
+
+// Saves the modified objects of the document in the pack file of
+// the backup directory.
+inline void write_test_backup(Doc* doc, const RecoveryConfig* config)
+{
+  if (!base::is_directory(kTestBackupDir))
+    base::make_directory(kTestBackupDir);
+
+  DocSnapshotPtr snapshot = take_document_snapshot(kTestBackupDir, doc, nullptr, config);
+  ASSERT_TRUE(snapshot != nullptr);
+  ASSERT_TRUE(write_document_snapshot(*snapshot));
+}
+
+inline std::unique_ptr<Doc> read_test_backup()
+{
+  base::task_token token;
+  return std::unique_ptr<Doc>(read_document(kTestBackupDir, &token));
+}
+
+// Record of a pack file (see internals.h).
+struct TestPackRecord {
+  size_t offset = 0;     // Position of the record size
+  size_t size = 0;       // Size of the whole record
+  size_t dataOffset = 0; // Position of the first MAGIC_NUMBER
+  doc::ObjectId id = 0;
+  doc::ObjectVersion ver = 0;
+  std::string prefix;
+};
+
+inline std::vector<TestPackRecord> read_test_pack_records(const std::string& fn)
+{
+  using namespace base::serialization::little_endian;
+
+  std::vector<TestPackRecord> records;
+  std::ifstream s(FSTREAM_PATH(fn), std::ifstream::binary);
+  const size_t fileSize = base::file_size(fn);
+  size_t pos = 0;
+  while (s && pos + 4 <= fileSize) {
+    TestPackRecord record;
+    record.offset = pos;
+    record.size = 4 + read32(s);
+    record.id = read32(s);
+    record.ver = read32(s);
+    record.prefix = doc::read_string(s);
+    record.dataOffset = size_t(s.tellg());
+    if (!s || pos + record.size > fileSize)
+      break;
+
+    records.push_back(record);
+    pos += record.size;
+    s.seekg(pos);
+  }
+  return records;
+}
+
+// Saves the document in a new backup and checks that the restored
+// document is the same.
+inline void check_backup_round_trip(const RecoveryConfig* config)
+{
+  delete_test_backup_dir();
+
+  TestContext ctx;
+  std::unique_ptr<Doc> doc = make_test_backup_doc(ctx, 40, 30);
+  write_test_backup(doc.get(), config);
+  expect_same_backup_docs(doc.get(), read_test_backup().get());
+
+  delete_document_internals(doc.get());
+  doc->close();
+  delete_test_backup_dir();
+}
+
+}} // namespace app::crash
+
+#endif
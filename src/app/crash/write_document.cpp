@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -13,8 +13,9 @@
 
 #include "app/crash/internals.h"
 #include "app/crash/log.h"
+#include "app/crash/recovery_config.h"
 #include "app/doc.h"
-#include "base/convert_to.h"
+#include "base/file_handle.h"
 #include "base/fs.h"
 #include "base/fstream_path.h"
 #include "base/serialization.h"
@@ -26,6 +27,7 @@
 #include "doc/cels_range.h"
 #include "doc/frame.h"
 #include "doc/image_io.h"
+#include "doc/image_ref.h"
 #include "doc/layer.h"
 #include "doc/layer_tilemap.h"
 #include "doc/palette.h"
@@ -43,8 +45,21 @@
 #include "doc/user_data_io.h"
 #include "fixmath/fixmath.h"
 
+#include <algorithm>
 #include <fstream>
 #include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+  #include <io.h>
+#else
+  #include <unistd.h>
+#endif
 
 namespace app { namespace crash {
 
@@ -52,23 +67,90 @@ using namespace base::serialization;
 using namespace base::serialization::little_endian;
 using namespace doc;
 
+// Objects of a document that must be saved in the next backup.
+struct DocSnapshot {
+  struct Object {
+    std::string prefix;
+    ObjectId id = 0;
+    ObjectVersion version = 0;
+    std::string data; // Serialized object
+    // Copies of images (e.g. a cel image or the tiles of a tileset),
+    // they are serialized when the document is unlocked and inserted
+    // in "data" at "imagesOffset"
+    std::vector<ImageRef> images;
+    size_t imagesOffset = 0;
+  };
+
+  std::string dir;
+  ObjectId docId = 0;
+  ImageCodec imageCodec = kDefaultImageCodec;
+  int imageCompressionLevel = kDefaultImageCompressionLevel;
+  // Objects in the same order they must be saved (children first)
+  std::vector<Object> objects;
+  // All objects of the document (modified or not)
+  std::set<ObjectId> liveObjects;
+};
+
 namespace {
 
+// Compact the pack file only if it's bigger than this size and
+// most of its content are old versions of objects.
+const size_t kMinPackSizeToCompact = 4 * 1024 * 1024;
+
+// Location of each object version in the pack file of a document.
+struct PackIndex {
+  struct Record {
+    size_t offset = 0;
+    size_t size = 0;
+  };
+  std::map<std::pair<ObjectId, ObjectVersion>, Record> records;
+  size_t fileSize = 0;
+  // True if a record couldn't be completely written and the file
+  // couldn't be truncated (so it must be compacted to skip the broken
+  // record before appending new records).
+  bool broken = false;
+};
+
 static std::map<ObjectId, ObjVersionsMap> g_docVersions;
-static std::map<ObjectId, base::paths> g_deleteFiles;
+static std::map<ObjectId, PackIndex> g_docPacks;
+
+// Makes sure that the data written in the file is on the disk.
+void sync_file(FILE* f)
+{
+  fflush(f);
+#ifdef _WIN32
+  _commit(_fileno(f));
+#else
+  fsync(fileno(f));
+#endif
+}
+
+// Truncates the file to the given size.
+bool truncate_file(const std::string& fn, const size_t size)
+{
+  base::FileHandle f = base::open_file(fn, "r+b");
+  if (!f)
+    return false;
+#ifdef _WIN32
+  return (_chsize_s(_fileno(f.get()), size) == 0);
+#else
+  return (ftruncate(fileno(f.get()), off_t(size)) == 0);
+#endif
+}
 
 class Writer {
 public:
-  Writer(const std::string& dir, Doc* doc, doc::CancelIO* cancel)
-    : m_dir(dir)
+  // The doc and cancel are needed only to take the snapshot.
+  Writer(DocSnapshot& snapshot, Doc* doc, doc::CancelIO* cancel)
+    : m_snapshot(snapshot)
     , m_doc(doc)
-    , m_objVersions(g_docVersions[doc->id()])
-    , m_deleteFiles(g_deleteFiles[doc->id()])
+    , m_objVersions(g_docVersions[snapshot.docId])
+    , m_pack(g_docPacks[snapshot.docId])
     , m_cancel(cancel)
   {
   }
 
-  bool saveDocument()
+  bool takeSnapshot()
   {
     Sprite* spr = m_doc->sprite();
 
@@ -139,15 +221,47 @@ public:
     if (!saveObject("doc", m_doc, &Writer::writeDocumentFile))
       return false;
 
-    // Delete old files after all files are correctly saved.
-    deleteOldVersions();
+    return true;
+  }
+
+  bool saveSnapshot()
+  {
+    for (DocSnapshot::Object& obj : m_snapshot.objects) {
+      if (!obj.images.empty()) {
+        std::ostringstream data;
+        data.write(obj.data.data(), obj.imagesOffset);
+        for (const ImageRef& image : obj.images) {
+          if (!writeImage(data, image.get()))
+            return false;
+        }
+        data.write(obj.data.data() + obj.imagesOffset, obj.data.size() - obj.imagesOffset);
+        obj.data = data.str();
+        obj.images.clear();
+      }
+
+      if (!appendRecord(obj))
+        return false;
+
+      // Rotate versions and add the latest one
+      m_objVersions[obj.id].rotateRevisions(obj.version);
+
+      RECO_TRACE(" - Saved %s #%d v%d\n", obj.prefix.c_str(), obj.id, obj.version);
+    }
+
+    // Just one sync for all the objects saved in this backup
+    if (m_packFile) {
+      sync_file(m_packFile.get());
+      m_packFile.reset();
+    }
+
+    compactPackIfNeeded();
     return true;
   }
 
 private:
   bool isCanceled() const { return (m_cancel && m_cancel->isCanceled()); }
 
-  bool writeDocumentFile(std::ofstream& s, Doc* doc)
+  bool writeDocumentFile(std::ostream& s, Doc* doc)
   {
     write32(s, doc->sprite()->id());
     write_string(s, doc->filename());
@@ -155,7 +269,7 @@ private:
     return true;
   }
 
-  bool writeSprite(std::ofstream& s, Sprite* spr)
+  bool writeSprite(std::ostream& s, Sprite* spr)
   {
     // Header
     write8(s, int(spr->colorMode()));
@@ -210,7 +324,7 @@ private:
     return true;
   }
 
-  bool writeGridBounds(std::ofstream& s, const gfx::Rect& grid)
+  bool writeGridBounds(std::ostream& s, const gfx::Rect& grid)
   {
     write16(s, (int16_t)grid.x);
     write16(s, (int16_t)grid.y);
@@ -219,7 +333,7 @@ private:
     return true;
   }
 
-  bool writeColorSpace(std::ofstream& s, const gfx::ColorSpaceRef& colorSpace)
+  bool writeColorSpace(std::ostream& s, const gfx::ColorSpaceRef& colorSpace)
   {
     write16(s, colorSpace->type());
     write16(s, colorSpace->flags());
@@ -234,7 +348,7 @@ private:
     return true;
   }
 
-  void writeAllLayersID(std::ofstream& s, ObjectId parentId, const LayerGroup* group)
+  void writeAllLayersID(std::ostream& s, ObjectId parentId, const LayerGroup* group)
   {
     for (const Layer* lay : group->layers()) {
       write32(s, lay->id());
@@ -245,7 +359,7 @@ private:
     }
   }
 
-  bool writeLayerStructure(std::ofstream& s, Layer* lay)
+  bool writeLayerStructure(std::ostream& s, Layer* lay)
   {
     write32(s, static_cast<int>(lay->flags())); // Flags
     write16(s, static_cast<int>(lay->type()));  // Type
@@ -285,46 +399,52 @@ private:
     return true;
   }
 
-  bool writeCel(std::ofstream& s, Cel* cel)
+  bool writeCel(std::ostream& s, Cel* cel)
   {
     write_cel(s, cel);
     return true;
   }
 
-  bool writeCelData(std::ofstream& s, CelData* celdata)
+  bool writeCelData(std::ostream& s, CelData* celdata)
   {
     write_celdata(s, celdata);
     return true;
   }
 
-  bool writeImage(std::ofstream& s, Image* img) { return write_image(s, img, m_cancel); }
+  bool writeImage(std::ostream& s, Image* img)
+  {
+    return write_image(s, img, m_cancel, m_snapshot.imageCodec, m_snapshot.imageCompressionLevel);
+  }
 
-  bool writePalette(std::ofstream& s, Palette* pal)
+  bool writePalette(std::ostream& s, Palette* pal)
   {
     write_palette(s, pal);
     return true;
   }
 
-  bool writeTileset(std::ofstream& s, Tileset* tileset)
+  bool writeTileset(std::ostream& s, Tileset* tileset)
   {
-    write_tileset(s, tileset);
-    return true;
+    return write_tileset(s,
+                         tileset,
+                         m_cancel,
+                         m_snapshot.imageCodec,
+                         m_snapshot.imageCompressionLevel);
   }
 
-  bool writeFrameTag(std::ofstream& s, Tag* frameTag)
+  bool writeFrameTag(std::ostream& s, Tag* frameTag)
   {
     write_tag(s, frameTag);
     return true;
   }
 
-  bool writeSlice(std::ofstream& s, Slice* slice)
+  bool writeSlice(std::ostream& s, Slice* slice)
   {
     write_slice(s, slice);
     return true;
   }
 
   template<typename T>
-  bool saveObject(const char* prefix, T* obj, bool (Writer::*writeMember)(std::ofstream&, T*))
+  bool saveObject(const char* prefix, T* obj, bool (Writer::*writeMember)(std::ostream&, T*))
   {
     if (isCanceled())
       return false;
@@ -332,62 +452,206 @@ private:
     if (!obj->version())
       obj->incrementVersion();
 
+    m_snapshot.liveObjects.insert(obj->id());
+
     ObjVersions& versions = m_objVersions[obj->id()];
     if (versions.newer() == obj->version())
       return true;
 
-    std::string fn = prefix;
-    fn.push_back('-');
-    fn += base::convert_to<std::string>(obj->id());
+    DocSnapshot::Object snapshotObj;
+    snapshotObj.prefix = prefix;
+    snapshotObj.id = obj->id();
+    snapshotObj.version = obj->version();
 
-    std::string fullfn = base::join_path(m_dir, fn);
-    std::string oldfn = fullfn + "." + base::convert_to<std::string>(versions.older());
-    fullfn += "." + base::convert_to<std::string>(obj->version());
+    if constexpr (std::is_same_v<T, Image>) {
+      // Just copy the pixels, encoding the image takes more time and
+      // it's done when the document is unlocked
+      snapshotObj.images.emplace_back(Image::createCopy(obj));
+    }
+    else if constexpr (std::is_same_v<T, Tileset>) {
+      // Same for the tiles, the rest of the tileset is serialized now
+      std::ostringstream data;
+      write_tileset_header(data, obj);
+      snapshotObj.imagesOffset = size_t(data.tellp());
+      snapshotObj.images.reserve(obj->size());
+      for (tile_index ti = 0; ti < obj->size(); ++ti)
+        snapshotObj.images.emplace_back(Image::createCopy(obj->get(ti).get()));
+      if (!write_tileset_footer(data, obj, m_cancel))
+        return false;
+      snapshotObj.data = data.str();
+    }
+    else {
+      std::ostringstream data;
+      if (!(this->*writeMember)(data, obj)) // Write the object
+        return false;
+      snapshotObj.data = data.str();
+    }
 
-    std::ofstream s(FSTREAM_PATH(fullfn), std::ofstream::binary);
-    write32(s, 0);                     // Leave a room for the magic number
-    if (!(this->*writeMember)(s, obj)) // Write the object
-      return false;
+    m_snapshot.objects.push_back(std::move(snapshotObj));
+    return true;
+  }
 
-    // Flush all data. In this way we ensure that the magic number is
-    // the last thing being written in the file.
-    s.flush();
+  // Appends the object at the end of the pack file.
+  bool appendRecord(const DocSnapshot::Object& obj)
+  {
+    // Create the whole record in memory to append it with just one
+    // fwrite() call.
+    std::ostringstream record;
+    write32(record, 0); // Leave a room for the record size
+    write32(record, obj.id);
+    write32(record, obj.version);
+    write_string(record, obj.prefix);
+    write32(record, MAGIC_NUMBER);
+    record.write(obj.data.data(), obj.data.size());
+    write32(record, MAGIC_NUMBER);
+
+    std::string buf = record.str();
+    const size_t size = buf.size() - 4;
+    buf[0] = char(size & 0xff);
+    buf[1] = char((size >> 8) & 0xff);
+    buf[2] = char((size >> 16) & 0xff);
+    buf[3] = char((size >> 24) & 0xff);
+
+    const std::string fn = base::join_path(m_snapshot.dir, kPackFilename);
+    if (!m_packFile) {
+      // Don't append records after a broken one
+      if (m_pack.broken) {
+        compactPackIfNeeded();
+        if (m_pack.broken)
+          return false;
+      }
 
-    // Write the magic number
-    s.seekp(0);
-    write32(s, MAGIC_NUMBER);
+      m_packFile = base::open_file(fn, "ab");
+      if (!m_packFile)
+        return false;
 
-    // Remove the older version
-    if (versions.older() && base::is_file(oldfn))
-      m_deleteFiles.push_back(oldfn);
+      // The pack file might contain records that we don't know (e.g.
+      // from a previous incomplete backup).
+      m_pack.fileSize = base::file_size(fn);
+    }
 
-    // Rotate versions and add the latest one
-    versions.rotateRevisions(obj->version());
+    if (fwrite(buf.data(), 1, buf.size(), m_packFile.get()) != buf.size()) {
+      // Remove the incomplete record (the file is closed first so
+      // its buffered data is not written after the truncation).
+      m_packFile.reset();
+      if (!truncate_file(fn, m_pack.fileSize)) {
+        m_pack.broken = true;
+        compactPackIfNeeded();
+      }
+      return false;
+    }
 
-    RECO_TRACE(" - Saved %s #%d v%d\n", prefix, obj->id(), obj->version());
+    m_pack.records[std::make_pair(obj.id, obj.version)] = { m_pack.fileSize, buf.size() };
+    m_pack.fileSize += buf.size();
     return true;
   }
 
-  void deleteOldVersions()
+  // Rewrites the pack file with the latest versions of the existent
+  // objects when the old versions take most of the space.
+  void compactPackIfNeeded()
   {
-    while (!m_deleteFiles.empty() && !isCanceled()) {
-      std::string file = m_deleteFiles.back();
-      m_deleteFiles.erase(m_deleteFiles.end() - 1);
+    using Item = std::pair<std::pair<ObjectId, ObjectVersion>, PackIndex::Record>;
+
+    size_t liveSize = 0;
+    std::vector<Item> liveRecords;
+    for (const auto& item : m_pack.records) {
+      if (isLiveRecord(item.first.first, item.first.second)) {
+        liveSize += item.second.size;
+        liveRecords.push_back(item);
+      }
+    }
+
+    if (!m_pack.broken &&
+        (m_pack.fileSize < kMinPackSizeToCompact || m_pack.fileSize < 2 * liveSize)) {
+      return;
+    }
 
-      try {
-        RECO_TRACE(" - Deleting <%s>\n", file.c_str());
-        base::delete_file(file);
+    RECO_TRACE(" - Compacting pack file (%d of %d bytes are used)\n",
+               int(liveSize),
+               int(m_pack.fileSize));
+
+    const std::string fn = base::join_path(m_snapshot.dir, kPackFilename);
+    const std::string newFn = base::join_path(m_snapshot.dir, kCompactPackFilename);
+
+    // Copy the records in the same order they were saved
+    std::sort(liveRecords.begin(), liveRecords.end(), [](const Item& a, const Item& b) {
+      return a.second.offset < b.second.offset;
+    });
+
+    PackIndex newPack;
+    {
+      std::ifstream src(FSTREAM_PATH(fn), std::ifstream::binary);
+      base::FileHandle dst = base::open_file(newFn, "wb");
+      if (!src || !dst)
+        return;
+
+      std::vector<char> buf;
+      for (const Item& item : liveRecords) {
+        if (isCanceled())
+          return;
+
+        buf.resize(item.second.size);
+        src.seekg(item.second.offset);
+        if (!src.read(buf.data(), buf.size()) ||
+            fwrite(buf.data(), 1, buf.size(), dst.get()) != buf.size()) {
+          return;
+        }
+
+        newPack.records[item.first] = { newPack.fileSize, item.second.size };
+        newPack.fileSize += item.second.size;
       }
-      catch (const std::exception&) {
-        RECO_TRACE(" - Cannot delete <%s>\n", file.c_str());
+      sync_file(dst.get());
+    }
+
+    try {
+      base::delete_file(fn);
+      base::move_file(newFn, fn);
+    }
+    catch (const std::exception&) {
+      RECO_TRACE(" - Cannot replace <%s>\n", fn.c_str());
+
+      // If the old pack file was deleted, all objects will be saved
+      // again in a new pack file (meanwhile the compacted file can be
+      // used to restore the document).
+      if (!base::is_file(fn)) {
+        m_pack = PackIndex();
+        m_objVersions.clear();
       }
+      return;
     }
+
+    // Forget the versions of deleted objects (so they are saved again
+    // if they come back, e.g. undoing the deletion)
+    for (auto it = m_objVersions.begin(); it != m_objVersions.end();) {
+      if (m_snapshot.liveObjects.find(it->first) == m_snapshot.liveObjects.end())
+        it = m_objVersions.erase(it);
+      else
+        ++it;
+    }
+    m_pack = std::move(newPack);
   }
 
-  std::string m_dir;
+  // Returns true if the given version of the object is still needed
+  // to restore the document (it's one of the last versions of an
+  // object of the document).
+  bool isLiveRecord(const ObjectId id, const ObjectVersion ver)
+  {
+    if (m_snapshot.liveObjects.find(id) == m_snapshot.liveObjects.end())
+      return false;
+
+    const ObjVersions& versions = m_objVersions[id];
+    for (size_t i = 0; i < versions.size(); ++i) {
+      if (versions[i] == ver)
+        return true;
+    }
+    return false;
+  }
+
+  DocSnapshot& m_snapshot;
   Doc* m_doc;
   ObjVersionsMap& m_objVersions;
-  base::paths& m_deleteFiles;
+  PackIndex& m_pack;
+  base::FileHandle m_packFile;
   doc::CancelIO* m_cancel;
 };
 
@@ -396,10 +660,29 @@ private:
 //////////////////////////////////////////////////////////////////////
 // Public API
 
-bool write_document(const std::string& dir, Doc* doc, doc::CancelIO* cancel)
+DocSnapshotPtr take_document_snapshot(const std::string& dir,
+                                      Doc* doc,
+                                      doc::CancelIO* cancel,
+                                      const RecoveryConfig* config)
+{
+  auto snapshot = std::make_shared<DocSnapshot>();
+  snapshot->dir = dir;
+  snapshot->docId = doc->id();
+  if (config) {
+    snapshot->imageCodec = config->imageCodec;
+    snapshot->imageCompressionLevel = config->imageCompressionLevel;
+  }
+
+  Writer writer(*snapshot, doc, cancel);
+  if (!writer.takeSnapshot())
+    return nullptr;
+  return snapshot;
+}
+
+bool write_document_snapshot(DocSnapshot& snapshot)
 {
-  Writer writer(dir, doc, cancel);
-  return writer.saveDocument();
+  Writer writer(snapshot, nullptr, nullptr);
+  return writer.saveSnapshot();
 }
 
 void delete_document_internals(Doc* doc)
@@ -414,9 +697,9 @@ void delete_document_internals(Doc* doc)
       g_docVersions.erase(it);
   }
   {
-    auto it = g_deleteFiles.find(doc->id());
-    if (it != g_deleteFiles.end())
-      g_deleteFiles.erase(it);
+    auto it = g_docPacks.find(doc->id());
+    if (it != g_docPacks.end())
+      g_docPacks.erase(it);
   }
 }
 
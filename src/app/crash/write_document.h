@@ -1,4 +1,5 @@
 // Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This program is distributed under the terms of
@@ -8,6 +9,7 @@
 #define APP_CRASH_WRITE_DOCUMENT_H_INCLUDED
 #pragma once
 
+#include <memory>
 #include <string>
 
 namespace doc {
@@ -18,8 +20,24 @@ namespace app {
 class Doc;
 
 namespace crash {
+struct RecoveryConfig;
+
+struct DocSnapshot;
+using DocSnapshotPtr = std::shared_ptr<DocSnapshot>;
+
+// Copies the objects of the document that were modified since the
+// last backup. It must be called with the document locked, but it
+// takes less time than write_document_snapshot() as images are just
+// copied (not encoded). Returns nullptr if it's canceled.
+DocSnapshotPtr take_document_snapshot(const std::string& dir,
+                                      Doc* doc,
+                                      doc::CancelIO* cancel,
+                                      const RecoveryConfig* config);
+
+// Saves the snapshot in its backup directory. The document doesn't
+// need to be locked.
+bool write_document_snapshot(DocSnapshot& snapshot);
 
-bool write_document(const std::string& dir, Doc* doc, doc::CancelIO* cancel);
 void delete_document_internals(Doc* doc);
 
 } // namespace crash
@@ -0,0 +1,67 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "app/crash/test_backup.h"
+
+using namespace app;
+using namespace app::crash;
+using namespace doc;
+
+TEST(WriteDocument, DefaultImageCodec)
+{
+  RecoveryConfig config;
+  EXPECT_EQ(kDefaultImageCodec, config.imageCodec);
+  EXPECT_EQ(kDefaultImageCompressionLevel, config.imageCompressionLevel);
+
+  // Without a config, the snapshot uses the same defaults
+  check_backup_round_trip(nullptr);
+}
+
+TEST(WriteDocument, RoundTripAllCodecs)
+{
+  for (const ImageCodec codec : { ImageCodec::Raw, ImageCodec::Rle, ImageCodec::Zlib }) {
+    for (const int level : { -1, 1, 9 }) {
+      RecoveryConfig config;
+      config.imageCodec = codec;
+      config.imageCompressionLevel = level;
+      check_backup_round_trip(&config);
+    }
+  }
+}
+
+TEST(WriteDocument, SnapshotCopiesImages)
+{
+  delete_test_backup_dir();
+  base::make_directory(kTestBackupDir);
+
+  TestContext ctx;
+  std::unique_ptr<Doc> doc = make_test_backup_doc(ctx, 16, 16);
+  Image* image = doc->sprite()->root()->firstLayer()->cel(0)->image();
+  Tileset* tileset = doc->sprite()->tilesets()->get(0);
+  ImageRef tile = tileset->get(2);
+  ImageRef oldImage(Image::createCopy(image));
+  ImageRef oldTile(Image::createCopy(tile.get()));
+
+  // Images modified after taking the snapshot (i.e. when the
+  // document is unlocked) must not be included in the backup
+  DocSnapshotPtr snapshot = take_document_snapshot(kTestBackupDir, doc.get(), nullptr, nullptr);
+  ASSERT_TRUE(snapshot != nullptr);
+  clear_image(image, rgba(255, 0, 0, 255));
+  clear_image(tile.get(), rgba(0, 0, 255, 255));
+  ASSERT_TRUE(write_document_snapshot(*snapshot));
+
+  std::unique_ptr<Doc> restored = read_test_backup();
+  ASSERT_TRUE(restored != nullptr);
+  EXPECT_TRUE(is_same_image(oldImage.get(),
+                            restored->sprite()->root()->firstLayer()->cel(0)->image()));
+  EXPECT_TRUE(is_same_image(oldTile.get(), restored->sprite()->tilesets()->get(0)->get(2).get()));
+
+  delete_document_internals(doc.get());
+  doc->close();
+  delete_test_backup_dir();
+}
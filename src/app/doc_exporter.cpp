@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -20,6 +20,7 @@
 #include "app/filename_formatter.h"
 #include "app/restore_visible_layers.h"
 #include "app/snap_to_grid.h"
+#include "app/task_scheduler.h"
 #include "app/util/autocrop.h"
 #include "base/convert_to.h"
 #include "base/fs.h"
@@ -29,7 +30,6 @@
 #include "doc/algorithm/shrink_bounds.h"
 #include "doc/cel.h"
 #include "doc/image.h"
-#include "doc/images_map.h"
 #include "doc/layer.h"
 #include "doc/palette.h"
 #include "doc/primitives.h"
@@ -48,11 +48,13 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <deque>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <memory>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 #define DX_TRACE(...) // TRACEARGS
@@ -83,6 +85,34 @@ std::ostream& operator<<(std::ostream& os, const doc::UserData& data)
   return os;
 }
 
+// Maximum number of samples rendered in parallel at the same time.
+const int kMaxBatchSamples = 64;
+
+// Maximum memory used by the renders of a batch of samples.
+const std::size_t kMaxBatchBytes = 64 * 1024 * 1024;
+
+// Maximum memory used by the renders of unique samples that we keep
+// from the duplicates detection to copy them to the texture.
+const std::size_t kMaxKeptRendersBytes = 256 * 1024 * 1024;
+
+// Calls func(k) for each k in [0, n) in the TaskScheduler workers
+// (or in the current thread if "parallel" is false) and waits all of
+// them.
+template<typename Func>
+void for_each_sample(const bool parallel, const int n, Func func)
+{
+  if (!parallel || n <= 1) {
+    for (int k = 0; k < n; ++k)
+      func(k);
+  }
+  else {
+    TaskGroup tasks(TaskPriority::Interactive);
+    for (int k = 0; k < n; ++k)
+      tasks.execute([&func, k] { func(k); });
+    tasks.wait();
+  }
+}
+
 } // anonymous namespace
 
 namespace app {
@@ -229,7 +259,23 @@ public:
   void setLinked() { m_isLinked = true; }
   void setDuplicated() { m_isDuplicated = true; }
 
-  ImageRef createRender(ImageBufferPtr& imageBuf)
+  // Render of the sample kept from the duplicates detection, so we
+  // can copy it to the texture instead of rendering it again.
+  const ImageRef& render() const { return m_render; }
+  void setRender(const ImageRef& render) { m_render = render; }
+
+  // Shows the selected layers of this sample (the visibility of the
+  // layers is restored when "layersVisibility" is destroyed).
+  void showSelectedLayers(RestoreVisibleLayers& layersVisibility) const
+  {
+    if (m_selLayers)
+      layersVisibility.showSelectedLayers(m_sprite, *m_selLayers);
+  }
+
+  // If "showLayers" is false, the selected layers must be already
+  // visible (see showSelectedLayers()). This is used to render
+  // several samples of the same sprite/layers from different threads.
+  ImageRef createRender(ImageBufferPtr& imageBuf, const bool showLayers = true)
   {
     ASSERT(m_sprite);
 
@@ -242,15 +288,28 @@ public:
       Image::create(m_sprite->pixelFormat(), m_trimmedBounds.w, m_trimmedBounds.h, imageBuf));
     render->setMaskColor(m_sprite->transparentColor());
     clear_image(render.get(), m_sprite->transparentColor());
-    renderSample(render.get(), 0, 0, false);
+    renderSample(render.get(), 0, 0, false, showLayers);
     return render;
   }
 
-  void renderSample(doc::Image* dst, int x, int y, bool extrude) const
+  void renderSample(doc::Image* dst,
+                    int x,
+                    int y,
+                    bool extrude,
+                    const bool showLayers = true) const
   {
     RestoreVisibleLayers layersVisibility;
-    if (m_selLayers)
-      layersVisibility.showSelectedLayers(m_sprite, *m_selLayers);
+    if (showLayers)
+      showSelectedLayers(layersVisibility);
+
+    // Copy the pixels from the existent render (its origin is the
+    // origin of the trimmed bounds)
+    const Image* src = m_image.get();
+    gfx::Point srcOrigin(0, 0);
+    if (!src && m_render && m_render->pixelFormat() == dst->pixelFormat()) {
+      src = m_render.get();
+      srcOrigin = m_trimmedBounds.origin();
+    }
 
     render::Render render;
 
@@ -280,8 +339,9 @@ public:
       for (int j = 0; j < 3; ++j) {
         for (int i = 0; i < 3; ++i) {
           gfx::Clip clip(x + dx[i], y + dy[j], gfx::RectT<int>(srcx[i], srcy[j], szx[i], szy[j]));
-          if (m_image) {
-            dst->copy(m_image.get(), clip);
+          if (src) {
+            clip.src -= srcOrigin;
+            dst->copy(src, clip);
           }
           else {
             render.renderSprite(dst, m_sprite, m_frame, clip);
@@ -291,8 +351,9 @@ public:
     }
     else {
       gfx::Clip clip(x, y, m_trimmedBounds);
-      if (m_image) {
-        dst->copy(m_image.get(), clip);
+      if (src) {
+        clip.src -= srcOrigin;
+        dst->copy(src, clip);
       }
       else {
         render.renderSprite(dst, m_sprite, m_frame, clip);
@@ -317,6 +378,7 @@ private:
   gfx::Size m_originalSize;
   gfx::Rect m_trimmedBounds;
   SharedRectPtr m_inTextureBounds;
+  ImageRef m_render;
 };
 
 class DocExporter::Samples {
@@ -330,6 +392,7 @@ public:
 
   void addSample(const Sample& sample) { m_samples.push_back(sample); }
 
+  Sample& operator[](const size_t i) { return m_samples[i]; }
   const Sample& operator[](const size_t i) const { return m_samples[i]; }
 
   iterator begin() { return m_samples.begin(); }
@@ -344,12 +407,118 @@ private:
 class DocExporter::LayoutSamples {
 public:
   virtual ~LayoutSamples() {}
+  void setParallel(const bool parallel) { m_parallel = parallel; }
   virtual void layoutSamples(Samples& samples,
                              int borderPadding,
                              int shapePadding,
                              int& width,
                              int& height,
                              base::task_token& token) = 0;
+
+protected:
+  // Marks each sample that has the same pixels of a previous sample
+  // as duplicated (sharing the bounds of the previous one). Only
+  // linked samples are compared if "mergeDups" is false.
+  //
+  // Samples are rendered in parallel in small batches, and we keep
+  // only the hash of each unique sample (and its render, to copy it
+  // to the texture later, up to kMaxKeptRendersBytes), so the memory
+  // usage is bounded no matter how many samples there are.
+  void findDuplicates(Samples& samples, const bool mergeDups, base::task_token& token)
+  {
+    // Unique samples by hash
+    std::unordered_map<uint32_t, std::vector<int>> uniques;
+
+    // Unique samples with a kept render (older first)
+    std::deque<int> kept;
+    std::size_t keptBytes = 0;
+
+    std::vector<int> batch;
+    std::vector<ImageRef> renders;
+    const int n = samples.size();
+    int i = 0;
+    while (i < n) {
+      if (token.canceled())
+        return;
+      token.set_progress(float(i) / n);
+
+      // Consecutive samples of the same sprite/layers, so we can
+      // change the visibility of the layers just once for the whole
+      // batch.
+      batch.clear();
+      std::size_t batchBytes = 0;
+      for (; i < n && int(batch.size()) < kMaxBatchSamples && batchBytes < kMaxBatchBytes; ++i) {
+        const Sample& sample = samples[i];
+        if (sample.isEmpty() || (!mergeDups && !sample.isLinked()))
+          continue;
+
+        if (!batch.empty() && (sample.sprite() != samples[batch[0]].sprite() ||
+                               sample.selectedLayers() != samples[batch[0]].selectedLayers()))
+          break;
+
+        const gfx::Rect& bounds = sample.trimmedBounds();
+        batch.push_back(i);
+        batchBytes += std::size_t(bounds.w) * bounds.h * sample.sprite()->spec().bytesPerPixel();
+      }
+      if (batch.empty())
+        continue;
+
+      renders.clear();
+      renders.resize(batch.size());
+      {
+        RestoreVisibleLayers layersVisibility;
+        samples[batch[0]].showSelectedLayers(layersVisibility);
+
+        for_each_sample(m_parallel, int(batch.size()), [&samples, &batch, &renders](const int k) {
+          doc::ImageBufferPtr sampleBuf = std::make_shared<doc::ImageBuffer>();
+          renders[k] = samples[batch[k]].createRender(sampleBuf, false);
+        });
+      }
+
+      // Compare the new renders with the previous unique samples in
+      // order (so the first sample is the one that is kept).
+      for (int k = 0; k < int(batch.size()); ++k) {
+        const int j = batch[k];
+        const ImageRef& sampleRender = renders[k];
+        std::vector<int>& candidates = uniques[sampleRender->contentHash()];
+
+        int dupOf = -1;
+        for (const int other : candidates) {
+          ImageRef otherRender = samples[other].render();
+          if (!otherRender) {
+            doc::ImageBufferPtr otherBuf = std::make_shared<doc::ImageBuffer>();
+            otherRender = samples[other].createRender(otherBuf);
+          }
+          if (is_same_image(sampleRender.get(), otherRender.get())) {
+            dupOf = other;
+            break;
+          }
+        }
+
+        Sample& sample = samples[j];
+        if (dupOf >= 0) {
+          sample.setDuplicated();
+          sample.setSharedBounds(samples[dupOf].sharedBounds());
+          continue;
+        }
+
+        candidates.push_back(j);
+        sample.setRender(sampleRender);
+        kept.push_back(j);
+        keptBytes += sampleRender->getMemSize();
+
+        while (keptBytes > kMaxKeptRendersBytes && !kept.empty()) {
+          Sample& oldest = samples[kept.front()];
+          keptBytes -= oldest.render()->getMemSize();
+          oldest.setRender(nullptr);
+          kept.pop_front();
+        }
+      }
+    }
+  }
+
+private:
+  bool m_parallel = true;
 };
 
 class DocExporter::SimpleLayoutSamples : public DocExporter::LayoutSamples {
@@ -384,11 +553,9 @@ public:
     const Layer* oldLayer = nullptr;
     const Tag* oldTag = nullptr;
 
-    doc::ImagesMap duplicates;
     gfx::Point framePt(borderPadding, borderPadding);
     gfx::Size rowSize(0, 0);
 
-    int i = 0;
     int itemInBand = 0;
     int itemsPerBand = -1;
     if (breakBands) {
@@ -398,33 +565,21 @@ public:
         itemsPerBand = m_maxCols;
     }
 
+    token.set_progress_range(0.2f, 0.4f);
+    findDuplicates(samples, m_mergeDups, token);
+    token.set_progress_range(0.0f, 1.0f);
+
     for (auto& sample : samples) {
       if (token.canceled())
         return;
-      token.set_progress(0.2f + 0.2f * i / samples.size());
 
       if (sample.isEmpty()) {
         sample.setInTextureBounds(gfx::Rect(0, 0, 0, 0));
-        ++i;
         continue;
       }
 
-      if (m_mergeDups || sample.isLinked()) {
-        doc::ImageBufferPtr sampleBuf = std::make_shared<doc::ImageBuffer>();
-        doc::ImageRef sampleRender(sample.createRender(sampleBuf));
-        auto it = duplicates.find(sampleRender);
-        if (it != duplicates.end()) {
-          const uint32_t j = it->second;
-
-          sample.setDuplicated();
-          sample.setSharedBounds(samples[j].sharedBounds());
-          ++i;
-          continue;
-        }
-        else {
-          duplicates[sampleRender] = i;
-        }
-      }
+      if (sample.isDuplicated())
+        continue;
 
       const Sprite* sprite = sample.sprite();
       const Layer* layer = sample.layer();
@@ -498,7 +653,6 @@ public:
       oldLayer = layer;
       oldTag = tag;
       ++itemInBand;
-      ++i;
     }
 
     DX_TRACE("DX: -> SimpleLayoutSamples", width, height);
@@ -523,36 +677,15 @@ public:
                      base::task_token& token) override
   {
     gfx::PackingRects pr(borderPadding, shapePadding);
-    doc::ImagesMap duplicates;
 
-    uint32_t i = 0;
-    for (auto& sample : samples) {
-      if (token.canceled())
-        return;
-      token.set_progress_range(0.2f, 0.3f);
-      token.set_progress(float(i) / samples.size());
-
-      if (sample.isEmpty()) {
-        ++i;
-        continue;
-      }
-
-      // We have to use one ImageBuffer for each image because we're
-      // going to store all images in the "duplicates" map.
-      doc::ImageBufferPtr sampleBuf = std::make_shared<doc::ImageBuffer>();
-      doc::ImageRef sampleRender(sample.createRender(sampleBuf));
-      auto it = duplicates.find(sampleRender);
-      if (it != duplicates.end()) {
-        const uint32_t j = it->second;
+    token.set_progress_range(0.2f, 0.3f);
+    findDuplicates(samples, true, token);
+    if (token.canceled())
+      return;
 
-        sample.setDuplicated();
-        sample.setSharedBounds(samples[j].sharedBounds());
-      }
-      else {
-        duplicates[sampleRender] = i;
+    for (const auto& sample : samples) {
+      if (!sample.isEmpty() && !sample.isDuplicated())
         pr.add(sample.requiredSize());
-      }
-      ++i;
     }
 
     token.set_progress_range(0.3f, 0.4f);
@@ -612,6 +745,7 @@ void DocExporter::reset()
   m_listLayers = false;
   m_listLayerHierarchy = false;
   m_listSlices = false;
+  m_parallel = true;
   m_documents.clear();
 }
 
@@ -1089,6 +1223,7 @@ void DocExporter::layoutSamples(Samples& samples, base::task_token& token)
   switch (m_sheetType) {
     case SpriteSheetType::Packed: {
       BestFitLayoutSamples layout;
+      layout.setParallel(m_parallel);
       layout.layoutSamples(samples, m_borderPadding, m_shapePadding, width, height, token);
       break;
     }
@@ -1099,6 +1234,7 @@ void DocExporter::layoutSamples(Samples& samples, base::task_token& token)
                                  m_splitLayers,
                                  m_splitTags,
                                  m_mergeDuplicates);
+      layout.setParallel(m_parallel);
       layout.layoutSamples(samples, m_borderPadding, m_shapePadding, width, height, token);
       break;
     }
@@ -1163,7 +1299,7 @@ Doc* DocExporter::createEmptyTexture(const Samples& samples, base::task_token& t
   // ctx->isUIAvailable() (instead of App::instance()->isGui())
   // because when the sprite sheet is generated from the UI, a
   // temporal non-UI context is created in a background thread.
-  const bool paletteRequiredByUIPreview = App::instance()->isGui();
+  const bool paletteRequiredByUIPreview = (App::instance() && App::instance()->isGui());
   const bool textureSupportsPalette = format_supports_palette(m_textureFilename) ||
                                       paletteRequiredByUIPreview;
 
@@ -1235,23 +1371,39 @@ void DocExporter::renderTexture(Context* ctx,
 {
   textureImage->clear(textureImage->maskColor());
 
+  // Unique samples are placed in different areas of the texture, so
+  // we can render several samples in parallel.
+  std::vector<int> batch;
+  const int n = samples.size();
   int i = 0;
-  for (const auto& sample : samples) {
+  while (i < n) {
     if (token.canceled())
       return;
-    token.set_progress(0.6f + 0.2f * i / int(samples.size()));
+    token.set_progress(0.6f + 0.2f * i / n);
 
-    if (sample.isLinked() || sample.isDuplicated() || sample.isEmpty()) {
-      ++i;
-      continue;
+    // Consecutive samples of the same sprite/layers
+    batch.clear();
+    for (; i < n && int(batch.size()) < kMaxBatchSamples; ++i) {
+      const Sample& sample = samples[i];
+      if (sample.isLinked() || sample.isDuplicated() || sample.isEmpty())
+        continue;
+
+      if (!batch.empty() && (sample.sprite() != samples[batch[0]].sprite() ||
+                             sample.selectedLayers() != samples[batch[0]].selectedLayers()))
+        break;
+
+      batch.push_back(i);
     }
+    if (batch.empty())
+      continue;
 
     // Make the sprite compatible with the texture so the render()
     // works correctly.
-    if (sample.sprite()->pixelFormat() != textureImage->pixelFormat()) {
+    const Sample& first = samples[batch[0]];
+    if (first.sprite()->pixelFormat() != textureImage->pixelFormat()) {
       RgbMapAlgorithm rgbmapAlgo = Preferences::instance().quantization.rgbmapAlgorithm();
       FitCriteria fc = Preferences::instance().quantization.fitCriteria();
-      cmd::SetPixelFormat(sample.sprite(),
+      cmd::SetPixelFormat(first.sprite(),
                           textureImage->pixelFormat(),
                           render::Dithering(),
                           rgbmapAlgo,
@@ -1261,11 +1413,19 @@ void DocExporter::renderTexture(Context* ctx,
         .execute(ctx);
     }
 
-    sample.renderSample(textureImage,
-                        sample.inTextureBounds().x + m_innerPadding,
-                        sample.inTextureBounds().y + m_innerPadding,
-                        m_extrude);
-    ++i;
+    RestoreVisibleLayers layersVisibility;
+    first.showSelectedLayers(layersVisibility);
+
+    for_each_sample(m_parallel,
+                    int(batch.size()),
+                    [this, &samples, &batch, textureImage](const int k) {
+                      const Sample& sample = samples[batch[k]];
+                      sample.renderSample(textureImage,
+                                          sample.inTextureBounds().x + m_innerPadding,
+                                          sample.inTextureBounds().y + m_innerPadding,
+                                          m_extrude,
+                                          false);
+                    });
   }
 }
 
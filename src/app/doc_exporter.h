@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -80,6 +80,9 @@ public:
   void setListLayerHierarchy(bool value) { m_listLayerHierarchy = value; }
   void setListSlices(bool value) { m_listSlices = value; }
 
+  // Renders the samples in several threads (true by default).
+  void setParallel(bool parallel) { m_parallel = parallel; }
+
   void addImage(Doc* doc, const doc::ImageRef& image);
 
   int addDocumentSamples(Doc* doc,
@@ -172,6 +175,7 @@ private:
   bool m_listLayers;
   bool m_listLayerHierarchy;
   bool m_listSlices;
+  bool m_parallel;
   Items m_documents;
 
   // Buffers used
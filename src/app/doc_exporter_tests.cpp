@@ -0,0 +1,235 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "app/context.h"
+#include "app/doc.h"
+#include "app/doc_exporter.h"
+#include "app/test_context.h"
+#include "base/fs.h"
+#include "base/task.h"
+#include "doc/cel.h"
+#include "doc/image.h"
+#include "doc/layer.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+#include "gfx/rect_io.h"
+
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace app;
+using namespace doc;
+
+namespace {
+
+// Creates a sprite with two layers where some cels are equal, some
+// are linked, and some are empty.
+std::unique_ptr<Doc> make_doc(Context& ctx)
+{
+  std::unique_ptr<Doc> doc(ctx.documents().add(24, 20));
+  Sprite* sprite = doc->sprite();
+  const frame_t nframes = 12;
+  sprite->setTotalFrames(nframes);
+
+  LayerImage* layer1 = static_cast<LayerImage*>(sprite->root()->firstLayer());
+  LayerImage* layer2 = new LayerImage(sprite);
+  sprite->root()->addLayer(layer2);
+
+  for (frame_t frame = 0; frame < nframes; ++frame) {
+    if (frame > 0)
+      layer1->addCel(new Cel(frame, ImageRef(Image::create(IMAGE_RGB, 24, 20))));
+    Image* image1 = layer1->cel(frame)->image();
+    clear_image(image1, rgba(0, 0, 0, 0));
+    // Only 4 different images in this layer
+    const int k = frame % 4;
+    fill_rect(image1, 2 + k, 3, 10 + 2 * k, 8 + k, rgba(255, 60 * k, 0, 255));
+    put_pixel(image1, 20, 15 - k, rgba(0, 0, 255, 128));
+
+    // The second layer has empty frames and links
+    if (frame % 3 == 2)
+      continue;
+    if (frame % 3 == 1) {
+      layer2->addCel(Cel::MakeLink(frame, layer2->cel(frame - 1)));
+      continue;
+    }
+    ImageRef image2(Image::create(IMAGE_RGB, 8, 6));
+    clear_image(image2.get(), rgba(0, 255, 0, 255));
+    put_pixel(image2.get(), frame % 8, 2, rgba(255, 255, 255, 255));
+    Cel* cel = new Cel(frame, image2);
+    cel->setPosition(frame, 10);
+    layer2->addCel(cel);
+  }
+  return doc;
+}
+
+struct SheetOutput {
+  ImageRef texture;
+  std::string data;
+};
+
+SheetOutput export_sheet(const bool parallel,
+                         const std::function<void(DocExporter&)>& setup,
+                         const bool splitLayers)
+{
+  TestContext ctx;
+  std::unique_ptr<Doc> doc = make_doc(ctx);
+
+  const std::string dataFn = "_test_sheet.json";
+  DocExporter exporter;
+  exporter.setDataFilename(dataFn);
+  exporter.setParallel(parallel);
+  exporter.setSplitLayers(splitLayers);
+  setup(exporter);
+  exporter.addDocumentSamples(doc.get(), nullptr, splitLayers, false, false, nullptr, nullptr);
+
+  base::task_token token;
+  std::unique_ptr<Doc> texture(exporter.exportSheet(&ctx, token));
+  EXPECT_TRUE(texture != nullptr);
+
+  SheetOutput output;
+  if (texture) {
+    output.texture.reset(
+      Image::createCopy(texture->sprite()->root()->firstLayer()->cel(0)->image()));
+    texture->close();
+  }
+  {
+    std::ifstream f(dataFn);
+    std::stringstream buf;
+    buf << f.rdbuf();
+    output.data = buf.str();
+  }
+  base::delete_file(dataFn);
+  doc->close();
+  return output;
+}
+
+// Returns the bounds in the texture of each sample of the JSON data.
+std::vector<gfx::Rect> get_frames_bounds(const std::string& data)
+{
+  static const std::regex re(
+    "\"frame\": \\{ \"x\": (\\d+), \"y\": (\\d+), \"w\": (\\d+), \"h\": (\\d+) \\}");
+
+  std::vector<gfx::Rect> result;
+  for (std::sregex_iterator it(data.begin(), data.end(), re), end; it != end; ++it) {
+    const std::smatch& m = *it;
+    result.push_back(
+      gfx::Rect(std::stoi(m[1]), std::stoi(m[2]), std::stoi(m[3]), std::stoi(m[4])));
+  }
+  return result;
+}
+
+// Checks that each sample uses the same bounds in the texture as
+// the sample with index expected[i] (duplicates are merged in the
+// first one), and that the other samples don't overlap.
+void expect_frames(const std::string& data, const std::vector<int>& expected)
+{
+  const std::vector<gfx::Rect> frames = get_frames_bounds(data);
+  ASSERT_EQ(expected.size(), frames.size());
+  for (int i = 0; i < int(frames.size()); ++i) {
+    for (int j = 0; j < i; ++j) {
+      if (expected[i] == j)
+        EXPECT_EQ(frames[j], frames[i]) << "sample " << i << " must be a duplicate of " << j;
+      else if (expected[i] == i)
+        EXPECT_FALSE(frames[j].intersects(frames[i])) << "samples " << i << " and " << j;
+    }
+  }
+}
+
+void expect_same_sheets(const std::function<void(DocExporter&)>& setup,
+                        const std::vector<int>& expectedFrames,
+                        const bool splitLayers = false)
+{
+  const SheetOutput seq = export_sheet(false, setup, splitLayers);
+  const SheetOutput par = export_sheet(true, setup, splitLayers);
+  expect_frames(seq.data, expectedFrames);
+
+  ASSERT_TRUE(seq.texture && par.texture);
+  ASSERT_EQ(seq.texture->pixelFormat(), par.texture->pixelFormat());
+  ASSERT_EQ(seq.texture->size(), par.texture->size());
+  for (int y = 0; y < seq.texture->height(); ++y) {
+    const int rowBytes = seq.texture->bytesPerPixel() * seq.texture->width();
+    EXPECT_EQ(0,
+              std::memcmp(seq.texture->getPixelAddress(0, y),
+                          par.texture->getPixelAddress(0, y),
+                          rowBytes))
+      << "row " << y;
+  }
+  EXPECT_FALSE(seq.data.empty());
+  EXPECT_EQ(seq.data, par.data);
+}
+
+// Index of the sample with the same image as each sample
+// exported from make_doc() (or the same index if it's unique).
+// Merging layers, all frames are different.
+const std::vector<int> kMergedLayersFrames = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+// Splitting layers, the first layer has only 4 different images, and
+// the second one has links (and empty cels, which are ignored).
+const std::vector<int> kSplitLayersFrames = {
+  0,  1,  2,  3,  0,  1,  2,  3,  0,  1,  2,  3, // Layer 1 (12 frames)
+  12, 12, 14, 14, 16, 16, 18, 18,                // Layer 2 (frames 0, 1, 3, 4, 6, 7, 9, 10)
+};
+
+} // anonymous namespace
+
+TEST(DocExporter, ParallelPackedWithDuplicates)
+{
+  expect_same_sheets(
+    [](DocExporter& exporter) {
+      exporter.setSpriteSheetType(SpriteSheetType::Packed);
+      exporter.setMergeDuplicates(true);
+      exporter.setTrimCels(true);
+      exporter.setShapePadding(1);
+    },
+    kMergedLayersFrames);
+}
+
+TEST(DocExporter, ParallelPackedWithDuplicatesSplitLayers)
+{
+  expect_same_sheets(
+    [](DocExporter& exporter) {
+      exporter.setSpriteSheetType(SpriteSheetType::Packed);
+      exporter.setMergeDuplicates(true);
+      exporter.setIgnoreEmptyCels(true);
+      exporter.setTrimCels(true);
+    },
+    kSplitLayersFrames,
+    true);
+}
+
+TEST(DocExporter, ParallelRowsExtrudeSplitLayers)
+{
+  expect_same_sheets(
+    [](DocExporter& exporter) {
+      exporter.setSpriteSheetType(SpriteSheetType::Rows);
+      exporter.setTextureColumns(5);
+      exporter.setMergeDuplicates(true);
+      exporter.setIgnoreEmptyCels(true);
+      exporter.setExtrude(true);
+      exporter.setInnerPadding(1);
+    },
+    kSplitLayersFrames,
+    true);
+}
+
+TEST(DocExporter, ParallelHorizontalLinkedOnly)
+{
+  expect_same_sheets(
+    [](DocExporter& exporter) {
+      exporter.setSpriteSheetType(SpriteSheetType::Horizontal);
+      exporter.setBorderPadding(2);
+      exporter.setTrimSprite(true);
+    },
+    kMergedLayersFrames);
+}
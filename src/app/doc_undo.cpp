@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022-2023  Igara Studio S.A.
+// Copyright (C) 2022-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -18,12 +18,16 @@
 #include "app/context.h"
 #include "app/doc_undo_observer.h"
 #include "app/pref/preferences.h"
+#include "app/task_scheduler.h"
 #include "base/mem_utils.h"
 #include "base/scoped_value.h"
 #include "undo/undo_history.h"
 #include "undo/undo_state.h"
 
+#include <algorithm>
 #include <cassert>
+#include <condition_variable>
+#include <mutex>
 #include <stdexcept>
 
 #define UNDO_TRACE(...)
@@ -31,10 +35,28 @@
 
 namespace app {
 
+struct DocUndo::CompressionTask {
+  enum class Status { Queued, Running, Done, Canceled };
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  Status status = Status::Queued;
+};
+
 DocUndo::DocUndo() : m_undoHistory(this)
 {
 }
 
+DocUndo::~DocUndo()
+{
+  // The undo history (and its commands) cannot be deleted while they
+  // are being compressed.
+  finishCompression(nullptr);
+
+  // Canceled states were added again to compress them later.
+  m_uncompressedStates.clear();
+}
+
 void DocUndo::setContext(Context* ctx)
 {
   m_ctx = ctx;
@@ -49,6 +71,8 @@ void DocUndo::add(CmdTransaction* cmd)
     throw CannotModifyWhenUndoingException();
   }
 
+  updateCompressedStates();
+
   UNDO_TRACE("UNDO: Add state <%s> of %s to %s\n",
              cmd->label().c_str(),
              base::get_pretty_memory_size(cmd->memSize()).c_str(),
@@ -61,6 +85,7 @@ void DocUndo::add(CmdTransaction* cmd)
 
   m_undoHistory.add(cmd);
   m_totalUndoSize += cmd->memSize();
+  addUncompressedState(m_undoHistory.currentState());
 
   notify_observers(&DocUndoObserver::onAddUndoState, this);
   notify_observers(&DocUndoObserver::onTotalUndoSizeChange, this);
@@ -82,6 +107,8 @@ void DocUndo::add(CmdTransaction* cmd)
     }
   }
 
+  compressColdStates();
+
   UNDO_TRACE("UNDO: New undo size %s\n", base::get_pretty_memory_size(m_totalUndoSize).c_str());
 }
 
@@ -100,14 +127,18 @@ void DocUndo::undo()
   ASSERT(!m_undoing);
   base::ScopedValue undoing(m_undoing, true);
   const size_t oldSize = m_totalUndoSize;
+  updateCompressedStates();
   {
     const undo::UndoState* state = nextUndo();
     ASSERT(state);
+    finishCompression(state);
     const Cmd* cmd = STATE_CMD(state);
     m_totalUndoSize -= cmd->memSize();
     m_undoHistory.undo();
     m_totalUndoSize += cmd->memSize();
+    addUncompressedState(state);
   }
+  compressColdStates();
   // This notification could execute a script that modifies the sprite
   // again (e.g. a script that is listening the "change" event, check
   // the SpriteEvents class). If the sprite is modified, the "cmd" is
@@ -122,14 +153,18 @@ void DocUndo::redo()
   ASSERT(!m_undoing);
   base::ScopedValue undoing(m_undoing, true);
   const size_t oldSize = m_totalUndoSize;
+  updateCompressedStates();
   {
     const undo::UndoState* state = nextRedo();
     ASSERT(state);
+    finishCompression(state);
     const Cmd* cmd = STATE_CMD(state);
     m_totalUndoSize -= cmd->memSize();
     m_undoHistory.redo();
     m_totalUndoSize += cmd->memSize();
+    addUncompressedState(state);
   }
+  compressColdStates();
   notify_observers(&DocUndoObserver::onCurrentUndoStateChange, this);
   if (m_totalUndoSize != oldSize)
     notify_observers(&DocUndoObserver::onTotalUndoSizeChange, this);
@@ -141,6 +176,7 @@ void DocUndo::clearRedo()
   if (currentState() == lastState())
     return;
 
+  // The compression of deleted states is finished in onDeleteUndoState()
   m_undoHistory.clearRedo();
   notify_observers(&DocUndoObserver::onClearRedo, this);
 }
@@ -273,6 +309,11 @@ void DocUndo::moveToState(const undo::UndoState* state)
 {
   ASSERT(!m_undoing);
   base::ScopedValue undoing(m_undoing, true);
+  size_t oldSize = m_totalUndoSize;
+
+  // We don't know which states will be undone/redone, so we cancel
+  // all the pending compressions (waiting only the running ones)
+  finishCompression(nullptr);
 
   m_undoHistory.moveTo(state);
 
@@ -281,14 +322,18 @@ void DocUndo::moveToState(const undo::UndoState* state)
   // sprite on its "change" event.
   notify_observers(&DocUndoObserver::onCurrentUndoStateChange, this);
 
-  // Recalculate the total undo size
-  size_t oldSize = m_totalUndoSize;
+  // Recalculate the total undo size (and as we don't know which
+  // states were decompressed to move to the new state, we check all
+  // of them again)
   m_totalUndoSize = 0;
+  m_uncompressedStates.clear();
   const undo::UndoState* s = m_undoHistory.firstState();
   while (s) {
     m_totalUndoSize += STATE_CMD(s)->memSize();
+    m_uncompressedStates.push_back(s);
     s = s->next();
   }
+  compressColdStates();
   if (m_totalUndoSize != oldSize)
     notify_observers(&DocUndoObserver::onTotalUndoSizeChange, this);
 }
@@ -307,11 +352,125 @@ const undo::UndoState* DocUndo::nextRedo() const
     return m_undoHistory.firstState();
 }
 
+void DocUndo::addUncompressedState(const undo::UndoState* state)
+{
+  if (state && std::find(m_uncompressedStates.begin(), m_uncompressedStates.end(), state) ==
+                 m_uncompressedStates.end()) {
+    m_uncompressedStates.push_back(state);
+  }
+}
+
+void DocUndo::compressColdStates()
+{
+  if (App::instance() && !App::instance()->preferences().undo.compressHistory()) {
+    m_uncompressedStates.clear();
+    return;
+  }
+
+  // The next states to undo/redo are kept uncompressed, so undoing
+  // and redoing the last action doesn't need to decompress anything.
+  const undo::UndoState* nextUndoState = nextUndo();
+  const undo::UndoState* nextRedoState = nextRedo();
+
+  auto it = m_uncompressedStates.begin();
+  while (it != m_uncompressedStates.end()) {
+    const undo::UndoState* state = *it;
+    if (state == nextUndoState || state == nextRedoState) {
+      ++it;
+      continue;
+    }
+
+    Cmd* cmd = STATE_CMD(state);
+    auto task = std::make_shared<CompressionTask>();
+    m_compressingStates.push_back(CompressingState{ state, cmd->memSize(), task });
+    it = m_uncompressedStates.erase(it);
+
+    // The cmd is not used if the task is canceled, so the task can be
+    // executed even after the state/DocUndo are deleted.
+    TaskScheduler::instance()->execute(TaskPriority::Background, [task, cmd] {
+      {
+        const std::lock_guard lock(task->mutex);
+        if (task->status == CompressionTask::Status::Canceled)
+          return;
+        task->status = CompressionTask::Status::Running;
+      }
+
+      cmd->compress();
+
+      {
+        const std::lock_guard lock(task->mutex);
+        task->status = CompressionTask::Status::Done;
+      }
+      task->cv.notify_all();
+    });
+  }
+}
+
+void DocUndo::updateCompressedStates()
+{
+  const size_t oldSize = m_totalUndoSize;
+
+  auto it = m_compressingStates.begin();
+  while (it != m_compressingStates.end()) {
+    {
+      const std::lock_guard lock(it->task->mutex);
+      if (it->task->status != CompressionTask::Status::Done) {
+        ++it;
+        continue;
+      }
+    }
+
+    m_totalUndoSize = m_totalUndoSize - it->oldMemSize + STATE_CMD(it->state)->memSize();
+    it = m_compressingStates.erase(it);
+  }
+
+  if (m_totalUndoSize != oldSize) {
+    UNDO_TRACE("UNDO: Undo size after compression %s -> %s\n",
+               base::get_pretty_memory_size(oldSize).c_str(),
+               base::get_pretty_memory_size(m_totalUndoSize).c_str());
+  }
+}
+
+void DocUndo::finishCompression(const undo::UndoState* state)
+{
+  auto it = m_compressingStates.begin();
+  while (it != m_compressingStates.end()) {
+    if (state && it->state != state) {
+      ++it;
+      continue;
+    }
+
+    CompressionTask* task = it->task.get();
+    bool done;
+    {
+      std::unique_lock lock(task->mutex);
+      if (task->status == CompressionTask::Status::Queued)
+        task->status = CompressionTask::Status::Canceled;
+      else
+        task->cv.wait(lock, [task] { return task->status == CompressionTask::Status::Done; });
+      done = (task->status == CompressionTask::Status::Done);
+    }
+
+    if (done)
+      m_totalUndoSize = m_totalUndoSize - it->oldMemSize + STATE_CMD(it->state)->memSize();
+    else
+      addUncompressedState(it->state); // To compress it later
+
+    it = m_compressingStates.erase(it);
+  }
+}
+
 void DocUndo::onDeleteUndoState(undo::UndoState* state)
 {
   ASSERT(state);
   Cmd* cmd = STATE_CMD(state);
 
+  finishCompression(state);
+
+  m_uncompressedStates.erase(
+    std::remove(m_uncompressedStates.begin(), m_uncompressedStates.end(), state),
+    m_uncompressedStates.end());
+
   UNDO_TRACE("UNDO: Deleting undo state <%s> of %s from %s\n",
              cmd->label().c_str(),
              base::get_pretty_memory_size(cmd->memSize()).c_str(),
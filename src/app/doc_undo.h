@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022-2023  Igara Studio S.A.
+// Copyright (C) 2022-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -17,7 +17,9 @@
 #include "undo/undo_history.h"
 
 #include <iosfwd>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace app {
 using namespace doc;
@@ -42,6 +44,7 @@ class DocUndo : public obs::observable<DocUndoObserver>,
                 public undo::UndoHistoryDelegate {
 public:
   DocUndo();
+  ~DocUndo();
 
   size_t totalUndoSize() const { return m_totalUndoSize; }
 
@@ -104,9 +107,38 @@ private:
   const undo::UndoState* nextUndo() const;
   const undo::UndoState* nextRedo() const;
 
+  void addUncompressedState(const undo::UndoState* state);
+
+  // Compresses (in a background thread) the undo data of the states
+  // that are not the next ones to be undone/redone.
+  void compressColdStates();
+
+  // Updates the m_totalUndoSize with the new size of the states that
+  // were already compressed (without waiting the other ones).
+  void updateCompressedStates();
+
+  // Finishes the background compression of the given state (or all
+  // states if it's nullptr) before we use/delete it: if its task
+  // didn't start yet, it's canceled, in other case we wait it.
+  void finishCompression(const undo::UndoState* state);
+
   // undo::UndoHistoryDelegate impl
   void onDeleteUndoState(undo::UndoState* state) override;
 
+  // States that might contain uncompressed undo data.
+  std::vector<const undo::UndoState*> m_uncompressedStates;
+
+  // States being compressed in background (each one in its own task)
+  struct CompressionTask;
+  struct CompressingState {
+    const undo::UndoState* state;
+    size_t oldMemSize; // memSize() before the compression
+    std::shared_ptr<CompressionTask> task;
+  };
+  std::vector<CompressingState> m_compressingStates;
+
+  // Declared after the vectors above because ~UndoHistory() calls
+  // onDeleteUndoState() for the remaining states, which uses them.
   undo::UndoHistory m_undoHistory;
   const undo::UndoState* m_savedState = nullptr;
   Context* m_ctx = nullptr;
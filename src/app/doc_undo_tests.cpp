@@ -0,0 +1,159 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "app/cmd.h"
+#include "app/cmd_transaction.h"
+#include "app/context.h"
+#include "app/doc_undo.h"
+#include "app/task_scheduler.h"
+#include "undo/undo_state.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace app;
+
+namespace {
+
+// Blocks the compression of a command until the test opens it.
+class Gate {
+public:
+  void enter()
+  {
+    std::unique_lock lock(m_mutex);
+    m_started = true;
+    m_cv.notify_all();
+    m_cv.wait(lock, [this] { return m_open; });
+  }
+
+  void waitStarted()
+  {
+    std::unique_lock lock(m_mutex);
+    m_cv.wait(lock, [this] { return m_started; });
+  }
+
+  void open()
+  {
+    const std::lock_guard lock(m_mutex);
+    m_open = true;
+    m_cv.notify_all();
+  }
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  bool m_started = false;
+  bool m_open = false;
+};
+
+// Command with fake undo data that is reduced when it's compressed
+// (only if it has a gate, the others keep their size).
+class TestCmd : public Cmd {
+public:
+  explicit TestCmd(Gate* gate) : m_gate(gate) {}
+
+protected:
+  size_t onMemSize() const override { return m_size; }
+  void onCompress() override
+  {
+    if (m_gate) {
+      m_gate->enter();
+      m_size = 100;
+    }
+  }
+
+private:
+  Gate* m_gate;
+  std::atomic<size_t> m_size = 1000;
+};
+
+// Uses a scheduler with only one worker for background tasks, so the
+// compression tasks are executed one by one.
+class DocUndoTest : public ::testing::Test {
+protected:
+  DocUndoTest() : m_scheduler(2) { TaskScheduler::setInstance(&m_scheduler); }
+  ~DocUndoTest() { TaskScheduler::setInstance(nullptr); }
+
+  void addState(DocUndo& undo, Gate* gate)
+  {
+    auto* transaction = new CmdTransaction("Test", true);
+    transaction->add(new TestCmd(gate));
+    transaction->execute(&m_ctx);
+    undo.add(transaction);
+  }
+
+  static size_t statesSize(const DocUndo& undo)
+  {
+    size_t size = 0;
+    for (const undo::UndoState* s = undo.firstState(); s; s = s->next())
+      size += static_cast<CmdTransaction*>(s->cmd())->memSize();
+    return size;
+  }
+
+  // Adds 4 states, and returns when the compression of the first
+  // one is Done, the second one is Running (blocked by gate2), and
+  // the third one is Queued.
+  void addStates(DocUndo& undo, Gate& gate1, Gate& gate2)
+  {
+    addState(undo, &gate1);
+    addState(undo, &gate2);
+    gate1.waitStarted();
+    addState(undo, nullptr);
+    addState(undo, nullptr);
+    gate1.open();
+    gate2.waitStarted();
+  }
+
+  TaskScheduler m_scheduler;
+  Context m_ctx;
+};
+
+} // anonymous namespace
+
+TEST_F(DocUndoTest, CompressionSize)
+{
+  Gate gate1, gate2;
+  DocUndo undo;
+  addStates(undo, gate1, gate2);
+  const size_t uncompressedSize = statesSize(undo);
+
+  undo.undo(); // Accounts the compressed 1st state
+  EXPECT_EQ(statesSize(undo), undo.totalUndoSize());
+  EXPECT_LT(statesSize(undo), uncompressedSize);
+
+  undo.undo(); // Cancels the compression of the 3rd state
+  EXPECT_EQ(statesSize(undo), undo.totalUndoSize());
+
+  gate2.open();
+  undo.undo(); // Waits the compression of the 2nd state
+  EXPECT_EQ(statesSize(undo), undo.totalUndoSize());
+
+  undo.redo();
+  undo.redo();
+  undo.redo();
+  EXPECT_EQ(statesSize(undo), undo.totalUndoSize());
+}
+
+TEST_F(DocUndoTest, DeleteWithPendingCompression)
+{
+  Gate gate1, gate2;
+  auto undo = std::make_unique<DocUndo>();
+  addStates(*undo, gate1, gate2);
+
+  // The DocUndo destructor must wait the running task
+  std::thread thread([&gate2] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    gate2.open();
+  });
+  undo.reset();
+  thread.join();
+}
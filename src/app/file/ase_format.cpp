@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -14,6 +14,7 @@
 #include "app/file/file.h"
 #include "app/file/file_format.h"
 #include "app/file/format_options.h"
+#include "app/task_scheduler.h"
 #include "base/cfile.h"
 #include "base/exception.h"
 #include "base/file_handle.h"
@@ -30,8 +31,11 @@
 #include "ver/info.h"
 #include "zlib.h"
 
+#include <condition_variable>
 #include <cstdio>
 #include <deque>
+#include <map>
+#include <mutex>
 #include <variant>
 
 #define ASEFILE_TRACE(...) // TRACE(__VA_ARGS__)
@@ -60,6 +64,8 @@ public:
 
   bool decodeOneFrame() override { return m_fop->isOneFrame(); }
 
+  bool decodeHeaderOnly() override { return m_fop->isHeaderOnly(); }
+
   doc::color_t defaultSliceColor() override
   {
     auto color = m_fop->config().defaultSliceColor;
@@ -72,6 +78,21 @@ public:
 
   bool cacheCompressedTilesets() const override { return m_fop->config().cacheCompressedTilesets; }
 
+  bool cacheCompressedCels() const override { return m_fop->config().cacheCompressedCels; }
+
+  void parallelFor(const int n, const std::function<void(int)>& func) override
+  {
+    if (!m_fop->config().parallelDecoding || n <= 1) {
+      dio::DecodeDelegate::parallelFor(n, func);
+      return;
+    }
+
+    TaskGroup tasks(TaskPriority::Interactive);
+    for (int i = 0; i < n; ++i)
+      tasks.execute([&func, i] { func(i); });
+    tasks.wait();
+  }
+
 private:
   FileOp* m_fop;
   doc::Sprite* m_sprite;
@@ -126,6 +147,135 @@ public:
 
 } // anonymous namespace
 
+static void write_compressed_image(FILE* f,
+                                   ScanlinesGen* gen,
+                                   PixelFormat pixelFormat,
+                                   const int compressionLevel,
+                                   base::buffer* compressedOutput = nullptr);
+
+namespace {
+
+// Compresses cel images in worker threads, so the main thread only
+// has to write the already compressed bytes of each cel. Images are
+// compressed in the same order they are added (which should be the
+// same order in which they are written), and only a limited number
+// of images are compressed ahead of the writer to limit the memory
+// usage.
+//
+// Images with valid cached compressed data (see
+// Image::compressedData()) are not compressed again.
+class CelCompressor {
+public:
+  CelCompressor(const int compressionLevel, const bool cacheCompressedCels)
+    : m_compressionLevel(compressionLevel)
+    , m_cacheCompressedCels(cacheCompressedCels)
+    , m_nthreads(TaskScheduler::instance()->workers())
+    , m_window(2 * m_nthreads)
+    , m_tasks(TaskPriority::Interactive)
+  {
+  }
+
+  int compressionLevel() const { return m_compressionLevel; }
+  bool cacheCompressedCels() const { return m_cacheCompressedCels; }
+
+  // Adds an image to be compressed. Must be called before the first
+  // takeCompressedData() call.
+  void addImage(const Image* image)
+  {
+    ASSERT(m_nextJob == 0);
+    if (m_nthreads <= 1 || image->hasValidCompressedData() ||
+        m_index.find(image) != m_index.end())
+      return;
+
+    m_index[image] = m_jobs.size();
+    m_jobs.push_back(std::make_unique<Job>(image));
+  }
+
+  // Returns false if the image wasn't added to the compressor (so
+  // it must be compressed by the caller), or true if the compressed
+  // data was moved to "output".
+  bool takeCompressedData(const Image* image, base::buffer& output)
+  {
+    auto it = m_index.find(image);
+    if (it == m_index.end())
+      return false;
+
+    const size_t i = it->second;
+    m_index.erase(it);
+    startJobsUntil(i + m_window);
+
+    // Help compressing the pending images while we wait this one
+    Job* job = m_jobs[i].get();
+    while (true) {
+      {
+        const std::lock_guard lock(m_mutex);
+        if (job->done)
+          break;
+      }
+      if (!m_tasks.runOne()) {
+        std::unique_lock lock(m_mutex);
+        m_cv.wait(lock, [job] { return job->done; });
+        break;
+      }
+    }
+
+    if (!job->error.empty())
+      throw base::Exception("%s", job->error.c_str());
+
+    output = std::move(job->output);
+    job->output = base::buffer();
+    return true;
+  }
+
+private:
+  struct Job {
+    const Image* image;
+    base::buffer output;
+    std::string error;
+    bool done = false;
+    Job(const Image* image) : image(image) {}
+  };
+
+  void startJobsUntil(const size_t end)
+  {
+    for (; m_nextJob < end && m_nextJob < m_jobs.size(); ++m_nextJob) {
+      Job* job = m_jobs[m_nextJob].get();
+      m_tasks.execute([this, job] {
+        try {
+          ImageScanlines scan(job->image);
+          write_compressed_image(nullptr,
+                                 &scan,
+                                 job->image->pixelFormat(),
+                                 m_compressionLevel,
+                                 &job->output);
+        }
+        catch (const std::exception& ex) {
+          job->error = ex.what();
+        }
+
+        const std::lock_guard lock(m_mutex);
+        job->done = true;
+        m_cv.notify_all();
+      });
+    }
+  }
+
+  const int m_compressionLevel;
+  const bool m_cacheCompressedCels;
+  const int m_nthreads;
+  const size_t m_window;
+  std::vector<std::unique_ptr<Job>> m_jobs;
+  std::map<const Image*, size_t> m_index;
+  size_t m_nextJob = 0;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  // The group is the last member so it's destroyed (and all its
+  // tasks are finished) before the jobs.
+  TaskGroup m_tasks;
+};
+
+} // anonymous namespace
+
 static void ase_file_prepare_header(FILE* f,
                                     dio::AsepriteHeader* header,
                                     const Sprite* sprite,
@@ -147,6 +297,7 @@ static layer_t ase_file_write_cels(FILE* f,
                                    FileOp* fop,
                                    dio::AsepriteFrameHeader* frame_header,
                                    const dio::AsepriteExternalFiles& ext_files,
+                                   CelCompressor& compressor,
                                    const Sprite* sprite,
                                    const Layer* layer,
                                    layer_t layer_index,
@@ -175,6 +326,7 @@ static void ase_file_write_layer_chunk(FILE* f,
                                        int child_level);
 static void ase_file_write_cel_chunk(FILE* f,
                                      dio::AsepriteFrameHeader* frame_header,
+                                     CelCompressor& compressor,
                                      const Cel* cel,
                                      const LayerImage* layer,
                                      const layer_t layer_index,
@@ -283,7 +435,7 @@ FileFormat* CreateAseFormat()
 bool AseFormat::onLoad(FileOp* fop)
 {
   FileHandle handle(open_file_with_exception(fop->filename(), "rb"));
-  dio::StdioFileInterface fileInterface(handle.get());
+  dio::BufferedFileInterface fileInterface(handle.get());
 
   DecodeDelegate delegate(fop);
   dio::AsepriteDecoder decoder;
@@ -365,6 +517,22 @@ bool AseFormat::onSave(FileOp* fop)
     }
   }
 
+  // Compress all cel images in worker threads in the same order
+  // they will be written in the file
+  CelCompressor compressor(fop->config().asepriteCompressionLevel,
+                           fop->config().cacheCompressedCels);
+  const LayerList allLayers = sprite->allLayers();
+  for (frame_t frame : fop->roi().framesSequence()) {
+    for (const Layer* layer : allLayers) {
+      if (!layer->isImage())
+        continue;
+
+      const Cel* cel = layer->cel(frame);
+      if (cel && cel->image())
+        compressor.addImage(cel->image());
+    }
+  }
+
   // Write frames
   int outputFrame = 0;
   dio::AsepriteExternalFiles ext_files;
@@ -444,7 +612,15 @@ bool AseFormat::onSave(FileOp* fop)
     }
 
     // Write cel chunks
-    ase_file_write_cels(f, fop, &frame_header, ext_files, sprite, sprite->root(), 0, frame);
+    ase_file_write_cels(f,
+                        fop,
+                        &frame_header,
+                        ext_files,
+                        compressor,
+                        sprite,
+                        sprite->root(),
+                        0,
+                        frame);
 
     // Write the frame header
     ase_file_write_frame_header(f, &frame_header);
@@ -597,6 +773,7 @@ static layer_t ase_file_write_cels(FILE* f,
                                    FileOp* fop,
                                    dio::AsepriteFrameHeader* frame_header,
                                    const dio::AsepriteExternalFiles& ext_files,
+                                   CelCompressor& compressor,
                                    const Sprite* sprite,
                                    const Layer* layer,
                                    layer_t layer_index,
@@ -607,6 +784,7 @@ static layer_t ase_file_write_cels(FILE* f,
     if (cel) {
       ase_file_write_cel_chunk(f,
                                frame_header,
+                               compressor,
                                cel,
                                static_cast<const LayerImage*>(layer),
                                layer_index,
@@ -627,8 +805,15 @@ static layer_t ase_file_write_cels(FILE* f,
 
   if (layer->isGroup()) {
     for (const Layer* child : static_cast<const LayerGroup*>(layer)->layers()) {
-      layer_index =
-        ase_file_write_cels(f, fop, frame_header, ext_files, sprite, child, layer_index, frame);
+      layer_index = ase_file_write_cels(f,
+                                        fop,
+                                        frame_header,
+                                        ext_files,
+                                        compressor,
+                                        sprite,
+                                        child,
+                                        layer_index,
+                                        frame);
     }
   }
 
@@ -884,8 +1069,13 @@ static void write_raw_image(FILE* f, ScanlinesGen* gen, PixelFormat pixelFormat)
 // Compressed Image
 //////////////////////////////////////////////////////////////////////
 
+// The compressed data is written in "f" (if it's not nullptr) and/or
+// in the "compressedOutput" buffer (if it's not nullptr).
 template<typename ImageTraits>
-static void write_compressed_image_templ(FILE* f, ScanlinesGen* gen, base::buffer* compressedOutput)
+static void write_compressed_image_templ(FILE* f,
+                                         ScanlinesGen* gen,
+                                         const int compressionLevel,
+                                         base::buffer* compressedOutput)
 {
   PixelIO<ImageTraits> pixel_io;
   z_stream zstream;
@@ -894,7 +1084,7 @@ static void write_compressed_image_templ(FILE* f, ScanlinesGen* gen, base::buffe
   zstream.zalloc = (alloc_func)0;
   zstream.zfree = (free_func)0;
   zstream.opaque = (voidpf)0;
-  err = deflateInit(&zstream, Z_DEFAULT_COMPRESSION);
+  err = deflateInit(&zstream, compressionLevel);
   if (err != Z_OK)
     throw base::Exception("ZLib error %d in deflateInit().", err);
 
@@ -923,7 +1113,8 @@ static void write_compressed_image_templ(FILE* f, ScanlinesGen* gen, base::buffe
 
       int output_bytes = compressed.size() - zstream.avail_out;
       if (output_bytes > 0) {
-        if ((fwrite(&compressed[0], 1, output_bytes, f) != (size_t)output_bytes) || ferror(f))
+        if (f &&
+            ((fwrite(&compressed[0], 1, output_bytes, f) != (size_t)output_bytes) || ferror(f)))
           throw base::Exception("Error writing compressed image pixels.\n");
 
         // Save the whole compressed buffer to re-use in following
@@ -948,31 +1139,68 @@ static void write_compressed_image_templ(FILE* f, ScanlinesGen* gen, base::buffe
 static void write_compressed_image(FILE* f,
                                    ScanlinesGen* gen,
                                    PixelFormat pixelFormat,
-                                   base::buffer* compressedOutput = nullptr)
+                                   const int compressionLevel,
+                                   base::buffer* compressedOutput)
 {
   switch (pixelFormat) {
-    case IMAGE_RGB: write_compressed_image_templ<RgbTraits>(f, gen, compressedOutput); break;
+    case IMAGE_RGB:
+      write_compressed_image_templ<RgbTraits>(f, gen, compressionLevel, compressedOutput);
+      break;
 
     case IMAGE_GRAYSCALE:
-      write_compressed_image_templ<GrayscaleTraits>(f, gen, compressedOutput);
+      write_compressed_image_templ<GrayscaleTraits>(f, gen, compressionLevel, compressedOutput);
       break;
 
     case IMAGE_INDEXED:
-      write_compressed_image_templ<IndexedTraits>(f, gen, compressedOutput);
+      write_compressed_image_templ<IndexedTraits>(f, gen, compressionLevel, compressedOutput);
       break;
 
     case IMAGE_TILEMAP:
-      write_compressed_image_templ<TilemapTraits>(f, gen, compressedOutput);
+      write_compressed_image_templ<TilemapTraits>(f, gen, compressionLevel, compressedOutput);
       break;
   }
 }
 
+static void write_compressed_data(FILE* f, const base::buffer& data)
+{
+  if (!data.empty() && ((fwrite(&data[0], 1, data.size(), f) != data.size()) || ferror(f)))
+    throw base::Exception("Error writing compressed image pixels.\n");
+}
+
+static void write_compressed_cel_image(FILE* f, CelCompressor& compressor, const Image* image)
+{
+  // Re-use the cached compressed data if the image wasn't modified
+  // since it was loaded/saved.
+  if (image->hasValidCompressedData()) {
+    ASEFILE_TRACE("[%d] saving cached compressed cel image\n", image->id());
+    write_compressed_data(f, image->compressedData());
+    return;
+  }
+
+  base::buffer data;
+  if (compressor.takeCompressedData(image, data)) {
+    write_compressed_data(f, data);
+  }
+  else {
+    ImageScanlines scan(image);
+    write_compressed_image(f,
+                           &scan,
+                           image->pixelFormat(),
+                           compressor.compressionLevel(),
+                           compressor.cacheCompressedCels() ? &data : nullptr);
+  }
+
+  if (compressor.cacheCompressedCels())
+    image->setCompressedData(data);
+}
+
 //////////////////////////////////////////////////////////////////////
 // Cel Chunk
 //////////////////////////////////////////////////////////////////////
 
 static void ase_file_write_cel_chunk(FILE* f,
                                      dio::AsepriteFrameHeader* frame_header,
+                                     CelCompressor& compressor,
                                      const Cel* cel,
                                      const LayerImage* layer,
                                      const layer_t layer_index,
@@ -1042,8 +1270,7 @@ static void ase_file_write_cel_chunk(FILE* f,
         fputw(image->width(), f);
         fputw(image->height(), f);
 
-        ImageScanlines scan(image);
-        write_compressed_image(f, &scan, image->pixelFormat());
+        write_compressed_cel_image(f, compressor, image);
       }
       else {
         // Width and height
@@ -1067,8 +1294,7 @@ static void ase_file_write_cel_chunk(FILE* f,
       fputl(tile_f_dflip, f);
       ase_file_write_padding(f, 10);
 
-      ImageScanlines scan(image);
-      write_compressed_image(f, &scan, IMAGE_TILEMAP);
+      write_compressed_cel_image(f, compressor, image);
     }
   }
 }
@@ -1511,7 +1737,11 @@ static void ase_file_write_tileset_chunk(FILE* f,
       if (fop->config().cacheCompressedTilesets)
         compressedDataPtr = &compressedData;
 
-      write_compressed_image(f, &gen, tileset->sprite()->pixelFormat(), compressedDataPtr);
+      write_compressed_image(f,
+                             &gen,
+                             tileset->sprite()->pixelFormat(),
+                             fop->config().asepriteCompressionLevel,
+                             compressedDataPtr);
 
       // As we've just compressed the tileset, we can cache this same
       // data (so saving the file again will not need recompressing).
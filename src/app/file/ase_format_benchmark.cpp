@@ -0,0 +1,123 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif
+
+#include "app/context.h"
+#include "app/doc.h"
+#include "app/file/file.h"
+#include "base/fs.h"
+#include "dio/aseprite_decoder.h"
+#include "dio/decode_delegate.h"
+#include "dio/file_interface.h"
+#include "doc/cel.h"
+#include "doc/image.h"
+#include "doc/image_ref.h"
+#include "doc/layer.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+
+using namespace app;
+using namespace doc;
+
+// Saves a .aseprite file with the given number of frames and layers
+// (one cel in each frame/layer with some random strokes, so the
+// decoder has to inflate real compressed images).
+static std::string save_test_file(const int w, const int h, const int frames, const int layers)
+{
+  const std::string fn = "_ase_format_benchmark.aseprite";
+
+  Context ctx;
+  std::unique_ptr<Doc> doc(ctx.documents().add(w, h));
+  doc->setFilename(fn);
+
+  Sprite* sprite = doc->sprite();
+  sprite->setTotalFrames(frames);
+  for (int i = 1; i < layers; ++i)
+    sprite->root()->addLayer(new LayerImage(sprite));
+
+  std::mt19937 rng(1);
+  for (Layer* layer : sprite->root()->layers()) {
+    auto layerImage = static_cast<LayerImage*>(layer);
+    for (frame_t frame = 0; frame < frames; ++frame) {
+      Cel* cel = layerImage->cel(frame);
+      if (!cel) {
+        cel = new Cel(frame, ImageRef(Image::create(IMAGE_RGB, w, h)));
+        clear_image(cel->image(), 0);
+        layerImage->addCel(cel);
+      }
+
+      for (int j = 0; j < 16; ++j) {
+        const int x = rng() % w;
+        const int y = rng() % h;
+        fill_rect(cel->image(),
+                  x,
+                  y,
+                  x + rng() % (w / 4),
+                  y + rng() % (h / 4),
+                  rgba(rng() % 256, rng() % 256, rng() % 256, 255));
+      }
+    }
+  }
+
+  save_document(&ctx, doc.get());
+  doc->close();
+  return fn;
+}
+
+template<typename T>
+static void decode_test_file(benchmark::State& state)
+{
+  const std::string fn =
+    save_test_file(state.range(0), state.range(1), state.range(2), state.range(3));
+
+  while (state.KeepRunning()) {
+    FILE* f = std::fopen(fn.c_str(), "rb");
+    T fileInterface(f);
+    dio::DecodeDelegate delegate;
+    dio::AsepriteDecoder decoder;
+    decoder.initialize(&delegate, &fileInterface);
+    benchmark::DoNotOptimize(decoder.decode());
+    std::fclose(f);
+  }
+
+  base::delete_file(fn);
+}
+
+void BM_DecodeAseStdio(benchmark::State& state)
+{
+  decode_test_file<dio::StdioFileInterface>(state);
+}
+
+void BM_DecodeAseBuffered(benchmark::State& state)
+{
+  decode_test_file<dio::BufferedFileInterface>(state);
+}
+
+BENCHMARK(BM_DecodeAseStdio)
+  ->Args({ 32, 32, 200, 8 })
+  ->Args({ 256, 256, 50, 4 })
+  ->Args({ 1024, 1024, 10, 2 })
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+BENCHMARK(BM_DecodeAseBuffered)
+  ->Args({ 32, 32, 200, 8 })
+  ->Args({ 256, 256, 50, 4 })
+  ->Args({ 1024, 1024, 10, 2 })
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -489,6 +489,10 @@ FileOp* FileOp::createLoadDocumentOperation(Context* context,
   if (flags & FILE_LOAD_ONE_FRAME)
     fop->m_oneframe = true;
 
+  // Load just the metadata of the first file
+  if (flags & FILE_LOAD_HEADER_ONLY)
+    fop->m_headerOnly = true;
+
   if (flags & FILE_LOAD_CREATE_PALETTE)
     fop->m_createPaletteFromRgba = true;
 
@@ -1438,6 +1442,7 @@ FileOp::FileOp(FileOpType type, Context* context, const FileOpConfig* config)
   , m_done(false)
   , m_stop(false)
   , m_oneframe(false)
+  , m_headerOnly(false)
   , m_createPaletteFromRgba(false)
   , m_ignoreEmpty(false)
   , m_embeddedColorProfile(false)
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -34,6 +34,7 @@
 #define FILE_LOAD_ONE_FRAME             0x00000010
 #define FILE_LOAD_DATA_FILE             0x00000020
 #define FILE_LOAD_CREATE_PALETTE        0x00000040
+#define FILE_LOAD_HEADER_ONLY           0x00000080
 
 namespace doc {
 class Tag;
@@ -164,6 +165,7 @@ public:
 
   bool isSequence() const { return !m_seq.filename_list.empty(); }
   bool isOneFrame() const { return m_oneframe; }
+  bool isHeaderOnly() const { return m_headerOnly; }
   bool preserveColorProfile() const { return m_config.preserveColorProfile; }
   const FileFormat* fileFormat() const { return m_format; }
 
@@ -299,6 +301,9 @@ private:
   bool m_oneframe;                    // Load just one frame (in formats
                                       // that support animation like
                                       // GIF/FLI/ASE).
+  bool m_headerOnly;                  // Load just the sprite metadata
+                                      // (size, frames, layers, tags,
+                                      // etc.) without the pixels.
   bool m_createPaletteFromRgba;
   bool m_ignoreEmpty;
 
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2024  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -47,6 +47,18 @@ struct FileOpConfig {
   // compressed data that was loaded as-is).
   bool cacheCompressedTilesets = true;
 
+  // Cache compressed cel images (read from or written to .aseprite
+  // files) so unmodified cels don't need to be re-compressed when
+  // the sprite is saved again.
+  bool cacheCompressedCels = true;
+
+  // Inflate the cel images of .aseprite files in several threads.
+  bool parallelDecoding = true;
+
+  // zlib compression level (from 1=fastest to 9=smallest) used to
+  // save .aseprite files, or -1 to use the zlib default level.
+  int asepriteCompressionLevel = -1;
+
   void fillFromPreferences();
 };
 
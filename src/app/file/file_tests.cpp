@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -12,7 +12,9 @@
 #include "app/doc.h"
 #include "app/file/file.h"
 #include "app/file/file_formats_manager.h"
+#include "app/file/file_op_config.h"
 #include "base/base64.h"
+#include "base/fs.h"
 #include "doc/doc.h"
 #include "doc/user_data.h"
 #include "fmt/format.h"
@@ -363,3 +365,150 @@ TEST(File, CustomProperties)
     }
   }
 }
+
+TEST(File, HeaderOnly)
+{
+  app::Context ctx;
+
+  for (const std::string fn : { "test_header.ase", "test_header.gif", "test_header.png" }) {
+    const bool animated = (base::get_file_extension(fn) != "png");
+    {
+      std::unique_ptr<Doc> doc(ctx.documents().add(32, 16, doc::ColorMode::INDEXED, 256));
+      doc->setFilename(fn);
+
+      Sprite* sprite = doc->sprite();
+      Image* image = sprite->root()->firstLayer()->cel(frame_t(0))->image();
+      clear_image(image, 1);
+      if (animated) {
+        sprite->addFrame(frame_t(1));
+        sprite->addFrame(frame_t(2));
+        sprite->setFrameDuration(frame_t(1), 200);
+        sprite->tags().add(new Tag(frame_t(0), frame_t(2)));
+      }
+      if (base::get_file_extension(fn) == "ase") {
+        // Palette change in a later frame
+        Palette pal(*sprite->palette(frame_t(0)));
+        pal.setFrame(frame_t(2));
+        pal.setEntry(1, rgba(255, 0, 0, 255));
+        sprite->setPalette(&pal, false);
+
+        auto tileset = new Tileset(sprite, Grid(gfx::Size(4, 4)), 2);
+        clear_image(tileset->get(1).get(), 1);
+        sprite->tilesets()->add(tileset);
+      }
+
+      save_document(&ctx, doc.get());
+      doc->close();
+    }
+
+    std::unique_ptr<FileOp> fop(
+      FileOp::createLoadDocumentOperation(&ctx,
+                                          fn,
+                                          FILE_LOAD_SEQUENCE_NONE | FILE_LOAD_HEADER_ONLY));
+    ASSERT_TRUE(fop != nullptr);
+    fop->operate();
+    fop->done();
+    ASSERT_FALSE(fop->hasError()) << fop->error();
+
+    std::unique_ptr<Doc> doc(fop->releaseDocument());
+    ASSERT_TRUE(doc != nullptr);
+    Sprite* sprite = doc->sprite();
+    EXPECT_EQ(32, sprite->width()) << fn;
+    EXPECT_EQ(16, sprite->height()) << fn;
+    EXPECT_EQ(animated ? 3 : 1, sprite->totalFrames()) << fn;
+    if (animated)
+      EXPECT_EQ(200, sprite->frameDuration(frame_t(1))) << fn;
+    if (base::get_file_extension(fn) == "ase") {
+      EXPECT_EQ(1, sprite->tags().size());
+      EXPECT_EQ(1, sprite->allLayersCount());
+      EXPECT_EQ(0, sprite->root()->firstLayer()->getCelsCount());
+      ASSERT_EQ(2, sprite->getPalettes().size());
+      EXPECT_NE(rgba(255, 0, 0, 255), sprite->palette(frame_t(1))->getEntry(1));
+      EXPECT_EQ(rgba(255, 0, 0, 255), sprite->palette(frame_t(2))->getEntry(1));
+
+      // Tilesets without the tile pixels
+      ASSERT_EQ(1, sprite->tilesets()->size());
+      ASSERT_EQ(2, sprite->tilesets()->get(0)->size());
+      EXPECT_TRUE(is_plain_image(sprite->tilesets()->get(0)->get(1).get(), 0));
+    }
+    doc->close();
+  }
+}
+
+TEST(File, ParallelDecoding)
+{
+  app::Context ctx;
+  const std::string fn = "test_parallel.ase";
+
+  // Sprite with several layers/frames with random pixels
+  {
+    std::unique_ptr<Doc> doc(ctx.documents().add(64, 48, doc::ColorMode::RGB, 256));
+    doc->setFilename(fn);
+
+    Sprite* sprite = doc->sprite();
+    for (int i = 0; i < 2; ++i)
+      sprite->root()->addLayer(new LayerImage(sprite));
+    for (frame_t frame = 1; frame < 8; ++frame)
+      sprite->addFrame(frame);
+
+    std::srand(64 * 48);
+    for (Layer* layer : sprite->allLayers()) {
+      for (frame_t frame = 0; frame < sprite->totalFrames(); ++frame) {
+        Cel* cel = layer->cel(frame);
+        if (!cel) {
+          cel = new Cel(frame, ImageRef(Image::create(IMAGE_RGB, 32, 24)));
+          cel->setPosition(std::rand() % 32, std::rand() % 24);
+          static_cast<LayerImage*>(layer)->addCel(cel);
+        }
+        Image* image = cel->image();
+        for (int y = 0; y < image->height(); ++y) {
+          for (int x = 0; x < image->width(); ++x) {
+            const int v = std::rand() % 4;
+            put_pixel(image, x, y, doc::rgba(60 * v, x * 3, y * 5, v ? 255 : 0));
+          }
+        }
+      }
+    }
+
+    save_document(&ctx, doc.get());
+    doc->close();
+  }
+
+  auto load = [&ctx, &fn](const bool parallel) {
+    FileOpConfig config;
+    config.fillFromPreferences();
+    config.parallelDecoding = parallel;
+
+    std::unique_ptr<FileOp> fop(
+      FileOp::createLoadDocumentOperation(&ctx, fn, FILE_LOAD_SEQUENCE_NONE, &config));
+    EXPECT_TRUE(fop != nullptr);
+    fop->operate();
+    fop->done();
+    EXPECT_FALSE(fop->hasError()) << fop->error();
+    return std::unique_ptr<Doc>(fop->releaseDocument());
+  };
+
+  std::unique_ptr<Doc> seqDoc = load(false);
+  std::unique_ptr<Doc> parDoc = load(true);
+  ASSERT_TRUE(seqDoc && parDoc);
+
+  const LayerList seqLayers = seqDoc->sprite()->allLayers();
+  const LayerList parLayers = parDoc->sprite()->allLayers();
+  ASSERT_EQ(3, int(seqLayers.size()));
+  ASSERT_EQ(seqLayers.size(), parLayers.size());
+  ASSERT_EQ(8, parDoc->sprite()->totalFrames());
+
+  for (int i = 0; i < int(seqLayers.size()); ++i) {
+    for (frame_t frame = 0; frame < seqDoc->sprite()->totalFrames(); ++frame) {
+      const Cel* seqCel = seqLayers[i]->cel(frame);
+      const Cel* parCel = parLayers[i]->cel(frame);
+      ASSERT_TRUE(seqCel && parCel);
+      EXPECT_EQ(seqCel->bounds(), parCel->bounds());
+      EXPECT_TRUE(is_same_image(seqCel->image(), parCel->image()))
+        << "layer " << i << " frame " << frame;
+    }
+  }
+
+  seqDoc->close();
+  parDoc->close();
+}
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -325,6 +325,19 @@ private:
     if (m_sprite->lastFrame() < m_frameNum)
       m_sprite->addFrame(m_frameNum);
 
+    // Count frames without decoding their pixels
+    if (m_fop->isHeaderOnly()) {
+      skipFrameImage();
+      if (m_frameDelay >= 0)
+        m_sprite->setFrameDuration(m_frameNum, m_frameDelay * 10);
+
+      m_disposalMethod = DisposalMethod::NONE;
+      m_localTransparentIndex = -1;
+      m_frameDelay = 1;
+      ++m_frameNum;
+      return;
+    }
+
     // Create a temporary image loading the frame pixels from the GIF file
     std::unique_ptr<Image> frameImage;
     // We don't know if a GIF file could contain empty bounds (width
@@ -393,6 +406,21 @@ private:
     ++m_frameNum;
   }
 
+  // Skips the compressed pixels of the current image (without
+  // decoding them).
+  void skipFrameImage()
+  {
+    int codeSize = 0;
+    GifByteType* codeBlock = nullptr;
+    if (DGifGetCode(m_gifFile, &codeSize, &codeBlock) == GIF_ERROR)
+      throw Exception("Invalid GIF image data.\n");
+
+    while (codeBlock) {
+      if (DGifGetCodeNext(m_gifFile, &codeBlock) == GIF_ERROR)
+        throw Exception("Invalid GIF image data.\n");
+    }
+  }
+
   Image* readFrameIndexedImage(const gfx::Rect& frameBounds)
   {
     std::unique_ptr<Image> frameImage(Image::create(IMAGE_INDEXED, frameBounds.w, frameBounds.h));
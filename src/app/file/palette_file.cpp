@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2022  Igara Studio S.A.
+// Copyright (C) 2018-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -36,6 +36,32 @@ using namespace doc;
 
 static const char* palExts[] = { "act", "col", "gpl", "hex", "pal" };
 
+// Returns the palette of the first frame of the given file.
+static std::unique_ptr<Palette> load_palette_from_document(const char* filename,
+                                                           const int flags,
+                                                           const FileOpConfig* config)
+{
+  std::unique_ptr<Palette> pal;
+  std::unique_ptr<FileOp> fop(FileOp::createLoadDocumentOperation(nullptr,
+                                                                  filename,
+                                                                  FILE_LOAD_SEQUENCE_NONE | flags,
+                                                                  config));
+
+  if (fop && !fop->hasError()) {
+    fop->operate(nullptr);
+    fop->postLoad();
+
+    if (fop->document() && fop->document()->sprite() &&
+        fop->document()->sprite()->palette(frame_t(0))) {
+      pal = std::make_unique<Palette>(*fop->document()->sprite()->palette(frame_t(0)));
+    }
+
+    delete fop->releaseDocument();
+    fop->done();
+  }
+  return pal;
+}
+
 base::paths get_readable_palette_extensions()
 {
   base::paths paths = get_readable_extensions();
@@ -73,23 +99,16 @@ std::unique_ptr<doc::Palette> load_palette(const char* filename, const FileOpCon
       if (!ff || !ff->support(FILE_SUPPORT_LOAD))
         break;
 
-      std::unique_ptr<FileOp> fop(FileOp::createLoadDocumentOperation(
-        nullptr,
-        filename,
-        FILE_LOAD_CREATE_PALETTE | FILE_LOAD_SEQUENCE_NONE | FILE_LOAD_ONE_FRAME,
-        config));
-
-      if (fop && !fop->hasError()) {
-        fop->operate(nullptr);
-        fop->postLoad();
-
-        if (fop->document() && fop->document()->sprite() &&
-            fop->document()->sprite()->palette(frame_t(0))) {
-          pal = std::make_unique<Palette>(*fop->document()->sprite()->palette(frame_t(0)));
-        }
+      // The palette is saved in .aseprite files, so we don't need
+      // to decode the pixels (except to create a palette for RGB
+      // sprites without one).
+      if (dioFormat == dio::FileFormat::ASE_ANIMATION)
+        pal = load_palette_from_document(filename, FILE_LOAD_HEADER_ONLY, config);
 
-        delete fop->releaseDocument();
-        fop->done();
+      if (!pal || pal->isBlack()) {
+        pal = load_palette_from_document(filename,
+                                         FILE_LOAD_CREATE_PALETTE | FILE_LOAD_ONE_FRAME,
+                                         config);
       }
       break;
     }
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2022  Igara Studio S.A.
+// Copyright (C) 2018-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -289,108 +289,112 @@ bool PngFormat::onLoad(FileOp* fop)
     png_get_tRNS(png, info, nullptr, nullptr, &png_trans_color);
   }
 
-  // Allocate the memory to hold the image using the fields of info.
-  rows_pointer = (png_bytepp)png_malloc(png, sizeof(png_bytep) * height);
-  for (y = 0; y < height; y++)
-    rows_pointer[y] = (png_bytep)png_malloc(png, png_get_rowbytes(png, info));
+  // Read the pixels (the image is kept empty if we need just the
+  // sprite information)
+  if (!fop->isHeaderOnly()) {
+    // Allocate the memory to hold the image using the fields of info.
+    rows_pointer = (png_bytepp)png_malloc(png, sizeof(png_bytep) * height);
+    for (y = 0; y < height; y++)
+      rows_pointer[y] = (png_bytep)png_malloc(png, png_get_rowbytes(png, info));
 
-  for (int pass = 0; pass < number_passes; ++pass) {
-    for (y = 0; y < height; y++) {
-      png_read_rows(png, rows_pointer + y, nullptr, 1);
-
-      fop->setProgress((double)((double)pass + (double)(y + 1) / (double)(height)) /
-                       (double)number_passes);
-
-      if (fop->isStop())
-        break;
-    }
-  }
+    for (int pass = 0; pass < number_passes; ++pass) {
+      for (y = 0; y < height; y++) {
+        png_read_rows(png, rows_pointer + y, nullptr, 1);
 
-  // Convert rows_pointer into the doc::Image
-  for (y = 0; y < height; y++) {
-    // RGB_ALPHA
-    if (png_get_color_type(png, info) == PNG_COLOR_TYPE_RGB_ALPHA) {
-      uint8_t* src_address = rows_pointer[y];
-      uint32_t* dst_address = (uint32_t*)image->getPixelAddress(0, y);
-      unsigned int x, r, g, b, a;
+        fop->setProgress((double)((double)pass + (double)(y + 1) / (double)(height)) /
+                         (double)number_passes);
 
-      for (x = 0; x < width; x++) {
-        r = *(src_address++);
-        g = *(src_address++);
-        b = *(src_address++);
-        a = *(src_address++);
-        *(dst_address++) = rgba(r, g, b, a);
+        if (fop->isStop())
+          break;
       }
     }
-    // RGB
-    else if (png_get_color_type(png, info) == PNG_COLOR_TYPE_RGB) {
-      uint8_t* src_address = rows_pointer[y];
-      uint32_t* dst_address = (uint32_t*)image->getPixelAddress(0, y);
-      unsigned int x, r, g, b, a;
 
-      for (x = 0; x < width; x++) {
-        r = *(src_address++);
-        g = *(src_address++);
-        b = *(src_address++);
-
-        // Transparent color
-        if (png_trans_color && r == png_trans_color->red && g == png_trans_color->green &&
-            b == png_trans_color->blue) {
-          a = 0;
-          if (!fop->sequenceGetHasAlpha())
-            fop->sequenceSetHasAlpha(true);
+    // Convert rows_pointer into the doc::Image
+    for (y = 0; y < height; y++) {
+      // RGB_ALPHA
+      if (png_get_color_type(png, info) == PNG_COLOR_TYPE_RGB_ALPHA) {
+        uint8_t* src_address = rows_pointer[y];
+        uint32_t* dst_address = (uint32_t*)image->getPixelAddress(0, y);
+        unsigned int x, r, g, b, a;
+
+        for (x = 0; x < width; x++) {
+          r = *(src_address++);
+          g = *(src_address++);
+          b = *(src_address++);
+          a = *(src_address++);
+          *(dst_address++) = rgba(r, g, b, a);
         }
-        else
-          a = 255;
-
-        *(dst_address++) = rgba(r, g, b, a);
       }
-    }
-    // GRAY_ALPHA
-    else if (png_get_color_type(png, info) == PNG_COLOR_TYPE_GRAY_ALPHA) {
-      uint8_t* src_address = rows_pointer[y];
-      uint16_t* dst_address = (uint16_t*)image->getPixelAddress(0, y);
-      unsigned int x, k, a;
+      // RGB
+      else if (png_get_color_type(png, info) == PNG_COLOR_TYPE_RGB) {
+        uint8_t* src_address = rows_pointer[y];
+        uint32_t* dst_address = (uint32_t*)image->getPixelAddress(0, y);
+        unsigned int x, r, g, b, a;
+
+        for (x = 0; x < width; x++) {
+          r = *(src_address++);
+          g = *(src_address++);
+          b = *(src_address++);
+
+          // Transparent color
+          if (png_trans_color && r == png_trans_color->red && g == png_trans_color->green &&
+              b == png_trans_color->blue) {
+            a = 0;
+            if (!fop->sequenceGetHasAlpha())
+              fop->sequenceSetHasAlpha(true);
+          }
+          else
+            a = 255;
 
-      for (x = 0; x < width; x++) {
-        k = *(src_address++);
-        a = *(src_address++);
-        *(dst_address++) = graya(k, a);
+          *(dst_address++) = rgba(r, g, b, a);
+        }
       }
-    }
-    // GRAY
-    else if (png_get_color_type(png, info) == PNG_COLOR_TYPE_GRAY) {
-      uint8_t* src_address = rows_pointer[y];
-      uint16_t* dst_address = (uint16_t*)image->getPixelAddress(0, y);
-      unsigned int x, k, a;
-
-      for (x = 0; x < width; x++) {
-        k = *(src_address++);
-
-        // Transparent color
-        if (png_trans_color && k == png_trans_color->gray) {
-          a = 0;
-          if (!fop->sequenceGetHasAlpha())
-            fop->sequenceSetHasAlpha(true);
+      // GRAY_ALPHA
+      else if (png_get_color_type(png, info) == PNG_COLOR_TYPE_GRAY_ALPHA) {
+        uint8_t* src_address = rows_pointer[y];
+        uint16_t* dst_address = (uint16_t*)image->getPixelAddress(0, y);
+        unsigned int x, k, a;
+
+        for (x = 0; x < width; x++) {
+          k = *(src_address++);
+          a = *(src_address++);
+          *(dst_address++) = graya(k, a);
         }
-        else
-          a = 255;
-
-        *(dst_address++) = graya(k, a);
       }
-    }
-    // PALETTE
-    else if (png_get_color_type(png, info) == PNG_COLOR_TYPE_PALETTE) {
-      uint8_t* src_address = rows_pointer[y];
-      uint8_t* dst_address = (uint8_t*)image->getPixelAddress(0, y);
-      unsigned int x;
+      // GRAY
+      else if (png_get_color_type(png, info) == PNG_COLOR_TYPE_GRAY) {
+        uint8_t* src_address = rows_pointer[y];
+        uint16_t* dst_address = (uint16_t*)image->getPixelAddress(0, y);
+        unsigned int x, k, a;
+
+        for (x = 0; x < width; x++) {
+          k = *(src_address++);
+
+          // Transparent color
+          if (png_trans_color && k == png_trans_color->gray) {
+            a = 0;
+            if (!fop->sequenceGetHasAlpha())
+              fop->sequenceSetHasAlpha(true);
+          }
+          else
+            a = 255;
 
-      for (x = 0; x < width; x++)
-        *(dst_address++) = *(src_address++);
+          *(dst_address++) = graya(k, a);
+        }
+      }
+      // PALETTE
+      else if (png_get_color_type(png, info) == PNG_COLOR_TYPE_PALETTE) {
+        uint8_t* src_address = rows_pointer[y];
+        uint8_t* dst_address = (uint8_t*)image->getPixelAddress(0, y);
+        unsigned int x;
+
+        for (x = 0; x < width; x++)
+          *(dst_address++) = *(src_address++);
+      }
+      png_free(png, rows_pointer[y]);
     }
-    png_free(png, rows_pointer[y]);
+    png_free(png, rows_pointer);
   }
-  png_free(png, rows_pointer);
 
   // Setup the color space.
   auto colorSpace = PngFormat::loadColorSpace(png, info);
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2021-2024  Igara Studio S.A.
+// Copyright (C) 2021-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -37,6 +37,7 @@ Job::Job(const std::string& jobName, const bool showProgress)
   m_last_progress = 0.0;
   m_done_flag = false;
   m_canceled_flag = false;
+  m_started = false;
 
   if (showProgress && App::instance()->isGui()) {
     m_alert_window = ui::Alert::create(Strings::alerts_job_working(jobName));
@@ -60,7 +61,8 @@ Job::~Job()
 
 void Job::startJob()
 {
-  m_thread = std::thread(&Job::thread_proc, this);
+  m_task.run([this](base::task_token&) { thread_proc(this); });
+  m_started = true;
   ++g_runningJobs;
 
   if (m_alert_window) {
@@ -96,8 +98,9 @@ void Job::waitJob()
   if (m_timer && m_timer->isRunning())
     m_timer->stop();
 
-  if (m_thread.joinable()) {
-    m_thread.join();
+  if (m_started) {
+    m_task.wait();
+    m_started = false;
 
     --g_runningJobs;
   }
@@ -133,7 +136,7 @@ void Job::done()
   m_done_flag = true;
 }
 
-// Called to start the worker thread.
+// Called from the worker thread.
 void Job::thread_proc(Job* self)
 {
   try {
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2021-2024  Igara Studio S.A.
+// Copyright (C) 2021-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -9,6 +9,7 @@
 #define APP_JOB_H_INCLUDED
 #pragma once
 
+#include "app/task.h"
 #include "ui/alert.h"
 #include "ui/timer.h"
 
@@ -16,7 +17,6 @@
 #include <exception>
 #include <mutex>
 #include <string>
-#include <thread>
 
 namespace app {
 
@@ -30,7 +30,7 @@ public:
   Job& operator==(const Job&) = delete;
   virtual ~Job();
 
-  // Starts the job calling onJob() event in another thread and
+  // Starts the job calling onJob() event in a TaskScheduler worker and
   // monitoring the progress with onMonitorTick() event.
   void startJob();
 
@@ -46,8 +46,8 @@ public:
   bool isCanceled();
 
 protected:
-  // This member function is called from another dedicated thread
-  // outside the GUI one, so you can do some image processing here.
+  // This member function is called from a TaskScheduler worker
+  // thread (outside the GUI one), so you can do some image processing here.
   // Remember that you cannot use any GUI element in this handler.
   virtual void onJob() = 0;
 
@@ -62,7 +62,8 @@ private:
   static void monitor_proc(void* data);
   static void monitor_free(void* data);
 
-  std::thread m_thread;
+  Task m_task;
+  bool m_started;
   std::unique_ptr<ui::Timer> m_timer;
   std::mutex m_mutex;
   ui::AlertPtr m_alert_window;
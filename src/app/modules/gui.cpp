@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -38,6 +38,7 @@
 #include "base/fs.h"
 #include "base/memory.h"
 #include "base/string.h"
+#include "doc/image_buffer.h"
 #include "doc/sprite.h"
 #include "os/error.h"
 #include "os/screen.h"
@@ -110,6 +111,9 @@ static Theme* gui_theme = nullptr;
 static ui::Timer* defered_invalid_timer = nullptr;
 static gfx::Region defered_invalid_region;
 
+// Timer to release the cached image buffers when the app is idle
+static ui::Timer* image_buffer_cache_timer = nullptr;
+
 // Load & save graphics configuration
 static bool load_gui_config(os::WindowSpec& spec, bool& maximized);
 static void save_gui_config();
@@ -196,6 +200,9 @@ int init_module_gui()
   // Create the default-manager
   manager = new CustomizedGuiManager(main_window);
 
+  image_buffer_cache_timer = new ui::Timer(5000, manager);
+  image_buffer_cache_timer->start();
+
   // Setup the GUI theme for all widgets
   gui_theme = new SkinTheme;
   ui::set_theme(gui_theme, pref.general.uiScale());
@@ -233,6 +240,7 @@ void exit_module_gui()
   save_gui_config();
 
   delete defered_invalid_timer;
+  delete image_buffer_cache_timer;
   delete manager;
 
   // Now we can destroy theme
@@ -579,6 +587,9 @@ bool CustomizedGuiManager::onProcessMessage(Message* msg)
         defered_invalid_region.clear();
         defered_invalid_timer->stop();
       }
+      else if (static_cast<TimerMessage*>(msg)->timer() == image_buffer_cache_timer) {
+        doc::ImageBuffer::trimUnusedCache();
+      }
       break;
   }
 
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022-2023  Igara Studio S.A.
+// Copyright (C) 2022-2025  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -80,6 +80,22 @@ public:
   virtual void setOnionskin(const render::OnionskinOptions& options) = 0;
   virtual void disableOnionskin() = 0;
 
+  // Pre-composited layers below/above the given layer (see
+  // render::Render::renderLayersCache()). renderLayersCache()
+  // returns false if the renderer doesn't support this cache.
+  virtual bool renderLayersCache(doc::Image* belowImage,
+                                 doc::Image* aboveImage,
+                                 const doc::Sprite* sprite,
+                                 const doc::Layer* layer,
+                                 const doc::frame_t frame,
+                                 const gfx::Rect& bounds) = 0;
+  virtual void setLayersCache(const doc::Layer* layer,
+                              const doc::frame_t frame,
+                              const doc::Image* belowImage,
+                              const doc::Image* aboveImage,
+                              const gfx::Point& origin) = 0;
+  virtual void removeLayersCache() = 0;
+
   // ----------------------------------------------------------------------
   // Compositing
 
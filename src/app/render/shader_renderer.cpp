@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022-2024  Igara Studio S.A.
+// Copyright (C) 2022-2025  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -171,6 +171,31 @@ void ShaderRenderer::disableOnionskin()
   // TODO impl
 }
 
+bool ShaderRenderer::renderLayersCache(doc::Image* belowImage,
+                                       doc::Image* aboveImage,
+                                       const doc::Sprite* sprite,
+                                       const doc::Layer* layer,
+                                       const doc::frame_t frame,
+                                       const gfx::Rect& bounds)
+{
+  // TODO impl
+  return false;
+}
+
+void ShaderRenderer::setLayersCache(const doc::Layer* layer,
+                                    const doc::frame_t frame,
+                                    const doc::Image* belowImage,
+                                    const doc::Image* aboveImage,
+                                    const gfx::Point& origin)
+{
+  // TODO impl
+}
+
+void ShaderRenderer::removeLayersCache()
+{
+  // TODO impl
+}
+
 void ShaderRenderer::renderSprite(os::Surface* dstSurface,
                                   const doc::Sprite* sprite,
                                   const doc::frame_t frame,
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022-2023  Igara Studio S.A.
+// Copyright (C) 2022-2025  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -59,6 +59,18 @@ public:
   void removeExtraImage() override;
   void setOnionskin(const render::OnionskinOptions& options) override;
   void disableOnionskin() override;
+  bool renderLayersCache(doc::Image* belowImage,
+                         doc::Image* aboveImage,
+                         const doc::Sprite* sprite,
+                         const doc::Layer* layer,
+                         const doc::frame_t frame,
+                         const gfx::Rect& bounds) override;
+  void setLayersCache(const doc::Layer* layer,
+                      const doc::frame_t frame,
+                      const doc::Image* belowImage,
+                      const doc::Image* aboveImage,
+                      const gfx::Point& origin) override;
+  void removeLayersCache() override;
 
   void renderSprite(os::Surface* dstSurface,
                     const doc::Sprite* sprite,
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022-2023  Igara Studio S.A.
+// Copyright (C) 2022-2025  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -92,6 +92,30 @@ void SimpleRenderer::disableOnionskin()
   m_render.disableOnionskin();
 }
 
+bool SimpleRenderer::renderLayersCache(doc::Image* belowImage,
+                                       doc::Image* aboveImage,
+                                       const doc::Sprite* sprite,
+                                       const doc::Layer* layer,
+                                       const doc::frame_t frame,
+                                       const gfx::Rect& bounds)
+{
+  return m_render.renderLayersCache(belowImage, aboveImage, sprite, layer, frame, bounds);
+}
+
+void SimpleRenderer::setLayersCache(const doc::Layer* layer,
+                                    const doc::frame_t frame,
+                                    const doc::Image* belowImage,
+                                    const doc::Image* aboveImage,
+                                    const gfx::Point& origin)
+{
+  m_render.setLayersCache(layer, frame, belowImage, aboveImage, origin);
+}
+
+void SimpleRenderer::removeLayersCache()
+{
+  m_render.removeLayersCache();
+}
+
 void SimpleRenderer::renderSprite(os::Surface* dstSurface,
                                   const doc::Sprite* sprite,
                                   const doc::frame_t frame,
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2025  Igara Studio S.A.
 // Copyright (C) 2015-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -238,6 +238,7 @@ int Image_clear(lua_State* L)
     color = convert_args_into_pixel_color(L, i, img->pixelFormat());
 
   doc::fill_rect(img, rc, color); // Clips the rectangle to the image bounds
+  img->incrementVersion();
   return 0;
 }
 
@@ -253,6 +254,7 @@ int Image_drawPixel(lua_State* L)
   else
     color = convert_args_into_pixel_color(L, 4, img->pixelFormat());
   doc::put_pixel(img, x, y, color);
+  img->incrementVersion();
 
   // Rehash tileset
   if (obj->tilesetId) {
@@ -330,6 +332,7 @@ int Image_drawImage(lua_State* L)
                      get_current_palette(),
                      opacity,
                      blendMode);
+    dst->incrementVersion();
   }
   return 0;
 }
@@ -362,6 +365,7 @@ int Image_drawSprite(lua_State* L)
   // the source image without undo information.
   else {
     render_sprite(dst, sprite, frame, pos.x, pos.y);
+    dst->incrementVersion();
   }
   return 0;
 }
@@ -619,6 +623,7 @@ int Image_flip(lua_State* L)
   }
   else {
     doc::algorithm::flip_image(img, img->bounds(), flipType);
+    img->incrementVersion();
   }
   return 0;
 }
@@ -666,6 +671,7 @@ int Image_set_bytes(lua_State* L)
 
   if (bytes_size == bytes_needed) {
     std::memcpy(img->getPixelAddress(0, 0), bytes, bytes_size);
+    img->incrementVersion();
   }
   else {
     lua_pushfstring(L, "Data size does not match: given %d, needed %d.", bytes_size, bytes_needed);
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018  Igara Studio S.A.
+// Copyright (C) 2018-2025  Igara Studio S.A.
 // Copyright (C) 2018  David Capello
 //
 // This program is distributed under the terms of
@@ -26,10 +26,12 @@ namespace {
 
 template<typename ImageTraits>
 struct ImageIteratorObj {
+  const doc::Image* image;
   typename doc::LockImageBits<ImageTraits> bits;
   typename doc::LockImageBits<ImageTraits>::iterator begin, next, end;
   ImageIteratorObj(const doc::Image* image, const gfx::Rect& bounds)
-    : bits(image, bounds)
+    : image(image)
+    , bits(image, bounds)
     , begin(bits.begin())
     , next(begin)
     , end(bits.end())
@@ -63,6 +65,9 @@ int ImageIterator_call(lua_State* L)
   // Set value
   else {
     *obj->begin = lua_tointeger(L, 2);
+    // Invalidate the cached data of the modified image (e.g. its
+    // hash or compressed pixels)
+    const_cast<doc::Image*>(obj->image)->incrementVersion();
     return 1;
   }
 }
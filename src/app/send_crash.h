@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2020-2021  Igara Studio S.A.
+// Copyright (C) 2020-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -35,7 +35,7 @@ private:
   void onClickDevFilename();
 
 private:
-  Task m_task;
+  Task m_task{ TaskPriority::Background };
   std::string m_dumpFilename;
 };
 
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -10,35 +10,60 @@
 
 #include "app/task.h"
 
-#include "base/task.h"
-#include "base/thread.h"
-#include "base/thread_pool.h"
+#include "base/debug.h"
+#include "base/log.h"
 
 namespace app {
 
-static base::thread_pool tasks_pool(4);
-
-Task::Task() : m_token(nullptr)
+Task::Task(const TaskPriority priority)
+  : m_priority(priority)
+  , m_running(false)
+  , m_completed(false)
 {
 }
 
 Task::~Task()
 {
+  // The task function is still using this Task
+  wait();
 }
 
 void Task::run(base::task::func_t&& func)
 {
-  const std::lock_guard lock(m_token_mutex);
-  m_task.on_execute(std::move(func));
-  m_token = &m_task.start(tasks_pool);
+  auto token = std::make_shared<base::task_token>();
+  {
+    const std::lock_guard lock(m_mutex);
+    ASSERT(!m_running);
+    m_token = token;
+    m_running = true;
+    m_completed = false;
+  }
+
+  TaskScheduler::instance()->execute(m_priority, [this, token, func = std::move(func)] {
+    try {
+      if (!token->canceled())
+        func(*token);
+    }
+    catch (const std::exception& ex) {
+      LOG(ERROR, "TASK: Exception running task: %s\n", ex.what());
+    }
+    catch (...) {
+      LOG(ERROR, "TASK: Unknown exception running task\n");
+    }
+
+    // Notify with the mutex locked so the Task cannot be destroyed
+    // (from a wait() in other thread) before notify_all() returns.
+    const std::lock_guard lock(m_mutex);
+    m_running = false;
+    m_completed = true;
+    m_completedCV.notify_all();
+  });
 }
 
 void Task::wait()
 {
-  // TODO wait a condition variable
-  while (!m_task.completed()) {
-    base::this_thread::sleep_for(0.1);
-  }
+  std::unique_lock lock(m_mutex);
+  m_completedCV.wait(lock, [this] { return !m_running; });
 }
 
 } // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2020  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -8,16 +8,22 @@
 #define APP_TASK_H_INCLUDED
 #pragma once
 
+#include "app/task_scheduler.h"
 #include "base/task.h"
 
+#include <condition_variable>
 #include <functional>
+#include <memory>
 #include <mutex>
 
 namespace app {
 
+// A function executed in the TaskScheduler that can be canceled and
+// report its progress through a base::task_token.
 class Task {
 public:
-  Task();
+  Task(TaskPriority priority = TaskPriority::Interactive);
+  // Waits the task to finish (it doesn't cancel it).
   ~Task();
 
   void run(base::task::func_t&& func);
@@ -25,13 +31,21 @@ public:
 
   // Returns true when the task is completed (whether it was
   // canceled or not)
-  bool completed() const { return m_task.completed(); }
+  bool completed() const
+  {
+    const std::lock_guard lock(m_mutex);
+    return m_completed;
+  }
 
-  bool running() const { return m_task.running(); }
+  bool running() const
+  {
+    const std::lock_guard lock(m_mutex);
+    return m_running;
+  }
 
   bool canceled() const
   {
-    const std::lock_guard lock(m_token_mutex);
+    const std::lock_guard lock(m_mutex);
     if (m_token)
       return m_token->canceled();
     return false;
@@ -39,7 +53,7 @@ public:
 
   float progress() const
   {
-    const std::lock_guard lock(m_token_mutex);
+    const std::lock_guard lock(m_mutex);
     if (m_token)
       return m_token->progress();
     return 0.0f;
@@ -47,22 +61,27 @@ public:
 
   void cancel()
   {
-    const std::lock_guard lock(m_token_mutex);
+    const std::lock_guard lock(m_mutex);
     if (m_token)
       m_token->cancel();
   }
 
   void set_progress(float progress)
   {
-    const std::lock_guard lock(m_token_mutex);
+    const std::lock_guard lock(m_mutex);
     if (m_token)
       m_token->set_progress(progress);
   }
 
 private:
-  base::task m_task;
-  mutable std::mutex m_token_mutex;
-  base::task_token* m_token;
+  TaskPriority m_priority;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_completedCV;
+  // Each run() uses a new token, so a canceled execution cannot
+  // cancel the next one.
+  std::shared_ptr<base::task_token> m_token;
+  bool m_running;
+  bool m_completed;
 };
 
 } // namespace app
@@ -0,0 +1,293 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif
+
+#include "app/task_scheduler.h"
+
+#include "base/debug.h"
+#include "base/log.h"
+#include "base/thread.h"
+
+#include <algorithm>
+
+namespace app {
+
+// Worker of the current thread (only for threads of a TaskScheduler)
+static thread_local const TaskScheduler* t_scheduler = nullptr;
+static thread_local int t_workerIndex = -1;
+
+static TaskScheduler* g_instance = nullptr;
+
+// static
+TaskScheduler* TaskScheduler::instance()
+{
+  if (g_instance)
+    return g_instance;
+
+  // We don't destroy this scheduler to avoid depending on the
+  // destruction order of static objects (e.g. a task using other
+  // static object while the program exits).
+  static TaskScheduler* scheduler = new TaskScheduler(defaultWorkers());
+  return scheduler;
+}
+
+// static
+void TaskScheduler::setInstance(TaskScheduler* scheduler)
+{
+  g_instance = scheduler;
+}
+
+// static
+int TaskScheduler::defaultWorkers()
+{
+  return std::max(4, int(std::thread::hardware_concurrency()));
+}
+
+TaskScheduler::TaskScheduler(const int nworkers)
+  : m_maxBackground(std::max(1, nworkers - 1))
+  , m_runningBackground(0)
+  , m_exit(false)
+  , m_pending(0)
+{
+  ASSERT(nworkers > 0);
+
+  // First we create all workers, and then we start their threads (a
+  // worker can steal tasks from any other worker).
+  m_workers.resize(std::max(1, nworkers));
+  for (auto& worker : m_workers)
+    worker = std::make_unique<Worker>();
+  for (int i = 0; i < int(m_workers.size()); ++i)
+    m_workers[i]->thread = std::thread([this, i] { workerProc(i); });
+}
+
+TaskScheduler::~TaskScheduler()
+{
+  {
+    const std::lock_guard lock(m_mutex);
+    m_exit = true;
+  }
+  m_cv.notify_all();
+
+  // Workers finish all the remaining tasks before exiting
+  for (auto& worker : m_workers)
+    worker->thread.join();
+}
+
+void TaskScheduler::execute(const TaskPriority priority, func_t&& func)
+{
+  // A task created from a worker thread is the continuation of its
+  // current work, so we keep it in the same worker (if it's not a
+  // background task).
+  if (priority != TaskPriority::Background && t_scheduler == this) {
+    // Increment m_pending with m_mutex locked (so a worker cannot miss
+    // this notification between checking hasTasks() and waiting m_cv)
+    // and before pushing the task (so m_pending cannot be decremented
+    // by a stealer before it's incremented).
+    {
+      const std::lock_guard lock(m_mutex);
+      ++m_pending;
+    }
+    Worker* worker = m_workers[t_workerIndex].get();
+    const std::lock_guard lock(worker->mutex);
+    worker->queue.push_back(std::move(func));
+  }
+  else {
+    const std::lock_guard lock(m_mutex);
+    switch (priority) {
+      case TaskPriority::UILatency:
+        m_uiQueue.push_back(std::move(func));
+        ++m_pending;
+        break;
+      case TaskPriority::Interactive:
+        m_interactiveQueue.push_back(std::move(func));
+        ++m_pending;
+        break;
+      case TaskPriority::Background: m_backgroundQueue.push_back(std::move(func)); break;
+    }
+  }
+  m_cv.notify_one();
+}
+
+void TaskScheduler::workerProc(const int index)
+{
+  t_scheduler = this;
+  t_workerIndex = index;
+  base::this_thread::set_name("tasks");
+
+  while (true) {
+    func_t func;
+    bool background = false;
+    if (popTask(index, func, background)) {
+      try {
+        func();
+      }
+      catch (const std::exception& ex) {
+        LOG(ERROR, "TASK: Exception running a task: %s\n", ex.what());
+      }
+      catch (...) {
+        LOG(ERROR, "TASK: Unknown exception running a task\n");
+      }
+      func = nullptr;
+
+      if (background) {
+        {
+          const std::lock_guard lock(m_mutex);
+          --m_runningBackground;
+        }
+        // Another worker can run the next background task
+        m_cv.notify_one();
+      }
+      continue;
+    }
+
+    std::unique_lock lock(m_mutex);
+    if (m_exit && m_pending == 0 && m_backgroundQueue.empty())
+      break;
+    m_cv.wait(lock, [this] { return m_exit || hasTasks(); });
+  }
+}
+
+// Gets the next task to execute in the given worker: first the tasks
+// of the worker itself (the last added one), then the global queues
+// by priority, and finally steals the oldest task from other workers.
+bool TaskScheduler::popTask(const int index, func_t& func, bool& background)
+{
+  {
+    Worker* worker = m_workers[index].get();
+    const std::lock_guard lock(worker->mutex);
+    if (!worker->queue.empty()) {
+      func = std::move(worker->queue.back());
+      worker->queue.pop_back();
+      --m_pending;
+      return true;
+    }
+  }
+
+  {
+    const std::lock_guard lock(m_mutex);
+    for (auto* queue : { &m_uiQueue, &m_interactiveQueue }) {
+      if (!queue->empty()) {
+        func = std::move(queue->front());
+        queue->pop_front();
+        --m_pending;
+        return true;
+      }
+    }
+    if (!m_backgroundQueue.empty() && m_runningBackground < m_maxBackground) {
+      func = std::move(m_backgroundQueue.front());
+      m_backgroundQueue.pop_front();
+      ++m_runningBackground;
+      background = true;
+      return true;
+    }
+  }
+
+  const int n = int(m_workers.size());
+  for (int i = 1; i < n; ++i) {
+    Worker* victim = m_workers[(index + i) % n].get();
+    const std::lock_guard lock(victim->mutex);
+    if (!victim->queue.empty()) {
+      func = std::move(victim->queue.front());
+      victim->queue.pop_front();
+      --m_pending;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Must be called with m_mutex locked.
+bool TaskScheduler::hasTasks() const
+{
+  return (m_pending > 0 ||
+          (!m_backgroundQueue.empty() && m_runningBackground < m_maxBackground));
+}
+
+TaskGroup::TaskGroup(const TaskPriority priority, TaskScheduler* scheduler)
+  : m_priority(priority)
+  , m_scheduler(scheduler)
+  , m_state(std::make_shared<State>())
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+  try {
+    wait();
+  }
+  catch (...) {
+    // Exceptions are rethrown only by an explicit wait()
+  }
+}
+
+void TaskGroup::execute(func_t&& func)
+{
+  {
+    const std::lock_guard lock(m_state->mutex);
+    m_state->queue.push_back(std::move(func));
+  }
+  // The scheduled task keeps a reference to the state, so it can run
+  // after the group is destroyed (when wait() executed the function).
+  m_scheduler->execute(m_priority, [state = m_state] { runOne(state); });
+}
+
+bool TaskGroup::runOne()
+{
+  return runOne(m_state);
+}
+
+void TaskGroup::wait()
+{
+  // Execute the pending functions in this thread instead of waiting
+  // them (so we can wait from a worker thread without a deadlock).
+  while (runOne(m_state))
+    ;
+
+  std::unique_lock lock(m_state->mutex);
+  m_state->cv.wait(lock, [this] { return m_state->running == 0; });
+  if (m_state->exception) {
+    std::exception_ptr ex;
+    std::swap(ex, m_state->exception);
+    std::rethrow_exception(ex);
+  }
+}
+
+// static
+bool TaskGroup::runOne(const std::shared_ptr<State>& state)
+{
+  func_t func;
+  {
+    const std::lock_guard lock(state->mutex);
+    if (state->queue.empty())
+      return false;
+    func = std::move(state->queue.front());
+    state->queue.pop_front();
+    ++state->running;
+  }
+
+  std::exception_ptr ex;
+  try {
+    func();
+  }
+  catch (...) {
+    ex = std::current_exception();
+  }
+  func = nullptr;
+
+  {
+    const std::lock_guard lock(state->mutex);
+    if (ex && !state->exception)
+      state->exception = ex;
+    --state->running;
+  }
+  state->cv.notify_all();
+  return true;
+}
+
+} // namespace app
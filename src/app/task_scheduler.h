@@ -0,0 +1,142 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_TASK_SCHEDULER_H_INCLUDED
+#define APP_TASK_SCHEDULER_H_INCLUDED
+#pragma once
+
+#include "base/disable_copying.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace app {
+
+enum class TaskPriority {
+  // Tasks that the user is waiting to see on the screen (e.g. the
+  // background painting of a widget).
+  UILatency,
+  // Tasks started by the user (e.g. a filter preview or a job with a
+  // progress bar).
+  Interactive,
+  // Tasks that can wait (e.g. generating thumbnails of files).
+  Background,
+};
+
+// Process-wide set of worker threads (one per CPU core) used to
+// execute tasks, so each subsystem doesn't need to create its own
+// threads.
+//
+// Tasks executed from a worker thread are added to the queue of that
+// same worker (they are the continuation of its current work), and
+// idle workers steal tasks from the queues of other workers. Tasks
+// from other threads are executed by priority. Background tasks never
+// use all workers, so there is always a worker available for
+// UILatency/Interactive tasks.
+class TaskScheduler {
+public:
+  using func_t = std::function<void()>;
+
+  explicit TaskScheduler(int nworkers);
+  ~TaskScheduler();
+
+  // Returns the scheduler owned by the App (see setInstance()), or,
+  // in programs without an App (e.g. unit tests), a scheduler that
+  // is never destroyed.
+  static TaskScheduler* instance();
+  static void setInstance(TaskScheduler* scheduler);
+
+  // At least 4 workers because some tasks (e.g. loading files) spend
+  // most of their time waiting I/O operations.
+  static int defaultWorkers();
+
+  int workers() const { return int(m_workers.size()); }
+
+  // Executes the given function in a worker thread.
+  void execute(TaskPriority priority, func_t&& func);
+
+private:
+  struct Worker {
+    std::thread thread;
+    std::mutex mutex;
+    std::deque<func_t> queue;
+  };
+
+  void workerProc(int index);
+  bool popTask(int index, func_t& func, bool& background);
+  bool hasTasks() const;
+
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  // Maximum number of workers running background tasks at the same time
+  int m_maxBackground;
+
+  // Protects the global queues, m_runningBackground and m_exit, and
+  // it's used to wait/notify m_cv.
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<func_t> m_uiQueue;
+  std::deque<func_t> m_interactiveQueue;
+  std::deque<func_t> m_backgroundQueue;
+  int m_runningBackground;
+  bool m_exit;
+
+  // Number of UILatency/Interactive tasks in all queues
+  std::atomic<int> m_pending;
+
+  DISABLE_COPYING(TaskScheduler);
+};
+
+// A set of related tasks executed in a TaskScheduler with the same
+// priority that can be waited together. E.g. the rows of an image
+// processed in parallel.
+class TaskGroup {
+public:
+  using func_t = TaskScheduler::func_t;
+
+  explicit TaskGroup(TaskPriority priority,
+                     TaskScheduler* scheduler = TaskScheduler::instance());
+  ~TaskGroup();
+
+  // Adds a new task to the group.
+  void execute(func_t&& func);
+
+  // Executes one pending task of the group in the current thread,
+  // returns false if there are no pending tasks.
+  bool runOne();
+
+  // Waits all tasks of the group, helping to execute the pending
+  // ones from the current thread. Rethrows the first exception
+  // thrown by a task.
+  void wait();
+
+private:
+  struct State {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<func_t> queue;
+    int running = 0;
+    std::exception_ptr exception;
+  };
+
+  static bool runOne(const std::shared_ptr<State>& state);
+
+  TaskPriority m_priority;
+  TaskScheduler* m_scheduler;
+  std::shared_ptr<State> m_state;
+
+  DISABLE_COPYING(TaskGroup);
+};
+
+} // namespace app
+
+#endif
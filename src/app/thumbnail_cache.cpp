@@ -0,0 +1,307 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif
+
+#include "app/thumbnail_cache.h"
+
+#include "base/file_handle.h"
+#include "base/fs.h"
+#include "base/fstream_path.h"
+#include "base/log.h"
+#include "base/serialization.h"
+#include "base/time.h"
+#include "fmt/format.h"
+#include "os/system.h"
+#include "zlib.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#define THUMBCACHE_TRACE(...)
+
+namespace app {
+
+using namespace base::serialization;
+using namespace base::serialization::little_endian;
+
+namespace {
+
+// Increase this version if the generated thumbnails change (e.g. a
+// different size), so old thumbnails are not used anymore.
+const char* kKeyVersion = "1";
+
+const char* kIndexFilename = "index";
+const char* kEntryExtension = "thumb";
+const uint32_t kEntryMagic = 0x4D554854; // "THUM"
+
+// Maximum size of a thumbnail (just to validate cached files)
+const int kMaxSize = 1024;
+
+// Key that identifies a specific version of a file
+std::string make_key(const std::string& filename)
+{
+  if (!base::is_file(filename))
+    return std::string();
+
+  const base::Time t = base::get_modification_time(filename);
+  return fmt::format("{}|{}|{}|{:04}{:02}{:02}{:02}{:02}{:02}",
+                     kKeyVersion,
+                     filename,
+                     base::file_size(filename),
+                     t.year,
+                     t.month,
+                     t.day,
+                     t.hour,
+                     t.minute,
+                     t.second);
+}
+
+// 64-bit FNV-1a hash, we need the same hash between different runs
+// of the program (std::hash doesn't guarantee it)
+uint64_t hash_key(const std::string& key)
+{
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (const char chr : key) {
+    hash ^= uint8_t(chr);
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+} // anonymous namespace
+
+ThumbnailCache::ThumbnailCache(const std::string& dir, const size_t maxSize)
+  : m_dir(dir)
+  , m_maxSize(maxSize)
+  , m_totalSize(0)
+  , m_clock(0)
+{
+  try {
+    if (!base::is_directory(m_dir))
+      base::make_all_directories(m_dir);
+
+    loadIndex();
+  }
+  catch (const std::exception& ex) {
+    LOG(ERROR, "THUMBCACHE: Error loading thumbnail cache %s\n", ex.what());
+  }
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+  try {
+    saveIndex();
+  }
+  catch (const std::exception& ex) {
+    LOG(ERROR, "THUMBCACHE: Error saving thumbnail cache index %s\n", ex.what());
+  }
+}
+
+os::SurfaceRef ThumbnailCache::get(const std::string& filename)
+{
+  const std::string key = make_key(filename);
+  if (key.empty())
+    return nullptr;
+
+  const uint64_t hash = hash_key(key);
+  {
+    const std::lock_guard lock(m_mutex);
+    auto it = m_entries.find(hash);
+    if (it == m_entries.end())
+      return nullptr;
+    it->second.lastUse = ++m_clock;
+  }
+
+  std::ifstream s(FSTREAM_PATH(entryFilename(hash)), std::ifstream::binary);
+  if (!s || read32(s) != kEntryMagic)
+    return nullptr;
+
+  std::string entryKey(read16(s), 0);
+  s.read(entryKey.data(), entryKey.size());
+  const int w = read16(s);
+  const int h = read16(s);
+  const uLong compressedSize = read32(s);
+  if (!s || entryKey != key || w < 1 || h < 1 || w > kMaxSize || h > kMaxSize)
+    return nullptr; // Hash collision or invalid file
+
+  std::vector<uint8_t> compressed(compressedSize);
+  if (!s.read((char*)compressed.data(), compressed.size()))
+    return nullptr;
+
+  const int rowBytes = 4 * w;
+  std::vector<uint8_t> pixels(rowBytes * h);
+  uLongf pixelsSize = pixels.size();
+  if (uncompress(pixels.data(), &pixelsSize, compressed.data(), compressed.size()) != Z_OK ||
+      pixelsSize != pixels.size()) {
+    return nullptr;
+  }
+
+  os::SurfaceRef thumbnail = os::instance()->makeRgbaSurface(w, h);
+  {
+    os::SurfaceLock lockDst(thumbnail.get());
+    for (int y = 0; y < h; ++y)
+      std::copy_n(&pixels[y * rowBytes], rowBytes, thumbnail->getData(0, y));
+  }
+
+  THUMBCACHE_TRACE("THUMBCACHE: Cache hit %s\n", filename.c_str());
+  return thumbnail;
+}
+
+void ThumbnailCache::set(const std::string& filename, os::Surface* thumbnail)
+{
+  if (m_maxSize == 0)
+    return;
+
+  const std::string key = make_key(filename);
+  if (key.empty())
+    return;
+
+  const int w = thumbnail->width();
+  const int h = thumbnail->height();
+  if (w < 1 || h < 1 || w > kMaxSize || h > kMaxSize)
+    return;
+
+  const int rowBytes = 4 * w;
+  std::vector<uint8_t> pixels(rowBytes * h);
+  {
+    os::SurfaceLock lockSrc(thumbnail);
+    for (int y = 0; y < h; ++y)
+      std::copy_n(thumbnail->getData(0, y), rowBytes, &pixels[y * rowBytes]);
+  }
+
+  uLongf compressedSize = compressBound(pixels.size());
+  std::vector<uint8_t> compressed(compressedSize);
+  if (compress2(compressed.data(), &compressedSize, pixels.data(), pixels.size(), Z_BEST_SPEED) !=
+      Z_OK) {
+    return;
+  }
+
+  std::ostringstream data;
+  write32(data, kEntryMagic);
+  write16(data, key.size());
+  data.write(key.data(), key.size());
+  write16(data, w);
+  write16(data, h);
+  write32(data, compressedSize);
+  data.write((const char*)compressed.data(), compressedSize);
+  const std::string buf = data.str();
+
+  // Write the file with a temporary name so other threads/processes
+  // don't read an incomplete thumbnail.
+  const uint64_t hash = hash_key(key);
+  const std::string fn = entryFilename(hash);
+  const std::string tmpFn = fn + ".tmp";
+  try {
+    {
+      base::FileHandle f = base::open_file(tmpFn, "wb");
+      if (!f || fwrite(buf.data(), 1, buf.size(), f.get()) != buf.size())
+        return;
+    }
+    if (base::is_file(fn))
+      base::delete_file(fn);
+    base::move_file(tmpFn, fn);
+  }
+  catch (const std::exception& ex) {
+    LOG(ERROR, "THUMBCACHE: Error saving thumbnail %s\n", ex.what());
+    return;
+  }
+
+  const std::lock_guard lock(m_mutex);
+  Entry& entry = m_entries[hash];
+  m_totalSize -= entry.size;
+  entry.size = buf.size();
+  entry.lastUse = ++m_clock;
+  m_totalSize += entry.size;
+
+  if (m_totalSize > m_maxSize)
+    evictOldEntries();
+}
+
+// Loads the list of cached thumbnails from the directory, and the
+// last time each one was used from the index file.
+void ThumbnailCache::loadIndex()
+{
+  for (const auto& fn : base::list_files(m_dir, base::ItemType::Files)) {
+    if (base::get_file_extension(fn) != kEntryExtension)
+      continue;
+
+    const std::string title = base::get_file_title(fn);
+    char* end = nullptr;
+    const uint64_t hash = std::strtoull(title.c_str(), &end, 16);
+    if (title.empty() || *end != 0)
+      continue;
+
+    Entry& entry = m_entries[hash];
+    entry.size = base::file_size(base::join_path(m_dir, fn));
+    m_totalSize += entry.size;
+  }
+
+  std::ifstream s(FSTREAM_PATH(base::join_path(m_dir, kIndexFilename)));
+  std::string hashStr;
+  uint64_t lastUse;
+  while (s >> hashStr >> lastUse) {
+    auto it = m_entries.find(std::strtoull(hashStr.c_str(), nullptr, 16));
+    if (it != m_entries.end()) {
+      it->second.lastUse = lastUse;
+      m_clock = std::max(m_clock, lastUse);
+    }
+  }
+
+  if (m_totalSize > m_maxSize)
+    evictOldEntries();
+}
+
+void ThumbnailCache::saveIndex()
+{
+  const std::lock_guard lock(m_mutex);
+  std::ofstream s(FSTREAM_PATH(base::join_path(m_dir, kIndexFilename)));
+  for (const auto& item : m_entries)
+    s << fmt::format("{:016x} {}\n", item.first, item.second.lastUse);
+}
+
+// Deletes the least recently used thumbnails until the cache uses
+// 90% of its maximum size (so we don't evict entries each time a new
+// thumbnail is added).
+void ThumbnailCache::evictOldEntries()
+{
+  std::vector<std::pair<uint64_t, uint64_t>> entries; // lastUse, hash
+  entries.reserve(m_entries.size());
+  for (const auto& item : m_entries)
+    entries.emplace_back(item.second.lastUse, item.first);
+  std::sort(entries.begin(), entries.end());
+
+  const size_t targetSize = m_maxSize / 10 * 9;
+  for (const auto& item : entries) {
+    if (m_totalSize <= targetSize)
+      break;
+
+    auto it = m_entries.find(item.second);
+    try {
+      base::delete_file(entryFilename(item.second));
+    }
+    catch (const std::exception&) {
+      // Ignore errors, the file could be already deleted by other
+      // process
+    }
+    m_totalSize -= it->second.size;
+    m_entries.erase(it);
+
+    THUMBCACHE_TRACE("THUMBCACHE: Evict %016llx\n", item.second);
+  }
+}
+
+std::string ThumbnailCache::entryFilename(const uint64_t hash) const
+{
+  return base::join_path(m_dir, fmt::format("{:016x}.{}", hash, kEntryExtension));
+}
+
+} // namespace app
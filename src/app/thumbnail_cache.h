@@ -0,0 +1,67 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_THUMBNAIL_CACHE_H_INCLUDED
+#define APP_THUMBNAIL_CACHE_H_INCLUDED
+#pragma once
+
+#include "base/disable_copying.h"
+#include "os/surface.h"
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace app {
+
+// Thumbnails of files saved on disk, so they don't need to be
+// generated again each time a folder is browsed (even after
+// restarting the program).
+//
+// Each thumbnail is saved in its own file, named with a hash of the
+// original file path, size, and modification time (so a modified
+// file gets a new thumbnail). When the cache is bigger than the
+// given size, the least recently used thumbnails are deleted.
+//
+// All member functions are thread-safe.
+class ThumbnailCache {
+public:
+  ThumbnailCache(const std::string& dir, size_t maxSize);
+  ~ThumbnailCache();
+
+  // Returns the cached thumbnail for the given file, or nullptr if
+  // it's not in the cache.
+  os::SurfaceRef get(const std::string& filename);
+
+  // Saves the thumbnail of the given file in the cache.
+  void set(const std::string& filename, os::Surface* thumbnail);
+
+private:
+  struct Entry {
+    size_t size = 0;
+    // Value of m_clock when the entry was used for the last time
+    uint64_t lastUse = 0;
+  };
+
+  void loadIndex();
+  void saveIndex();
+  void evictOldEntries();
+  std::string entryFilename(uint64_t hash) const;
+
+  std::string m_dir;
+  size_t m_maxSize;
+  size_t m_totalSize;
+  uint64_t m_clock;
+  std::map<uint64_t, Entry> m_entries;
+  std::mutex m_mutex;
+
+  DISABLE_COPYING(ThumbnailCache);
+};
+
+} // namespace app
+
+#endif
@@ -0,0 +1,185 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#define TEST_GUI
+#include "tests/app_test.h"
+
+#include "app/thumbnail_cache.h"
+#include "base/file_handle.h"
+#include "base/fs.h"
+#include "os/surface.h"
+#include "os/system.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace app;
+
+namespace {
+
+const std::string kCacheDir = "_test_thumbnail_cache";
+
+void write_file(const std::string& fn, const std::string& content)
+{
+  base::FileHandle f = base::open_file(fn, "wb");
+  ASSERT_TRUE(f != nullptr);
+  fwrite(content.data(), 1, content.size(), f.get());
+}
+
+size_t cache_dir_size()
+{
+  size_t size = 0;
+  for (const auto& fn : base::list_files(kCacheDir, base::ItemType::Files)) {
+    if (base::get_file_extension(fn) == "thumb")
+      size += base::file_size(base::join_path(kCacheDir, fn));
+  }
+  return size;
+}
+
+void delete_cache_dir()
+{
+  if (!base::is_directory(kCacheDir))
+    return;
+  for (const auto& fn : base::list_files(kCacheDir, base::ItemType::Files))
+    base::delete_file(base::join_path(kCacheDir, fn));
+  base::remove_directory(kCacheDir);
+}
+
+os::SurfaceRef make_thumbnail(const int w, const int h)
+{
+  os::SurfaceRef thumbnail = os::instance()->makeRgbaSurface(w, h);
+  os::SurfaceLock lock(thumbnail.get());
+  for (int y = 0; y < h; ++y) {
+    uint8_t* p = thumbnail->getData(0, y);
+    for (int x = 0; x < 4 * w; ++x)
+      *(p++) = uint8_t((x * 7 + y * 13) ^ (x * y));
+  }
+  return thumbnail;
+}
+
+void expect_same_thumbnails(os::Surface* a, os::Surface* b)
+{
+  ASSERT_TRUE(a != nullptr);
+  ASSERT_TRUE(b != nullptr);
+  ASSERT_EQ(a->width(), b->width());
+  ASSERT_EQ(a->height(), b->height());
+  os::SurfaceLock lockA(a);
+  os::SurfaceLock lockB(b);
+  const int rowBytes = 4 * a->width();
+  for (int y = 0; y < a->height(); ++y)
+    EXPECT_EQ(0, std::memcmp(a->getData(0, y), b->getData(0, y), rowBytes)) << "row " << y;
+}
+
+} // anonymous namespace
+
+TEST(ThumbnailCache, Hit)
+{
+  delete_cache_dir();
+  write_file("_test_thumb_a.ase", "content");
+
+  os::SurfaceRef thumbnail = make_thumbnail(20, 10);
+  {
+    ThumbnailCache cache(kCacheDir, 1024 * 1024);
+    EXPECT_EQ(nullptr, cache.get("_test_thumb_a.ase").get());
+
+    cache.set("_test_thumb_a.ase", thumbnail.get());
+    expect_same_thumbnails(thumbnail.get(), cache.get("_test_thumb_a.ase").get());
+
+    // Files that are not in the cache or don't exist
+    EXPECT_EQ(nullptr, cache.get("_test_thumb_b.ase").get());
+  }
+
+  // The thumbnail is still there after re-opening the cache
+  {
+    ThumbnailCache cache(kCacheDir, 1024 * 1024);
+    expect_same_thumbnails(thumbnail.get(), cache.get("_test_thumb_a.ase").get());
+  }
+
+  base::delete_file("_test_thumb_a.ase");
+  delete_cache_dir();
+}
+
+TEST(ThumbnailCache, StaleFile)
+{
+  delete_cache_dir();
+  write_file("_test_thumb_a.ase", "content");
+
+  ThumbnailCache cache(kCacheDir, 1024 * 1024);
+  os::SurfaceRef thumbnail = make_thumbnail(16, 16);
+  cache.set("_test_thumb_a.ase", thumbnail.get());
+  EXPECT_NE(nullptr, cache.get("_test_thumb_a.ase").get());
+
+  // Different size
+  write_file("_test_thumb_a.ase", "new content");
+  EXPECT_EQ(nullptr, cache.get("_test_thumb_a.ase").get());
+
+  // Same size, different modification time (wait more than the
+  // modification time resolution)
+  cache.set("_test_thumb_a.ase", thumbnail.get());
+  EXPECT_NE(nullptr, cache.get("_test_thumb_a.ase").get());
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  write_file("_test_thumb_a.ase", "NEW CONTENT");
+  EXPECT_EQ(nullptr, cache.get("_test_thumb_a.ase").get());
+
+  base::delete_file("_test_thumb_a.ase");
+  delete_cache_dir();
+}
+
+TEST(ThumbnailCache, EvictLeastRecentlyUsed)
+{
+  delete_cache_dir();
+  const char* files[] = { "_test_thumb_a.ase",
+                          "_test_thumb_b.ase",
+                          "_test_thumb_c.ase",
+                          "_test_thumb_d.ase" };
+  for (const char* fn : files)
+    write_file(fn, "content");
+
+  // Size of each thumbnail in the cache (all files use the same
+  // thumbnail and their names have the same length)
+  os::SurfaceRef thumbnail = make_thumbnail(32, 32);
+  size_t entrySize;
+  {
+    ThumbnailCache cache(kCacheDir, 1024 * 1024);
+    cache.set(files[0], thumbnail.get());
+    entrySize = cache_dir_size();
+  }
+  delete_cache_dir();
+  ASSERT_GT(entrySize, 0u);
+
+  {
+    ThumbnailCache cache(kCacheDir, entrySize * 7 / 2);
+    cache.set(files[0], thumbnail.get());
+    cache.set(files[1], thumbnail.get());
+    cache.set(files[2], thumbnail.get());
+    EXPECT_EQ(3 * entrySize, cache_dir_size());
+
+    // Use the first thumbnail, so the second one is the oldest
+    EXPECT_NE(nullptr, cache.get(files[0]).get());
+
+    cache.set(files[3], thumbnail.get());
+    EXPECT_EQ(3 * entrySize, cache_dir_size());
+    EXPECT_NE(nullptr, cache.get(files[0]).get());
+    EXPECT_EQ(nullptr, cache.get(files[1]).get());
+    EXPECT_NE(nullptr, cache.get(files[2]).get());
+    EXPECT_NE(nullptr, cache.get(files[3]).get());
+  }
+
+  // The size limit is applied when the cache is loaded too
+  {
+    ThumbnailCache cache(kCacheDir, entrySize * 3 / 2);
+    EXPECT_EQ(entrySize, cache_dir_size());
+    EXPECT_NE(nullptr, cache.get(files[3]).get());
+  }
+
+  for (const char* fn : files)
+    base::delete_file(fn);
+  delete_cache_dir();
+}
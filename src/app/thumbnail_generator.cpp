@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -16,8 +16,12 @@
 #include "app/doc.h"
 #include "app/file/file.h"
 #include "app/file_system.h"
+#include "app/pref/preferences.h"
+#include "app/resource_finder.h"
+#include "app/task_scheduler.h"
+#include "app/thumbnail_cache.h"
 #include "app/util/conversion_to_surface.h"
-#include "base/thread.h"
+#include "base/fs.h"
 #include "doc/algorithm/rotate.h"
 #include "doc/image.h"
 #include "doc/palette.h"
@@ -30,8 +34,8 @@
 
 #include <algorithm>
 #include <atomic>
+#include <condition_variable>
 #include <memory>
-#include <thread>
 
 #define MAX_THUMBNAIL_SIZE 128
 #define THUMB_TRACE(...)
@@ -40,27 +44,28 @@ namespace app {
 
 class ThumbnailGenerator::Worker {
 public:
-  Worker(base::concurrent_queue<ThumbnailGenerator::Item>& queue)
+  Worker(base::concurrent_queue<ThumbnailGenerator::Item>& queue, ThumbnailCache* cache)
     : m_queue(queue)
+    , m_cache(cache)
     , m_fop(nullptr)
+    , m_stop(false)
     , m_isDone(false)
-    , m_thread([this] { loadBgThread(); })
   {
+    TaskScheduler::instance()->execute(TaskPriority::Background, [this] { loadNextItem(); });
   }
 
   ~Worker()
   {
-    {
-      const std::lock_guard lock(m_mutex);
-      if (m_fop)
-        m_fop->stop();
-    }
-    m_thread.join();
+    stop();
+    std::unique_lock lock(m_mutex);
+    m_doneCV.wait(lock, [this] { return m_isDone.load(); });
   }
 
-  void stop() const
+  // Stops loading the current item.
+  void stop()
   {
     const std::lock_guard lock(m_mutex);
+    m_stop = true;
     if (m_fop)
       m_fop->stop();
   }
@@ -70,8 +75,8 @@ public:
   void updateProgress()
   {
     const std::lock_guard lock(m_mutex);
-    if (m_item.fileitem && m_item.fop) {
-      double progress = m_item.fop->progress();
+    if (m_item.fileitem && m_fop) {
+      double progress = m_fop->progress();
       if (progress > m_item.fileitem->getThumbnailProgress())
         m_item.fileitem->setThumbnailProgress(progress);
     }
@@ -81,104 +86,53 @@ private:
   void loadItem()
   {
     ASSERT(!m_fop);
+    bool stopped = false;
     try {
-      {
+      const std::string filename = m_item.fileitem->fileName();
+      THUMB_TRACE("FOP loading thumbnail: %s\n", filename.c_str());
+
+      // Use the thumbnail saved in the disk cache (if the file wasn't
+      // modified since the thumbnail was generated), we check it from
+      // this background thread because it reads the file from disk.
+      os::SurfaceRef thumbnail = (m_cache ? m_cache->get(filename) : nullptr);
+      if (thumbnail) {
         const std::lock_guard lock(m_mutex);
-        m_fop = m_item.fop;
-        ASSERT(m_fop);
-      }
-
-      THUMB_TRACE("FOP loading thumbnail: %s\n", m_item.fileitem->fileName().c_str());
-
-      // Load the file
-      m_fop->operate(nullptr);
-
-      // Don't call post-load because postLoad() needs user interaction.
-      // m_fop->postLoad();
-
-      // Convert the loaded document into the os::Surface.
-      const Sprite* sprite =
-        (m_fop->document() && m_fop->document()->sprite() ? m_fop->document()->sprite() : nullptr);
-
-      std::unique_ptr<Image> thumbnailImage;
-      std::unique_ptr<Palette> palette;
-      if (!m_fop->isStop() && sprite) {
-        // The palette to convert the Image
-        palette.reset(new Palette(*sprite->palette(frame_t(0))));
-
-        // Special case for indexed images:
-        // If the sprite is transparent -> set the transparent color index alpha = 0
-        if (sprite->colorMode() == ColorMode::INDEXED && !sprite->backgroundLayer()) {
-          int i = sprite->transparentColor();
-          if (i >= 0 && i < int(palette->size()))
-            palette->setEntry(i, doc::rgba(0, 0, 0, 0));
-        }
-
-        const int w = sprite->width() * sprite->pixelRatio().w;
-        const int h = sprite->height() * sprite->pixelRatio().h;
-
-        // Calculate the thumbnail size
-        int thumb_w = MAX_THUMBNAIL_SIZE * w / std::max(w, h);
-        int thumb_h = MAX_THUMBNAIL_SIZE * h / std::max(w, h);
-        if (std::max(thumb_w, thumb_h) > std::max(w, h)) {
-          thumb_w = w;
-          thumb_h = h;
-        }
-        thumb_w = std::clamp(thumb_w, 1, MAX_THUMBNAIL_SIZE);
-        thumb_h = std::clamp(thumb_h, 1, MAX_THUMBNAIL_SIZE);
-
-        // Stretch the 'image'
-        thumbnailImage.reset(Image::create(sprite->pixelFormat(), thumb_w, thumb_h));
-
-        render::Projection proj(sprite->pixelRatio(), render::Zoom(thumb_w, w));
-        render::Render render;
-        render.setBgOptions(render::BgOptions::MakeTransparent());
-        render.setProjection(proj);
-        render.renderSprite(thumbnailImage.get(), sprite, frame_t(0), gfx::Clip(0, 0, 0, 0, w, h));
-
-        // Convert the image to sRGB color space
-        auto cs = sprite->colorSpace();
-        if (m_fop->preserveColorProfile() && cs && !cs->nearlyEqual(*gfx::ColorSpace::MakeSRGB())) {
-          app::cmd::convert_color_profile(thumbnailImage.get(),
-                                          palette.get(),
-                                          cs,
-                                          gfx::ColorSpace::MakeSRGB());
-        }
+        m_item.fileitem->setThumbnail(thumbnail);
       }
-
-      // Close file
-      delete m_fop->releaseDocument();
-
-      // Set the thumbnail of the file-item.
-      if (thumbnailImage) {
-        os::SurfaceRef thumbnail = os::instance()->makeRgbaSurface(thumbnailImage->width(),
-                                                                   thumbnailImage->height());
-
-        convert_image_to_surface(thumbnailImage.get(),
-                                 palette.get(),
-                                 thumbnail.get(),
-                                 0,
-                                 0,
-                                 0,
-                                 0,
-                                 thumbnailImage->width(),
-                                 thumbnailImage->height());
-
-        {
-          const std::lock_guard lock(m_mutex);
-          m_item.fileitem->setThumbnail(thumbnail);
+      else {
+        // The FileOp is created only when we have to load the file.
+        // We need the pixels of the first frame only (all formats stop
+        // decoding after it with FILE_LOAD_ONE_FRAME),
+        // FILE_LOAD_HEADER_ONLY cannot be used here as it skips all
+        // pixels.
+        std::unique_ptr<FileOp> fop(
+          FileOp::createLoadDocumentOperation(nullptr,
+                                              filename.c_str(),
+                                              FILE_LOAD_SEQUENCE_NONE | FILE_LOAD_ONE_FRAME));
+        if (fop && !fop->hasError()) {
+          {
+            const std::lock_guard lock(m_mutex);
+            m_fop = fop.release();
+            if (m_stop)
+              m_fop->stop();
+          }
+          generateThumbnail(filename);
         }
       }
 
       THUMB_TRACE("FOP done with thumbnail: %s %s\n",
                   m_item.fileitem->fileName().c_str(),
-                  (m_fop->isStop() ? " (stop)" : ""));
+                  (m_fop && m_fop->isStop() ? " (stop)" : ""));
     }
     catch (const std::exception& e) {
-      m_fop->setError("Error loading file:\n%s", e.what());
+      if (m_fop)
+        m_fop->setError("Error loading file:\n%s", e.what());
     }
 
-    if (!m_fop->isStop()) {
+    if (m_fop)
+      stopped = m_fop->isStop();
+
+    if (!stopped) {
       // Set a nullptr thumbnail if we failed loading the given file,
       // in this way we're not going to re-try generating this same
       // thumbnail.
@@ -193,41 +147,139 @@ private:
       m_item.fileitem = nullptr;
     }
 
-    m_fop->done();
-    {
+    if (m_fop) {
+      m_fop->done();
       const std::lock_guard lock(m_mutex);
-      m_item.fop = nullptr;
       delete m_fop;
       m_fop = nullptr;
     }
     ASSERT(!m_fop);
   }
 
-  void loadBgThread()
+  // Loads the file and generates its thumbnail (saving it in the
+  // disk cache too).
+  void generateThumbnail(const std::string& filename)
   {
-    base::this_thread::set_name("thumbnails");
-
-    while (!m_queue.empty()) {
-      bool success = true;
-      while (success) {
-        {
-          const std::lock_guard lock(m_mutex); // To access m_item
-          success = m_queue.try_pop(m_item);
-        }
-        if (success)
-          loadItem();
+    // Load the file
+    m_fop->operate(nullptr);
+
+    // Don't call post-load because postLoad() needs user interaction.
+    // m_fop->postLoad();
+
+    // Convert the loaded document into the os::Surface.
+    const Sprite* sprite =
+      (m_fop->document() && m_fop->document()->sprite() ? m_fop->document()->sprite() : nullptr);
+
+    std::unique_ptr<Image> thumbnailImage;
+    std::unique_ptr<Palette> palette;
+    if (!m_fop->isStop() && sprite) {
+      // The palette to convert the Image
+      palette.reset(new Palette(*sprite->palette(frame_t(0))));
+
+      // Special case for indexed images:
+      // If the sprite is transparent -> set the transparent color index alpha = 0
+      if (sprite->colorMode() == ColorMode::INDEXED && !sprite->backgroundLayer()) {
+        int i = sprite->transparentColor();
+        if (i >= 0 && i < int(palette->size()))
+          palette->setEntry(i, doc::rgba(0, 0, 0, 0));
+      }
+
+      const int w = sprite->width() * sprite->pixelRatio().w;
+      const int h = sprite->height() * sprite->pixelRatio().h;
+
+      // Calculate the thumbnail size
+      int thumb_w = MAX_THUMBNAIL_SIZE * w / std::max(w, h);
+      int thumb_h = MAX_THUMBNAIL_SIZE * h / std::max(w, h);
+      if (std::max(thumb_w, thumb_h) > std::max(w, h)) {
+        thumb_w = w;
+        thumb_h = h;
+      }
+      thumb_w = std::clamp(thumb_w, 1, MAX_THUMBNAIL_SIZE);
+      thumb_h = std::clamp(thumb_h, 1, MAX_THUMBNAIL_SIZE);
+
+      // Stretch the 'image'
+      thumbnailImage.reset(Image::create(sprite->pixelFormat(), thumb_w, thumb_h));
+
+      render::Projection proj(sprite->pixelRatio(), render::Zoom(thumb_w, w));
+      render::Render render;
+      render.setBgOptions(render::BgOptions::MakeTransparent());
+      render.setProjection(proj);
+      render.renderSprite(thumbnailImage.get(), sprite, frame_t(0), gfx::Clip(0, 0, 0, 0, w, h));
+
+      // Convert the image to sRGB color space
+      auto cs = sprite->colorSpace();
+      if (m_fop->preserveColorProfile() && cs && !cs->nearlyEqual(*gfx::ColorSpace::MakeSRGB())) {
+        app::cmd::convert_color_profile(thumbnailImage.get(),
+                                        palette.get(),
+                                        cs,
+                                        gfx::ColorSpace::MakeSRGB());
       }
-      base::this_thread::yield();
     }
+
+    // Close file
+    delete m_fop->releaseDocument();
+
+    // Set the thumbnail of the file-item.
+    if (thumbnailImage) {
+      os::SurfaceRef thumbnail = os::instance()->makeRgbaSurface(thumbnailImage->width(),
+                                                                 thumbnailImage->height());
+
+      convert_image_to_surface(thumbnailImage.get(),
+                               palette.get(),
+                               thumbnail.get(),
+                               0,
+                               0,
+                               0,
+                               0,
+                               thumbnailImage->width(),
+                               thumbnailImage->height());
+
+      {
+        const std::lock_guard lock(m_mutex);
+        m_item.fileitem->setThumbnail(thumbnail);
+      }
+
+      if (m_cache && !m_fop->isStop())
+        m_cache->set(filename, thumbnail.get());
+    }
+  }
+
+  // Loads one item of the queue and executes a new task for the next
+  // one (instead of looping in the same task), so other background
+  // tasks (e.g. undo compression) can run between thumbnails.
+  void loadNextItem()
+  {
+    bool success;
+    {
+      const std::lock_guard lock(m_mutex); // To access m_item
+      success = m_queue.try_pop(m_item);
+      m_stop = false;
+    }
+    if (success) {
+      loadItem();
+
+      if (!m_queue.empty()) {
+        TaskScheduler::instance()->execute(TaskPriority::Background,
+                                           [this] { loadNextItem(); });
+        return;
+      }
+    }
+
+    // Notify with the mutex locked so the Worker cannot be destroyed
+    // before notify_one() returns.
+    const std::lock_guard lock(m_mutex);
     m_isDone = true;
+    m_doneCV.notify_one();
   }
 
   base::concurrent_queue<Item>& m_queue;
+  ThumbnailCache* m_cache;
   app::ThumbnailGenerator::Item m_item;
   FileOp* m_fop;
+  bool m_stop; // True if stop() was called for the current item
   mutable std::mutex m_mutex;
   std::atomic<bool> m_isDone;
-  std::thread m_thread;
+  std::condition_variable m_doneCV;
 };
 
 ThumbnailGenerator* ThumbnailGenerator::instance()
@@ -245,10 +297,17 @@ ThumbnailGenerator* ThumbnailGenerator::instance()
 
 ThumbnailGenerator::ThumbnailGenerator()
 {
-  int n = std::thread::hardware_concurrency() - 1;
-  if (n < 1)
-    n = 1;
-  m_maxWorkers = n;
+  // Use at most half of the TaskScheduler workers, so other
+  // background tasks can run while we generate thumbnails.
+  m_maxWorkers = std::max(1, TaskScheduler::instance()->workers() / 2);
+
+  const int cacheSize = Preferences::instance().fileSelector.thumbnailCacheSize();
+  if (cacheSize > 0) {
+    ResourceFinder rf;
+    rf.includeUserDir(base::join_path("thumbnails", ".").c_str());
+    m_cache = std::make_unique<ThumbnailCache>(base::get_file_path(rf.getFirstOrCreateDefault()),
+                                               size_t(cacheSize) * 1024 * 1024);
+  }
 }
 
 bool ThumbnailGenerator::checkWorkers()
@@ -283,12 +342,12 @@ void ThumbnailGenerator::generateThumbnail(IFileItem* fileitem)
       // one to process the m_remainingItems queue. How is it possible
       // that a IFileItem has a thumbnail progress == 0.00001 but
       // there is no workers?  This is an edge case where:
-      // 1. The Worker::loadBgThread() asks for the queue of remaining items
-      //    and it's empty, so the thread is going to be closed
+      // 1. The Worker::loadNextItem() asks for the queue of remaining items
+      //    and it's empty, so the worker is going to be closed
       // 2. We've just created a FOP for this IFileItem and ask for
       //    available workers and we've already launch the max quantity
       //    of possible workers (m_maxWorkers)
-      // 3. All worker threads are just closed so there is no more
+      // 3. All workers are just closed so there is no more
       //    worker for the remaining item in the queue.
       if (m_workers.empty())
         startWorker();
@@ -299,22 +358,11 @@ void ThumbnailGenerator::generateThumbnail(IFileItem* fileitem)
   // Set a starting progress so we don't enqueue the same item two times.
   fileitem->setThumbnailProgress(0.00001);
 
-  THUMB_TRACE("Queue FOP thumbnail for %s\n", fileitem->fileName().c_str());
-
-  std::unique_ptr<FileOp> fop(
-    FileOp::createLoadDocumentOperation(nullptr,
-                                        fileitem->fileName().c_str(),
-                                        FILE_LOAD_SEQUENCE_NONE | FILE_LOAD_ONE_FRAME));
-  if (!fop || fop->hasError()) {
-    // Set a nullptr thumbnail so we don't try to generate a thumbnail
-    // for this fileitem again.
-    fileitem->setThumbnail(nullptr);
-    return;
-  }
-
-  m_remainingItems.push(Item(fileitem, fop.get()));
-  fop.release();
+  THUMB_TRACE("Queue thumbnail for %s\n", fileitem->fileName().c_str());
 
+  // The cached thumbnail is looked up (and the file is opened if it's
+  // needed) in the worker, so nothing is read from the UI thread.
+  m_remainingItems.push(Item(fileitem));
   startWorker();
 }
 
@@ -324,12 +372,11 @@ void ThumbnailGenerator::stopAllWorkers()
   while (!m_remainingItems.empty()) {
     while (m_remainingItems.try_pop(item)) {
       if (!item.fileitem->getThumbnail()) {
-        // Reset progress to 0.0 because the FileOp wasn't used and we
-        // will need to create it again if we require this FileItem
+        // Reset progress to 0.0 because the item wasn't loaded and
+        // we will need to queue it again if we require this FileItem
         // thumbnail again.
         item.fileitem->setThumbnailProgress(0.0);
       }
-      delete item.fop;
     }
   }
 
@@ -342,7 +389,7 @@ void ThumbnailGenerator::startWorker()
 {
   const std::lock_guard lock(m_workersAccess);
   if (m_workers.size() < m_maxWorkers) {
-    m_workers.push_back(std::make_unique<Worker>(m_remainingItems));
+    m_workers.push_back(std::make_unique<Worker>(m_remainingItems, m_cache.get()));
   }
 }
 
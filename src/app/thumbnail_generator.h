@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -22,6 +22,7 @@ class thread;
 namespace app {
 class FileOp;
 class IFileItem;
+class ThumbnailCache;
 
 class ThumbnailGenerator {
   ThumbnailGenerator();
@@ -53,13 +54,14 @@ private:
 
   struct Item {
     IFileItem* fileitem;
-    FileOp* fop;
-    Item() : fileitem(nullptr), fop(nullptr) {}
-    Item(const Item& item) : fileitem(item.fileitem), fop(item.fop) {}
-    Item(IFileItem* fileitem, FileOp* fop) : fileitem(fileitem), fop(fop) {}
+    Item() : fileitem(nullptr) {}
+    Item(const Item& item) : fileitem(item.fileitem) {}
+    Item(IFileItem* fileitem) : fileitem(fileitem) {}
   };
 
   int m_maxWorkers;
+  // Thumbnails saved on disk (destroyed after all workers)
+  std::unique_ptr<ThumbnailCache> m_cache;
   WorkerList m_workers;
   std::mutex m_workersAccess;
   base::concurrent_queue<Item> m_remainingItems;
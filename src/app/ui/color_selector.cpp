@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2025  Igara Studio S.A.
 // Copyright (C) 2016-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -18,12 +18,12 @@
 #include "app/color_utils.h"
 #include "app/modules/gfx.h"
 #include "app/pref/preferences.h"
+#include "app/task_scheduler.h"
 #include "app/ui/skin/skin_theme.h"
 #include "app/ui/status_bar.h"
 #include "app/util/shader_helpers.h"
 #include "base/concurrent_queue.h"
 #include "base/scoped_value.h"
-#include "base/thread.h"
 #include "os/surface.h"
 #include "os/system.h"
 #include "ui/manager.h"
@@ -38,7 +38,6 @@
 #include <cmath>
 #include <condition_variable>
 #include <cstdio>
-#include <thread>
 
 #if SK_ENABLE_SKSL
   #include "os/skia/skia_surface.h"
@@ -80,10 +79,6 @@ public:
   void addRef()
   {
     assert_ui_thread();
-
-    if (m_ref == 0)
-      m_paintingThread = std::thread([this] { paintingProc(); });
-
     ++m_ref;
   }
 
@@ -96,12 +91,8 @@ public:
       {
         std::unique_lock<std::mutex> lock(m_mutex);
         stopCurrentPainting(lock);
-
-        m_killing = true;
-        m_paintingCV.notify_one();
       }
 
-      m_paintingThread.join();
       if (m_canvas)
         m_canvas.reset();
     }
@@ -143,17 +134,22 @@ public:
     assert_ui_thread();
     COLSEL_TRACE("COLSEL: startBgPainting for %p\n", colorSelector);
 
-    std::unique_lock<std::mutex> lock(m_mutex);
-    stopCurrentPainting(lock);
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      stopCurrentPainting(lock);
 
-    m_colorSelector = colorSelector;
-    m_manager = colorSelector->manager();
-    m_mainBounds = mainBounds;
-    m_bottomBarBounds = bottomBarBounds;
-    m_alphaBarBounds = alphaBarBounds;
+      m_colorSelector = colorSelector;
+      m_manager = colorSelector->manager();
+      m_mainBounds = mainBounds;
+      m_bottomBarBounds = bottomBarBounds;
+      m_alphaBarBounds = alphaBarBounds;
 
-    m_stopPainting = false;
-    m_paintingCV.notify_one();
+      m_stopPainting = false;
+      ++m_paintingId;
+    }
+
+    TaskScheduler::instance()->execute(TaskPriority::UILatency,
+                                       [this, id = m_paintingId] { paintingProc(id); });
   }
 
 private:
@@ -163,72 +159,72 @@ private:
     if (m_colorSelector) {
       COLSEL_TRACE("COLSEL: stoppping painting of %p\n", m_colorSelector);
 
-      // TODO use another condition variable here
       m_stopPainting = true;
-      m_waitStopCV.wait(lock);
+
+      // We wait the painting only if it was already started (it will
+      // stop soon as m_stopPainting is true). If the task is still in
+      // the queue, it's just canceled (it will do nothing when it's
+      // executed), so we never block the UI thread waiting for a task
+      // that didn't start yet.
+      if (m_painting)
+        m_paintingDoneCV.wait(lock, [this] { return !m_painting; });
+      m_colorSelector = nullptr;
     }
 
     ASSERT(m_colorSelector == nullptr);
   }
 
-  void paintingProc()
+  // Executed in a TaskScheduler worker for each startBgPainting()
+  void paintingProc(const int id)
   {
-    COLSEL_TRACE("COLSEL: paintingProc starts\n");
-
-    base::this_thread::set_name("colsel-painter");
-
     std::unique_lock<std::mutex> lock(m_mutex);
-    while (true) {
-      m_paintingCV.wait(lock);
-
-      if (m_killing)
-        break;
-
-      auto colorSel = m_colorSelector;
-      if (!colorSel)
-        break;
+    auto colorSel = m_colorSelector;
+    // This painting was canceled/superseded before it was started
+    if (!colorSel || id != m_paintingId)
+      return;
 
+    // Do the intesive painting in the background thread (if it
+    // wasn't stopped before this task was executed)
+    if (!m_stopPainting) {
       COLSEL_TRACE("COLSEL: starting painting in bg for %p\n", colorSel);
 
-      // Do the intesive painting in the background thread
-      {
-        lock.unlock();
-        colorSel->onPaintSurfaceInBgThread(m_canvas.get(),
-                                           m_mainBounds,
-                                           m_bottomBarBounds,
-                                           m_alphaBarBounds,
-                                           m_stopPainting);
-        lock.lock();
-      }
+      m_painting = true;
+      lock.unlock();
+      colorSel->onPaintSurfaceInBgThread(m_canvas.get(),
+                                         m_mainBounds,
+                                         m_bottomBarBounds,
+                                         m_alphaBarBounds,
+                                         m_stopPainting);
+      lock.lock();
+      m_painting = false;
+    }
 
-      m_colorSelector = nullptr;
+    m_colorSelector = nullptr;
 
-      if (m_stopPainting) {
-        COLSEL_TRACE("COLSEL: painting for %p stopped\n");
-        m_waitStopCV.notify_one();
-      }
-      else {
-        COLSEL_TRACE("COLSEL: painting for %p done and sending message\n");
-        colorSel->m_paintFlags |= DoneFlag;
-      }
+    if (m_stopPainting) {
+      COLSEL_TRACE("COLSEL: painting for %p stopped\n");
     }
-
-    COLSEL_TRACE("COLSEL: paintingProc ends\n");
+    else {
+      COLSEL_TRACE("COLSEL: painting for %p done and sending message\n");
+      colorSel->m_paintFlags |= DoneFlag;
+    }
+    m_paintingDoneCV.notify_one();
   }
 
   int m_ref = 0;
-  bool m_killing = false;
   bool m_stopPainting = false;
+  // True while onPaintSurfaceInBgThread() is running
+  bool m_painting = false;
+  // ID of the last startBgPainting() call
+  int m_paintingId = 0;
   std::mutex m_mutex;
-  std::condition_variable m_paintingCV;
-  std::condition_variable m_waitStopCV;
+  std::condition_variable m_paintingDoneCV;
   os::SurfaceRef m_canvas;
-  ColorSelector* m_colorSelector;
+  ColorSelector* m_colorSelector = nullptr;
   ui::Manager* m_manager;
   gfx::Rect m_mainBounds;
   gfx::Rect m_bottomBarBounds;
   gfx::Rect m_alphaBarBounds;
-  std::thread m_paintingThread;
 };
 
 static ColorSelector::Painter painter;
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -144,6 +144,13 @@ void DrawingState::notifyToolLoopModifiersChange(Editor* editor)
     m_toolLoopManager->notifyToolLoopModifiersChange();
 }
 
+EditorState::LeaveAction DrawingState::onLeaveState(Editor* editor, EditorState* newState)
+{
+  // The layers cache is used only while we paint.
+  editor->releaseLayersCache();
+  return StandbyState::onLeaveState(editor, newState);
+}
+
 void DrawingState::onBeforePopState(Editor* editor)
 {
   m_beforeCmdConn.disconnect();
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 // Copyright (C) 2001-2017  David Capello
 //
 // This program is distributed under the terms of
@@ -30,6 +30,7 @@ class DrawingState : public StandbyState,
 public:
   DrawingState(Editor* editor, tools::ToolLoop* loop, const DrawingType type);
   virtual ~DrawingState();
+  virtual LeaveAction onLeaveState(Editor* editor, EditorState* newState) override;
   virtual void onBeforePopState(Editor* editor) override;
   virtual bool onMouseDown(Editor* editor, ui::MouseMessage* msg) override;
   virtual bool onMouseUp(Editor* editor, ui::MouseMessage* msg) override;
@@ -52,6 +53,9 @@ public:
   // is expanded dynamically while we paint.)
   virtual bool allowLayerEdges() override { return false; }
 
+  // Only the active layer is modified by the tool loop.
+  virtual bool modifiesOnlyActiveLayer() override { return true; }
+
   virtual bool getGridBounds(Editor* editor, gfx::Rect& gridBounds) override;
 
   void initToolLoop(Editor* editor, const ui::MouseMessage* msg, const tools::Pointer& pointer);
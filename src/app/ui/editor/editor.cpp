@@ -147,6 +147,7 @@ Editor::Editor(Doc* document, EditorFlags flags, EditorStatePtr state)
   , m_docPref(Preferences::instance().document(document))
   , m_tiledModeHelper(app::TiledModeHelper(m_docPref.tiled.mode(), m_sprite))
   , m_brushPreview(this)
+  , m_layersCache(document)
   , m_toolLoopModifiers(tools::ToolLoopModifiers::kNone)
   , m_padding(0, 0)
   , m_antsTimer(100, this)
@@ -701,6 +702,25 @@ void Editor::drawOneSpriteUnclippedRect(ui::Graphics* g,
                                     m_frame);
     }
 
+    // While we paint only the active layer is modified, so we can
+    // use the pre-composited layers below/above it. Only the visible
+    // area of the sprite is cached, including the extra pixels that
+    // we add to the "expose" area depending on the zoom level. The
+    // render engine uses the cache with integer zoom levels only.
+    if (m_state->modifiesOnlyActiveLayer() && m_proj.zoom().isSimpleZoomLevel() &&
+        m_proj.zoom().scale() >= 1.0) {
+      gfx::Region visibleRgn(getVisibleSpriteBounds());
+      collapseRegionByTiledMode(visibleRgn);
+      gfx::Rect visibleBounds = visibleRgn.bounds();
+      visibleBounds.enlarge(2 + int(1.0 / std::min(m_proj.scaleX(), m_proj.scaleY())));
+
+      m_layersCache.setupRenderEngine(m_renderEngine.get(),
+                                      m_layer,
+                                      m_frame,
+                                      otherLayersOpacity(),
+                                      visibleBounds);
+    }
+
     // Render background first (e.g. new ShaderRenderer will paint the
     // background on the screen first and then composite the rendered
     // sprite on it.)
@@ -725,6 +745,7 @@ void Editor::drawOneSpriteUnclippedRect(ui::Graphics* g,
     m_renderEngine->renderSprite(rendered.get(), m_sprite, m_frame, gfx::Clip(0, 0, rc2));
 
     m_renderEngine->removeExtraImage();
+    m_renderEngine->removeLayersCache();
 
     // If the checkered background is visible in this sprite, we save
     // all settings of the background for this document.
@@ -1615,6 +1636,11 @@ Rect Editor::getVisibleSpriteBounds()
   return Rect();
 }
 
+void Editor::releaseLayersCache()
+{
+  m_layersCache.releaseImages();
+}
+
 // Changes the scroll to see the given point as the center of the editor.
 void Editor::centerInSpritePoint(const gfx::PointF& spritePos)
 {
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -18,6 +18,7 @@
 #include "app/ui/color_source.h"
 #include "app/ui/editor/brush_preview.h"
 #include "app/ui/editor/editor_hit.h"
+#include "app/ui/editor/editor_layers_cache.h"
 #include "app/ui/editor/editor_observers.h"
 #include "app/ui/editor/editor_state.h"
 #include "app/ui/editor/editor_states_history.h"
@@ -200,6 +201,10 @@ public:
   void expandRegionByTiledMode(gfx::Region& rgn, const bool withProj) const;
   void collapseRegionByTiledMode(gfx::Region& rgn) const;
 
+  // Frees the images used to cache the layers below/above the active
+  // layer while we paint (see EditorLayersCache).
+  void releaseLayersCache();
+
   // Changes the scroll to see the given point as the center of the editor.
   void centerInSpritePoint(const gfx::PointF& spritePos);
   void centerInSpritePoint(const gfx::Point& spritePos);
@@ -427,6 +432,10 @@ private:
   // Brush preview
   BrushPreview m_brushPreview;
 
+  // Layers below/above the active layer pre-composited to redraw the
+  // editor faster while we paint.
+  EditorLayersCache m_layersCache;
+
   tools::ToolLoopModifiers m_toolLoopModifiers;
 
   // Extra space around the sprite.
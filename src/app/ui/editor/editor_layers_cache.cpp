@@ -0,0 +1,279 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif
+
+#include "app/ui/editor/editor_layers_cache.h"
+
+#include "app/doc.h"
+#include "app/doc_event.h"
+#include "app/ui/editor/editor_render.h"
+#include "doc/cel.h"
+#include "doc/image.h"
+#include "doc/layer.h"
+#include "doc/layer_tilemap.h"
+#include "doc/palette.h"
+#include "doc/render_plan.h"
+#include "doc/sprite.h"
+#include "doc/tileset.h"
+
+namespace app {
+
+using namespace doc;
+
+// Maximum number of pixels of each cached image (two 64MB images)
+static constexpr int kMaxCachePixels = 4096 * 4096;
+
+EditorLayersCache::EditorLayersCache(Doc* doc) : m_doc(doc), m_valid(false), m_supported(false)
+{
+  m_doc->add_observer(this);
+}
+
+EditorLayersCache::~EditorLayersCache()
+{
+  m_doc->remove_observer(this);
+}
+
+bool EditorLayersCache::setupRenderEngine(EditorRender* renderEngine,
+                                          const Layer* layer,
+                                          const frame_t frame,
+                                          const int nonactiveLayersOpacity,
+                                          const gfx::Rect& visibleBounds)
+{
+  // Tiles of the active tilemap layer are modified while we paint,
+  // and its tileset can be used by other layers too.
+  if (!layer || !layer->isImage() || layer->isTilemap() || !layer->isVisibleHierarchy())
+    return false;
+
+  const Sprite* sprite = layer->sprite();
+  const gfx::Rect bounds = visibleBounds.createIntersection(sprite->bounds());
+  if (bounds.isEmpty())
+    return false;
+
+  // Big areas (e.g. a huge sprite with a small zoom level) are
+  // rendered without the cache.
+  if (int64_t(bounds.w) * int64_t(bounds.h) > kMaxCachePixels) {
+    releaseImages();
+    return false;
+  }
+
+  std::vector<uint32_t> versions = calcVersions(sprite, layer, frame, nonactiveLayersOpacity);
+  if (!m_valid || versions != m_versions || !m_bounds.contains(bounds)) {
+    m_versions = std::move(versions);
+    m_bounds = bounds;
+    m_valid = true;
+
+    if (!m_belowImage || m_belowImage->size() != bounds.size()) {
+      m_belowImage.reset(Image::create(IMAGE_RGB, bounds.w, bounds.h));
+      m_aboveImage.reset(Image::create(IMAGE_RGB, bounds.w, bounds.h));
+    }
+
+    m_supported = renderEngine->renderLayersCache(m_belowImage.get(),
+                                                  m_aboveImage.get(),
+                                                  sprite,
+                                                  layer,
+                                                  frame,
+                                                  m_bounds);
+    if (!m_supported) {
+      m_belowImage.reset();
+      m_aboveImage.reset();
+    }
+  }
+
+  if (!m_supported)
+    return false;
+
+  renderEngine->setLayersCache(layer,
+                               frame,
+                               m_belowImage.get(),
+                               m_aboveImage.get(),
+                               m_bounds.origin());
+  return true;
+}
+
+void EditorLayersCache::invalidate()
+{
+  m_valid = false;
+}
+
+void EditorLayersCache::releaseImages()
+{
+  invalidate();
+  m_versions.clear();
+  m_bounds = gfx::Rect();
+  m_belowImage.reset();
+  m_aboveImage.reset();
+}
+
+void EditorLayersCache::onGeneralUpdate(DocEvent& ev)
+{
+  invalidate();
+}
+
+void EditorLayersCache::onPixelFormatChanged(DocEvent& ev)
+{
+  invalidate();
+}
+
+void EditorLayersCache::onPaletteChanged(DocEvent& ev)
+{
+  invalidate();
+}
+
+void EditorLayersCache::onAddLayer(DocEvent& ev)
+{
+  invalidate();
+}
+
+void EditorLayersCache::onAddCel(DocEvent& ev)
+{
+  invalidateIfNotActiveLayer(ev);
+}
+
+void EditorLayersCache::onAfterRemoveLayer(DocEvent& ev)
+{
+  invalidate();
+}
+
+void EditorLayersCache::onAfterRemoveCel(DocEvent& ev)
+{
+  invalidateIfNotActiveLayer(ev);
+}
+
+void EditorLayersCache::onSpriteSizeChanged(DocEvent& ev)
+{
+  invalidate();
+}
+
+void EditorLayersCache::onSpriteTransparentColorChanged(DocEvent& ev)
+{
+  invalidate();
+}
+
+void EditorLayersCache::onLayerOpacityChange(DocEvent& ev)
+{
+  invalidateIfNotActiveLayer(ev);
+}
+
+void EditorLayersCache::onLayerBlendModeChange(DocEvent& ev)
+{
+  invalidateIfNotActiveLayer(ev);
+}
+
+void EditorLayersCache::onLayerRestacked(DocEvent& ev)
+{
+  invalidate();
+}
+
+void EditorLayersCache::onLayerMergedDown(DocEvent& ev)
+{
+  invalidate();
+}
+
+void EditorLayersCache::onCelMoved(DocEvent& ev)
+{
+  invalidate();
+}
+
+void EditorLayersCache::onCelCopied(DocEvent& ev)
+{
+  invalidate();
+}
+
+void EditorLayersCache::onCelFrameChanged(DocEvent& ev)
+{
+  invalidate();
+}
+
+void EditorLayersCache::onCelPositionChanged(DocEvent& ev)
+{
+  invalidateIfNotActiveLayer(ev);
+}
+
+void EditorLayersCache::onCelOpacityChange(DocEvent& ev)
+{
+  invalidateIfNotActiveLayer(ev);
+}
+
+void EditorLayersCache::onCelZIndexChange(DocEvent& ev)
+{
+  invalidate();
+}
+
+void EditorLayersCache::onTilesetChanged(DocEvent& ev)
+{
+  invalidate();
+}
+
+void EditorLayersCache::onAfterLayerVisibilityChange(DocEvent& ev)
+{
+  invalidate();
+}
+
+// The active layer is rendered layer by layer (it's not included in
+// the cache), so we can ignore the changes in its cels/properties.
+void EditorLayersCache::invalidateIfNotActiveLayer(DocEvent& ev)
+{
+  if (!m_valid || m_versions.empty() || !ev.layer() || ev.layer()->id() != m_versions[0])
+    invalidate();
+}
+
+// Returns the layer/frame/options used to render the cache and the
+// ID/version of each object that can modify the rendered pixels.
+std::vector<uint32_t> EditorLayersCache::calcVersions(const Sprite* sprite,
+                                                      const Layer* layer,
+                                                      const frame_t frame,
+                                                      const int nonactiveLayersOpacity) const
+{
+  std::vector<uint32_t> versions;
+  versions.reserve(64);
+  versions.push_back(layer->id());
+  versions.push_back(uint32_t(frame));
+  versions.push_back(uint32_t(nonactiveLayersOpacity));
+  versions.push_back(sprite->id());
+  versions.push_back(sprite->version());
+  versions.push_back(uint32_t(sprite->pixelFormat()));
+  versions.push_back(uint32_t(sprite->width()));
+  versions.push_back(uint32_t(sprite->height()));
+
+  const Palette* pal = sprite->palette(frame);
+  versions.push_back(pal->id());
+  versions.push_back(pal->version());
+
+  RenderPlan plan;
+  plan.addLayer(sprite->root(), frame);
+  for (const auto& item : plan.items()) {
+    versions.push_back(item.layer->id());
+
+    // The active layer is not in the cache, we just need its
+    // position in the plan.
+    if (item.layer == layer)
+      continue;
+
+    versions.push_back(item.layer->version());
+    const Cel* cel = item.cel;
+    versions.push_back(cel ? cel->id() : NullId);
+    if (cel) {
+      versions.push_back(cel->version());
+      versions.push_back(cel->data()->id());
+      versions.push_back(cel->data()->version());
+
+      const Image* image = cel->image();
+      versions.push_back(image ? image->id() : NullId);
+      if (image)
+        versions.push_back(image->version());
+    }
+    if (item.layer->isTilemap()) {
+      if (const Tileset* tileset = static_cast<const LayerTilemap*>(item.layer)->tileset())
+        versions.push_back(tileset->version());
+    }
+  }
+  return versions;
+}
+
+} // namespace app
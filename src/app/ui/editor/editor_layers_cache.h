@@ -0,0 +1,115 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_UI_EDITOR_EDITOR_LAYERS_CACHE_H_INCLUDED
+#define APP_UI_EDITOR_EDITOR_LAYERS_CACHE_H_INCLUDED
+#pragma once
+
+#include "app/doc_observer.h"
+#include "base/disable_copying.h"
+#include "doc/frame.h"
+#include "doc/image_ref.h"
+#include "gfx/rect.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace doc {
+class Layer;
+class Sprite;
+} // namespace doc
+
+namespace app {
+class Doc;
+class EditorRender;
+
+// Keeps the layers below/above the active layer of an editor
+// pre-composited in two images, so when we paint a stroke (where
+// only the active layer is modified) each redraw of the editor
+// composites just these two images and the active layer, instead of
+// all the visible layers of the sprite.
+//
+// The cache is re-generated when the active layer/frame changes,
+// when a DocObserver event modifies the structure of the sprite, or
+// when the version of one of the cached objects (layers, cels,
+// images, tilesets, palette) changes.
+//
+// Only the visible area of the sprite is cached, and the images are
+// released with releaseImages() when we stop painting.
+class EditorLayersCache : public DocObserver {
+public:
+  EditorLayersCache(Doc* doc);
+  ~EditorLayersCache();
+
+  // Configures the render engine to use the cache to render the given
+  // layer/frame (re-generating the cache if needed). The visible
+  // bounds (in sprite coordinates) is the area that must be cached.
+  // The render engine must be configured (non-active layers opacity,
+  // selected layer, etc.) before calling this function. Returns false
+  // if the cache cannot be used (e.g. other layers use blend modes
+  // different than NORMAL, layers above have semi-transparent pixels,
+  // or the area is too big), in this case you don't need to call
+  // EditorRender::removeLayersCache().
+  bool setupRenderEngine(EditorRender* renderEngine,
+                         const doc::Layer* layer,
+                         doc::frame_t frame,
+                         int nonactiveLayersOpacity,
+                         const gfx::Rect& visibleBounds);
+
+  void invalidate();
+
+  // Frees the cached images (e.g. when we stop painting).
+  void releaseImages();
+
+private:
+  // DocObserver impl
+  void onGeneralUpdate(DocEvent& ev) override;
+  void onPixelFormatChanged(DocEvent& ev) override;
+  void onPaletteChanged(DocEvent& ev) override;
+  void onAddLayer(DocEvent& ev) override;
+  void onAddCel(DocEvent& ev) override;
+  void onAfterRemoveLayer(DocEvent& ev) override;
+  void onAfterRemoveCel(DocEvent& ev) override;
+  void onSpriteSizeChanged(DocEvent& ev) override;
+  void onSpriteTransparentColorChanged(DocEvent& ev) override;
+  void onLayerOpacityChange(DocEvent& ev) override;
+  void onLayerBlendModeChange(DocEvent& ev) override;
+  void onLayerRestacked(DocEvent& ev) override;
+  void onLayerMergedDown(DocEvent& ev) override;
+  void onCelMoved(DocEvent& ev) override;
+  void onCelCopied(DocEvent& ev) override;
+  void onCelFrameChanged(DocEvent& ev) override;
+  void onCelPositionChanged(DocEvent& ev) override;
+  void onCelOpacityChange(DocEvent& ev) override;
+  void onCelZIndexChange(DocEvent& ev) override;
+  void onTilesetChanged(DocEvent& ev) override;
+  void onAfterLayerVisibilityChange(DocEvent& ev) override;
+
+  void invalidateIfNotActiveLayer(DocEvent& ev);
+  std::vector<uint32_t> calcVersions(const doc::Sprite* sprite,
+                                     const doc::Layer* layer,
+                                     doc::frame_t frame,
+                                     int nonactiveLayersOpacity) const;
+
+  Doc* m_doc;
+  bool m_valid;
+  // False if the last time we've tried to render the cache, the
+  // renderer didn't support it for this configuration.
+  bool m_supported;
+  // IDs and versions of all objects that were used to render the
+  // cache (and the layer/frame/options used to render it).
+  std::vector<uint32_t> m_versions;
+  // Area of the sprite cached in the images.
+  gfx::Rect m_bounds;
+  doc::ImageRef m_belowImage;
+  doc::ImageRef m_aboveImage;
+
+  DISABLE_COPYING(EditorLayersCache);
+};
+
+} // namespace app
+
+#endif
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 // Copyright (C) 2018  David Capello
 //
 // This program is distributed under the terms of
@@ -169,6 +169,30 @@ void EditorRender::disableOnionskin()
   m_renderer->disableOnionskin();
 }
 
+bool EditorRender::renderLayersCache(doc::Image* belowImage,
+                                     doc::Image* aboveImage,
+                                     const doc::Sprite* sprite,
+                                     const doc::Layer* layer,
+                                     const doc::frame_t frame,
+                                     const gfx::Rect& bounds)
+{
+  return m_renderer->renderLayersCache(belowImage, aboveImage, sprite, layer, frame, bounds);
+}
+
+void EditorRender::setLayersCache(const doc::Layer* layer,
+                                  const doc::frame_t frame,
+                                  const doc::Image* belowImage,
+                                  const doc::Image* aboveImage,
+                                  const gfx::Point& origin)
+{
+  m_renderer->setLayersCache(layer, frame, belowImage, aboveImage, origin);
+}
+
+void EditorRender::removeLayersCache()
+{
+  m_renderer->removeLayersCache();
+}
+
 void EditorRender::renderSprite(os::Surface* dstSurface,
                                 const doc::Sprite* sprite,
                                 doc::frame_t frame,
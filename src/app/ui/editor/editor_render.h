@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 // Copyright (C) 2018  David Capello
 //
 // This program is distributed under the terms of
@@ -17,6 +17,7 @@
 #include "doc/pixel_format.h"
 #include "gfx/clip.h"
 #include "gfx/point.h"
+#include "gfx/rect.h"
 #include "render/extra_type.h"
 #include "render/onionskin_options.h"
 #include "render/projection.h"
@@ -82,6 +83,19 @@ public:
   void setOnionskin(const render::OnionskinOptions& options);
   void disableOnionskin();
 
+  bool renderLayersCache(doc::Image* belowImage,
+                         doc::Image* aboveImage,
+                         const doc::Sprite* sprite,
+                         const doc::Layer* layer,
+                         const doc::frame_t frame,
+                         const gfx::Rect& bounds);
+  void setLayersCache(const doc::Layer* layer,
+                      const doc::frame_t frame,
+                      const doc::Image* belowImage,
+                      const doc::Image* aboveImage,
+                      const gfx::Point& origin);
+  void removeLayersCache();
+
   void renderSprite(os::Surface* dstSurface,
                     const doc::Sprite* sprite,
                     doc::frame_t frame,
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2024  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This program is distributed under the terms of
@@ -123,6 +123,11 @@ public:
   // Returns true if this state allow layer edges and cel guides
   virtual bool allowLayerEdges() { return false; }
 
+  // Returns true if this state modifies only the pixels of the
+  // active layer (e.g. when we paint a stroke), so the editor can
+  // cache the composition of all other layers.
+  virtual bool modifiesOnlyActiveLayer() { return false; }
+
   // Returns true if this state accept the given quicktool.
   virtual bool acceptQuickTool(tools::Tool* tool) { return true; }
 
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2024  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -22,6 +22,7 @@
 #include "app/cmd/set_cel_position.h"
 #include "app/cmd_sequence.h"
 #include "app/doc.h"
+#include "app/task_scheduler.h"
 #include "doc/algorithm/fill_selection.h"
 #include "doc/algorithm/flip_image.h"
 #include "doc/algorithm/resize_image.h"
@@ -45,9 +46,15 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
+#if defined(__x86_64__) || defined(_WIN64)
+  #include <emmintrin.h>
+#endif
+
 #define OPS_TRACE(...) // TRACE(__VA_ARGS__)
 
 namespace app {
@@ -83,19 +90,114 @@ void mask_image(Image* image, Image* bitmap)
   }
 }
 
+// Returns the first pixel in [x, x2) that is different in both rows
+// (or x2 if all pixels are equal).
+template<typename ImageTraits>
+int find_first_diff(const typename ImageTraits::pixel_t* a,
+                    const typename ImageTraits::pixel_t* b,
+                    int x,
+                    const int x2)
+{
+  using pixel_t = typename ImageTraits::pixel_t;
+
+  // Skip blocks of 16 bytes of equal pixels
+  constexpr int kBlockPixels = 16 / sizeof(pixel_t);
+  for (; x + kBlockPixels <= x2; x += kBlockPixels) {
+#if defined(__x86_64__) || defined(_WIN64)
+    const __m128i va = _mm_loadu_si128((const __m128i*)(a + x));
+    const __m128i vb = _mm_loadu_si128((const __m128i*)(b + x));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xffff)
+      break;
+#else
+    if (std::memcmp(a + x, b + x, 16) != 0)
+      break;
+#endif
+  }
+
+  for (; x < x2 && a[x] == b[x]; ++x)
+    ;
+  return x;
+}
+
+// Returns the first pixel in [x, x2) that is equal in both rows (or
+// x2 if all pixels are different).
+template<typename ImageTraits>
+int find_first_equal(const typename ImageTraits::pixel_t* a,
+                     const typename ImageTraits::pixel_t* b,
+                     int x,
+                     const int x2)
+{
+  for (; x < x2 && a[x] != b[x]; ++x)
+    ;
+  return x;
+}
+
+// Creates a region with the union of all the given rectangles. The
+// regions are merged by pairs (instead of adding each rectangle to
+// one big region) so each pixel is copied O(log n) times only.
+void create_region_from_rects(const std::vector<gfx::Rect>& rects, gfx::Region& output)
+{
+  if (rects.empty())
+    return;
+
+  std::vector<gfx::Region> regions;
+  regions.reserve(rects.size());
+  for (const gfx::Rect& rc : rects)
+    regions.emplace_back(rc);
+
+  const int n = int(regions.size());
+  for (int step = 1; step < n; step *= 2) {
+    for (int i = 0; i + step < n; i += 2 * step)
+      regions[i].createUnion(regions[i], regions[i + step]);
+  }
+  output.createUnion(output, regions[0]);
+}
+
+// Compares both images row by row, each row is converted to spans of
+// different pixels, and spans with the same horizontal position in
+// consecutive rows are merged in one rectangle.
 template<typename ImageTraits>
 void create_region_with_differences_templ(const Image* a,
                                           const Image* b,
                                           const gfx::Rect& bounds,
                                           gfx::Region& output)
 {
+  using pixel_t = typename ImageTraits::pixel_t;
+
+  std::vector<gfx::Rect> rects;
+  // Rectangles that can be expanded to the current row (sorted by x)
+  std::vector<gfx::Rect> open, next;
+
   for (int y = bounds.y; y < bounds.y2(); ++y) {
-    for (int x = bounds.x; x < bounds.x2(); ++x) {
-      if (get_pixel_fast<ImageTraits>(a, x, y) != get_pixel_fast<ImageTraits>(b, x, y)) {
-        output.createUnion(output, gfx::Region(gfx::Rect(x, y, 1, 1)));
+    const auto* rowA = (const pixel_t*)a->getPixelAddress(0, y);
+    const auto* rowB = (const pixel_t*)b->getPixelAddress(0, y);
+    auto it = open.begin();
+
+    next.clear();
+    for (int x = find_first_diff<ImageTraits>(rowA, rowB, bounds.x, bounds.x2()); x < bounds.x2();
+         x = find_first_diff<ImageTraits>(rowA, rowB, x, bounds.x2())) {
+      const int x2 = find_first_equal<ImageTraits>(rowA, rowB, x + 1, bounds.x2());
+
+      // Close rectangles that cannot be expanded with this span
+      for (; it != open.end() && it->x < x; ++it)
+        rects.push_back(*it);
+
+      if (it != open.end() && it->x == x && it->x2() == x2) {
+        next.push_back(*it);
+        ++next.back().h;
+        ++it;
+      }
+      else {
+        next.emplace_back(x, y, x2 - x, 1);
       }
+      x = x2;
     }
+    rects.insert(rects.end(), it, open.end());
+    std::swap(open, next);
   }
+  rects.insert(rects.end(), open.begin(), open.end());
+
+  create_region_from_rects(rects, output);
 }
 
 // TODO merge this with Sprite::getTilemapsByTileset()
@@ -131,6 +233,8 @@ public:
   {
     m_flipped = !m_flipped;
     doc::algorithm::flip_image(m_image, m_image->bounds(), m_flipType);
+    // Invalidate the cached hash of the image
+    m_image->incrementVersion();
   }
   void reset()
   {
@@ -246,6 +350,183 @@ bool find_tile(doc::Tileset* tileset,
   return false;
 }
 
+// Minimum number of grid cells to match them in parallel.
+const int kMinParallelCells = 256;
+
+// Calls func(i) for each i in [0, n) using the TaskScheduler workers
+// (when there are enough items).
+template<typename Func>
+void parallel_for_cells(const int n, Func func)
+{
+  const int ntasks = std::min<int>(TaskScheduler::instance()->workers(), n / kMinParallelCells);
+  if (ntasks <= 1) {
+    for (int i = 0; i < n; ++i)
+      func(i);
+  }
+  else {
+    TaskGroup tasks(TaskPriority::Interactive);
+    for (int t = 0; t < ntasks; ++t) {
+      tasks.execute([&func, n, ntasks, t] {
+        const int end = n * (t + 1) / ntasks;
+        for (int i = n * t / ntasks; i < end; ++i)
+          func(i);
+      });
+    }
+    tasks.wait();
+  }
+}
+
+// Returns true if the pixels of two rectangles (of the same size) in
+// the same image are equal.
+bool is_same_cell(const Image* image, const gfx::Rect& a, const gfx::Rect& b)
+{
+  const int widthBytes = image->bytesPerPixel() * a.w;
+  for (int y = 0; y < a.h; ++y) {
+    if (std::memcmp(image->getPixelAddress(a.x, a.y + y),
+                    image->getPixelAddress(b.x, b.y + y),
+                    widthBytes) != 0)
+      return false;
+  }
+  return true;
+}
+
+// Matches all the grid cells of an image against the tiles of a
+// tileset, adding the new tiles in the same order as if the cells
+// were matched one by one with find_tile().
+//
+// Cells completely inside the image are hashed/compared in-place
+// (without cropping them), so equal cells are cropped and matched
+// just once. The different cells are matched in parallel against
+// the tileset (which is not modified in this step), and then the
+// cells that weren't found are added as new tiles in the current
+// thread.
+class BatchTileMatcher {
+public:
+  BatchTileMatcher(doc::Tileset* tileset,
+                   const doc::Grid& grid,
+                   const doc::Image* srcImage,
+                   const gfx::Point& srcImagePos)
+    : m_tileset(tileset)
+    , m_grid(grid)
+    , m_srcImage(srcImage)
+    , m_srcImagePos(srcImagePos)
+  {
+  }
+
+  // Adds a new cell to match, "tilePt" is the position of the cell
+  // in tiles.
+  void addCell(const gfx::Point& tilePt)
+  {
+    const gfx::Point pt = m_grid.tileToCanvas(tilePt) - m_srcImagePos;
+    m_cells.push_back(Cell{ tilePt, gfx::Rect(pt, m_grid.tileSize()), -1 });
+  }
+
+  // Groups the equal cells and finds the tile that matches each
+  // group (without modifying the tileset).
+  void matchCells()
+  {
+    // In-place hashes of the cells that are completely inside the
+    // source image (cells in the borders are cropped with the mask
+    // color, so we handle them individually).
+    const bool canCompareInPlace = (m_srcImage->pixelFormat() != IMAGE_BITMAP &&
+                                    m_srcImage->pixelFormat() != IMAGE_TILEMAP);
+    const gfx::Rect srcBounds = m_srcImage->bounds();
+    std::vector<uint32_t> hashes(m_cells.size(), 0);
+    if (canCompareInPlace) {
+      parallel_for_cells(int(m_cells.size()), [this, &hashes, &srcBounds](const int i) {
+        if (srcBounds.contains(m_cells[i].srcBounds))
+          hashes[i] = calculate_image_hash(m_srcImage, m_cells[i].srcBounds);
+      });
+    }
+
+    std::unordered_map<uint32_t, std::vector<int>> groupsByHash;
+    for (int i = 0; i < int(m_cells.size()); ++i) {
+      Cell& cell = m_cells[i];
+      if (canCompareInPlace && srcBounds.contains(cell.srcBounds)) {
+        auto& groups = groupsByHash[hashes[i]];
+        for (const int j : groups) {
+          if (is_same_cell(m_srcImage, m_groups[j].srcBounds, cell.srcBounds)) {
+            cell.group = j;
+            break;
+          }
+        }
+        if (cell.group < 0)
+          groups.push_back(int(m_groups.size()));
+      }
+      if (cell.group < 0) {
+        cell.group = int(m_groups.size());
+        m_groups.push_back(Group{ cell.srcBounds });
+      }
+    }
+
+    // Create the hash table in this thread so the tileset can be
+    // used from other threads (as long as we don't add tiles).
+    m_tileset->prepareHashTable();
+
+    parallel_for_cells(int(m_groups.size()), [this](const int i) {
+      Group& group = m_groups[i];
+      group.image.reset(
+        doc::crop_image(m_srcImage, group.srcBounds, m_srcImage->maskColor()));
+      if (m_grid.hasMask())
+        mask_image(group.image.get(), m_grid.mask().get());
+
+      preprocess_transparent_pixels(group.image.get());
+
+      group.found = find_tile(m_tileset, group.image, group.tileIndex, group.tileFlags);
+    });
+  }
+
+  // Calls addTile(image) for each cell that needs a new tile (which
+  // must add the image to the tileset and return its index), and
+  // then putTile(tilePt, tile) for each cell.
+  template<typename AddTileFunc, typename PutTileFunc>
+  void addTiles(AddTileFunc addTile, PutTileFunc putTile)
+  {
+    const doc::tile_index oldSize = m_tileset->size();
+
+    for (const Cell& cell : m_cells) {
+      Group& group = m_groups[cell.group];
+      if (!group.resolved) {
+        // Tiles added by previous cells can match this cell now, or
+        // can be matched before a flipped version of an old tile.
+        if (!group.found || (group.tileFlags != 0 && m_tileset->size() != oldSize)) {
+          group.found = find_tile(m_tileset, group.image, group.tileIndex, group.tileFlags);
+        }
+        if (!group.found) {
+          group.tileIndex = addTile(group.image);
+          group.tileFlags = 0;
+        }
+        group.resolved = true;
+      }
+      putTile(cell.tilePt, doc::tile(group.tileIndex, group.tileFlags));
+    }
+  }
+
+private:
+  struct Cell {
+    gfx::Point tilePt;
+    gfx::Rect srcBounds; // Bounds of the cell in the source image
+    int group;
+  };
+
+  // Group of cells with the same pixels
+  struct Group {
+    gfx::Rect srcBounds; // Bounds of the first cell of the group
+    doc::ImageRef image;
+    doc::tile_index tileIndex = doc::notile;
+    doc::tile_flags tileFlags = 0;
+    bool found = false;
+    bool resolved = false;
+  };
+
+  doc::Tileset* m_tileset;
+  const doc::Grid& m_grid;
+  const doc::Image* m_srcImage;
+  gfx::Point m_srcImagePos;
+  std::vector<Cell> m_cells;
+  std::vector<Group> m_groups;
+};
+
 } // anonymous namespace
 
 void create_region_with_differences(const Image* a,
@@ -488,7 +769,8 @@ void draw_image_into_new_tilemap_cel(CmdSequence* cmds,
                                      const gfx::Point& gridOrigin,
                                      const gfx::Point& srcImagePos,
                                      const gfx::Rect& canvasBounds,
-                                     doc::ImageRef& newTilemap)
+                                     doc::ImageRef& newTilemap,
+                                     const bool parallel)
 {
   ASSERT(dstLayer->isTilemap());
 
@@ -497,7 +779,6 @@ void draw_image_into_new_tilemap_cel(CmdSequence* cmds,
   doc::Grid grid = tileset->grid();
   grid.origin(gridOrigin);
 
-  gfx::Size tileSize = grid.tileSize();
   const gfx::Rect tilemapBounds = grid.canvasToTile(canvasBounds);
 
   if (!newTilemap) {
@@ -510,48 +791,64 @@ void draw_image_into_new_tilemap_cel(CmdSequence* cmds,
     ASSERT(tilemapBounds.h == newTilemap->height());
   }
 
-  for (const gfx::Point& tilePt : grid.tilesInCanvasRegion(gfx::Region(canvasBounds))) {
-    const gfx::Point tilePtInCanvas = grid.tileToCanvas(tilePt);
-    doc::ImageRef tileImage(doc::crop_image(srcImage,
-                                            tilePtInCanvas.x - srcImagePos.x,
-                                            tilePtInCanvas.y - srcImagePos.y,
-                                            tileSize.w,
-                                            tileSize.h,
-                                            srcImage->maskColor()));
-    if (grid.hasMask())
-      mask_image(tileImage.get(), grid.mask().get());
-
-    preprocess_transparent_pixels(tileImage.get());
-
-    doc::tile_index tileIndex;
-    doc::tile_flags tileFlag = 0;
-
-    if (!find_tile(tileset, tileImage, tileIndex, tileFlag)) {
-      auto addTile = new cmd::AddTile(tileset, tileImage);
+  auto addNewTile = [cmds, doc, dstLayer, dstCel, tileset](const doc::ImageRef& tileImage) {
+    auto addTile = new cmd::AddTile(tileset, tileImage);
 
-      if (cmds)
-        cmds->executeAndAdd(addTile);
-      else {
-        // TODO a little hacky
-        addTile->execute(doc->context());
-      }
+    if (cmds)
+      cmds->executeAndAdd(addTile);
+    else {
+      // TODO a little hacky
+      addTile->execute(doc->context());
+    }
 
-      tileIndex = addTile->tileIndex();
+    const doc::tile_index tileIndex = addTile->tileIndex();
 
-      if (!cmds)
-        delete addTile;
+    if (!cmds)
+      delete addTile;
 
-      doc->notifyAfterAddTile(dstLayer, dstCel->frame(), tileIndex);
-    }
+    doc->notifyAfterAddTile(dstLayer, dstCel->frame(), tileIndex);
+    return tileIndex;
+  };
 
+  auto putTile = [&newTilemap, &tilemapBounds](const gfx::Point& tilePt, const doc::tile_t tile) {
     // We were using newTilemap->putPixel() directly but received a
     // crash report about an "access violation". So now we've added
     // some checks to the operation.
-    {
-      const int u = tilePt.x - tilemapBounds.x;
-      const int v = tilePt.y - tilemapBounds.y;
-      ASSERT((u >= 0) && (v >= 0) && (u < newTilemap->width()) && (v < newTilemap->height()));
-      doc::put_pixel(newTilemap.get(), u, v, doc::tile(tileIndex, tileFlag));
+    const int u = tilePt.x - tilemapBounds.x;
+    const int v = tilePt.y - tilemapBounds.y;
+    ASSERT((u >= 0) && (v >= 0) && (u < newTilemap->width()) && (v < newTilemap->height()));
+    doc::put_pixel(newTilemap.get(), u, v, tile);
+  };
+
+  if (parallel) {
+    BatchTileMatcher matcher(tileset, grid, srcImage, srcImagePos);
+    for (const gfx::Point& tilePt : grid.tilesInCanvasRegion(gfx::Region(canvasBounds)))
+      matcher.addCell(tilePt);
+
+    matcher.matchCells();
+    matcher.addTiles(addNewTile, putTile);
+  }
+  else {
+    const gfx::Size tileSize = grid.tileSize();
+    for (const gfx::Point& tilePt : grid.tilesInCanvasRegion(gfx::Region(canvasBounds))) {
+      const gfx::Point tilePtInCanvas = grid.tileToCanvas(tilePt);
+      doc::ImageRef tileImage(doc::crop_image(srcImage,
+                                              tilePtInCanvas.x - srcImagePos.x,
+                                              tilePtInCanvas.y - srcImagePos.y,
+                                              tileSize.w,
+                                              tileSize.h,
+                                              srcImage->maskColor()));
+      if (grid.hasMask())
+        mask_image(tileImage.get(), grid.mask().get());
+
+      preprocess_transparent_pixels(tileImage.get());
+
+      doc::tile_index tileIndex;
+      doc::tile_flags tileFlag = 0;
+      if (!find_tile(tileset, tileImage, tileIndex, tileFlag))
+        tileIndex = addNewTile(tileImage);
+
+      putTile(tilePt, doc::tile(tileIndex, tileFlag));
     }
   }
 
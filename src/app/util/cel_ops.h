@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2021  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This program is distributed under the terms of
@@ -52,7 +52,9 @@ doc::Cel* create_cel_copy(CmdSequence* cmds,
                           doc::Layer* dstLayer,
                           const doc::frame_t dstFrame);
 
-// Draws an image creating new tiles.
+// Draws an image creating new tiles. If "parallel" is false, the
+// cells are matched one by one in the current thread (the result is
+// the same in both cases).
 void draw_image_into_new_tilemap_cel(CmdSequence* cmds,
                                      doc::LayerTilemap* dstLayer,
                                      doc::Cel* dstCel,
@@ -60,7 +62,8 @@ void draw_image_into_new_tilemap_cel(CmdSequence* cmds,
                                      const gfx::Point& gridOrigin,
                                      const gfx::Point& srcImagePos,
                                      const gfx::Rect& canvasBounds,
-                                     doc::ImageRef& newTilemap);
+                                     doc::ImageRef& newTilemap,
+                                     bool parallel = true);
 
 void modify_tilemap_cel_region(CmdSequence* cmds,
                                doc::Cel* cel,
@@ -0,0 +1,226 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "app/doc.h"
+#include "app/util/cel_ops.h"
+#include "doc/cel.h"
+#include "doc/image.h"
+#include "doc/layer_tilemap.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+#include "doc/tileset.h"
+#include "doc/tilesets.h"
+#include "gfx/region.h"
+
+#include <cstdlib>
+#include <memory>
+
+using namespace app;
+using namespace doc;
+
+namespace {
+
+struct TilemapDoc {
+  std::unique_ptr<Doc> doc;
+  LayerTilemap* layer;
+  Cel* cel;
+
+  TilemapDoc(const gfx::Size& size, const gfx::Size& tileSize, const tile_flags matchFlags)
+  {
+    Sprite* sprite = Sprite::MakeStdSprite(ImageSpec(ColorMode::RGB, size.w, size.h));
+    auto tileset = new Tileset(sprite, Grid(tileSize), 1);
+    tileset->setMatchFlags(matchFlags);
+    sprite->tilesets()->add(tileset);
+
+    layer = new LayerTilemap(sprite, 0);
+    sprite->root()->addLayer(layer);
+
+    ImageRef tilemap(Image::create(IMAGE_TILEMAP, 1, 1));
+    tilemap->clear(notile);
+    cel = new Cel(0, tilemap);
+    layer->addCel(cel);
+
+    doc.reset(new Doc(sprite));
+  }
+
+  ~TilemapDoc() { doc->close(); }
+};
+
+// Image with a few different tiles, repeated, flipped, and with
+// some cells partially outside the image.
+ImageRef make_tiles_image(const gfx::Size& size, const gfx::Size& tileSize, const int seed)
+{
+  std::srand(seed);
+  ImageRef image(Image::create(IMAGE_RGB, size.w, size.h));
+  clear_image(image.get(), rgba(0, 0, 0, 0));
+
+  const int ntiles = 6;
+  for (int v = 0; v < size.h / tileSize.h + 1; ++v) {
+    for (int u = 0; u < size.w / tileSize.w + 1; ++u) {
+      const int t = std::rand() % ntiles;
+      const bool xflip = (std::rand() % 4) == 0;
+      const bool yflip = (std::rand() % 4) == 0;
+      for (int y = 0; y < tileSize.h; ++y) {
+        for (int x = 0; x < tileSize.w; ++x) {
+          const int tx = (xflip ? tileSize.w - x - 1 : x);
+          const int ty = (yflip ? tileSize.h - y - 1 : y);
+          const color_t c = (t == 0 ? rgba(0, 0, 0, 0) :
+                                      rgba(40 * t, 7 * tx + ty, 3 * ty + t * tx, 255));
+          put_pixel(image.get(), u * tileSize.w + x, v * tileSize.h + y, c);
+        }
+      }
+    }
+  }
+  return image;
+}
+
+void expect_same_tilemaps(const TilemapDoc& a, const TilemapDoc& b)
+{
+  const Tileset* tsA = a.layer->tileset();
+  const Tileset* tsB = b.layer->tileset();
+  ASSERT_EQ(tsA->size(), tsB->size());
+  for (tile_index ti = 0; ti < tsA->size(); ++ti)
+    EXPECT_TRUE(is_same_image(tsA->get(ti).get(), tsB->get(ti).get())) << "tile " << ti;
+
+  EXPECT_EQ(a.cel->position(), b.cel->position());
+  const Image* tmA = a.cel->image();
+  const Image* tmB = b.cel->image();
+  ASSERT_EQ(tmA->width(), tmB->width());
+  ASSERT_EQ(tmA->height(), tmB->height());
+  for (int v = 0; v < tmA->height(); ++v)
+    for (int u = 0; u < tmA->width(); ++u)
+      EXPECT_EQ(get_pixel(tmA, u, v), get_pixel(tmB, u, v)) << u << "," << v;
+}
+
+// Old implementation of create_region_with_differences() that adds
+// each different pixel to the region.
+void create_region_with_differences_per_pixel(const Image* a,
+                                              const Image* b,
+                                              const gfx::Rect& bounds,
+                                              gfx::Region& output)
+{
+  for (int y = bounds.y; y < bounds.y2(); ++y) {
+    for (int x = bounds.x; x < bounds.x2(); ++x) {
+      if (get_pixel(a, x, y) != get_pixel(b, x, y))
+        output.createUnion(output, gfx::Region(gfx::Rect(x, y, 1, 1)));
+    }
+  }
+}
+
+void expect_same_regions(const gfx::Region& expected, const gfx::Region& result)
+{
+  gfx::Region diff;
+  diff.createSubtraction(expected, result);
+  EXPECT_TRUE(diff.isEmpty());
+  diff.createSubtraction(result, expected);
+  EXPECT_TRUE(diff.isEmpty());
+  EXPECT_EQ(expected.bounds(), result.bounds());
+}
+
+// Compares create_region_with_differences() with the per-pixel
+// version for the given images, and returns the result.
+gfx::Region check_region_with_differences(const Image* a,
+                                          const Image* b,
+                                          const gfx::Rect& bounds,
+                                          const gfx::Region& initial = gfx::Region())
+{
+  gfx::Region expected = initial, result = initial;
+  create_region_with_differences_per_pixel(a, b, bounds, expected);
+  create_region_with_differences(a, b, bounds, result);
+  expect_same_regions(expected, result);
+  return result;
+}
+
+} // anonymous namespace
+
+TEST(CelOps, RegionWithDifferences)
+{
+  for (const PixelFormat pf : { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED }) {
+    const int w = 45, h = 23;
+    ImageRef a(Image::create(pf, w, h));
+    ImageRef b(Image::create(pf, w, h));
+    const gfx::Rect bounds = a->bounds();
+
+    // Empty diff
+    clear_image(a.get(), 0);
+    clear_image(b.get(), 0);
+    EXPECT_TRUE(check_region_with_differences(a.get(), b.get(), bounds).isEmpty());
+
+    // Full diff
+    clear_image(b.get(), 1);
+    EXPECT_EQ(bounds, check_region_with_differences(a.get(), b.get(), bounds).bounds());
+
+    // Single-pixel spans (checkerboard)
+    clear_image(b.get(), 0);
+    for (int y = 0; y < h; ++y)
+      for (int x = (y & 1); x < w; x += 2)
+        put_pixel(b.get(), x, y, 1);
+    check_region_with_differences(a.get(), b.get(), bounds);
+
+    // Touching spans: stairs of spans that overlap/touch the spans of
+    // the previous row, spans with the same x and different x2, etc.
+    clear_image(b.get(), 0);
+    for (int y = 0; y < h; ++y) {
+      fill_rect(b.get(), y, y, y + 5, y, 1);
+      fill_rect(b.get(), 20, y, 20 + (y % 3), y, 2);
+      fill_rect(b.get(), 30 + (y % 2), y, 35, y, 3);
+    }
+    fill_rect(b.get(), w - 4, 0, w - 1, h - 1, 4); // Spans touching the right edge
+    check_region_with_differences(a.get(), b.get(), bounds);
+
+    // Random pixels, sub-bounds, and a non-empty initial region
+    std::srand(pf + 1);
+    for (int i = 0; i < 300; ++i)
+      put_pixel(b.get(), std::rand() % w, std::rand() % h, std::rand() % 4);
+    check_region_with_differences(a.get(), b.get(), bounds);
+    check_region_with_differences(a.get(), b.get(), gfx::Rect(3, 2, 30, 17));
+    check_region_with_differences(a.get(),
+                                  b.get(),
+                                  gfx::Rect(3, 2, 30, 17),
+                                  gfx::Region(gfx::Rect(40, 0, 10, 30)));
+  }
+}
+
+TEST(CelOps, DrawImageIntoNewTilemapCelParallel)
+{
+  const gfx::Size tileSize(8, 8);
+  for (const tile_flags matchFlags : { tile_flags(0), tile_flags(tile_f_xflip | tile_f_yflip) }) {
+    for (int seed = 1; seed <= 3; ++seed) {
+      // Enough cells to match them in parallel
+      const gfx::Size size(300, 250);
+      ImageRef src = make_tiles_image(size, tileSize, seed);
+      const gfx::Point srcPos(3, 5);
+      const gfx::Rect canvasBounds(srcPos, size);
+
+      TilemapDoc seq(size, tileSize, matchFlags);
+      TilemapDoc par(size, tileSize, matchFlags);
+      ImageRef seqTilemap, parTilemap;
+      draw_image_into_new_tilemap_cel(nullptr,
+                                      seq.layer,
+                                      seq.cel,
+                                      src.get(),
+                                      gfx::Point(0, 0),
+                                      srcPos,
+                                      canvasBounds,
+                                      seqTilemap,
+                                      false);
+      draw_image_into_new_tilemap_cel(nullptr,
+                                      par.layer,
+                                      par.cel,
+                                      src.get(),
+                                      gfx::Point(0, 0),
+                                      srcPos,
+                                      canvasBounds,
+                                      parTilemap,
+                                      true);
+
+      EXPECT_GT(seq.layer->tileset()->size(), 1);
+      expect_same_tilemaps(seq, par);
+    }
+  }
+}
@@ -0,0 +1,75 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif
+
+#include "app/util/compressed_buffer.h"
+
+#include "base/exception.h"
+
+#include "zlib.h"
+
+namespace app {
+
+CompressedBuffer::CompressedBuffer() : m_size(0), m_compressed(false)
+{
+}
+
+base::buffer& CompressedBuffer::buffer()
+{
+  const std::lock_guard lock(m_mutex);
+  if (!m_compressed)
+    return m_buffer;
+
+  base::buffer data(m_size);
+  uLongf size = uLongf(m_size);
+  const int err = uncompress(data.data(), &size, m_buffer.data(), uLong(m_buffer.size()));
+  if (err != Z_OK || size != m_size)
+    throw base::Exception("ZLib error %d in uncompress().", err);
+
+  m_buffer = std::move(data);
+  m_compressed = false;
+  return m_buffer;
+}
+
+void CompressedBuffer::compress()
+{
+  const std::lock_guard lock(m_mutex);
+  if (m_compressed || m_buffer.empty())
+    return;
+
+  // Speed is more important than size here (we don't want to block
+  // the next undo/redo for too long).
+  base::buffer data(compressBound(uLong(m_buffer.size())));
+  uLongf size = uLongf(data.size());
+  const int err =
+    compress2(data.data(), &size, m_buffer.data(), uLong(m_buffer.size()), Z_BEST_SPEED);
+  if (err != Z_OK || size >= m_buffer.size())
+    return;
+
+  data.resize(size);
+  data.shrink_to_fit();
+
+  m_size = m_buffer.size();
+  m_buffer = std::move(data);
+  m_compressed = true;
+}
+
+bool CompressedBuffer::isCompressed() const
+{
+  const std::lock_guard lock(m_mutex);
+  return m_compressed;
+}
+
+size_t CompressedBuffer::memSize() const
+{
+  const std::lock_guard lock(m_mutex);
+  return m_buffer.size();
+}
+
+} // namespace app
@@ -0,0 +1,46 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_UTIL_COMPRESSED_BUFFER_H_INCLUDED
+#define APP_UTIL_COMPRESSED_BUFFER_H_INCLUDED
+#pragma once
+
+#include "base/buffer.h"
+
+#include <mutex>
+
+namespace app {
+
+// A buffer of bytes that can be compressed while it's not used
+// (e.g. the pixels of the undo history). compress() can be called
+// from a background thread, and the buffer is decompressed again when
+// it's accessed with buffer().
+class CompressedBuffer {
+public:
+  CompressedBuffer();
+
+  // Returns the uncompressed data, decompressing it if it's needed.
+  base::buffer& buffer();
+
+  // Compresses the data to reduce the memory usage. If the
+  // compressed data is not smaller, the buffer is kept uncompressed.
+  void compress();
+
+  bool isCompressed() const;
+
+  // Bytes used in memory by this buffer.
+  size_t memSize() const;
+
+private:
+  mutable std::mutex m_mutex;
+  base::buffer m_buffer;
+  size_t m_size; // Uncompressed size (when m_compressed is true)
+  bool m_compressed;
+};
+
+} // namespace app
+
+#endif
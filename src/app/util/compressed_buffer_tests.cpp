@@ -0,0 +1,68 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "app/util/compressed_buffer.h"
+
+#include <cstdlib>
+
+using namespace app;
+
+TEST(CompressedBuffer, Empty)
+{
+  CompressedBuffer buf;
+  buf.compress();
+  EXPECT_FALSE(buf.isCompressed());
+  EXPECT_TRUE(buf.buffer().empty());
+  EXPECT_EQ(0, buf.memSize());
+}
+
+TEST(CompressedBuffer, RoundTrip)
+{
+  base::buffer data(64 * 1024);
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = uint8_t((i / 128) & 0xff);
+
+  CompressedBuffer buf;
+  buf.buffer() = data;
+  EXPECT_EQ(data.size(), buf.memSize());
+
+  buf.compress();
+  EXPECT_TRUE(buf.isCompressed());
+  EXPECT_LT(buf.memSize(), data.size());
+
+  // Compressing twice doesn't change anything
+  const size_t compressedSize = buf.memSize();
+  buf.compress();
+  EXPECT_EQ(compressedSize, buf.memSize());
+
+  EXPECT_EQ(data, buf.buffer());
+  EXPECT_FALSE(buf.isCompressed());
+  EXPECT_EQ(data.size(), buf.memSize());
+
+  // Modify the uncompressed data and compress it again
+  buf.buffer()[100] = 200;
+  data[100] = 200;
+  buf.compress();
+  EXPECT_TRUE(buf.isCompressed());
+  EXPECT_EQ(data, buf.buffer());
+}
+
+TEST(CompressedBuffer, Incompressible)
+{
+  std::srand(1);
+  base::buffer data(1024);
+  for (auto& b : data)
+    b = uint8_t(std::rand() & 0xff);
+
+  CompressedBuffer buf;
+  buf.buffer() = data;
+  buf.compress();
+  EXPECT_FALSE(buf.isCompressed());
+  EXPECT_EQ(data.size(), buf.memSize());
+  EXPECT_EQ(data, buf.buffer());
+}
@@ -1,5 +1,5 @@
 // Aseprite Document IO Library
-// Copyright (c) 2018-2023 Igara Studio S.A.
+// Copyright (c) 2018-2025 Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -27,6 +27,7 @@
 #include "gfx/color_space.h"
 #include "zlib.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <vector>
 
@@ -83,11 +84,13 @@ bool AsepriteDecoder::decode()
   auto tag_end = sprite->tags().end();
 
   m_allLayers.clear();
+  m_pendingCels.clear();
 
   int current_level = -1;
   AsepriteExternalFiles extFiles;
 
   // Just one frame?
+  const bool headerOnly = delegate()->decodeHeaderOnly();
   doc::frame_t nframes = sprite->totalFrames();
   if (nframes > 1 && delegate()->decodeOneFrame())
     nframes = 1;
@@ -118,6 +121,15 @@ bool AsepriteDecoder::decode()
         int chunk_size = read32();
         int chunk_type = read16();
 
+        // All the metadata is in the first frame except palette
+        // changes, so if we only need the header we skip the other
+        // chunks of the next frames.
+        if (headerOnly && frame > 0 && chunk_type != ASE_FILE_CHUNK_PALETTE &&
+            chunk_type != ASE_FILE_CHUNK_FLI_COLOR && chunk_type != ASE_FILE_CHUNK_FLI_COLOR2) {
+          f()->seek(chunk_pos + chunk_size);
+          continue;
+        }
+
         switch (chunk_type) {
           case ASE_FILE_CHUNK_FLI_COLOR:
           case ASE_FILE_CHUNK_FLI_COLOR2:
@@ -159,6 +171,13 @@ bool AsepriteDecoder::decode()
           }
 
           case ASE_FILE_CHUNK_CEL: {
+            // Skip the cel (and its extra/user data chunks)
+            if (headerOnly) {
+              last_cel = nullptr;
+              last_object_with_user_data = nullptr;
+              break;
+            }
+
             doc::Cel* cel = readCelChunk(sprite.get(),
                                          frame,
                                          sprite->pixelFormat(),
@@ -300,6 +319,10 @@ bool AsepriteDecoder::decode()
       break;
   }
 
+  // Inflate all compressed cels that we've read (even if the
+  // operation was canceled, the images must have valid pixels)
+  decodePendingCels(&header);
+
   delegate()->onSprite(sprite.release());
   return true;
 }
@@ -386,11 +409,9 @@ std::string AsepriteDecoder::readString()
   if (length == EOF)
     return "";
 
-  std::string string;
-  string.reserve(length + 1);
-
-  for (int c = 0; c < length; c++)
-    string.push_back(read8());
+  std::string string(length, 0);
+  if (length > 0)
+    readBytes((uint8_t*)&string[0], length);
 
   return string;
 }
@@ -803,8 +824,61 @@ void read_compressed_image(FileInterface* f,
   }
 }
 
+// Collects the errors found inflating a pending cel in a worker
+// thread, so they can be reported later from the decoder thread.
+class PendingCelDelegate : public DecodeDelegate {
+public:
+  PendingCelDelegate(std::string& error) : m_error(error) {}
+
+  void error(const std::string& msg) override
+  {
+    if (!m_error.empty())
+      m_error.push_back('\n');
+    m_error += msg;
+  }
+
+private:
+  std::string& m_error;
+};
+
 } // anonymous namespace
 
+void AsepriteDecoder::decodePendingCels(const AsepriteHeader* header)
+{
+  if (m_pendingCels.empty())
+    return;
+
+  const bool cacheCompressedCels = delegate()->cacheCompressedCels();
+  auto decodeCel = [header, cacheCompressedCels](PendingCel& pending) {
+    MemoryFileInterface memFile(pending.compressed.data(), pending.compressed.size());
+    PendingCelDelegate errorDelegate(pending.error);
+    read_compressed_image(&memFile,
+                          &errorDelegate,
+                          pending.image.get(),
+                          header,
+                          pending.compressed.size());
+
+    // Keep the compressed data in the image to save it without
+    // re-compressing (only if it was read/decoded correctly)
+    if (cacheCompressedCels && pending.error.empty())
+      pending.image->setCompressedData(pending.compressed);
+
+    // Free the compressed data as soon as possible
+    pending.compressed = std::vector<uint8_t>();
+  };
+
+  delegate()->parallelFor(int(m_pendingCels.size()),
+                          [this, &decodeCel](const int i) { decodeCel(m_pendingCels[i]); });
+
+  // Report errors in the same order as the cels were read
+  for (const PendingCel& pending : m_pendingCels) {
+    if (!pending.error.empty())
+      delegate()->error(pending.error);
+  }
+
+  m_pendingCels.clear();
+}
+
 //////////////////////////////////////////////////////////////////////
 // Cel Chunk
 //////////////////////////////////////////////////////////////////////
@@ -876,6 +950,9 @@ doc::Cel* AsepriteDecoder::readCelChunk(doc::Sprite* sprite,
           cel.reset(doc::Cel::MakeLink(frame, link));
         }
         else {
+          // We need the pixels of the linked cel to make the copy
+          decodePendingCels(header);
+
           cel.reset(doc::Cel::MakeCopy(frame, link));
           cel->setPosition(x, y);
           cel->setOpacity(opacity);
@@ -896,7 +973,22 @@ doc::Cel* AsepriteDecoder::readCelChunk(doc::Sprite* sprite,
 
       if (w > 0 && h > 0) {
         doc::ImageRef image(doc::Image::create(pixelFormat, w, h));
-        read_compressed_image(f(), delegate(), image.get(), header, chunk_end);
+
+        // Read the compressed pixels to inflate them later (in
+        // parallel with other cels) in decodePendingCels()
+        const size_t pos = f()->tell();
+        if (pos < chunk_end) {
+          PendingCel pending;
+          pending.image = image;
+          pending.compressed.resize(chunk_end - pos);
+          const size_t bytes_read = f()->readBytes(&pending.compressed[0], chunk_end - pos);
+          if (bytes_read < pending.compressed.size()) {
+            pending.error = fmt::format("Error reading {} bytes of compressed data",
+                                        pending.compressed.size());
+            pending.compressed.resize(bytes_read);
+          }
+          m_pendingCels.push_back(std::move(pending));
+        }
 
         cel = std::make_unique<doc::Cel>(frame, image);
         cel->setPosition(x, y);
@@ -1256,7 +1348,8 @@ doc::Tileset* AsepriteDecoder::readTilesetChunk(doc::Sprite* sprite,
   }
 
   if (flags & ASE_TILESET_FLAG_EMBEDDED) {
-    if (ntiles > 0) {
+    // Tiles are kept empty if we need just the sprite information
+    if (ntiles > 0 && !delegate()->decodeHeaderOnly()) {
       const size_t dataSize = read32(); // Size of compressed data
       const size_t dataBeg = f()->tell();
       const size_t dataEnd = dataBeg + dataSize;
@@ -1,5 +1,5 @@
 // Aseprite Document IO Library
-// Copyright (c) 2018-2023 Igara Studio S.A.
+// Copyright (c) 2018-2025 Igara Studio S.A.
 // Copyright (c) 2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -11,6 +11,7 @@
 
 #include "dio/decoder.h"
 #include "doc/frame.h"
+#include "doc/image_ref.h"
 #include "doc/layer_list.h"
 #include "doc/pixel_format.h"
 #include "doc/slices.h"
@@ -42,6 +43,15 @@ public:
   bool decode() override;
 
 private:
+  // Compressed pixels of a cel image that were read from the file
+  // but are not yet inflated. All pending cels are inflated in
+  // parallel by decodePendingCels().
+  struct PendingCel {
+    doc::ImageRef image;
+    std::vector<uint8_t> compressed;
+    std::string error;
+  };
+
   bool readHeader(AsepriteHeader* header);
   void readFrameHeader(AsepriteFrameHeader* frame_header);
   void readPadding(const int bytes);
@@ -75,9 +85,11 @@ private:
                           const AsepriteExternalFiles& extFiles);
   const doc::UserData::Variant readPropertyValue(uint16_t type);
   void readTilesData(doc::Tileset* tileset, const AsepriteExternalFiles& extFiles);
+  void decodePendingCels(const AsepriteHeader* header);
 
   doc::LayerList m_allLayers;
   std::vector<uint32_t> m_tilesetFlags;
+  std::vector<PendingCel> m_pendingCels;
 };
 
 } // namespace dio
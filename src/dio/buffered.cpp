@@ -0,0 +1,93 @@
+// Aseprite Document IO Library
+// Copyright (c) 2025 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "dio/file_interface.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace dio {
+
+// The position of the FILE* is always at m_bufferPos + m_end (the end
+// of the buffered data), so seeking inside the buffer doesn't need
+// to touch the FILE* at all.
+
+BufferedFileInterface::BufferedFileInterface(FILE* file)
+  : m_file(file)
+  , m_buffer(kBufferSize)
+  , m_bufferPos(ftell(file))
+  , m_pos(0)
+  , m_end(0)
+  , m_ok(true)
+{
+}
+
+void BufferedFileInterface::seek(size_t absPos)
+{
+  if (absPos >= m_bufferPos && absPos <= m_bufferPos + m_end) {
+    m_pos = absPos - m_bufferPos;
+  }
+  else {
+    fseek(m_file, absPos, SEEK_SET);
+    m_bufferPos = absPos;
+    m_pos = m_end = 0;
+  }
+}
+
+size_t BufferedFileInterface::readBytes(uint8_t* buf, size_t n)
+{
+  size_t copied = std::min(n, m_end - m_pos);
+  if (copied > 0) {
+    std::memcpy(buf, &m_buffer[m_pos], copied);
+    m_pos += copied;
+  }
+
+  // Big blocks are read directly to the destination
+  if (n - copied >= m_buffer.size()) {
+    m_bufferPos += m_end;
+    m_pos = m_end = 0;
+
+    size_t n2 = fread(buf + copied, 1, n - copied, m_file);
+    m_bufferPos += n2;
+    copied += n2;
+  }
+  else {
+    while (copied < n && fillBuffer()) {
+      size_t n2 = std::min(n - copied, m_end);
+      std::memcpy(buf + copied, &m_buffer[0], n2);
+      m_pos = n2;
+      copied += n2;
+    }
+  }
+
+  if (copied != n)
+    m_ok = false;
+  return copied;
+}
+
+void BufferedFileInterface::write8(uint8_t value)
+{
+  m_ok = false;
+}
+
+uint8_t BufferedFileInterface::read8Slow()
+{
+  if (fillBuffer())
+    return m_buffer[m_pos++];
+
+  m_ok = false;
+  return 0;
+}
+
+bool BufferedFileInterface::fillBuffer()
+{
+  m_bufferPos += m_end;
+  m_pos = 0;
+  m_end = fread(&m_buffer[0], 1, m_buffer.size(), m_file);
+  return (m_end > 0);
+}
+
+} // namespace dio
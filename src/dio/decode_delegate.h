@@ -1,5 +1,5 @@
 // Aseprite Document IO Library
-// Copyright (c) 2023 Igara Studio S.A.
+// Copyright (c) 2023-2025 Igara Studio S.A.
 // Copyright (c) 2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -13,6 +13,7 @@
 #include "doc/frame.h"
 #include "doc/sprite.h"
 
+#include <functional>
 #include <string>
 
 namespace dio {
@@ -38,6 +39,11 @@ public:
   // to generate a thumbnail)
   virtual bool decodeOneFrame() { return false; }
 
+  // Return true if you want to read just the sprite metadata (size,
+  // frames, layers, tags, slices, etc.) without the cels (e.g. useful
+  // to get information about a file quickly)
+  virtual bool decodeHeaderOnly() { return false; }
+
   // Default color for slices without user data
   virtual doc::color_t defaultSliceColor() { return doc::rgba(0, 0, 255, 255); }
 
@@ -53,6 +59,20 @@ public:
   // tilesets exactly as they are in the disk (so we can save it
   // without re-compressing).
   virtual bool cacheCompressedTilesets() const { return false; }
+
+  // Returns true if we want to cache the read compressed data of cel
+  // images (so we can save them again without re-compressing).
+  virtual bool cacheCompressedCels() const { return false; }
+
+  // Calls func(i) for each i in [0, n) and waits all the calls. It's
+  // used to inflate several cel images at the same time, so you can
+  // overwrite it to run the calls in several threads (by default
+  // they are called in the current thread).
+  virtual void parallelFor(const int n, const std::function<void(int)>& func)
+  {
+    for (int i = 0; i < n; ++i)
+      func(i);
+  }
 };
 
 } // namespace dio
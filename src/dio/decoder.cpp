@@ -1,5 +1,5 @@
 // Aseprite Document IO Library
-// Copyright (c) 2018 Igara Studio S.A.
+// Copyright (c) 2018-2025 Igara Studio S.A.
 // Copyright (c) 2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -33,47 +33,22 @@ uint8_t Decoder::read8()
 
 uint16_t Decoder::read16()
 {
-  int b1 = m_f->read8();
-  int b2 = m_f->read8();
-
-  if (m_f->ok()) {
-    return ((b2 << 8) | b1); // Little endian
-  }
-  else
-    return 0;
+  return m_f->read16();
 }
 
 uint32_t Decoder::read32()
 {
-  int b1 = m_f->read8();
-  int b2 = m_f->read8();
-  int b3 = m_f->read8();
-  int b4 = m_f->read8();
-
-  if (m_f->ok()) {
-    // Little endian
-    return ((b4 << 24) | (b3 << 16) | (b2 << 8) | b1);
-  }
-  else
-    return 0;
+  return m_f->read32();
 }
 
 uint64_t Decoder::read64()
 {
-  int b1 = m_f->read8();
-  int b2 = m_f->read8();
-  int b3 = m_f->read8();
-  int b4 = m_f->read8();
-  int b5 = m_f->read8();
-  int b6 = m_f->read8();
-  int b7 = m_f->read8();
-  int b8 = m_f->read8();
+  uint64_t lo = m_f->read32();
+  uint64_t hi = m_f->read32();
 
   if (m_f->ok()) {
     // Little endian
-    return (((long long)b8 << 56) | ((long long)b7 << 48) | ((long long)b6 << 40) |
-            ((long long)b5 << 32) | ((long long)b4 << 24) | ((long long)b3 << 16) |
-            ((long long)b2 << 8) | (long long)b1);
+    return ((hi << 32) | lo);
   }
   else
     return 0;
@@ -0,0 +1,38 @@
+// Aseprite Document IO Library
+// Copyright (c) 2025 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "dio/file_interface.h"
+
+namespace dio {
+
+uint16_t FileInterface::read16()
+{
+  int b1 = read8();
+  int b2 = read8();
+
+  if (ok()) {
+    return ((b2 << 8) | b1); // Little endian
+  }
+  else
+    return 0;
+}
+
+uint32_t FileInterface::read32()
+{
+  int b1 = read8();
+  int b2 = read8();
+  int b3 = read8();
+  int b4 = read8();
+
+  if (ok()) {
+    // Little endian
+    return ((b4 << 24) | (b3 << 16) | (b2 << 8) | b1);
+  }
+  else
+    return 0;
+}
+
+} // namespace dio
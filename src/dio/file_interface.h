@@ -1,4 +1,5 @@
 // Aseprite Document IO Library
+// Copyright (c) 2025 Igara Studio S.A.
 // Copyright (c) 2017-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -11,6 +12,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <vector>
 
 namespace dio {
 
@@ -31,6 +33,12 @@ public:
   virtual uint8_t read8() = 0;
   virtual size_t readBytes(uint8_t* buf, size_t n) = 0;
 
+  // Returns the next little endian 16/32-bit value in the file or 0
+  // if ok() = false. The default implementation uses read8(), but
+  // implementations can override these to avoid the per-byte call.
+  virtual uint16_t read16();
+  virtual uint32_t read32();
+
   // Writes one byte in the file (or do nothing if ok() = false)
   virtual void write8(uint8_t value) = 0;
 };
@@ -50,6 +58,80 @@ private:
   bool m_ok;
 };
 
+// Reads a FILE* through a big memory buffer, so reading each field
+// of the file doesn't require a fgetc() call. Useful to decode files
+// with a lot of small chunks. Writing is not supported.
+class BufferedFileInterface : public FileInterface {
+public:
+  static constexpr size_t kBufferSize = 64 * 1024;
+
+  BufferedFileInterface(FILE* file);
+  bool ok() const override { return m_ok; }
+  size_t tell() override { return m_bufferPos + m_pos; }
+  void seek(size_t absPos) override;
+
+  uint8_t read8() override
+  {
+    if (m_pos < m_end)
+      return m_buffer[m_pos++];
+    return read8Slow();
+  }
+
+  uint16_t read16() override
+  {
+    if (m_pos + 2 <= m_end) {
+      const uint8_t* p = &m_buffer[m_pos];
+      m_pos += 2;
+      return ((p[1] << 8) | p[0]);
+    }
+    return FileInterface::read16();
+  }
+
+  uint32_t read32() override
+  {
+    if (m_pos + 4 <= m_end) {
+      const uint8_t* p = &m_buffer[m_pos];
+      m_pos += 4;
+      return ((uint32_t(p[3]) << 24) | (uint32_t(p[2]) << 16) | (uint32_t(p[1]) << 8) |
+              uint32_t(p[0]));
+    }
+    return FileInterface::read32();
+  }
+
+  size_t readBytes(uint8_t* buf, size_t n) override;
+  void write8(uint8_t value) override;
+
+private:
+  uint8_t read8Slow();
+  bool fillBuffer();
+
+  FILE* m_file;
+  std::vector<uint8_t> m_buffer;
+  size_t m_bufferPos; // Position of m_buffer[0] in the file
+  size_t m_pos;       // Current position inside m_buffer
+  size_t m_end;       // Number of valid bytes in m_buffer
+  bool m_ok;
+};
+
+// Reads bytes from a memory block. The memory must be kept alive
+// while this interface is used. Writing is not supported.
+class MemoryFileInterface : public FileInterface {
+public:
+  MemoryFileInterface(const uint8_t* data, size_t size);
+  bool ok() const override;
+  size_t tell() override;
+  void seek(size_t absPos) override;
+  uint8_t read8() override;
+  size_t readBytes(uint8_t* buf, size_t n) override;
+  void write8(uint8_t value) override;
+
+private:
+  const uint8_t* m_data;
+  size_t m_size;
+  size_t m_pos;
+  bool m_ok;
+};
+
 } // namespace dio
 
 #endif
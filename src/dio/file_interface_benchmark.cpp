@@ -0,0 +1,82 @@
+// Aseprite Document IO Library
+// Copyright (c) 2025 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif
+
+#include "dio/file_interface.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <vector>
+
+using namespace dio;
+
+// Creates a temporary file with "nchunks" small chunks similar to
+// the ones found in .aseprite files (size + type + some data).
+static FILE* create_file_with_chunks(const int nchunks)
+{
+  FILE* f = std::tmpfile();
+  for (int i = 0; i < nchunks; ++i) {
+    const uint32_t size = 6 + 16;
+    const uint16_t type = 0x2020;
+    fputc(size & 0xff, f);
+    fputc((size >> 8) & 0xff, f);
+    fputc((size >> 16) & 0xff, f);
+    fputc((size >> 24) & 0xff, f);
+    fputc(type & 0xff, f);
+    fputc((type >> 8) & 0xff, f);
+    for (int j = 0; j < 16; ++j)
+      fputc(j, f);
+  }
+  fflush(f);
+  return f;
+}
+
+template<typename T>
+static void read_chunks(T& fi, const int nchunks)
+{
+  for (int i = 0; i < nchunks; ++i) {
+    const size_t pos = fi.tell();
+    const uint32_t size = fi.read32();
+    benchmark::DoNotOptimize(fi.read16());
+    for (int j = 0; j < 4; ++j)
+      benchmark::DoNotOptimize(fi.read32());
+    fi.seek(pos + size);
+  }
+}
+
+void BM_StdioFileInterface(benchmark::State& state)
+{
+  const int nchunks = state.range(0);
+  FILE* f = create_file_with_chunks(nchunks);
+  while (state.KeepRunning()) {
+    fseek(f, 0, SEEK_SET);
+    StdioFileInterface fi(f);
+    read_chunks(fi, nchunks);
+  }
+  fclose(f);
+}
+
+void BM_BufferedFileInterface(benchmark::State& state)
+{
+  const int nchunks = state.range(0);
+  FILE* f = create_file_with_chunks(nchunks);
+  while (state.KeepRunning()) {
+    fseek(f, 0, SEEK_SET);
+    BufferedFileInterface fi(f);
+    read_chunks(fi, nchunks);
+  }
+  fclose(f);
+}
+
+BENCHMARK(BM_StdioFileInterface)->Arg(1000)->Arg(100000)->UseRealTime();
+
+BENCHMARK(BM_BufferedFileInterface)->Arg(1000)->Arg(100000)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,63 @@
+// Aseprite Document IO Library
+// Copyright (c) 2025 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "dio/file_interface.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace dio {
+
+MemoryFileInterface::MemoryFileInterface(const uint8_t* data, size_t size)
+  : m_data(data)
+  , m_size(size)
+  , m_pos(0)
+  , m_ok(true)
+{
+}
+
+bool MemoryFileInterface::ok() const
+{
+  return m_ok;
+}
+
+size_t MemoryFileInterface::tell()
+{
+  return m_pos;
+}
+
+void MemoryFileInterface::seek(size_t absPos)
+{
+  m_pos = std::min(absPos, m_size);
+}
+
+uint8_t MemoryFileInterface::read8()
+{
+  if (m_pos < m_size)
+    return m_data[m_pos++];
+
+  m_ok = false;
+  return 0;
+}
+
+size_t MemoryFileInterface::readBytes(uint8_t* buf, size_t n)
+{
+  size_t n2 = std::min(n, m_size - m_pos);
+  if (n2 > 0) {
+    std::memcpy(buf, m_data + m_pos, n2);
+    m_pos += n2;
+  }
+  if (n2 != n)
+    m_ok = false;
+  return n2;
+}
+
+void MemoryFileInterface::write8(uint8_t value)
+{
+  m_ok = false;
+}
+
+} // namespace dio
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2019 Igara Studio S.A.
+// Copyright (c) 2019-2025 Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -32,8 +32,44 @@ void BM_ShrinkBounds(benchmark::State& state)
   }
 }
 
+// Image with pixels in the corners (nothing to shrink, only the
+// first/last rows should be scanned)
+void BM_ShrinkBoundsFull(benchmark::State& state)
+{
+  const PixelFormat pixelFormat = (PixelFormat)state.range(0);
+  const int w = state.range(1);
+  const int h = state.range(2);
+
+  std::unique_ptr<Image> img(Image::create(pixelFormat, w, h));
+  img->putPixel(0, 0, rgba(1, 2, 3, 4));
+  img->putPixel(w - 1, h - 1, rgba(1, 2, 3, 4));
+  gfx::Rect rc;
+  while (state.KeepRunning()) {
+    doc::algorithm::shrink_bounds(img.get(), 0, nullptr, rc);
+  }
+}
+
+// Completely transparent image (all rows must be scanned)
+void BM_ShrinkBoundsEmpty(benchmark::State& state)
+{
+  const PixelFormat pixelFormat = (PixelFormat)state.range(0);
+  const int w = state.range(1);
+  const int h = state.range(2);
+
+  std::unique_ptr<Image> img(Image::create(pixelFormat, w, h));
+  img->clear(0);
+  gfx::Rect rc;
+  while (state.KeepRunning()) {
+    doc::algorithm::shrink_bounds(img.get(), 0, nullptr, rc);
+  }
+}
+
+// Small (cels), medium (sprites), and huge images
 #define DEFARGS(MODE)                                                                              \
-  ->Args({ MODE, 100, 100 })                                                                       \
+  ->Args({ MODE, 16, 16 })                                                                         \
+    ->Args({ MODE, 32, 32 })                                                                       \
+    ->Args({ MODE, 64, 64 })                                                                       \
+    ->Args({ MODE, 100, 100 })                                                                     \
     ->Args({ MODE, 200, 200 })                                                                     \
     ->Args({ MODE, 300, 300 })                                                                     \
     ->Args({ MODE, 400, 400 })                                                                     \
@@ -45,6 +81,8 @@ void BM_ShrinkBounds(benchmark::State& state)
     ->Args({ MODE, 800, 800 })                                                                     \
     ->Args({ MODE, 900, 900 })                                                                     \
     ->Args({ MODE, 1000, 1000 })                                                                   \
+    ->Args({ MODE, 1023, 1024 })                                                                   \
+    ->Args({ MODE, 1024, 1024 })                                                                   \
     ->Args({ MODE, 1500, 1500 })                                                                   \
     ->Args({ MODE, 2000, 2000 })                                                                   \
     ->Args({ MODE, 4000, 4000 })                                                                   \
@@ -55,4 +93,11 @@ DEFARGS(IMAGE_RGB)
 DEFARGS(IMAGE_GRAYSCALE)
 DEFARGS(IMAGE_INDEXED)->Unit(benchmark::kMicrosecond)->UseRealTime();
 
+BENCHMARK(BM_ShrinkBoundsFull)
+DEFARGS(IMAGE_RGB)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+BENCHMARK(BM_ShrinkBoundsEmpty)
+DEFARGS(IMAGE_RGB)
+DEFARGS(IMAGE_INDEXED)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
 BENCHMARK_MAIN();
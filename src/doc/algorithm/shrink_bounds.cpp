@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2019-2023 Igara Studio S.A.
+// Copyright (c) 2019-2025 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -17,156 +17,248 @@
 #include "doc/image_impl.h"
 #include "doc/layer.h"
 #include "doc/layer_tilemap.h"
+#include "doc/parallel_for.h"
 #include "doc/primitives.h"
 #include "doc/primitives_fast.h"
 #include "doc/tileset.h"
 
-#include <thread>
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_WIN64)
+  #include <emmintrin.h>
+#endif
 
 namespace doc { namespace algorithm {
 
 namespace {
 
+// A pixel is equal to the reference pixel if (pixel & mask) == value.
+// In this way we can compare several pixels at once without
+// branches (see block_has_diff()).
 template<typename ImageTraits>
-bool is_same_pixel(color_t pixel1, color_t pixel2)
-{
-  static_assert(false && sizeof(ImageTraits), "No is_same_pixel impl");
-  return false;
-}
+struct RefPixel {
+  using pixel_t = typename ImageTraits::pixel_t;
+  pixel_t mask;
+  pixel_t value;
+};
 
-template<>
-bool is_same_pixel<RgbTraits>(color_t pixel1, color_t pixel2)
+template<typename ImageTraits>
+RefPixel<ImageTraits> make_ref_pixel(color_t refpixel)
 {
-  return (rgba_geta(pixel1) == 0 && rgba_geta(pixel2) == 0) || (pixel1 == pixel2);
+  using pixel_t = typename ImageTraits::pixel_t;
+  return { pixel_t(~0), pixel_t(refpixel) };
 }
 
+// All transparent pixels are equal
 template<>
-bool is_same_pixel<GrayscaleTraits>(color_t pixel1, color_t pixel2)
+RefPixel<RgbTraits> make_ref_pixel<RgbTraits>(color_t refpixel)
 {
-  return (graya_geta(pixel1) == 0 && graya_geta(pixel2) == 0) || (pixel1 == pixel2);
+  if (rgba_geta(refpixel) == 0)
+    return { rgba_a_mask, 0 };
+  return { 0xffffffff, refpixel };
 }
 
 template<>
-bool is_same_pixel<IndexedTraits>(color_t pixel1, color_t pixel2)
+RefPixel<GrayscaleTraits> make_ref_pixel<GrayscaleTraits>(color_t refpixel)
 {
-  return pixel1 == pixel2;
+  if (graya_geta(refpixel) == 0)
+    return { graya_a_mask, 0 };
+  return { 0xffff, uint16_t(refpixel) };
 }
 
-template<>
-bool is_same_pixel<BitmapTraits>(color_t pixel1, color_t pixel2)
+// Number of pixels checked at once by block_has_diff() (64 bytes)
+template<typename ImageTraits>
+constexpr int kBlockPixels = 64 / sizeof(typename ImageTraits::pixel_t);
+
+// Returns true if any of the kBlockPixels pixels starting at "p" is
+// different than the reference pixel.
+template<typename ImageTraits>
+bool block_has_diff(const typename ImageTraits::pixel_t* p, const RefPixel<ImageTraits> ref)
 {
-  return pixel1 == pixel2;
+  using pixel_t = typename ImageTraits::pixel_t;
+#if defined(__x86_64__) || defined(_WIN64)
+  __m128i mask, value;
+  if constexpr (sizeof(pixel_t) == 4) {
+    mask = _mm_set1_epi32(ref.mask);
+    value = _mm_set1_epi32(ref.value);
+  }
+  else if constexpr (sizeof(pixel_t) == 2) {
+    mask = _mm_set1_epi16(ref.mask);
+    value = _mm_set1_epi16(ref.value);
+  }
+  else {
+    mask = _mm_set1_epi8(ref.mask);
+    value = _mm_set1_epi8(ref.value);
+  }
+  const __m128i* q = (const __m128i*)p;
+  __m128i diff = _mm_setzero_si128();
+  for (int i = 0; i < 4; ++i)
+    diff = _mm_or_si128(diff, _mm_xor_si128(_mm_and_si128(_mm_loadu_si128(q + i), mask), value));
+  return (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xffff);
+#else
+  pixel_t diff = 0;
+  for (int i = 0; i < kBlockPixels<ImageTraits>; ++i)
+    diff |= (p[i] & ref.mask) ^ ref.value;
+  return (diff != 0);
+#endif
 }
 
+// Returns the index of the first pixel in row[0, n) that is not
+// equal to the reference pixel, or n if all pixels are equal.
 template<typename ImageTraits>
-bool shrink_bounds_left_templ(const Image* image, gfx::Rect& bounds, color_t refpixel, int rowPixels)
+int find_first_diff(const typename ImageTraits::pixel_t* row,
+                    const int n,
+                    const RefPixel<ImageTraits> ref)
 {
-  int u, v;
-  // Shrink left side
-  for (u = bounds.x; u < bounds.x2(); ++u) {
-    auto ptr = get_pixel_address_fast<ImageTraits>(image, u, v = bounds.y);
-    for (; v < bounds.y2(); ++v, ptr += rowPixels) {
-      ASSERT(ptr == get_pixel_address_fast<ImageTraits>(image, u, v));
-      if (!is_same_pixel<ImageTraits>(*ptr, refpixel))
-        return (!bounds.isEmpty());
-    }
-    ++bounds.x;
-    --bounds.w;
+  constexpr int kBlock = kBlockPixels<ImageTraits>;
+
+  int i = 0;
+  for (; i + kBlock <= n; i += kBlock) {
+    if (block_has_diff<ImageTraits>(row + i, ref))
+      break;
   }
-  return (!bounds.isEmpty());
+  for (; i < n; ++i) {
+    if ((row[i] & ref.mask) != ref.value)
+      return i;
+  }
+  return n;
 }
 
+// Returns the index of the last pixel in row[0, n) that is not equal
+// to the reference pixel, or -1 if all pixels are equal.
 template<typename ImageTraits>
-bool shrink_bounds_right_templ(const Image* image,
-                               gfx::Rect& bounds,
-                               color_t refpixel,
-                               int rowPixels)
+int find_last_diff(const typename ImageTraits::pixel_t* row,
+                   const int n,
+                   const RefPixel<ImageTraits> ref)
 {
-  int u, v;
-  // Shrink right side
-  for (u = bounds.x2() - 1; u >= bounds.x; --u) {
-    auto ptr = get_pixel_address_fast<ImageTraits>(image, u, v = bounds.y);
-    for (; v < bounds.y2(); ++v, ptr += rowPixels) {
-      ASSERT(ptr == get_pixel_address_fast<ImageTraits>(image, u, v));
-      if (!is_same_pixel<ImageTraits>(*ptr, refpixel))
-        return (!bounds.isEmpty());
-    }
-    --bounds.w;
+  constexpr int kBlock = kBlockPixels<ImageTraits>;
+
+  int i = n;
+  for (; i - kBlock >= 0; i -= kBlock) {
+    if (block_has_diff<ImageTraits>(row + i - kBlock, ref))
+      break;
   }
-  return (!bounds.isEmpty());
+  for (--i; i >= 0; --i) {
+    if ((row[i] & ref.mask) != ref.value)
+      return i;
+  }
+  return -1;
 }
 
+// Returns a pointer to the pixels of the given row in the "bounds"
+// area. Bitmap images are unpacked in "buf" (one byte per pixel).
 template<typename ImageTraits>
-bool shrink_bounds_top_templ(const Image* image, gfx::Rect& bounds, color_t refpixel)
+const typename ImageTraits::pixel_t* get_row(const Image* image,
+                                             const gfx::Rect& bounds,
+                                             const int y,
+                                             std::vector<uint8_t>& buf)
 {
-  int u, v;
-  // Shrink top side
-  for (v = bounds.y; v < bounds.y2(); ++v) {
-    auto ptr = get_pixel_address_fast<ImageTraits>(image, u = bounds.x, v);
-    for (; u < bounds.x2(); ++u, ++ptr) {
-      ASSERT(ptr == get_pixel_address_fast<ImageTraits>(image, u, v));
-      if (!is_same_pixel<ImageTraits>(*ptr, refpixel))
-        return (!bounds.isEmpty());
-    }
-    ++bounds.y;
-    --bounds.h;
+  if constexpr (std::is_same_v<ImageTraits, BitmapTraits>) {
+    buf.resize(bounds.w);
+    for (int x = 0; x < bounds.w; ++x)
+      buf[x] = get_pixel_fast<BitmapTraits>(image, bounds.x + x, y);
+    return buf.data();
+  }
+  else {
+    return get_pixel_address_fast<ImageTraits>(image, bounds.x, y);
   }
-  return (!bounds.isEmpty());
 }
 
+// Returns the bounds of the pixels inside the given "bounds" that are
+// different than the reference pixel (or an empty rectangle if all
+// pixels are equal).
+//
+// All rows are scanned from left to right (to use the CPU cache):
+// first we look for the top and bottom rows with different pixels,
+// and then the rows between them are scanned only outside the
+// current left/right limits.
 template<typename ImageTraits>
-bool shrink_bounds_bottom_templ(const Image* image, gfx::Rect& bounds, color_t refpixel)
+gfx::Rect get_diff_bounds(const Image* image,
+                          const gfx::Rect& bounds,
+                          const RefPixel<ImageTraits> ref)
 {
-  int u, v;
-  // Shrink bottom side
-  for (v = bounds.y2() - 1; v >= bounds.y; --v) {
-    auto ptr = get_pixel_address_fast<ImageTraits>(image, u = bounds.x, v);
-    for (; u < bounds.x2(); ++u, ++ptr) {
-      ASSERT(ptr == get_pixel_address_fast<ImageTraits>(image, u, v));
-      if (!is_same_pixel<ImageTraits>(*ptr, refpixel))
-        return (!bounds.isEmpty());
+  std::vector<uint8_t> buf;
+  const int w = bounds.w;
+  int left = w, right = -1;
+  int top, bottom;
+
+  // Top row
+  for (top = bounds.y; top < bounds.y2(); ++top) {
+    auto row = get_row<ImageTraits>(image, bounds, top, buf);
+    left = find_first_diff<ImageTraits>(row, w, ref);
+    if (left < w) {
+      right = find_last_diff<ImageTraits>(row, w, ref);
+      break;
     }
-    --bounds.h;
   }
-  return (!bounds.isEmpty());
+  if (top == bounds.y2())
+    return gfx::Rect();
+
+  // Bottom row
+  for (bottom = bounds.y2() - 1; bottom > top; --bottom) {
+    auto row = get_row<ImageTraits>(image, bounds, bottom, buf);
+    const int i = find_first_diff<ImageTraits>(row, w, ref);
+    if (i < w) {
+      left = std::min(left, i);
+      right = std::max(right, find_last_diff<ImageTraits>(row, w, ref));
+      break;
+    }
+  }
+
+  // Rows in the middle
+  for (int v = top + 1; v < bottom && (left > 0 || right < w - 1); ++v) {
+    auto row = get_row<ImageTraits>(image, bounds, v, buf);
+    if (left > 0)
+      left = find_first_diff<ImageTraits>(row, left, ref);
+    if (right < w - 1) {
+      const int i = find_last_diff<ImageTraits>(row + right + 1, w - right - 1, ref);
+      if (i >= 0)
+        right += i + 1;
+    }
+  }
+
+  return gfx::Rect(bounds.x + left, top, right - left + 1, bottom - top + 1);
 }
 
+// Minimum number of pixels to scan an image in parallel (for smaller
+// images the scan is faster than waking up other threads)
+const int kMinParallelPixels = 1024 * 1024;
+
 template<typename ImageTraits>
 bool shrink_bounds_templ(const Image* image, gfx::Rect& bounds, color_t refpixel)
 {
-  // Pixels per row
-  const int rowPixels = image->rowPixels();
-  const int canvasSize = image->width() * image->height();
-  if ((std::thread::hardware_concurrency() >= 4) &&
-      ((image->pixelFormat() == IMAGE_RGB && canvasSize >= 800 * 800) ||
-       (image->pixelFormat() != IMAGE_RGB && canvasSize >= 500 * 500))) {
-    gfx::Rect leftBounds(bounds), rightBounds(bounds), topBounds(bounds), bottomBounds(bounds);
-
-    // TODO use a base::thread_pool and a base::task for each border
-
-    std::thread left(
-      [&] { shrink_bounds_left_templ<ImageTraits>(image, leftBounds, refpixel, rowPixels); });
-    std::thread right(
-      [&] { shrink_bounds_right_templ<ImageTraits>(image, rightBounds, refpixel, rowPixels); });
-    std::thread top([&] { shrink_bounds_top_templ<ImageTraits>(image, topBounds, refpixel); });
-    std::thread bottom(
-      [&] { shrink_bounds_bottom_templ<ImageTraits>(image, bottomBounds, refpixel); });
-    left.join();
-    right.join();
-    top.join();
-    bottom.join();
-    bounds = leftBounds;
-    bounds &= rightBounds;
-    bounds &= topBounds;
-    bounds &= bottomBounds;
-    return !bounds.isEmpty();
+  const RefPixel<ImageTraits> ref = make_ref_pixel<ImageTraits>(refpixel);
+  const int nthreads = parallel_for_threads();
+  const int nbands = std::min(nthreads, bounds.h);
+  gfx::Rect result;
+
+  if (nthreads >= 2 && nbands >= 2 && bounds.w * bounds.h >= kMinParallelPixels) {
+    // Calculate the bounds of each band of rows in parallel
+    std::vector<gfx::Rect> bandBounds(nbands);
+    parallel_for(nbands, [image, &bounds, &bandBounds, ref, nbands](const int i) {
+      const int y = bounds.y + bounds.h * i / nbands;
+      const int y2 = bounds.y + bounds.h * (i + 1) / nbands;
+      bandBounds[i] =
+        get_diff_bounds<ImageTraits>(image, gfx::Rect(bounds.x, y, bounds.w, y2 - y), ref);
+    });
+
+    for (const gfx::Rect& rc : bandBounds)
+      result |= rc;
   }
   else {
-    return shrink_bounds_left_templ<ImageTraits>(image, bounds, refpixel, rowPixels) &&
-           shrink_bounds_right_templ<ImageTraits>(image, bounds, refpixel, rowPixels) &&
-           shrink_bounds_top_templ<ImageTraits>(image, bounds, refpixel) &&
-           shrink_bounds_bottom_templ<ImageTraits>(image, bounds, refpixel);
+    result = get_diff_bounds<ImageTraits>(image, bounds, ref);
   }
+
+  if (result.isEmpty()) {
+    // The whole image is equal to the reference pixel
+    bounds.x = bounds.x2();
+    bounds.w = 0;
+    return false;
+  }
+  bounds = result;
+  return true;
 }
 
 template<typename ImageTraits>
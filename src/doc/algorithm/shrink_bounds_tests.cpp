@@ -0,0 +1,119 @@
+// Aseprite Document Library
+// Copyright (c) 2025  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "gtest/gtest.h"
+
+#include "doc/algorithm/shrink_bounds.h"
+
+#include "doc/color.h"
+#include "doc/image.h"
+#include "doc/image_ref.h"
+#include "doc/parallel_for.h"
+#include "doc/primitives.h"
+#include "gfx/rect_io.h"
+
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <vector>
+
+using namespace doc;
+using namespace gfx;
+
+// Bounds of the pixels different than the reference pixel
+// calculated pixel by pixel
+static Rect slow_bounds(const Image* image, const color_t refpixel)
+{
+  Rect bounds;
+  for (int y = 0; y < image->height(); ++y) {
+    for (int x = 0; x < image->width(); ++x) {
+      const color_t c = get_pixel(image, x, y);
+      bool same = (c == refpixel);
+      if (image->pixelFormat() == IMAGE_RGB)
+        same |= (rgba_geta(c) == 0 && rgba_geta(refpixel) == 0);
+      else if (image->pixelFormat() == IMAGE_GRAYSCALE)
+        same |= (graya_geta(c) == 0 && graya_geta(refpixel) == 0);
+      if (!same)
+        bounds |= Rect(x, y, 1, 1);
+    }
+  }
+  return bounds;
+}
+
+TEST(ShrinkBounds, EmptyImage)
+{
+  ImageRef img(Image::create(IMAGE_RGB, 32, 16));
+  clear_image(img.get(), rgba(255, 0, 0, 0));
+
+  Rect bounds;
+  EXPECT_FALSE(doc::algorithm::shrink_bounds(img.get(), 0, nullptr, bounds));
+  EXPECT_TRUE(bounds.isEmpty());
+}
+
+TEST(ShrinkBounds, Pixels)
+{
+  std::srand(1);
+  for (auto pf : { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED, IMAGE_BITMAP }) {
+    for (int h = 1; h < 100; h += 7) {
+      for (int w = 1; w < 150; w += 9) {
+        ImageRef img(Image::create(pf, w, h));
+        clear_image(img.get(), 0);
+
+        const color_t c = (pf == IMAGE_RGB       ? rgba(1, 2, 3, 255) :
+                           pf == IMAGE_GRAYSCALE ? graya(1, 255) :
+                                                   1);
+        for (int i = std::rand() % 4; i > 0; --i)
+          put_pixel(img.get(), std::rand() % w, std::rand() % h, c);
+
+        const Rect expected = slow_bounds(img.get(), 0);
+        Rect bounds;
+        EXPECT_EQ(!expected.isEmpty(),
+                  doc::algorithm::shrink_bounds(img.get(), 0, nullptr, bounds));
+        if (!expected.isEmpty()) {
+          EXPECT_EQ(expected, bounds) << "Pixel format=" << pf << " Size=" << w << "x" << h;
+        }
+      }
+    }
+  }
+}
+
+TEST(ShrinkBounds, BigImage)
+{
+  // Big enough to be scanned in parallel (using 4 threads)
+  doc::set_parallel_for(
+    [](const int n, const std::function<void(int)>& func) {
+      std::vector<std::thread> threads;
+      for (int i = 1; i < n; ++i)
+        threads.emplace_back(func, i);
+      func(0);
+      for (auto& thread : threads)
+        thread.join();
+    },
+    4);
+
+  ImageRef img(Image::create(IMAGE_RGB, 2000, 1500));
+  clear_image(img.get(), rgba(0, 0, 0, 0));
+  put_pixel(img.get(), 300, 1400, rgba(0, 0, 0, 1));
+  put_pixel(img.get(), 1700, 20, rgba(0, 0, 0, 1));
+  put_pixel(img.get(), 1000, 750, rgba(0, 0, 0, 1));
+
+  Rect bounds;
+  EXPECT_TRUE(doc::algorithm::shrink_bounds(img.get(), 0, nullptr, bounds));
+  EXPECT_EQ(Rect(300, 20, 1401, 1381), bounds);
+
+  // With a start bounds
+  EXPECT_TRUE(
+    doc::algorithm::shrink_bounds(img.get(), 0, nullptr, Rect(500, 0, 1500, 1500), bounds));
+  EXPECT_EQ(Rect(1000, 20, 701, 731), bounds);
+
+  doc::set_parallel_for(nullptr, 1);
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,4 +1,5 @@
 // Aseprite Document Library
+// Copyright (c) 2025 Igara Studio S.A.
 // Copyright (c) 2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -9,9 +10,13 @@
 #endif
 
 #include "doc/blend_funcs.h"
+#include "doc/blend_row.h"
 
 #include <benchmark/benchmark.h>
 
+#include <random>
+#include <vector>
+
 using namespace doc;
 
 static void CustomArguments(benchmark::internal::Benchmark* b)
@@ -55,4 +60,45 @@ BENCHMARK_TEMPLATE(BM_Rgba, rgba_blender_hsl_saturation)->Apply(CustomArguments)
 BENCHMARK_TEMPLATE(BM_Rgba, rgba_blender_hsl_color)->Apply(CustomArguments);
 BENCHMARK_TEMPLATE(BM_Rgba, rgba_blender_hsl_luminosity)->Apply(CustomArguments);
 
+template<BlendMode Mode, bool NewBlend>
+void BM_RgbaRow(benchmark::State& state)
+{
+  const auto impl = BlendRowImpl(state.range(0));
+  const int w = state.range(1);
+  BlendRowFunc func = get_rgba_row_blender(Mode, NewBlend, impl);
+  if (!func) {
+    state.SkipWithError("Implementation not supported");
+    return;
+  }
+
+  std::mt19937 rng(w);
+  std::vector<color_t> src(w), dst(w);
+  for (int x = 0; x < w; ++x) {
+    src[x] = rng();
+    dst[x] = rng();
+  }
+
+  while (state.KeepRunning()) {
+    func(dst.data(), src.data(), w, 128, 0);
+    benchmark::DoNotOptimize(dst.data());
+  }
+  state.SetItemsProcessed(state.iterations() * w);
+}
+
+static void RowArguments(benchmark::internal::Benchmark* b)
+{
+  for (auto impl : { BlendRowImpl::Scalar, BlendRowImpl::SSE2, BlendRowImpl::AVX2, BlendRowImpl::NEON })
+    b->Args({ int(impl), 1024 });
+}
+
+BENCHMARK_TEMPLATE(BM_RgbaRow, BlendMode::NORMAL, false)->Apply(RowArguments);
+BENCHMARK_TEMPLATE(BM_RgbaRow, BlendMode::MULTIPLY, false)->Apply(RowArguments);
+BENCHMARK_TEMPLATE(BM_RgbaRow, BlendMode::MULTIPLY, true)->Apply(RowArguments);
+BENCHMARK_TEMPLATE(BM_RgbaRow, BlendMode::SCREEN, false)->Apply(RowArguments);
+BENCHMARK_TEMPLATE(BM_RgbaRow, BlendMode::SCREEN, true)->Apply(RowArguments);
+BENCHMARK_TEMPLATE(BM_RgbaRow, BlendMode::OVERLAY, false)->Apply(RowArguments);
+BENCHMARK_TEMPLATE(BM_RgbaRow, BlendMode::OVERLAY, true)->Apply(RowArguments);
+BENCHMARK_TEMPLATE(BM_RgbaRow, BlendMode::ADDITION, false)->Apply(RowArguments);
+BENCHMARK_TEMPLATE(BM_RgbaRow, BlendMode::ADDITION, true)->Apply(RowArguments);
+
 BENCHMARK_MAIN();
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (C) 2019  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 // Copyright (c) 2001-2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -42,6 +42,26 @@ color_t rgba_blender_addition(color_t backdrop, color_t src, int opacity);
 color_t rgba_blender_subtract(color_t backdrop, color_t src, int opacity);
 color_t rgba_blender_divide(color_t backdrop, color_t src, int opacity);
 
+// New blend method versions
+color_t rgba_blender_multiply_n(color_t backdrop, color_t src, int opacity);
+color_t rgba_blender_screen_n(color_t backdrop, color_t src, int opacity);
+color_t rgba_blender_overlay_n(color_t backdrop, color_t src, int opacity);
+color_t rgba_blender_darken_n(color_t backdrop, color_t src, int opacity);
+color_t rgba_blender_lighten_n(color_t backdrop, color_t src, int opacity);
+color_t rgba_blender_color_dodge_n(color_t backdrop, color_t src, int opacity);
+color_t rgba_blender_color_burn_n(color_t backdrop, color_t src, int opacity);
+color_t rgba_blender_hard_light_n(color_t backdrop, color_t src, int opacity);
+color_t rgba_blender_soft_light_n(color_t backdrop, color_t src, int opacity);
+color_t rgba_blender_difference_n(color_t backdrop, color_t src, int opacity);
+color_t rgba_blender_exclusion_n(color_t backdrop, color_t src, int opacity);
+color_t rgba_blender_hsl_hue_n(color_t backdrop, color_t src, int opacity);
+color_t rgba_blender_hsl_saturation_n(color_t backdrop, color_t src, int opacity);
+color_t rgba_blender_hsl_color_n(color_t backdrop, color_t src, int opacity);
+color_t rgba_blender_hsl_luminosity_n(color_t backdrop, color_t src, int opacity);
+color_t rgba_blender_addition_n(color_t backdrop, color_t src, int opacity);
+color_t rgba_blender_subtract_n(color_t backdrop, color_t src, int opacity);
+color_t rgba_blender_divide_n(color_t backdrop, color_t src, int opacity);
+
 color_t graya_blender_src(color_t backdrop, color_t src, int opacity);
 color_t graya_blender_merge(color_t backdrop, color_t src, int opacity);
 color_t graya_blender_neg_bw(color_t backdrop, color_t src, int opacity);
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2024  Igara Studio S.A.
+// Copyright (c) 2024-2025  Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -11,8 +11,11 @@
 #include "doc/blend_image.h"
 
 #include "doc/blend_internals.h"
+#include "doc/blend_row.h"
 #include "doc/image_impl.h"
 
+#include <type_traits>
+
 namespace doc {
 
 template<typename DstTraits, typename SrcTraits>
@@ -29,6 +32,21 @@ void blend_image_templ(Image* dst,
     if (pal == nullptr)
       return;
   }
+  if constexpr (std::is_same_v<DstTraits, RgbTraits> && std::is_same_v<SrcTraits, RgbTraits>) {
+    if (BlendRowFunc blendRow = get_rgba_row_blender(blendMode, true)) {
+      const gfx::Rect dstBounds = area.dstBounds();
+      const gfx::Rect srcBounds = area.srcBounds();
+      for (int y = 0; y < dstBounds.h; ++y) {
+        blendRow((color_t*)dst->getPixelAddress(dstBounds.x, dstBounds.y + y),
+                 (const color_t*)src->getPixelAddress(srcBounds.x, srcBounds.y + y),
+                 dstBounds.w,
+                 opacity,
+                 src->maskColor());
+      }
+      return;
+    }
+  }
+
   BlenderHelper<DstTraits, SrcTraits> blender(dst, src, pal, blendMode, true);
   LockImageBits<DstTraits> dstBits(dst);
   const LockImageBits<SrcTraits> srcBits(src);
@@ -0,0 +1,231 @@
+// Aseprite Document Library
+// Copyright (c) 2025 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif
+
+#include "doc/blend_row.h"
+
+#include "doc/blend_funcs.h"
+#include "doc/blend_row_kernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define DOC_BLEND_ROW_SSE2 1
+  #include <emmintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+  #define DOC_BLEND_ROW_NEON 1
+  #include <arm_neon.h>
+#endif
+
+#if DOC_HAVE_AVX2 && defined(_MSC_VER)
+  #include <immintrin.h>
+  #include <intrin.h>
+#endif
+
+namespace doc {
+
+#if DOC_HAVE_AVX2
+// Defined in blend_row_avx2.cpp
+BlendRowFunc get_rgba_row_blender_avx2(BlendMode blendMode, bool newBlend);
+#endif
+
+namespace {
+
+template<BlendFunc F>
+void blend_row_scalar(color_t* dst,
+                      const color_t* src,
+                      const int n,
+                      const int opacity,
+                      const color_t maskColor)
+{
+  for (int i = 0; i < n; ++i) {
+    if (src[i] != maskColor)
+      dst[i] = F(dst[i], src[i], opacity);
+  }
+}
+
+BlendRowFunc get_rgba_row_blender_scalar(const BlendMode blendMode, const bool newBlend)
+{
+  // Only blend modes with a vectorized version are available, in
+  // other cases the per-pixel BlendFunc is used directly.
+  switch (blendMode) {
+    case BlendMode::NORMAL: return blend_row_scalar<rgba_blender_normal>;
+    case BlendMode::MULTIPLY:
+      return newBlend ? blend_row_scalar<rgba_blender_multiply_n> :
+                        blend_row_scalar<rgba_blender_multiply>;
+    case BlendMode::SCREEN:
+      return newBlend ? blend_row_scalar<rgba_blender_screen_n> :
+                        blend_row_scalar<rgba_blender_screen>;
+    case BlendMode::OVERLAY:
+      return newBlend ? blend_row_scalar<rgba_blender_overlay_n> :
+                        blend_row_scalar<rgba_blender_overlay>;
+    case BlendMode::ADDITION:
+      return newBlend ? blend_row_scalar<rgba_blender_addition_n> :
+                        blend_row_scalar<rgba_blender_addition>;
+    default: return nullptr;
+  }
+}
+
+#if DOC_BLEND_ROW_SSE2
+
+struct Sse2 {
+  using vec = __m128i;
+  static constexpr int size = 4;
+
+  static vec zero() { return _mm_setzero_si128(); }
+  static vec set1(const int v) { return _mm_set1_epi32(v); }
+  static vec load(const color_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+  static void store(color_t* p, const vec v) { _mm_storeu_si128((__m128i*)p, v); }
+  static vec add(const vec a, const vec b) { return _mm_add_epi32(a, b); }
+  static vec sub(const vec a, const vec b) { return _mm_sub_epi32(a, b); }
+  // There is no 32-bit multiplication in SSE2, but with operands in
+  // the 16-bit range, pmaddwd gives us the full 32-bit product.
+  static vec mul(const vec a, const vec b)
+  {
+    return _mm_madd_epi16(a, _mm_and_si128(b, _mm_set1_epi32(0xffff)));
+  }
+  static vec and_(const vec a, const vec b) { return _mm_and_si128(a, b); }
+  static vec or_(const vec a, const vec b) { return _mm_or_si128(a, b); }
+  static vec srl(const vec a, const int n) { return _mm_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+  static vec sra(const vec a, const int n) { return _mm_sra_epi32(a, _mm_cvtsi32_si128(n)); }
+  static vec sll(const vec a, const int n) { return _mm_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+  static vec cmpeq(const vec a, const vec b) { return _mm_cmpeq_epi32(a, b); }
+  static vec cmplt(const vec a, const vec b) { return _mm_cmplt_epi32(a, b); }
+  static vec select(const vec m, const vec a, const vec b)
+  {
+    return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+  }
+  static vec div_trunc(const vec a, const vec b)
+  {
+    return _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(a), _mm_cvtepi32_ps(b)));
+  }
+};
+
+#endif // DOC_BLEND_ROW_SSE2
+
+#if DOC_BLEND_ROW_NEON
+
+struct Neon {
+  using vec = int32x4_t;
+  static constexpr int size = 4;
+
+  static vec zero() { return vdupq_n_s32(0); }
+  static vec set1(const int v) { return vdupq_n_s32(v); }
+  static vec load(const color_t* p) { return vreinterpretq_s32_u32(vld1q_u32(p)); }
+  static void store(color_t* p, const vec v) { vst1q_u32(p, vreinterpretq_u32_s32(v)); }
+  static vec add(const vec a, const vec b) { return vaddq_s32(a, b); }
+  static vec sub(const vec a, const vec b) { return vsubq_s32(a, b); }
+  static vec mul(const vec a, const vec b) { return vmulq_s32(a, b); }
+  static vec and_(const vec a, const vec b) { return vandq_s32(a, b); }
+  static vec or_(const vec a, const vec b) { return vorrq_s32(a, b); }
+  static vec srl(const vec a, const int n)
+  {
+    return vreinterpretq_s32_u32(vshlq_u32(vreinterpretq_u32_s32(a), vdupq_n_s32(-n)));
+  }
+  static vec sra(const vec a, const int n) { return vshlq_s32(a, vdupq_n_s32(-n)); }
+  static vec sll(const vec a, const int n) { return vshlq_s32(a, vdupq_n_s32(n)); }
+  static vec cmpeq(const vec a, const vec b) { return vreinterpretq_s32_u32(vceqq_s32(a, b)); }
+  static vec cmplt(const vec a, const vec b) { return vreinterpretq_s32_u32(vcltq_s32(a, b)); }
+  static vec select(const vec m, const vec a, const vec b)
+  {
+    return vbslq_s32(vreinterpretq_u32_s32(m), a, b);
+  }
+  static vec div_trunc(const vec a, const vec b)
+  {
+    return vcvtq_s32_f32(vdivq_f32(vcvtq_f32_s32(a), vcvtq_f32_s32(b)));
+  }
+};
+
+#endif // DOC_BLEND_ROW_NEON
+
+#if DOC_HAVE_AVX2
+
+bool cpu_has_avx2()
+{
+  #if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7)
+    return false;
+
+  // AVX must be supported by the CPU and enabled by the OS
+  __cpuid(info, 1);
+  if ((info[2] & (1 << 27)) == 0 || // OSXSAVE
+      (info[2] & (1 << 28)) == 0 || // AVX
+      (_xgetbv(0) & 6) != 6)        // XMM/YMM state
+    return false;
+
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+  #else
+  return __builtin_cpu_supports("avx2");
+  #endif
+}
+
+#endif // DOC_HAVE_AVX2
+
+} // anonymous namespace
+
+bool is_blend_row_impl_supported(const BlendRowImpl impl)
+{
+  switch (impl) {
+    case BlendRowImpl::Scalar: return true;
+#if DOC_BLEND_ROW_SSE2
+    case BlendRowImpl::SSE2: return true;
+#endif
+#if DOC_HAVE_AVX2
+    case BlendRowImpl::AVX2: {
+      static const bool avx2 = cpu_has_avx2();
+      return avx2;
+    }
+#endif
+#if DOC_BLEND_ROW_NEON
+    case BlendRowImpl::NEON: return true;
+#endif
+    default: return false;
+  }
+}
+
+BlendRowImpl best_blend_row_impl()
+{
+  static const BlendRowImpl best = []() {
+    for (BlendRowImpl impl : { BlendRowImpl::AVX2, BlendRowImpl::SSE2, BlendRowImpl::NEON }) {
+      if (is_blend_row_impl_supported(impl))
+        return impl;
+    }
+    return BlendRowImpl::Scalar;
+  }();
+  return best;
+}
+
+BlendRowFunc get_rgba_row_blender(const BlendMode blendMode,
+                                  const bool newBlend,
+                                  const BlendRowImpl impl)
+{
+  if (!is_blend_row_impl_supported(impl))
+    return nullptr;
+
+  switch (impl) {
+    case BlendRowImpl::Scalar: return get_rgba_row_blender_scalar(blendMode, newBlend);
+#if DOC_BLEND_ROW_SSE2
+    case BlendRowImpl::SSE2:
+      return blend_row_kernels::get_row_blender<Sse2>(blendMode, newBlend);
+#endif
+#if DOC_HAVE_AVX2
+    case BlendRowImpl::AVX2: return get_rgba_row_blender_avx2(blendMode, newBlend);
+#endif
+#if DOC_BLEND_ROW_NEON
+    case BlendRowImpl::NEON:
+      return blend_row_kernels::get_row_blender<Neon>(blendMode, newBlend);
+#endif
+    default: return nullptr;
+  }
+}
+
+} // namespace doc
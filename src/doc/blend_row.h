@@ -0,0 +1,52 @@
+// Aseprite Document Library
+// Copyright (c) 2025 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef DOC_BLEND_ROW_H_INCLUDED
+#define DOC_BLEND_ROW_H_INCLUDED
+#pragma once
+
+#include "doc/blend_mode.h"
+#include "doc/color.h"
+
+namespace doc {
+
+// Blends "n" pixels of "src" into "dst" (dst = blend(dst, src,
+// opacity)). Source pixels equal to "maskColor" are skipped, just
+// like BlenderHelper does.
+typedef void (*BlendRowFunc)(color_t* dst,
+                             const color_t* src,
+                             int n,
+                             int opacity,
+                             color_t maskColor);
+
+// Available implementations of the RGBA row blenders. All of them
+// produce exactly the same results as the per-pixel functions of
+// doc/blend_funcs.h (which are the reference implementation).
+enum class BlendRowImpl {
+  Scalar,
+  SSE2,
+  AVX2,
+  NEON,
+};
+
+// Returns true if the given implementation was compiled and can be
+// used in the current CPU.
+bool is_blend_row_impl_supported(BlendRowImpl impl);
+
+// Returns the fastest implementation supported by the current CPU.
+BlendRowImpl best_blend_row_impl();
+
+// Returns a function to blend rows of RGBA pixels with the given
+// blend mode, or nullptr if the blend mode (or the implementation)
+// is not available, in that case the caller should fallback to the
+// per-pixel BlendFunc from get_rgba_blender().
+BlendRowFunc get_rgba_row_blender(BlendMode blendMode,
+                                  bool newBlend,
+                                  BlendRowImpl impl = best_blend_row_impl());
+
+} // namespace doc
+
+#endif
@@ -0,0 +1,57 @@
+// Aseprite Document Library
+// Copyright (c) 2025 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+//
+// This file is compiled with AVX2 instructions enabled (see
+// doc/CMakeLists.txt), its functions are used only if the CPU
+// supports AVX2 (see get_rgba_row_blender()).
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif
+
+#include "doc/blend_row.h"
+
+#include "doc/blend_row_kernels.h"
+
+#include <immintrin.h>
+
+namespace doc {
+
+namespace {
+
+struct Avx2 {
+  using vec = __m256i;
+  static constexpr int size = 8;
+
+  static vec zero() { return _mm256_setzero_si256(); }
+  static vec set1(const int v) { return _mm256_set1_epi32(v); }
+  static vec load(const color_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+  static void store(color_t* p, const vec v) { _mm256_storeu_si256((__m256i*)p, v); }
+  static vec add(const vec a, const vec b) { return _mm256_add_epi32(a, b); }
+  static vec sub(const vec a, const vec b) { return _mm256_sub_epi32(a, b); }
+  static vec mul(const vec a, const vec b) { return _mm256_mullo_epi32(a, b); }
+  static vec and_(const vec a, const vec b) { return _mm256_and_si256(a, b); }
+  static vec or_(const vec a, const vec b) { return _mm256_or_si256(a, b); }
+  static vec srl(const vec a, const int n) { return _mm256_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+  static vec sra(const vec a, const int n) { return _mm256_sra_epi32(a, _mm_cvtsi32_si128(n)); }
+  static vec sll(const vec a, const int n) { return _mm256_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+  static vec cmpeq(const vec a, const vec b) { return _mm256_cmpeq_epi32(a, b); }
+  static vec cmplt(const vec a, const vec b) { return _mm256_cmpgt_epi32(b, a); }
+  static vec select(const vec m, const vec a, const vec b) { return _mm256_blendv_epi8(b, a, m); }
+  static vec div_trunc(const vec a, const vec b)
+  {
+    return _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(a), _mm256_cvtepi32_ps(b)));
+  }
+};
+
+} // anonymous namespace
+
+BlendRowFunc get_rgba_row_blender_avx2(const BlendMode blendMode, const bool newBlend)
+{
+  return blend_row_kernels::get_row_blender<Avx2>(blendMode, newBlend);
+}
+
+} // namespace doc
@@ -0,0 +1,257 @@
+// Aseprite Document Library
+// Copyright (c) 2025 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef DOC_BLEND_ROW_KERNELS_H_INCLUDED
+#define DOC_BLEND_ROW_KERNELS_H_INCLUDED
+#pragma once
+
+// Generic implementation of the RGBA row blenders. The algorithms are
+// written once in terms of a "V" type that wraps the intrinsics of
+// one instruction set (see blend_row.cpp and blend_row_avx2.cpp), and
+// they replicate step by step the integer math of blend_funcs.cpp so
+// we get exactly the same results.
+//
+// Each V type must be defined in an anonymous namespace: this header
+// is included from files compiled with different CPU flags and we
+// don't want the linker to merge instantiations between them.
+//
+// All values are handled in 32-bit lanes (one pixel per lane), and
+// V::mul() is only used with operands in the [-32768, 32767] range.
+
+#include "doc/blend_row.h"
+
+#include <cstdint>
+
+namespace doc {
+namespace blend_row_kernels {
+
+template<class V>
+struct Ops {
+  using vec = typename V::vec;
+
+  static vec channel(const vec c, const int shift)
+  {
+    return V::and_(V::srl(c, shift), V::set1(0xff));
+  }
+
+  static vec alpha(const vec c) { return V::srl(c, 24); }
+
+  static vec pack(const vec r, const vec g, const vec b, const vec a)
+  {
+    return V::or_(V::or_(r, V::sll(g, 8)), V::or_(V::sll(b, 16), V::sll(a, 24)));
+  }
+
+  // Same as MUL_UN8() from pixman (with signed "a" values too)
+  static vec mul_un8(const vec a, const vec b)
+  {
+    const vec t = V::add(V::mul(a, b), V::set1(0x80));
+    return V::sra(V::add(V::sra(t, 8), t), 8);
+  }
+
+  // rgba_blender_normal()
+  static vec normal(const vec B, const vec S, const vec opacity)
+  {
+    const vec zero = V::zero();
+    const vec Ba = alpha(B);
+    const vec Sa0 = alpha(S);
+    const vec Sa = mul_un8(Sa0, opacity);
+    const vec Ra = V::sub(V::add(Sa, Ba), mul_un8(Ba, Sa));
+
+    // Ra is zero only in lanes where Ba is zero too (which are
+    // discarded at the end), we use 1 to avoid dividing by zero.
+    const vec den = V::add(Ra, V::and_(V::cmpeq(Ra, zero), V::set1(1)));
+
+    // Rc = Bc + (Sc-Bc)*Sa/Ra, the float division is exact enough to
+    // truncate to the same integer as the scalar version.
+    vec Rc[3];
+    for (int i = 0; i < 3; ++i) {
+      const vec Bc = channel(B, 8 * i);
+      const vec Sc = channel(S, 8 * i);
+      Rc[i] = V::add(Bc, V::div_trunc(V::mul(V::sub(Sc, Bc), Sa), den));
+    }
+
+    vec R = pack(Rc[0], Rc[1], Rc[2], Ra);
+    R = V::select(V::cmpeq(Sa0, zero), B, R);
+
+    // Transparent backdrop
+    const vec T = V::or_(V::and_(S, V::set1(0x00ffffff)), V::sll(Sa, 24));
+    return V::select(V::cmpeq(Ba, zero), T, R);
+  }
+
+  // rgba_blender_merge() with a different opacity for each pixel
+  static vec merge(const vec B, const vec S, const vec opacity)
+  {
+    const vec zero = V::zero();
+    const vec Ba = alpha(B);
+    const vec Sa = alpha(S);
+    const vec Ra = V::add(Ba, mul_un8(V::sub(Sa, Ba), opacity));
+    const vec BaZero = V::cmpeq(Ba, zero);
+    const vec SaZero = V::cmpeq(Sa, zero);
+    const vec RaZero = V::cmpeq(Ra, zero);
+
+    vec Rc[3];
+    for (int i = 0; i < 3; ++i) {
+      const vec Bc = channel(B, 8 * i);
+      const vec Sc = channel(S, 8 * i);
+      vec c = V::add(Bc, mul_un8(V::sub(Sc, Bc), opacity));
+      c = V::select(SaZero, Bc, c);
+      c = V::select(BaZero, Sc, c);
+      Rc[i] = V::select(RaZero, zero, c);
+    }
+    return pack(Rc[0], Rc[1], Rc[2], Ra);
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+// Blend modes
+
+template<class V>
+struct Normal {
+  using vec = typename V::vec;
+
+  static vec apply(const vec B, const vec S, const vec opacity)
+  {
+    return Ops<V>::normal(B, S, opacity);
+  }
+};
+
+template<class V>
+struct Multiply {
+  using vec = typename V::vec;
+
+  static vec blend(const vec b, const vec s) { return Ops<V>::mul_un8(b, s); }
+};
+
+template<class V>
+struct Screen {
+  using vec = typename V::vec;
+
+  static vec blend(const vec b, const vec s)
+  {
+    return V::sub(V::add(b, s), Ops<V>::mul_un8(b, s));
+  }
+};
+
+template<class V>
+struct Overlay {
+  using vec = typename V::vec;
+
+  // blend_hard_light(s, b)
+  static vec blend(const vec b, const vec s)
+  {
+    const vec b2 = V::sll(b, 1);
+    const vec multiply = Ops<V>::mul_un8(s, b2);
+    const vec b2m = V::sub(b2, V::set1(255));
+    const vec screen = V::sub(V::add(s, b2m), Ops<V>::mul_un8(s, b2m));
+    return V::select(V::cmplt(b, V::set1(128)), multiply, screen);
+  }
+};
+
+template<class V>
+struct Addition {
+  using vec = typename V::vec;
+
+  static vec blend(const vec b, const vec s)
+  {
+    const vec v = V::add(b, s);
+    const vec max = V::set1(255);
+    return V::select(V::cmplt(v, max), v, max);
+  }
+};
+
+// Separable blend modes (rgba_blender_multiply(), etc.), and their
+// "new blend" versions (RGBA_BLENDER_N() macro).
+template<class V, template<class> class Mode, bool NewBlend>
+struct Separable {
+  using vec = typename V::vec;
+  using O = Ops<V>;
+
+  static vec apply(const vec B, const vec S, const vec opacity)
+  {
+    const vec Sblend = O::pack(Mode<V>::blend(O::channel(B, 0), O::channel(S, 0)),
+                               Mode<V>::blend(O::channel(B, 8), O::channel(S, 8)),
+                               Mode<V>::blend(O::channel(B, 16), O::channel(S, 16)),
+                               O::alpha(S));
+    const vec blend = O::normal(B, Sblend, opacity);
+    if constexpr (!NewBlend)
+      return blend;
+
+    const vec normal = O::normal(B, S, opacity);
+    const vec Ba = O::alpha(B);
+    const vec normalToBlendMerge = O::merge(normal, blend, Ba);
+    const vec srcTotalAlpha = O::mul_un8(O::alpha(S), opacity);
+    const vec compositeAlpha = O::mul_un8(Ba, srcTotalAlpha);
+    const vec R = O::merge(normalToBlendMerge, blend, compositeAlpha);
+    return V::select(V::cmpeq(Ba, V::zero()), normal, R);
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+// Row loop
+
+template<class V, class Blender>
+void blend_row(color_t* dst,
+               const color_t* src,
+               const int n,
+               const int opacity,
+               const color_t maskColor)
+{
+  using vec = typename V::vec;
+  const vec op = V::set1(opacity);
+  const vec mask = V::set1(int(maskColor));
+
+  int i = 0;
+  for (; i + V::size <= n; i += V::size) {
+    const vec B = V::load(dst + i);
+    const vec S = V::load(src + i);
+    V::store(dst + i, V::select(V::cmpeq(S, mask), B, Blender::apply(B, S, op)));
+  }
+
+  // Remaining pixels are blended in a temporary vector
+  if (i < n) {
+    color_t b[V::size] = {};
+    color_t s[V::size];
+    for (int j = 0; j < V::size; ++j)
+      s[j] = maskColor;
+    for (int j = 0; i + j < n; ++j) {
+      b[j] = dst[i + j];
+      s[j] = src[i + j];
+    }
+
+    const vec B = V::load(b);
+    const vec S = V::load(s);
+    V::store(b, V::select(V::cmpeq(S, mask), B, Blender::apply(B, S, op)));
+
+    for (int j = 0; i + j < n; ++j)
+      dst[i + j] = b[j];
+  }
+}
+
+template<class V>
+BlendRowFunc get_row_blender(const BlendMode blendMode, const bool newBlend)
+{
+  switch (blendMode) {
+    case BlendMode::NORMAL: return blend_row<V, Normal<V>>;
+    case BlendMode::MULTIPLY:
+      return newBlend ? blend_row<V, Separable<V, Multiply, true>> :
+                        blend_row<V, Separable<V, Multiply, false>>;
+    case BlendMode::SCREEN:
+      return newBlend ? blend_row<V, Separable<V, Screen, true>> :
+                        blend_row<V, Separable<V, Screen, false>>;
+    case BlendMode::OVERLAY:
+      return newBlend ? blend_row<V, Separable<V, Overlay, true>> :
+                        blend_row<V, Separable<V, Overlay, false>>;
+    case BlendMode::ADDITION:
+      return newBlend ? blend_row<V, Separable<V, Addition, true>> :
+                        blend_row<V, Separable<V, Addition, false>>;
+    default: return nullptr;
+  }
+}
+
+} // namespace blend_row_kernels
+} // namespace doc
+
+#endif
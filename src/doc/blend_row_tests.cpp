@@ -0,0 +1,111 @@
+// Aseprite Document Library
+// Copyright (c) 2025 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/blend_funcs.h"
+#include "doc/blend_row.h"
+
+#include <random>
+#include <vector>
+
+using namespace doc;
+
+namespace {
+
+const BlendMode kModes[] = { BlendMode::NORMAL,
+                             BlendMode::MULTIPLY,
+                             BlendMode::SCREEN,
+                             BlendMode::OVERLAY,
+                             BlendMode::ADDITION };
+
+// Generates channel values with more chances to get the edge cases
+// of the blend functions (0, 128, 255, etc.)
+int random_channel(std::mt19937& rng)
+{
+  static const int kSpecial[] = { 0, 1, 127, 128, 254, 255 };
+  if (rng() % 3 == 0)
+    return kSpecial[rng() % 6];
+  return rng() % 256;
+}
+
+color_t random_color(std::mt19937& rng)
+{
+  const int r = random_channel(rng);
+  const int g = random_channel(rng);
+  const int b = random_channel(rng);
+  const int a = random_channel(rng);
+  return rgba(r, g, b, a);
+}
+
+} // anonymous namespace
+
+TEST(BlendRow, ScalarMatchesBlendFuncs)
+{
+  std::mt19937 rng(1);
+  for (const BlendMode mode : kModes) {
+    for (const bool newBlend : { false, true }) {
+      BlendRowFunc blendRow = get_rgba_row_blender(mode, newBlend, BlendRowImpl::Scalar);
+      BlendFunc blendFunc = get_rgba_blender(mode, newBlend);
+      ASSERT_TRUE(blendRow != nullptr);
+
+      for (int i = 0; i < 1000; ++i) {
+        const color_t backdrop = random_color(rng);
+        const color_t src = random_color(rng);
+        const int opacity = random_channel(rng);
+        color_t dst = backdrop;
+        blendRow(&dst, &src, 1, opacity, 0);
+        EXPECT_EQ(src == 0 ? backdrop : blendFunc(backdrop, src, opacity), dst);
+      }
+    }
+  }
+}
+
+TEST(BlendRow, VectorizedVersionsAreBitExact)
+{
+  std::mt19937 rng(2);
+  for (const BlendRowImpl impl : { BlendRowImpl::SSE2, BlendRowImpl::AVX2, BlendRowImpl::NEON }) {
+    if (!is_blend_row_impl_supported(impl))
+      continue;
+
+    for (const BlendMode mode : kModes) {
+      for (const bool newBlend : { false, true }) {
+        BlendRowFunc ref = get_rgba_row_blender(mode, newBlend, BlendRowImpl::Scalar);
+        BlendRowFunc func = get_rgba_row_blender(mode, newBlend, impl);
+        ASSERT_TRUE(func != nullptr);
+
+        for (int i = 0; i < 1000; ++i) {
+          // Different widths to test the tail of the rows too
+          const int w = rng() % 37;
+          std::vector<color_t> src(w), expected(w);
+          for (int x = 0; x < w; ++x) {
+            src[x] = (rng() % 8 == 0 ? 0 : random_color(rng));
+            expected[x] = random_color(rng);
+          }
+          std::vector<color_t> dst = expected;
+          const int opacity = random_channel(rng);
+          const color_t maskColor = (w > 0 && rng() % 2 ? src[0] : 0);
+
+          ref(expected.data(), src.data(), w, opacity, maskColor);
+          func(dst.data(), src.data(), w, opacity, maskColor);
+          ASSERT_EQ(expected, dst) << "impl=" << int(impl) << " mode=" << int(mode)
+                                   << " newBlend=" << newBlend << " opacity=" << opacity;
+        }
+      }
+    }
+  }
+}
+
+TEST(BlendRow, UnsupportedModes)
+{
+  EXPECT_EQ(nullptr, get_rgba_row_blender(BlendMode::HSL_HUE, false));
+  EXPECT_EQ(nullptr, get_rgba_row_blender(BlendMode::DST_OVER, true));
+  EXPECT_EQ(nullptr, get_rgba_row_blender(BlendMode::SRC, true, BlendRowImpl::Scalar));
+}
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2018-2020 Igara Studio S.A.
+// Copyright (c) 2018-2025 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -30,7 +30,31 @@ Image::~Image()
 
 int Image::getMemSize() const
 {
-  return sizeof(Image) + rowBytes() * height();
+  return sizeof(Image) + rowBytes() * height() + m_compressedData.size();
+}
+
+void Image::discardCompressedData()
+{
+  m_compressedData.clear();
+  m_compressedDataVersion = 0;
+}
+
+void Image::setCompressedData(const base::buffer& buffer) const
+{
+  if (!buffer.empty()) {
+    m_compressedData = buffer;
+    m_compressedDataVersion = version();
+  }
+}
+
+uint32_t Image::contentHash() const
+{
+  if (!m_hasContentHash || m_contentHashVersion != version()) {
+    m_contentHash = calculate_image_hash(this, bounds());
+    m_contentHashVersion = version();
+    m_hasContentHash = true;
+  }
+  return m_contentHash;
 }
 
 // static
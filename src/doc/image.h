@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2018-2023 Igara Studio S.A.
+// Copyright (c) 2018-2025 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -9,6 +9,7 @@
 #define DOC_IMAGE_H_INCLUDED
 #pragma once
 
+#include "base/buffer.h"
 #include "doc/color.h"
 #include "doc/color_mode.h"
 #include "doc/image_buffer.h"
@@ -73,9 +74,34 @@ public:
 
   virtual int getMemSize() const override;
 
+  // Cached compressed pixels read/written directly from/to an
+  // .aseprite file. It's used to save the image as-is (without
+  // re-compressing it) while the image version doesn't change. It's
+  // discarded when pixels are modified with putPixel()/clear()/
+  // copy()/drawHLine()/fillRect()/blendRect() or with write locks,
+  // code that modifies the pixels through getPixelAddress() must
+  // call incrementVersion() (the same rule used by contentHash()).
+  void discardCompressedData();
+  void setCompressedData(const base::buffer& buffer) const;
+  const base::buffer& compressedData() const { return m_compressedData; }
+  ObjectVersion compressedDataVersion() const { return m_compressedDataVersion; }
+  bool hasValidCompressedData() const
+  {
+    return !m_compressedData.empty() && m_compressedDataVersion == version();
+  }
+
+  // Hash of all the image pixels (calculate_image_hash() with the
+  // image bounds). It's cached and re-calculated only when the image
+  // version changes, so if you modify the pixels directly (not
+  // through a cmd::), you have to call incrementVersion() before
+  // using the image as a key in ImagesMap/TilesetHashTable.
+  uint32_t contentHash() const;
+
   template<typename ImageTraits>
   ImageBits<ImageTraits> lockBits(LockType lockType, const gfx::Rect& bounds)
   {
+    if (lockType != ReadLock)
+      pixelsChanged();
     return ImageBits<ImageTraits>(this, bounds);
   }
 
@@ -106,11 +132,25 @@ public:
 protected:
   Image(const ImageSpec& spec);
 
+  // Called before modifying pixels. Only images with cached
+  // compressed data are modified here, so temporary images can be
+  // drawn from several threads (e.g. rendering bands) without races.
+  void pixelsChanged()
+  {
+    if (!m_compressedData.empty())
+      discardCompressedData();
+  }
+
   // Number of bytes for each row.
   size_t m_rowBytes;
 
 private:
   ImageSpec m_spec;
+  mutable base::buffer m_compressedData;
+  mutable ObjectVersion m_compressedDataVersion = 0;
+  mutable uint32_t m_contentHash = 0;
+  mutable ObjectVersion m_contentHashVersion = 0;
+  mutable bool m_hasContentHash = false;
 };
 
 } // namespace doc
@@ -0,0 +1,259 @@
+// Aseprite Document Library
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif
+
+#include "doc/image_buffer.h"
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace doc {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Smaller buffers are allocated/freed directly (the system allocator
+// is fast enough for them).
+const std::size_t kMinCachedSize = 64 * 1024;
+
+// Default maximum size of the cache.
+const std::size_t kDefaultMaxCacheSize = 256 * 1024 * 1024;
+
+// Cached buffers are released after this time without being used.
+const auto kMaxUnusedTime = std::chrono::seconds(10);
+
+bool g_cacheDestroyed = false;
+
+class BufferCache {
+public:
+  ~BufferCache()
+  {
+    trim(0);
+    g_cacheDestroyed = true;
+  }
+
+  // Returns a cached buffer of "size" bytes. If "exactSize" is false
+  // the buffer can be up to 12.5% bigger, in that case "size" is
+  // modified with the real buffer size.
+  uint8_t* take(std::size_t& size, const bool exactSize)
+  {
+    std::vector<uint8_t*> oldBuffers;
+    uint8_t* ptr = nullptr;
+    {
+      const std::lock_guard lock(m_mutex);
+      removeUnusedBuffers(oldBuffers);
+
+      const std::size_t maxSize = (exactSize ? size : size + size / 8);
+      auto it = m_buffers.lower_bound(size);
+      if (it != m_buffers.end() && it->first <= maxSize) {
+        size = it->first;
+        ptr = it->second.ptr;
+        m_size -= it->first;
+        m_buffers.erase(it);
+      }
+    }
+    free_buffers(oldBuffers);
+    return ptr;
+  }
+
+  // Returns false if the buffer cannot be cached (and it must be
+  // released).
+  bool put(uint8_t* ptr, const std::size_t size)
+  {
+    std::vector<uint8_t*> oldBuffers;
+    {
+      const std::lock_guard lock(m_mutex);
+      if (size > m_maxSize)
+        return false;
+
+      m_buffers.insert(std::make_pair(size, Entry{ ptr, Clock::now() }));
+      m_size += size;
+
+      removeUnusedBuffers(oldBuffers);
+      removeOldestBuffers(m_maxSize, oldBuffers);
+    }
+    free_buffers(oldBuffers);
+    return true;
+  }
+
+  void trimUnused()
+  {
+    std::vector<uint8_t*> oldBuffers;
+    {
+      const std::lock_guard lock(m_mutex);
+      removeUnusedBuffers(oldBuffers);
+    }
+    free_buffers(oldBuffers);
+  }
+
+  void trim(const std::size_t maxSize)
+  {
+    std::vector<uint8_t*> oldBuffers;
+    {
+      const std::lock_guard lock(m_mutex);
+      removeOldestBuffers(maxSize, oldBuffers);
+    }
+    free_buffers(oldBuffers);
+  }
+
+  std::size_t size() const
+  {
+    const std::lock_guard lock(m_mutex);
+    return m_size;
+  }
+
+  void setMaxSize(const std::size_t maxSize)
+  {
+    {
+      const std::lock_guard lock(m_mutex);
+      m_maxSize = maxSize;
+    }
+    trim(maxSize);
+  }
+
+private:
+  struct Entry {
+    uint8_t* ptr;
+    Clock::time_point lastUse;
+  };
+
+  static void free_buffers(const std::vector<uint8_t*>& buffers)
+  {
+    for (uint8_t* ptr : buffers)
+      doc_aligned_free(ptr);
+  }
+
+  void removeUnusedBuffers(std::vector<uint8_t*>& oldBuffers)
+  {
+    const auto now = Clock::now();
+    for (auto it = m_buffers.begin(); it != m_buffers.end();) {
+      if (now - it->second.lastUse > kMaxUnusedTime) {
+        oldBuffers.push_back(it->second.ptr);
+        m_size -= it->first;
+        it = m_buffers.erase(it);
+      }
+      else
+        ++it;
+    }
+  }
+
+  void removeOldestBuffers(const std::size_t maxSize, std::vector<uint8_t*>& oldBuffers)
+  {
+    while (m_size > maxSize) {
+      auto oldest = m_buffers.begin();
+      for (auto it = m_buffers.begin(); it != m_buffers.end(); ++it) {
+        if (it->second.lastUse < oldest->second.lastUse)
+          oldest = it;
+      }
+      oldBuffers.push_back(oldest->second.ptr);
+      m_size -= oldest->first;
+      m_buffers.erase(oldest);
+    }
+  }
+
+  mutable std::mutex m_mutex;
+  // Free buffers by size
+  std::multimap<std::size_t, Entry> m_buffers;
+  std::size_t m_size = 0;
+  std::size_t m_maxSize = kDefaultMaxCacheSize;
+};
+
+BufferCache& buffer_cache()
+{
+  static BufferCache cache;
+  return cache;
+}
+
+uint8_t* alloc_buffer(std::size_t& size, const bool exactSize)
+{
+  if (size >= kMinCachedSize && !g_cacheDestroyed) {
+    if (uint8_t* ptr = buffer_cache().take(size, exactSize))
+      return ptr;
+  }
+
+  auto ptr = (uint8_t*)doc_aligned_alloc(size);
+  if (!ptr && !g_cacheDestroyed) {
+    // Release the cached memory and try again
+    buffer_cache().trim(0);
+    ptr = (uint8_t*)doc_aligned_alloc(size);
+  }
+  if (!ptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void free_buffer(uint8_t* ptr, const std::size_t size)
+{
+  if (size < kMinCachedSize || g_cacheDestroyed || !buffer_cache().put(ptr, size))
+    doc_aligned_free(ptr);
+}
+
+} // anonymous namespace
+
+// New buffers use the exact size because they can be used by
+// long-lived images (e.g. cels).
+ImageBuffer::ImageBuffer(std::size_t size)
+  : m_size(doc_align_size(size))
+  , m_buffer(alloc_buffer(m_size, true))
+{
+}
+
+ImageBuffer::~ImageBuffer() noexcept
+{
+  if (m_buffer)
+    free_buffer(m_buffer, m_size);
+}
+
+void ImageBuffer::resizeIfNecessary(std::size_t size)
+{
+  if (size > m_size) {
+    if (m_buffer) {
+      free_buffer(m_buffer, m_size);
+      m_buffer = nullptr;
+    }
+
+    // A buffer that is resized is used for temporary images, so it
+    // can reuse a bigger cached buffer.
+    m_size = doc_align_size(size);
+    m_buffer = alloc_buffer(m_size, false);
+  }
+}
+
+// static
+void ImageBuffer::trimCache(const std::size_t maxSize)
+{
+  if (!g_cacheDestroyed)
+    buffer_cache().trim(maxSize);
+}
+
+// static
+void ImageBuffer::trimUnusedCache()
+{
+  if (!g_cacheDestroyed)
+    buffer_cache().trimUnused();
+}
+
+// static
+std::size_t ImageBuffer::cacheSize()
+{
+  return (g_cacheDestroyed ? 0 : buffer_cache().size());
+}
+
+// static
+void ImageBuffer::setMaxCacheSize(const std::size_t maxSize)
+{
+  if (!g_cacheDestroyed)
+    buffer_cache().setMaxSize(maxSize);
+}
+
+} // namespace doc
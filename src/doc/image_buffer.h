@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (C) 2019-2024  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -20,39 +20,41 @@
 
 namespace doc {
 
+// Memory used to store the pixels of an image.
+//
+// Big buffers (like the ones used for temporary images to render
+// the canvas or to preview filters) are not returned to the system
+// when an ImageBuffer is destroyed, they are kept in a cache to be
+// reused by the next ImageBuffer of the same size (or a similar
+// size when the buffer is resized with resizeIfNecessary()). Cached
+// buffers are released after some seconds without being used (see
+// trimUnusedCache()), when the cache exceeds its maximum size, or
+// when we run out of memory.
 class ImageBuffer {
 public:
-  ImageBuffer(std::size_t size = 1)
-    : m_size(doc_align_size(size))
-    , m_buffer((uint8_t*)doc_aligned_alloc(m_size))
-  {
-    if (!m_buffer)
-      throw std::bad_alloc();
-  }
-
-  ~ImageBuffer() noexcept
-  {
-    if (m_buffer)
-      doc_aligned_free(m_buffer);
-  }
+  ImageBuffer(std::size_t size = 1);
+  ~ImageBuffer() noexcept;
 
   std::size_t size() const { return m_size; }
   uint8_t* buffer() { return (uint8_t*)m_buffer; }
 
-  void resizeIfNecessary(std::size_t size)
-  {
-    if (size > m_size) {
-      if (m_buffer) {
-        doc_aligned_free(m_buffer);
-        m_buffer = nullptr;
-      }
-
-      m_size = doc_align_size(size);
-      m_buffer = (uint8_t*)doc_aligned_alloc(m_size);
-      if (!m_buffer)
-        throw std::bad_alloc();
-    }
-  }
+  void resizeIfNecessary(std::size_t size);
+
+  // Releases cached buffers until the cache uses "maxSize" bytes or
+  // less (all cached buffers are released by default).
+  static void trimCache(std::size_t maxSize = 0);
+
+  // Releases cached buffers that were not used in the last seconds.
+  // The cache checks this only when buffers are allocated/released,
+  // so it must be called periodically (e.g. from a timer) to release
+  // memory when the app is idle.
+  static void trimUnusedCache();
+
+  // Number of bytes used by cached buffers
+  static std::size_t cacheSize();
+
+  // Maximum number of bytes to keep in the cache
+  static void setMaxCacheSize(std::size_t maxSize);
 
 private:
   size_t m_size;
@@ -0,0 +1,114 @@
+// Aseprite Document Library
+// Copyright (c) 2025 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/image_buffer.h"
+
+using namespace doc;
+
+TEST(ImageBuffer, ReuseBigBuffers)
+{
+  ImageBuffer::trimCache();
+  EXPECT_EQ(0u, ImageBuffer::cacheSize());
+
+  uint8_t* ptr;
+  std::size_t size;
+  {
+    ImageBuffer buf(1024 * 1024);
+    ptr = buf.buffer();
+    size = buf.size();
+  }
+  EXPECT_EQ(size, ImageBuffer::cacheSize());
+
+  // A buffer of the same size reuses the cached buffer
+  {
+    ImageBuffer buf(1024 * 1024);
+    EXPECT_EQ(ptr, buf.buffer());
+    EXPECT_EQ(size, buf.size());
+    EXPECT_EQ(0u, ImageBuffer::cacheSize());
+  }
+
+  // A new buffer of a similar size doesn't reuse it (it could be
+  // used by a long-lived image)
+  {
+    ImageBuffer buf(1000 * 1024);
+    EXPECT_NE(ptr, buf.buffer());
+    EXPECT_EQ(size, ImageBuffer::cacheSize());
+  }
+
+  // A resized buffer of a similar size reuses the cached buffer
+  ImageBuffer::trimCache();
+  {
+    ImageBuffer buf(1024 * 1024);
+    ptr = buf.buffer();
+  }
+  {
+    ImageBuffer buf(1);
+    buf.resizeIfNecessary(1000 * 1024);
+    EXPECT_EQ(ptr, buf.buffer());
+    EXPECT_EQ(size, buf.size());
+    EXPECT_EQ(0u, ImageBuffer::cacheSize());
+  }
+
+  // A buffer that is too small doesn't reuse it
+  {
+    ImageBuffer buf(1);
+    buf.resizeIfNecessary(512 * 1024);
+    EXPECT_EQ(size, ImageBuffer::cacheSize());
+  }
+  EXPECT_LT(size, ImageBuffer::cacheSize());
+
+  // Recently used buffers are not released
+  ImageBuffer::trimUnusedCache();
+  EXPECT_LT(size, ImageBuffer::cacheSize());
+
+  ImageBuffer::trimCache();
+  EXPECT_EQ(0u, ImageBuffer::cacheSize());
+}
+
+TEST(ImageBuffer, SmallBuffersAreNotCached)
+{
+  ImageBuffer::trimCache();
+  {
+    ImageBuffer buf(1024);
+  }
+  EXPECT_EQ(0u, ImageBuffer::cacheSize());
+}
+
+TEST(ImageBuffer, MaxCacheSize)
+{
+  ImageBuffer::trimCache();
+  ImageBuffer::setMaxCacheSize(3 * 1024 * 1024);
+  {
+    ImageBuffer a(1024 * 1024);
+    ImageBuffer b(1024 * 1024);
+    ImageBuffer c(1024 * 1024);
+    ImageBuffer d(1024 * 1024);
+  }
+  EXPECT_LE(ImageBuffer::cacheSize(), std::size_t(3 * 1024 * 1024));
+  EXPECT_GE(ImageBuffer::cacheSize(), std::size_t(2 * 1024 * 1024));
+
+  ImageBuffer::trimCache(1024 * 1024);
+  EXPECT_LE(ImageBuffer::cacheSize(), std::size_t(1024 * 1024));
+
+  ImageBuffer::setMaxCacheSize(0);
+  EXPECT_EQ(0u, ImageBuffer::cacheSize());
+  {
+    ImageBuffer buf(1024 * 1024);
+  }
+  EXPECT_EQ(0u, ImageBuffer::cacheSize());
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
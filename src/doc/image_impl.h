@@ -107,11 +107,13 @@ public:
     ASSERT(x >= 0 && x < width());
     ASSERT(y >= 0 && y < height());
 
+    pixelsChanged();
     *address(x, y) = color;
   }
 
   void clear(color_t color) override
   {
+    pixelsChanged();
     const int w = width();
     const int h = height();
     for (int y = 0; y < h; ++y) {
@@ -129,6 +131,7 @@ public:
     if (!area.clip(width(), height(), src->width(), src->height()))
       return;
 
+    pixelsChanged();
     for (int end_y = area.dst.y + area.size.h; area.dst.y < end_y; ++area.dst.y, ++area.src.y) {
       src_address = src->address(area.src.x, area.src.y);
       dst_address = address(area.dst.x, area.dst.y);
@@ -139,6 +142,7 @@ public:
 
   void drawHLine(int x1, int y, int x2, color_t color) override
   {
+    pixelsChanged();
     LockImageBits<Traits> bits(this, gfx::Rect(x1, y, x2 - x1 + 1, 1));
     typename LockImageBits<Traits>::iterator it(bits.begin());
     typename LockImageBits<Traits>::iterator end(bits.end());
@@ -227,6 +231,7 @@ private:
 template<>
 inline void ImageImpl<IndexedTraits>::clear(color_t color)
 {
+  pixelsChanged();
   uint8_t* p = address(0, 0);
   std::fill(p, p + rowBytes() * height(), color);
 }
@@ -234,6 +239,7 @@ inline void ImageImpl<IndexedTraits>::clear(color_t color)
 template<>
 inline void ImageImpl<BitmapTraits>::clear(color_t color)
 {
+  pixelsChanged();
   uint8_t* p = address(0, 0);
   std::fill(p, p + rowBytes() * height(), (color ? 0xff : 0x00));
 }
@@ -254,6 +260,7 @@ inline void ImageImpl<BitmapTraits>::putPixel(int x, int y, color_t color)
   ASSERT(x >= 0 && x < width());
   ASSERT(y >= 0 && y < height());
 
+  pixelsChanged();
   std::div_t d = std::div(x, 8);
   if (color)
     (*(getLineAddress(y) + d.quot)) |= (1 << d.rem);
@@ -279,6 +286,7 @@ inline void ImageImpl<RgbTraits>::blendRect(int x1,
   address_t addr;
   int x, y;
 
+  pixelsChanged();
   for (y = y1; y <= y2; ++y) {
     addr = (address_t)getPixelAddress(x1, y);
     for (x = x1; x <= x2; ++x) {
@@ -292,6 +300,7 @@ void copy_bitmaps(Image* dst, const Image* src, gfx::Clip area);
 template<>
 inline void ImageImpl<BitmapTraits>::copy(const Image* src, gfx::Clip area)
 {
+  pixelsChanged();
   copy_bitmaps(this, src, area);
 }
 
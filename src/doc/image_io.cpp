@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2019-2024  Igara Studio S.A.
+// Copyright (c) 2019-2025  Igara Studio S.A.
 // Copyright (c) 2001-2018  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -20,88 +20,351 @@
 #include <algorithm>
 #include <iostream>
 #include <memory>
+#include <vector>
 
 namespace doc {
 
 using namespace base::serialization;
 using namespace base::serialization::little_endian;
 
+namespace {
+
+// Bit of the pixel format field used to indicate that a byte with
+// the ImageCodec is saved after the mask color. Images saved with the
+// default codec (zlib) don't use this bit, so they can be read by old
+// versions.
+constexpr int kImageCodecFlag = 0x80;
+
+// Maximum number of pixels in each RLE packet
+constexpr int kMaxRlePacket = 128;
+
 // TODO Create a zlib wrapper for iostreams
 
-bool write_image(std::ostream& os, const Image* image, CancelIO* cancel)
+bool write_zlib_pixels(std::ostream& os,
+                       const Image* image,
+                       CancelIO* cancel,
+                       const int compressionLevel)
 {
-  write32(os, image->id());
-  write8(os, image->pixelFormat()); // Pixel format
-  write16(os, image->width());      // Width
-  write16(os, image->height());     // Height
-  write32(os, image->maskColor());  // Mask color
-
   // Number of bytes for visible pixels on each row
   const int widthBytes = image->widthBytes();
 
-#if 0
-  {
-    for (int c=0; c<image->height(); c++)
-      os.write((char*)image->getPixelAddress(0, c), widthBytes);
-  }
-#else
-  {
-    std::ostream::pos_type total_output_pos = os.tellp();
-    write32(os, 0); // Compressed size (we update this value later)
-
-    z_stream zstream;
-    zstream.zalloc = (alloc_func)0;
-    zstream.zfree = (free_func)0;
-    zstream.opaque = (voidpf)0;
-    int err = deflateInit(&zstream, Z_DEFAULT_COMPRESSION);
-    if (err != Z_OK)
-      throw base::Exception("ZLib error %d in deflateInit().", err);
-
-    std::vector<uint8_t> compressed(4096);
-    int total_output_bytes = 0;
-
-    for (int y = 0; y < image->height(); y++) {
-      if (cancel && cancel->isCanceled()) {
-        deflateEnd(&zstream);
-        return false;
+  const std::ostream::pos_type total_output_pos = os.tellp();
+  write32(os, 0); // Compressed size (we update this value later)
+
+  z_stream zstream;
+  zstream.zalloc = (alloc_func)0;
+  zstream.zfree = (free_func)0;
+  zstream.opaque = (voidpf)0;
+  int err = deflateInit(&zstream, compressionLevel);
+  if (err != Z_OK)
+    throw base::Exception("ZLib error %d in deflateInit().", err);
+
+  std::vector<uint8_t> compressed(4096);
+  int total_output_bytes = 0;
+
+  for (int y = 0; y < image->height(); y++) {
+    if (cancel && cancel->isCanceled()) {
+      deflateEnd(&zstream);
+      return false;
+    }
+
+    zstream.next_in = (Bytef*)image->getPixelAddress(0, y);
+    zstream.avail_in = widthBytes;
+    int flush = (y == image->height() - 1 ? Z_FINISH : Z_NO_FLUSH);
+
+    do {
+      zstream.next_out = (Bytef*)&compressed[0];
+      zstream.avail_out = compressed.size();
+
+      // Compress
+      err = deflate(&zstream, flush);
+      if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR)
+        throw base::Exception("ZLib error %d in deflate().", err);
+
+      int output_bytes = compressed.size() - zstream.avail_out;
+      if (output_bytes > 0) {
+        if (os.write((char*)&compressed[0], output_bytes).fail())
+          throw base::Exception("Error writing compressed image pixels.\n");
+
+        total_output_bytes += output_bytes;
       }
+    } while (zstream.avail_out == 0);
+  }
+
+  err = deflateEnd(&zstream);
+  if (err != Z_OK)
+    throw base::Exception("ZLib error %d in deflateEnd().", err);
+
+  std::ostream::pos_type bak = os.tellp();
+  os.seekp(total_output_pos);
+  write32(os, total_output_bytes);
+  os.seekp(bak);
+  return true;
+}
+
+void read_zlib_pixels(std::istream& is, Image* image)
+{
+  const int widthBytes = image->widthBytes();
+
+  int avail_bytes = read32(is);
+
+  z_stream zstream;
+  zstream.zalloc = (alloc_func)0;
+  zstream.zfree = (free_func)0;
+  zstream.opaque = (voidpf)0;
+
+  int err = inflateInit(&zstream);
+  if (err != Z_OK)
+    throw base::Exception("ZLib error %d in inflateInit().", err);
 
-      zstream.next_in = (Bytef*)image->getPixelAddress(0, y);
-      zstream.avail_in = widthBytes;
-      int flush = (y == image->height() - 1 ? Z_FINISH : Z_NO_FLUSH);
+  int remain = avail_bytes;
 
-      do {
-        zstream.next_out = (Bytef*)&compressed[0];
-        zstream.avail_out = compressed.size();
+  std::vector<uint8_t> compressed(4096);
+  int y = 0;
+  uint8_t* address = nullptr;
+  uint8_t* address_end = nullptr;
 
-        // Compress
-        err = deflate(&zstream, flush);
-        if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR)
-          throw base::Exception("ZLib error %d in deflate().", err);
+  while (remain > 0) {
+    int len = std::min(remain, int(compressed.size()));
+    if (is.read((char*)&compressed[0], len).fail()) {
+      ASSERT(false);
+      throw base::Exception("Error reading stream to restore image");
+    }
+
+    int bytes_read = (int)is.gcount();
+    if (bytes_read == 0) {
+      ASSERT(remain == 0);
+      break;
+    }
+
+    remain -= bytes_read;
 
-        int output_bytes = compressed.size() - zstream.avail_out;
-        if (output_bytes > 0) {
-          if (os.write((char*)&compressed[0], output_bytes).fail())
-            throw base::Exception("Error writing compressed image pixels.\n");
+    zstream.next_in = (Bytef*)&compressed[0];
+    zstream.avail_in = (uInt)bytes_read;
 
-          total_output_bytes += output_bytes;
+    do {
+      if (address == address_end) {
+        if (y < image->height()) {
+          address = image->getPixelAddress(0, y++);
+          address_end = address + widthBytes;
         }
-      } while (zstream.avail_out == 0);
+        else {
+          // Special reported case where we just fill the whole
+          // output image buffer (avail_out == 0), and more input
+          // was previously reported as available (avail_in != 0).
+          //
+          // Not sure why zlib reports this in certain cases, where
+          // avail_in != 0 and err == Z_OK instead of err ==
+          // Z_STREAM_END and we have to do a final inflate() call
+          // (even w/avail_out=0) to get the final Z_STREAM_END
+          // result.
+          ASSERT(y == image->height());
+          ASSERT(err == Z_OK);
+        }
+      }
+
+      zstream.next_out = (Bytef*)address;
+      zstream.avail_out = address_end - address;
+
+      err = inflate(&zstream, Z_NO_FLUSH);
+      if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR)
+        throw base::Exception("ZLib error %d in inflate().", err);
+
+      int uncompressed_bytes = (int)((address_end - address) - zstream.avail_out);
+      if (uncompressed_bytes > 0) {
+        address += uncompressed_bytes;
+      }
+    } while (zstream.avail_in != 0 && zstream.avail_out == 0);
+  }
+
+  err = inflateEnd(&zstream);
+  if (err != Z_OK)
+    throw base::Exception("ZLib error %d in inflateEnd().", err);
+}
+
+bool write_raw_pixels(std::ostream& os, const Image* image, CancelIO* cancel)
+{
+  const int widthBytes = image->widthBytes();
+  for (int y = 0; y < image->height(); y++) {
+    if (cancel && cancel->isCanceled())
+      return false;
+
+    if (os.write((const char*)image->getPixelAddress(0, y), widthBytes).fail())
+      throw base::Exception("Error writing image pixels.\n");
+  }
+  return true;
+}
+
+void read_raw_pixels(std::istream& is, Image* image)
+{
+  const int widthBytes = image->widthBytes();
+  for (int y = 0; y < image->height(); y++) {
+    if (is.read((char*)image->getPixelAddress(0, y), widthBytes).fail())
+      throw base::Exception("Error reading stream to restore image");
+  }
+}
+
+// Encodes a row of pixels in packets of up to 128 pixels. Each packet
+// starts with a header byte: if the high bit is set, the next pixel
+// is repeated (header & 0x7f) + 1 times, in other case (header + 1)
+// different pixels follow.
+template<typename T>
+void encode_rle_row(const T* pixels, const int n, std::vector<uint8_t>& out)
+{
+  auto addLiterals = [pixels, &out](int from, const int to) {
+    while (from < to) {
+      const int count = std::min(to - from, kMaxRlePacket);
+      const auto* p = (const uint8_t*)(pixels + from);
+      out.push_back(uint8_t(count - 1));
+      out.insert(out.end(), p, p + count * sizeof(T));
+      from += count;
+    }
+  };
+
+  int literal = 0; // First pixel that is not encoded yet
+  int i = 0;
+  while (i < n) {
+    int run = 1;
+    while (i + run < n && run < kMaxRlePacket && pixels[i + run] == pixels[i])
+      ++run;
+
+    if (run > 1) {
+      addLiterals(literal, i);
+
+      const auto* p = (const uint8_t*)(pixels + i);
+      out.push_back(uint8_t(0x80 | (run - 1)));
+      out.insert(out.end(), p, p + sizeof(T));
+      i += run;
+      literal = i;
+    }
+    else
+      ++i;
+  }
+  addLiterals(literal, n);
+}
+
+template<typename T>
+const uint8_t* decode_rle_row(const uint8_t* src, const uint8_t* srcEnd, T* pixels, const int n)
+{
+  int i = 0;
+  while (i < n) {
+    if (src == srcEnd)
+      throw base::Exception("Invalid RLE image data");
+
+    const int header = *(src++);
+    const int count = (header & 0x7f) + 1;
+    const size_t bytes = (header & 0x80 ? 1 : count) * sizeof(T);
+    if (i + count > n || size_t(srcEnd - src) < bytes)
+      throw base::Exception("Invalid RLE image data");
+
+    if (header & 0x80) {
+      T pixel;
+      std::copy(src, src + sizeof(T), (uint8_t*)&pixel);
+      std::fill(pixels + i, pixels + i + count, pixel);
     }
+    else {
+      std::copy(src, src + bytes, (uint8_t*)(pixels + i));
+    }
+    src += bytes;
+    i += count;
+  }
+  return src;
+}
+
+template<typename T>
+bool write_rle_pixels_templ(std::ostream& os, const Image* image, CancelIO* cancel)
+{
+  const std::ostream::pos_type total_output_pos = os.tellp();
+  write32(os, 0); // Encoded size (we update this value later)
+
+  const int n = image->widthBytes() / sizeof(T);
+  std::vector<uint8_t> encoded;
+  encoded.reserve(image->widthBytes() + image->widthBytes() / kMaxRlePacket + 1);
+  int total_output_bytes = 0;
 
-    err = deflateEnd(&zstream);
-    if (err != Z_OK)
-      throw base::Exception("ZLib error %d in deflateEnd().", err);
+  for (int y = 0; y < image->height(); y++) {
+    if (cancel && cancel->isCanceled())
+      return false;
 
-    std::ostream::pos_type bak = os.tellp();
-    os.seekp(total_output_pos);
-    write32(os, total_output_bytes);
-    os.seekp(bak);
+    encoded.clear();
+    encode_rle_row((const T*)image->getPixelAddress(0, y), n, encoded);
+    if (os.write((const char*)encoded.data(), encoded.size()).fail())
+      throw base::Exception("Error writing encoded image pixels.\n");
+
+    total_output_bytes += int(encoded.size());
   }
-#endif
+
+  const std::ostream::pos_type bak = os.tellp();
+  os.seekp(total_output_pos);
+  write32(os, total_output_bytes);
+  os.seekp(bak);
   return true;
 }
 
+template<typename T>
+void read_rle_pixels_templ(std::istream& is, Image* image)
+{
+  const size_t avail_bytes = read32(is);
+  std::vector<uint8_t> encoded(avail_bytes);
+  if (is.read((char*)encoded.data(), avail_bytes).fail())
+    throw base::Exception("Error reading stream to restore image");
+
+  const int n = image->widthBytes() / sizeof(T);
+  const uint8_t* src = encoded.data();
+  const uint8_t* srcEnd = src + encoded.size();
+  for (int y = 0; y < image->height(); y++)
+    src = decode_rle_row(src, srcEnd, (T*)image->getPixelAddress(0, y), n);
+}
+
+bool write_rle_pixels(std::ostream& os, const Image* image, CancelIO* cancel)
+{
+  switch (image->bytesPerPixel()) {
+    case 1: return write_rle_pixels_templ<uint8_t>(os, image, cancel);
+    case 2: return write_rle_pixels_templ<uint16_t>(os, image, cancel);
+    case 4: return write_rle_pixels_templ<uint32_t>(os, image, cancel);
+  }
+  ASSERT(false);
+  return false;
+}
+
+void read_rle_pixels(std::istream& is, Image* image)
+{
+  switch (image->bytesPerPixel()) {
+    case 1: read_rle_pixels_templ<uint8_t>(is, image); break;
+    case 2: read_rle_pixels_templ<uint16_t>(is, image); break;
+    case 4: read_rle_pixels_templ<uint32_t>(is, image); break;
+    default: ASSERT(false); break;
+  }
+}
+
+} // anonymous namespace
+
+bool write_image(std::ostream& os,
+                 const Image* image,
+                 CancelIO* cancel,
+                 const ImageCodec codec,
+                 const int compressionLevel)
+{
+  int pixelFormat = image->pixelFormat();
+  if (codec != ImageCodec::Zlib)
+    pixelFormat |= kImageCodecFlag;
+
+  write32(os, image->id());
+  write8(os, pixelFormat);         // Pixel format
+  write16(os, image->width());     // Width
+  write16(os, image->height());    // Height
+  write32(os, image->maskColor()); // Mask color
+  if (codec != ImageCodec::Zlib)
+    write8(os, int(codec)); // Codec
+
+  switch (codec) {
+    case ImageCodec::Zlib: return write_zlib_pixels(os, image, cancel, compressionLevel);
+    case ImageCodec::Raw:  return write_raw_pixels(os, image, cancel);
+    case ImageCodec::Rle:  return write_rle_pixels(os, image, cancel);
+  }
+  throw base::Exception("Invalid image codec %d.", int(codec));
+}
+
 Image* read_image(std::istream& is, const bool setId)
 {
   ObjectId id = read32(is);
@@ -110,6 +373,14 @@ Image* read_image(std::istream& is, const bool setId)
   int height = read16(is);         // Height
   uint32_t maskColor = read32(is); // Mask color
 
+  auto codec = ImageCodec::Zlib;
+  if (pixelFormat & kImageCodecFlag) {
+    pixelFormat &= ~kImageCodecFlag;
+    codec = ImageCodec(read8(is)); // Codec
+    if (codec != ImageCodec::Raw && codec != ImageCodec::Rle)
+      return nullptr;
+  }
+
   if ((pixelFormat != IMAGE_RGB && pixelFormat != IMAGE_GRAYSCALE && pixelFormat != IMAGE_INDEXED &&
        pixelFormat != IMAGE_BITMAP && pixelFormat != IMAGE_TILEMAP) ||
       (width < 1 || height < 1) || (width > 0xfffff || height > 0xfffff))
@@ -117,91 +388,11 @@ Image* read_image(std::istream& is, const bool setId)
 
   std::unique_ptr<Image> image(Image::create(static_cast<PixelFormat>(pixelFormat), width, height));
 
-  const int widthBytes = image->widthBytes();
-
-#if 0
-  {
-    for (int c=0; c<image->height(); c++)
-      is.read((char*)image->getPixelAddress(0, c), widthBytes);
+  switch (codec) {
+    case ImageCodec::Zlib: read_zlib_pixels(is, image.get()); break;
+    case ImageCodec::Raw:  read_raw_pixels(is, image.get()); break;
+    case ImageCodec::Rle:  read_rle_pixels(is, image.get()); break;
   }
-#else
-  {
-    int avail_bytes = read32(is);
-
-    z_stream zstream;
-    zstream.zalloc = (alloc_func)0;
-    zstream.zfree = (free_func)0;
-    zstream.opaque = (voidpf)0;
-
-    int err = inflateInit(&zstream);
-    if (err != Z_OK)
-      throw base::Exception("ZLib error %d in inflateInit().", err);
-
-    int remain = avail_bytes;
-
-    std::vector<uint8_t> compressed(4096);
-    int y = 0;
-    uint8_t* address = nullptr;
-    uint8_t* address_end = nullptr;
-
-    while (remain > 0) {
-      int len = std::min(remain, int(compressed.size()));
-      if (is.read((char*)&compressed[0], len).fail()) {
-        ASSERT(false);
-        throw base::Exception("Error reading stream to restore image");
-      }
-
-      int bytes_read = (int)is.gcount();
-      if (bytes_read == 0) {
-        ASSERT(remain == 0);
-        break;
-      }
-
-      remain -= bytes_read;
-
-      zstream.next_in = (Bytef*)&compressed[0];
-      zstream.avail_in = (uInt)bytes_read;
-
-      do {
-        if (address == address_end) {
-          if (y < image->height()) {
-            address = image->getPixelAddress(0, y++);
-            address_end = address + widthBytes;
-          }
-          else {
-            // Special reported case where we just fill the whole
-            // output image buffer (avail_out == 0), and more input
-            // was previously reported as available (avail_in != 0).
-            //
-            // Not sure why zlib reports this in certain cases, where
-            // avail_in != 0 and err == Z_OK instead of err ==
-            // Z_STREAM_END and we have to do a final inflate() call
-            // (even w/avail_out=0) to get the final Z_STREAM_END
-            // result.
-            ASSERT(y == image->height());
-            ASSERT(err == Z_OK);
-          }
-        }
-
-        zstream.next_out = (Bytef*)address;
-        zstream.avail_out = address_end - address;
-
-        err = inflate(&zstream, Z_NO_FLUSH);
-        if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR)
-          throw base::Exception("ZLib error %d in inflate().", err);
-
-        int uncompressed_bytes = (int)((address_end - address) - zstream.avail_out);
-        if (uncompressed_bytes > 0) {
-          address += uncompressed_bytes;
-        }
-      } while (zstream.avail_in != 0 && zstream.avail_out == 0);
-    }
-
-    err = inflateEnd(&zstream);
-    if (err != Z_OK)
-      throw base::Exception("ZLib error %d in inflateEnd().", err);
-  }
-#endif
 
   image->setMaskColor(maskColor);
   if (setId)
@@ -1,4 +1,5 @@
 // Aseprite Document Library
+// Copyright (c) 2025  Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -8,6 +9,7 @@
 #define DOC_IMAGE_IO_H_INCLUDED
 #pragma once
 
+#include <cstdint>
 #include <iosfwd>
 
 namespace doc {
@@ -15,7 +17,25 @@ namespace doc {
 class CancelIO;
 class Image;
 
-bool write_image(std::ostream& os, const Image* image, CancelIO* cancel = nullptr);
+// Method used to store the pixels of an image in a stream.
+enum class ImageCodec : uint8_t {
+  // Deflated rows (the only format supported by old versions)
+  Zlib = 0,
+  // Uncompressed rows
+  Raw = 1,
+  // Run-length encoded pixels, fast to encode and decode, useful for
+  // images with big areas of the same color (e.g. pixel art)
+  Rle = 2,
+};
+
+// The compressionLevel is used only with ImageCodec::Zlib (-1 is
+// Z_DEFAULT_COMPRESSION, 1 is Z_BEST_SPEED, 9 is
+// Z_BEST_COMPRESSION). read_image() detects the codec automatically.
+bool write_image(std::ostream& os,
+                 const Image* image,
+                 CancelIO* cancel = nullptr,
+                 ImageCodec codec = ImageCodec::Zlib,
+                 int compressionLevel = -1);
 Image* read_image(std::istream& is, bool setId = true);
 
 } // namespace doc
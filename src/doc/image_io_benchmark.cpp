@@ -0,0 +1,105 @@
+// Aseprite Document Library
+// Copyright (c) 2025 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif
+
+#include "doc/image_io.h"
+
+#include "doc/image.h"
+#include "doc/image_ref.h"
+#include "doc/primitives.h"
+
+#include <benchmark/benchmark.h>
+
+#include <sstream>
+
+using namespace doc;
+
+namespace {
+
+// Image similar to a sprite with big areas of the same color
+ImageRef create_sprite_like_image(const int w, const int h)
+{
+  ImageRef image(Image::create(IMAGE_RGB, w, h));
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      color_t c = 0;
+      if ((x / 37 + y / 23) % 5 != 0)
+        c = rgba((x / 64) * 3, (y / 50) * 5, (x * y / 4096) & 0xf0, 255);
+      put_pixel(image.get(), x, y, c);
+    }
+  }
+  return image;
+}
+
+void write_image_benchmark(benchmark::State& state, const ImageCodec codec, const int level)
+{
+  const int size = state.range(0);
+  ImageRef image = create_sprite_like_image(size, size);
+  size_t bytes = 0;
+  while (state.KeepRunning()) {
+    std::stringstream s;
+    write_image(s, image.get(), nullptr, codec, level);
+    bytes = s.tellp();
+  }
+  state.counters["bytes"] = double(bytes);
+}
+
+void read_image_benchmark(benchmark::State& state, const ImageCodec codec, const int level)
+{
+  const int size = state.range(0);
+  ImageRef image = create_sprite_like_image(size, size);
+  std::stringstream s;
+  write_image(s, image.get(), nullptr, codec, level);
+  const std::string data = s.str();
+  while (state.KeepRunning()) {
+    std::istringstream t(data);
+    ImageRef copy(read_image(t));
+  }
+}
+
+} // anonymous namespace
+
+void BM_WriteImageZlibDefault(benchmark::State& state)
+{
+  write_image_benchmark(state, ImageCodec::Zlib, -1);
+}
+
+void BM_WriteImageZlibFast(benchmark::State& state)
+{
+  write_image_benchmark(state, ImageCodec::Zlib, 1);
+}
+
+void BM_WriteImageRaw(benchmark::State& state)
+{
+  write_image_benchmark(state, ImageCodec::Raw, -1);
+}
+
+void BM_WriteImageRle(benchmark::State& state)
+{
+  write_image_benchmark(state, ImageCodec::Rle, -1);
+}
+
+void BM_ReadImageZlib(benchmark::State& state)
+{
+  read_image_benchmark(state, ImageCodec::Zlib, -1);
+}
+
+void BM_ReadImageRle(benchmark::State& state)
+{
+  read_image_benchmark(state, ImageCodec::Rle, -1);
+}
+
+BENCHMARK(BM_WriteImageZlibDefault)->Arg(256)->Arg(2048)->UseRealTime();
+BENCHMARK(BM_WriteImageZlibFast)->Arg(256)->Arg(2048)->UseRealTime();
+BENCHMARK(BM_WriteImageRaw)->Arg(256)->Arg(2048)->UseRealTime();
+BENCHMARK(BM_WriteImageRle)->Arg(256)->Arg(2048)->UseRealTime();
+BENCHMARK(BM_ReadImageZlib)->Arg(256)->Arg(2048)->UseRealTime();
+BENCHMARK(BM_ReadImageRle)->Arg(256)->Arg(2048)->UseRealTime();
+
+BENCHMARK_MAIN();
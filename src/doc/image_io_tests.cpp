@@ -0,0 +1,124 @@
+// Aseprite Document Library
+// Copyright (c) 2025 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/algorithm/random_image.h"
+#include "doc/image.h"
+#include "doc/image_io.h"
+#include "doc/image_ref.h"
+#include "doc/primitives.h"
+
+#include <random>
+#include <sstream>
+
+using namespace doc;
+
+namespace {
+
+const ImageCodec kCodecs[] = { ImageCodec::Zlib, ImageCodec::Raw, ImageCodec::Rle };
+
+const PixelFormat kFormats[] = { IMAGE_RGB,
+                                 IMAGE_GRAYSCALE,
+                                 IMAGE_INDEXED,
+                                 IMAGE_BITMAP,
+                                 IMAGE_TILEMAP };
+
+// Creates an image with runs of pixels of different lengths (to test
+// the RLE packets) and some random areas.
+ImageRef create_test_image(const PixelFormat pf, const int w, const int h, std::mt19937& rng)
+{
+  ImageRef image(Image::create(pf, w, h));
+  doc::algorithm::random_image(image.get());
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w;) {
+      const int run = 1 + rng() % 300;
+      const color_t c = get_pixel(image.get(), x, y);
+      for (int i = 0; i < run && x < w; ++i, ++x)
+        put_pixel(image.get(), x, y, c);
+      x += rng() % 4;
+    }
+  }
+  return image;
+}
+
+ImageRef write_and_read(const Image* image, const ImageCodec codec, const int level = -1)
+{
+  std::stringstream s;
+  EXPECT_TRUE(write_image(s, image, nullptr, codec, level));
+  // Add more data to check that the image reads just its own bytes
+  s.put('X');
+
+  ImageRef result(read_image(s));
+  EXPECT_EQ('X', s.get());
+  return result;
+}
+
+} // anonymous namespace
+
+TEST(ImageIO, AllCodecs)
+{
+  std::mt19937 rng(1);
+  for (const PixelFormat pf : kFormats) {
+    for (const int w : { 1, 2, 7, 127, 128, 129, 300 }) {
+      ImageRef image = create_test_image(pf, w, 1 + rng() % 20, rng);
+      image->setMaskColor(1);
+
+      for (const ImageCodec codec : kCodecs) {
+        ImageRef copy = write_and_read(image.get(), codec);
+        ASSERT_TRUE(copy != nullptr);
+        EXPECT_EQ(image->id(), copy->id());
+        EXPECT_EQ(image->maskColor(), copy->maskColor());
+        EXPECT_TRUE(is_same_image(image.get(), copy.get()))
+          << "pf=" << int(pf) << " w=" << w << " codec=" << int(codec);
+      }
+    }
+  }
+}
+
+TEST(ImageIO, ZlibLevels)
+{
+  std::mt19937 rng(2);
+  ImageRef image = create_test_image(IMAGE_RGB, 64, 64, rng);
+  for (const int level : { -1, 1, 9 }) {
+    ImageRef copy = write_and_read(image.get(), ImageCodec::Zlib, level);
+    ASSERT_TRUE(copy != nullptr);
+    EXPECT_TRUE(is_same_image(image.get(), copy.get()));
+  }
+}
+
+TEST(ImageIO, DefaultCodecIsCompatible)
+{
+  ImageRef image(Image::create(IMAGE_INDEXED, 4, 4));
+  clear_image(image.get(), 3);
+
+  std::stringstream a, b;
+  write_image(a, image.get());
+  write_image(b, image.get(), nullptr, ImageCodec::Rle);
+
+  // Pixel format (without the codec flag)
+  EXPECT_EQ(IMAGE_INDEXED, a.str()[4]);
+  EXPECT_NE(IMAGE_INDEXED, b.str()[4]);
+}
+
+TEST(ImageIO, InvalidRleData)
+{
+  ImageRef image(Image::create(IMAGE_RGB, 16, 2));
+  clear_image(image.get(), rgba(255, 0, 0, 255));
+
+  std::stringstream s;
+  write_image(s, image.get(), nullptr, ImageCodec::Rle);
+
+  // Remove the last byte of the encoded pixels
+  std::string data = s.str();
+  data.resize(data.size() - 1);
+  std::stringstream t(data);
+  EXPECT_ANY_THROW(read_image(t));
+}
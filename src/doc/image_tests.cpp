@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2018 Igara Studio S.A.
+// Copyright (c) 2018-2025 Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -14,6 +14,7 @@
 #include "doc/image_impl.h"
 #include "doc/primitives.h"
 
+#include <functional>
 #include <memory>
 
 using namespace base;
@@ -220,6 +221,72 @@ TYPED_TEST(ImageAllTypes, FillRect)
   }
 }
 
+TEST(Image, CompressedDataIsInvalidatedByNewVersions)
+{
+  std::unique_ptr<Image> a(Image::create(IMAGE_RGB, 16, 16));
+  clear_image(a.get(), rgba(0, 0, 0, 0));
+  EXPECT_FALSE(a->hasValidCompressedData());
+
+  // Any non-empty buffer is fine for this test
+  a->setCompressedData(base::buffer(8, 1));
+  EXPECT_TRUE(a->hasValidCompressedData());
+
+  // Version changes
+  a->incrementVersion();
+  EXPECT_FALSE(a->hasValidCompressedData());
+
+  a->setCompressedData(base::buffer(8, 1));
+  EXPECT_TRUE(a->hasValidCompressedData());
+
+  // Pixel changes must increment the version
+  put_pixel(a.get(), 3, 4, rgba(255, 0, 0, 255));
+  a->incrementVersion();
+  EXPECT_FALSE(a->hasValidCompressedData());
+
+  a->setCompressedData(base::buffer(8, 1));
+  EXPECT_TRUE(a->hasValidCompressedData());
+  a->discardCompressedData();
+  EXPECT_FALSE(a->hasValidCompressedData());
+}
+
+TEST(Image, CompressedDataIsDiscardedByPixelChanges)
+{
+  for (const PixelFormat format : { IMAGE_RGB, IMAGE_INDEXED, IMAGE_BITMAP }) {
+    std::unique_ptr<Image> a(Image::create(format, 16, 16));
+    std::unique_ptr<Image> b(Image::create(format, 4, 4));
+    clear_image(a.get(), 0);
+    clear_image(b.get(), 1);
+
+    const std::function<void()> changes[] = {
+      [&] { put_pixel(a.get(), 3, 4, 1); },
+      [&] { clear_image(a.get(), 1); },
+      [&] { fill_rect(a.get(), 2, 2, 8, 9, 1); },
+      [&] { copy_image(a.get(), b.get(), 5, 6); },
+      [&] { a->blendRect(1, 1, 3, 3, 1, 128); },
+      [&] {
+        if (format == IMAGE_RGB)
+          LockImageBits<RgbTraits> bits(a.get(), Image::WriteLock);
+        else if (format == IMAGE_INDEXED)
+          LockImageBits<IndexedTraits> bits(a.get(), Image::WriteLock);
+        else
+          LockImageBits<BitmapTraits> bits(a.get(), Image::WriteLock);
+      },
+    };
+    for (const auto& change : changes) {
+      a->setCompressedData(base::buffer(8, 1));
+      EXPECT_TRUE(a->hasValidCompressedData());
+      change();
+      EXPECT_FALSE(a->hasValidCompressedData()) << "format " << int(format);
+    }
+
+    // Reading pixels keeps the compressed data
+    a->setCompressedData(base::buffer(8, 1));
+    get_pixel(a.get(), 3, 4);
+    is_same_image(a.get(), a.get());
+    EXPECT_TRUE(a->hasValidCompressedData());
+  }
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
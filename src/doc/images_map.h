@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (C) 2019  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -18,7 +18,7 @@ namespace doc {
 namespace details {
 
 struct image_hash {
-  size_t operator()(const ImageRef& i) const { return calculate_image_hash(i.get(), i->bounds()); }
+  size_t operator()(const ImageRef& i) const { return i->contentHash(); }
 };
 
 struct image_eq {
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2020-2024 Igara Studio S.A.
+// Copyright (c) 2020-2025 Igara Studio S.A.
 // Copyright (c) 2001-2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -20,7 +20,6 @@
 
 #include <algorithm>
 #include <cmath>
-#include <limits>
 
 namespace doc {
 
@@ -36,6 +35,7 @@ Palette::Palette(frame_t frame, int ncolors) : Object(ObjectType::Palette)
 
   m_frame = frame;
   m_colors.resize(ncolors, doc::rgba(0, 0, 0, 255));
+  m_bestfit.setColors(m_colors.data(), size());
   m_modifications = 0;
 }
 
@@ -43,6 +43,7 @@ Palette::Palette(const Palette& palette) : Object(palette), m_comment(palette.m_
 {
   m_frame = palette.m_frame;
   m_colors = palette.m_colors;
+  m_bestfit = palette.m_bestfit;
   m_modifications = 0;
 }
 
@@ -67,6 +68,7 @@ Palette& Palette::operator=(const Palette& that)
 {
   m_frame = that.m_frame;
   m_colors = that.m_colors;
+  m_bestfit = that.m_bestfit;
   m_names = that.m_names;
   m_filename = that.m_filename;
   m_comment = that.m_comment;
@@ -88,6 +90,7 @@ void Palette::resize(int ncolors, color_t color)
   ASSERT(ncolors >= 0);
 
   m_colors.resize(ncolors, color);
+  m_bestfit.setColors(m_colors.data(), size());
   ++m_modifications;
 }
 
@@ -127,12 +130,14 @@ void Palette::setEntry(int i, color_t color)
   ASSERT(i >= 0 && i < size());
 
   m_colors[i] = color;
+  m_bestfit.setColor(i, color);
   ++m_modifications;
 }
 
 void Palette::copyColorsTo(Palette* dst) const
 {
   dst->m_colors = m_colors;
+  dst->m_bestfit = m_bestfit;
   ++dst->m_modifications;
 }
 
@@ -196,6 +201,7 @@ bool Palette::isBlack() const
 void Palette::makeBlack()
 {
   std::fill(m_colors.begin(), m_colors.end(), rgba(0, 0, 0, 255));
+  m_bestfit.setColors(m_colors.data(), size());
   ++m_modifications;
 }
 
@@ -313,75 +319,9 @@ bool Palette::findExactMatch(color_t color) const
   return false;
 }
 
-//////////////////////////////////////////////////////////////////////
-// Based on Allegro's bestfit_color
-
-static std::vector<uint32_t> col_diff;
-static uint32_t* col_diff_g;
-static uint32_t* col_diff_r;
-static uint32_t* col_diff_b;
-static uint32_t* col_diff_a;
-
-void Palette::initBestfit()
-{
-  col_diff.resize(4 * 128, 0);
-  col_diff_g = &col_diff[128 * 0];
-  col_diff_r = &col_diff[128 * 1];
-  col_diff_b = &col_diff[128 * 2];
-  col_diff_a = &col_diff[128 * 3];
-
-  for (int i = 1; i < 64; ++i) {
-    int k = i * i;
-    col_diff_g[i] = col_diff_g[128 - i] = k * 59 * 59;
-    col_diff_r[i] = col_diff_r[128 - i] = k * 30 * 30;
-    col_diff_b[i] = col_diff_b[128 - i] = k * 11 * 11;
-    col_diff_a[i] = col_diff_a[128 - i] = k * 8 * 8;
-  }
-}
-
 int Palette::findBestfit(int r, int g, int b, int a, int mask_index) const
 {
-  ASSERT(r >= 0 && r <= 255);
-  ASSERT(g >= 0 && g <= 255);
-  ASSERT(b >= 0 && b <= 255);
-  ASSERT(a >= 0 && a <= 255);
-  ASSERT(!col_diff.empty());
-
-  r >>= 3;
-  g >>= 3;
-  b >>= 3;
-  a >>= 3;
-
-  // Mask index is like alpha = 0, so we can use it as transparent color.
-  if (a == 0 && mask_index >= 0)
-    return mask_index;
-
-  int bestfit = 0;
-  int lowest = std::numeric_limits<int>::max();
-  int size = std::min(256, int(m_colors.size()));
-
-  for (int i = 0; i < size; ++i) {
-    color_t rgb = m_colors[i];
-
-    int coldiff = col_diff_g[((rgba_getg(rgb) >> 3) - g) & 127];
-    if (coldiff < lowest) {
-      coldiff += col_diff_r[(((rgba_getr(rgb) >> 3) - r) & 127)];
-      if (coldiff < lowest) {
-        coldiff += col_diff_b[(((rgba_getb(rgb) >> 3) - b) & 127)];
-        if (coldiff < lowest) {
-          coldiff += col_diff_a[(((rgba_geta(rgb) >> 3) - a) & 127)];
-          if (coldiff < lowest && i != mask_index) {
-            if (coldiff == 0)
-              return i;
-
-            bestfit = i;
-            lowest = coldiff;
-          }
-        }
-      }
-    }
-  }
-  return bestfit;
+  return m_bestfit.findBestfit(r, g, b, a, mask_index);
 }
 
 int Palette::findMaskColor() const
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (C) 2020-2023  Igara Studio S.A.
+// Copyright (C) 2020-2025  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -13,6 +13,7 @@
 #include "doc/color.h"
 #include "doc/frame.h"
 #include "doc/object.h"
+#include "doc/palette_bestfit.h"
 #include "doc/palette_gradient_type.h"
 
 #include <string>
@@ -24,8 +25,6 @@ class Remap;
 
 class Palette : public Object {
 public:
-  static void initBestfit();
-
   Palette();
   Palette(frame_t frame, int ncolors);
   Palette(const Palette& palette);
@@ -109,6 +108,7 @@ private:
   std::vector<color_t> m_colors;
   std::vector<std::string> m_names;
   int m_modifications;
+  PaletteBestfit m_bestfit; // Copy of m_colors to find the nearest color fast
   std::string m_filename; // If the palette is associated with a file.
   std::string m_comment;  // Some extra comment from the .gpl file (author, website, etc.).
 };
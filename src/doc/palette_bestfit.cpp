@@ -0,0 +1,165 @@
+// Aseprite Document Library
+// Copyright (c) 2025 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif
+
+#include "doc/palette_bestfit.h"
+
+#include "base/debug.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define DOC_PALETTE_BESTFIT_SSE2 1
+  #include <emmintrin.h>
+#endif
+
+namespace doc {
+
+namespace {
+
+// Number of entries compared in each iteration
+constexpr int kBlock = 4;
+
+// Value of the padding entries, it's far away from any real color
+// (the distance to any color is greater than the maximum distance
+// between two real colors) but it doesn't overflow the 32-bit sums.
+constexpr int16_t kFarAway = -16384;
+
+// Weights of each component
+constexpr int kWeightR = 30;
+constexpr int kWeightG = 59;
+constexpr int kWeightB = 11;
+constexpr int kWeightA = 8;
+
+} // anonymous namespace
+
+PaletteBestfit::PaletteBestfit() : m_size(0)
+{
+}
+
+void PaletteBestfit::setColors(const color_t* colors, const int n)
+{
+  m_size = std::clamp(n, 0, kMaxColors);
+
+  const int padded = (m_size + kBlock - 1) / kBlock * kBlock;
+  m_gr.assign(2 * padded, kFarAway);
+  m_ba.assign(2 * padded, kFarAway);
+
+  for (int i = 0; i < m_size; ++i)
+    setColor(i, colors[i]);
+}
+
+void PaletteBestfit::setColor(const int i, const color_t color)
+{
+  if (i < 0 || i >= m_size)
+    return;
+
+  m_gr[2 * i] = kWeightG * (rgba_getg(color) >> 3);
+  m_gr[2 * i + 1] = kWeightR * (rgba_getr(color) >> 3);
+  m_ba[2 * i] = kWeightB * (rgba_getb(color) >> 3);
+  m_ba[2 * i + 1] = kWeightA * (rgba_geta(color) >> 3);
+}
+
+int PaletteBestfit::findBestfit(int r, int g, int b, int a, const int mask_index) const
+{
+  ASSERT(r >= 0 && r <= 255);
+  ASSERT(g >= 0 && g <= 255);
+  ASSERT(b >= 0 && b <= 255);
+  ASSERT(a >= 0 && a <= 255);
+
+  r = kWeightR * (r >> 3);
+  g = kWeightG * (g >> 3);
+  b = kWeightB * (b >> 3);
+  a = kWeightA * (a >> 3);
+
+  // Mask index is like alpha = 0, so we can use it as transparent color.
+  if (a == 0 && mask_index >= 0)
+    return mask_index;
+
+  if (m_size == 0)
+    return 0;
+
+  const int16_t* gr = m_gr.data();
+  const int16_t* ba = m_ba.data();
+  const int n = int(m_gr.size() / 2);
+  int bestfit;
+
+#if DOC_PALETTE_BESTFIT_SSE2
+  // The differences of two components are multiplied and added with
+  // just one instruction (pmaddwd): (g0-g)^2 + (r0-r)^2, etc.
+  const __m128i qgr = _mm_set1_epi32((r << 16) | g);
+  const __m128i qba = _mm_set1_epi32((a << 16) | b);
+  const __m128i maskIndex = _mm_set1_epi32(mask_index);
+  const __m128i maskDist = _mm_set1_epi32(std::numeric_limits<int>::max());
+  const __m128i step = _mm_set1_epi32(kBlock);
+  __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+  __m128i lowest = maskDist;
+  __m128i lowestIndex = _mm_setzero_si128();
+
+  for (int i = 0; i < n; i += kBlock) {
+    const __m128i dgr = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(gr + 2 * i)), qgr);
+    const __m128i dba = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(ba + 2 * i)), qba);
+    __m128i dist = _mm_add_epi32(_mm_madd_epi16(dgr, dgr), _mm_madd_epi16(dba, dba));
+
+    // The mask index cannot be selected
+    const __m128i isMask = _mm_cmpeq_epi32(index, maskIndex);
+    dist = _mm_or_si128(_mm_and_si128(isMask, maskDist), _mm_andnot_si128(isMask, dist));
+
+    // Keep the first lowest distance of each lane
+    const __m128i lower = _mm_cmplt_epi32(dist, lowest);
+    lowest = _mm_or_si128(_mm_and_si128(lower, dist), _mm_andnot_si128(lower, lowest));
+    lowestIndex = _mm_or_si128(_mm_and_si128(lower, index),
+                               _mm_andnot_si128(lower, lowestIndex));
+    index = _mm_add_epi32(index, step);
+
+    // Exact match, the next entries cannot be better
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(lowest, _mm_setzero_si128())))
+      break;
+  }
+
+  int dists[kBlock];
+  int indexes[kBlock];
+  _mm_storeu_si128((__m128i*)dists, lowest);
+  _mm_storeu_si128((__m128i*)indexes, lowestIndex);
+
+  int lowestDist = dists[0];
+  bestfit = indexes[0];
+  for (int j = 1; j < kBlock; ++j) {
+    if (dists[j] < lowestDist || (dists[j] == lowestDist && indexes[j] < bestfit)) {
+      lowestDist = dists[j];
+      bestfit = indexes[j];
+    }
+  }
+#else
+  int lowest = std::numeric_limits<int>::max();
+  bestfit = 0;
+  for (int i = 0; i < n; ++i) {
+    const int dg = gr[2 * i] - g;
+    const int dr = gr[2 * i + 1] - r;
+    const int db = ba[2 * i] - b;
+    const int da = ba[2 * i + 1] - a;
+    const int dist = dg * dg + dr * dr + db * db + da * da;
+    if (dist < lowest && i != mask_index) {
+      bestfit = i;
+      lowest = dist;
+      if (dist == 0)
+        break;
+    }
+  }
+#endif
+
+  // All entries are the mask index (or padding)
+  if (bestfit >= m_size || bestfit == mask_index)
+    return 0;
+
+  return bestfit;
+}
+
+} // namespace doc
@@ -0,0 +1,52 @@
+// Aseprite Document Library
+// Copyright (c) 2025 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef DOC_PALETTE_BESTFIT_H_INCLUDED
+#define DOC_PALETTE_BESTFIT_H_INCLUDED
+#pragma once
+
+#include "doc/color.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace doc {
+
+// Structure-of-arrays copy of the first 256 colors of a palette used
+// to find the nearest color of the palette (Palette::findBestfit())
+// comparing several entries at the same time with SIMD instructions.
+//
+// The distance between two colors is the same one used by Allegro's
+// bestfit_color(): the squared difference of the 5-bit components
+// weighted by 59 (green), 30 (red), 11 (blue), and 8 (alpha).
+class PaletteBestfit {
+public:
+  // Maximum number of colors used to find the best fit.
+  static constexpr int kMaxColors = 256;
+
+  PaletteBestfit();
+
+  void setColors(const color_t* colors, int n);
+  void setColor(int i, color_t color);
+
+  // Returns the index of the nearest color to the given RGBA values
+  // (in the [0,255] range), or the first one if there are several
+  // colors at the same distance. "mask_index" is never returned,
+  // except if "a" is 0.
+  int findBestfit(int r, int g, int b, int a, int mask_index) const;
+
+private:
+  // Interleaved pairs of weighted 5-bit components (59*g, 30*r) and
+  // (11*b, 8*a) for each color, padded with far away values up to a
+  // multiple of 4 entries.
+  std::vector<int16_t> m_gr;
+  std::vector<int16_t> m_ba;
+  int m_size;
+};
+
+} // namespace doc
+
+#endif
@@ -0,0 +1,104 @@
+// Aseprite Document Library
+// Copyright (c) 2025 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/palette.h"
+
+#include <limits>
+#include <random>
+
+using namespace doc;
+
+namespace {
+
+// Straightforward version of the Allegro's bestfit_color() algorithm
+int reference_bestfit(const Palette& pal, int r, int g, int b, int a, int mask_index)
+{
+  r >>= 3;
+  g >>= 3;
+  b >>= 3;
+  a >>= 3;
+
+  if (a == 0 && mask_index >= 0)
+    return mask_index;
+
+  int bestfit = 0;
+  int lowest = std::numeric_limits<int>::max();
+  for (int i = 0; i < std::min(256, pal.size()); ++i) {
+    const color_t c = pal.getEntry(i);
+    const int dr = (rgba_getr(c) >> 3) - r;
+    const int dg = (rgba_getg(c) >> 3) - g;
+    const int db = (rgba_getb(c) >> 3) - b;
+    const int da = (rgba_geta(c) >> 3) - a;
+    const int dist = dg * dg * 59 * 59 + dr * dr * 30 * 30 + db * db * 11 * 11 +
+                     da * da * 8 * 8;
+    if (dist < lowest && i != mask_index) {
+      bestfit = i;
+      lowest = dist;
+    }
+  }
+  return bestfit;
+}
+
+} // anonymous namespace
+
+TEST(PaletteBestfit, MatchesReference)
+{
+  std::mt19937 rng(1);
+  for (const int ncolors : { 1, 2, 3, 4, 5, 16, 31, 255, 256, 300 }) {
+    Palette pal(frame_t(0), ncolors);
+    for (int i = 0; i < ncolors; ++i) {
+      // Use few different values to get several colors at the same
+      // distance (the first one must be returned).
+      pal.setEntry(i, rgba(rng() % 4 * 85, rng() % 4 * 85, rng() % 4 * 85, rng() % 2 * 255));
+    }
+
+    for (int i = 0; i < 2000; ++i) {
+      const int r = rng() % 256;
+      const int g = rng() % 256;
+      const int b = rng() % 256;
+      const int a = rng() % 256;
+      const int mask = int(rng() % (ncolors + 1)) - 1;
+      ASSERT_EQ(reference_bestfit(pal, r, g, b, a, mask), pal.findBestfit(r, g, b, a, mask))
+        << "ncolors=" << ncolors << " rgba=" << r << "," << g << "," << b << "," << a
+        << " mask=" << mask;
+    }
+  }
+}
+
+TEST(PaletteBestfit, ExactMatchAndMask)
+{
+  Palette pal(frame_t(0), 5);
+  pal.setEntry(0, rgba(0, 0, 0, 0));
+  pal.setEntry(1, rgba(255, 0, 0, 255));
+  pal.setEntry(2, rgba(0, 255, 0, 255));
+  pal.setEntry(3, rgba(0, 0, 255, 255));
+  pal.setEntry(4, rgba(255, 0, 0, 255));
+
+  EXPECT_EQ(1, pal.findBestfit(255, 0, 0, 255, 0));
+  EXPECT_EQ(4, pal.findBestfit(255, 0, 0, 255, 1));
+  EXPECT_EQ(2, pal.findBestfit(0, 250, 0, 255, 0));
+  EXPECT_EQ(0, pal.findBestfit(255, 0, 0, 0, 0));
+  EXPECT_EQ(3, pal.findBestfit(0, 0, 200, 0, -1));
+
+  // Palette modifications are taken into account
+  pal.setEntry(3, rgba(0, 0, 100, 255));
+  EXPECT_EQ(3, pal.findBestfit(0, 0, 100, 255, 0));
+  pal.resize(6, rgba(0, 0, 200, 255));
+  EXPECT_EQ(5, pal.findBestfit(0, 0, 200, 255, 0));
+
+  Palette copy(pal);
+  EXPECT_EQ(5, copy.findBestfit(0, 0, 200, 255, 0));
+
+  // Only the mask color
+  Palette one(frame_t(0), 1);
+  EXPECT_EQ(0, one.findBestfit(0, 0, 0, 255, 0));
+}
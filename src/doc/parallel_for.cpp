@@ -0,0 +1,42 @@
+// Aseprite Document Library
+// Copyright (c) 2025 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif
+
+#include "doc/parallel_for.h"
+
+#include <algorithm>
+
+namespace doc {
+
+static ParallelForFunc g_parallelFor;
+static int g_threads = 1;
+
+void set_parallel_for(ParallelForFunc&& func, const int threads)
+{
+  g_parallelFor = std::move(func);
+  g_threads = (g_parallelFor ? std::max(1, threads) : 1);
+}
+
+int parallel_for_threads()
+{
+  return g_threads;
+}
+
+void parallel_for(const int n, const std::function<void(int i)>& func)
+{
+  if (g_parallelFor && n > 1) {
+    g_parallelFor(n, func);
+  }
+  else {
+    for (int i = 0; i < n; ++i)
+      func(i);
+  }
+}
+
+} // namespace doc
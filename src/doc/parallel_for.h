@@ -0,0 +1,34 @@
+// Aseprite Document Library
+// Copyright (c) 2025 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef DOC_PARALLEL_FOR_H_INCLUDED
+#define DOC_PARALLEL_FOR_H_INCLUDED
+#pragma once
+
+#include <functional>
+
+namespace doc {
+
+// Function that calls func(i) for each i in [0, n) (possibly from
+// several threads) and returns when all the calls are finished.
+using ParallelForFunc = std::function<void(int n, const std::function<void(int i)>& func)>;
+
+// Sets the function used by parallel_for() and the number of threads
+// it uses. The app uses its own task scheduler, so the algorithms of
+// doc/render libraries don't need to create their own threads. By
+// default (or with a nullptr function) all calls are executed in the
+// current thread.
+void set_parallel_for(ParallelForFunc&& func, int threads);
+
+// Returns the number of threads used by parallel_for() (1 if all
+// calls are executed in the current thread).
+int parallel_for_threads();
+
+void parallel_for(int n, const std::function<void(int i)>& func);
+
+} // namespace doc
+
+#endif
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2018-2023 Igara Studio S.A.
+// Copyright (c) 2018-2025 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -546,33 +546,32 @@ void remap_image(Image* image, const Remap& remap)
   }
 }
 
-// TODO test this hash routine and find a better alternative
-
+// Hashes each row of the given bounds chaining the hash of the
+// previous rows, so we don't need to copy a sub-rectangle to a
+// temporary buffer, and the same pixels give the same hash
+// independently of how the rows are stored in memory.
 template<typename ImageTraits, uint32_t Mask>
 static uint32_t calculate_image_hash_templ(const Image* image, const gfx::Rect& bounds)
 {
+  const uint32_t widthBytes = ImageTraits::bytes_per_pixel * bounds.w;
+
 #if defined(__LP64__) || defined(__x86_64__) || defined(_WIN64)
-  #define CITYHASH(buf, len) (CityHash64(buf, len) & 0xffffffff)
   static_assert(sizeof(void*) == 8, "This CPU is not 64-bit");
+  uint64_t hash = 0;
+  for (int y = 0; y < bounds.h; ++y) {
+    auto row = (const char*)image->getPixelAddress(bounds.x, bounds.y + y);
+    hash = CityHash64WithSeed(row, widthBytes, hash);
+  }
+  return uint32_t(hash & 0xffffffff);
 #else
-  #define CITYHASH(buf, len) CityHash32(buf, len)
   static_assert(sizeof(void*) == 4, "This CPU is not 32-bit");
-#endif
-
-  const uint32_t widthBytes = ImageTraits::bytes_per_pixel * bounds.w;
-  const uint32_t len = widthBytes * bounds.h;
-  if (bounds == image->bounds() && widthBytes == image->rowBytes()) {
-    return CITYHASH((const char*)image->getPixelAddress(0, 0), len);
-  }
-  else {
-    std::vector<uint8_t> buf(len);
-    uint8_t* dst = &buf[0];
-    for (int y = 0; y < bounds.h; ++y, dst += widthBytes) {
-      auto src = (const uint8_t*)image->getPixelAddress(bounds.x, bounds.y + y);
-      std::copy(src, src + widthBytes, dst);
-    }
-    return CITYHASH((const char*)&buf[0], buf.size());
+  uint32_t hash = 0;
+  for (int y = 0; y < bounds.h; ++y) {
+    auto row = (const char*)image->getPixelAddress(bounds.x, bounds.y + y);
+    hash ^= CityHash32(row, widthBytes) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
   }
+  return hash;
+#endif
 }
 
 uint32_t calculate_image_hash(const Image* img, const gfx::Rect& bounds)
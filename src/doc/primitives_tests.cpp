@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2023  Igara Studio S.A.
+// Copyright (c) 2023-2025  Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -81,6 +81,37 @@ TYPED_TEST(Primitives, IsSameImage)
   }
 }
 
+TEST(ImageHash, SubRectangle)
+{
+  for (auto pf : { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED }) {
+    ImageRef a(Image::create(pf, 64, 48));
+    doc::algorithm::random_image(a.get());
+
+    for (const Rect& rc : { Rect(0, 0, 64, 48), Rect(0, 10, 64, 20), Rect(7, 3, 31, 17) }) {
+      ImageRef b(crop_image(a.get(), rc, 0));
+      EXPECT_EQ(calculate_image_hash(a.get(), rc), calculate_image_hash(b.get(), b->bounds()))
+        << "Pixel format=" << pf << " Rect=" << rc.x << "," << rc.y << "," << rc.w << ","
+        << rc.h;
+      EXPECT_EQ(calculate_image_hash(b.get(), b->bounds()), b->contentHash());
+    }
+  }
+}
+
+TEST(ImageHash, CachedHashUsesVersion)
+{
+  ImageRef a(Image::create(IMAGE_RGB, 16, 16));
+  clear_image(a.get(), rgba(0, 0, 0, 0));
+  const uint32_t hash = a->contentHash();
+
+  // The cached hash is not re-calculated until the version changes
+  put_pixel(a.get(), 3, 4, rgba(255, 0, 0, 255));
+  EXPECT_EQ(hash, a->contentHash());
+
+  a->incrementVersion();
+  EXPECT_NE(hash, a->contentHash());
+  EXPECT_EQ(calculate_image_hash(a.get(), a->bounds()), a->contentHash());
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,151 @@
+// Aseprite Document Library
+// Copyright (c) 2025 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif
+
+#include "doc/sparse_image.h"
+
+#include "doc/image.h"
+
+#include <algorithm>
+
+namespace doc {
+
+SparseImage::SparseImage(const ImageSpec& spec)
+  : m_spec(spec)
+  , m_cols((spec.width() + kChunkSize - 1) / kChunkSize)
+  , m_rows((spec.height() + kChunkSize - 1) / kChunkSize)
+{
+  ImageSpec chunkSpec = spec;
+  chunkSpec.setSize(kChunkSize, kChunkSize);
+  m_emptyChunk.reset(Image::create(chunkSpec));
+  m_emptyChunk->clear(spec.maskColor());
+  m_chunks.resize(m_cols * m_rows, m_emptyChunk);
+}
+
+// static
+SparseImage* SparseImage::createFromImage(const Image* image)
+{
+  auto* sparse = new SparseImage(image->spec());
+  const color_t mask = image->maskColor();
+
+  for (int cy = 0; cy < sparse->m_rows; ++cy) {
+    for (int cx = 0; cx < sparse->m_cols; ++cx) {
+      const gfx::Rect rc =
+        gfx::Rect(cx * kChunkSize, cy * kChunkSize, kChunkSize, kChunkSize).createIntersection(
+          image->bounds());
+
+      // Skip chunks without pixels
+      bool empty = true;
+      for (int y = rc.y; y < rc.y2() && empty; ++y) {
+        for (int x = rc.x; x < rc.x2(); ++x) {
+          if (image->getPixel(x, y) != mask) {
+            empty = false;
+            break;
+          }
+        }
+      }
+      if (empty)
+        continue;
+
+      sparse->writableChunk(cx, cy)->copy(image, gfx::Clip(0, 0, rc));
+    }
+  }
+  return sparse;
+}
+
+Image* SparseImage::createImage(const ImageBufferPtr& buffer) const
+{
+  Image* image = Image::create(m_spec, buffer);
+  image->clear(maskColor());
+
+  for (int cy = 0; cy < m_rows; ++cy) {
+    for (int cx = 0; cx < m_cols; ++cx) {
+      const ImageRef& c = chunk(cx, cy);
+      if (c != m_emptyChunk)
+        image->copy(c.get(),
+                    gfx::Clip(cx * kChunkSize, cy * kChunkSize, 0, 0, kChunkSize, kChunkSize));
+    }
+  }
+  return image;
+}
+
+int SparseImage::allocatedChunks() const
+{
+  return int(std::count_if(m_chunks.begin(), m_chunks.end(), [this](const ImageRef& c) {
+    return c != m_emptyChunk;
+  }));
+}
+
+int SparseImage::getMemSize() const
+{
+  const int chunkSize = m_emptyChunk->getMemSize();
+  return sizeof(SparseImage) + int(m_chunks.size() * sizeof(ImageRef)) +
+         (1 + allocatedChunks()) * chunkSize;
+}
+
+color_t SparseImage::getPixel(const int x, const int y) const
+{
+  if (x < 0 || y < 0 || x >= width() || y >= height())
+    return maskColor();
+
+  return chunk(x / kChunkSize, y / kChunkSize)->getPixel(x % kChunkSize, y % kChunkSize);
+}
+
+void SparseImage::putPixel(const int x, const int y, const color_t color)
+{
+  if (x < 0 || y < 0 || x >= width() || y >= height())
+    return;
+
+  const int cx = x / kChunkSize;
+  const int cy = y / kChunkSize;
+
+  // Writing the mask color in an empty chunk doesn't change anything
+  if (chunk(cx, cy) == m_emptyChunk && color == maskColor())
+    return;
+
+  writableChunk(cx, cy)->putPixel(x % kChunkSize, y % kChunkSize, color);
+}
+
+void SparseImage::fillRect(const gfx::Rect& rc0, const color_t color)
+{
+  const gfx::Rect rc = rc0.createIntersection(bounds());
+  if (rc.isEmpty())
+    return;
+
+  for (int cy = rc.y / kChunkSize; cy <= (rc.y2() - 1) / kChunkSize; ++cy) {
+    for (int cx = rc.x / kChunkSize; cx <= (rc.x2() - 1) / kChunkSize; ++cx) {
+      if (chunk(cx, cy) == m_emptyChunk && color == maskColor())
+        continue;
+
+      const gfx::Point origin(cx * kChunkSize, cy * kChunkSize);
+      const gfx::Rect chunkRc =
+        gfx::Rect(origin, gfx::Size(kChunkSize, kChunkSize)).createIntersection(rc);
+      writableChunk(cx, cy)->fillRect(chunkRc.x - origin.x,
+                                      chunkRc.y - origin.y,
+                                      chunkRc.x2() - origin.x - 1,
+                                      chunkRc.y2() - origin.y - 1,
+                                      color);
+    }
+  }
+}
+
+void SparseImage::clear()
+{
+  std::fill(m_chunks.begin(), m_chunks.end(), m_emptyChunk);
+}
+
+Image* SparseImage::writableChunk(const int cx, const int cy)
+{
+  ImageRef& c = m_chunks[cy * m_cols + cx];
+  if (c == m_emptyChunk)
+    c.reset(Image::createCopy(m_emptyChunk.get()));
+  return c.get();
+}
+
+} // namespace doc
@@ -0,0 +1,80 @@
+// Aseprite Document Library
+// Copyright (c) 2025 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef DOC_SPARSE_IMAGE_H_INCLUDED
+#define DOC_SPARSE_IMAGE_H_INCLUDED
+#pragma once
+
+#include "doc/color.h"
+#include "doc/image_buffer.h"
+#include "doc/image_ref.h"
+#include "doc/image_spec.h"
+#include "gfx/rect.h"
+
+#include <vector>
+
+namespace doc {
+
+class Image;
+
+// Pixels of an image stored in square chunks of kChunkSize x
+// kChunkSize pixels. Chunks are allocated when they are written for
+// the first time, meanwhile all of them share the same empty chunk
+// (filled with the mask color). So a big image where only a small
+// area is painted uses memory proportional to the painted area.
+//
+// It's not an Image because the Image pixel functions need rows of
+// contiguous pixels, it can be converted from/to an Image instead.
+class SparseImage {
+public:
+  static constexpr int kChunkSize = 64;
+
+  explicit SparseImage(const ImageSpec& spec);
+
+  // Creates a sparse image from the given image, only chunks with
+  // pixels different than the mask color are allocated.
+  static SparseImage* createFromImage(const Image* image);
+
+  // Returns a new image with all the pixels of this sparse image.
+  Image* createImage(const ImageBufferPtr& buffer = ImageBufferPtr()) const;
+
+  const ImageSpec& spec() const { return m_spec; }
+  PixelFormat pixelFormat() const { return (PixelFormat)m_spec.colorMode(); }
+  int width() const { return m_spec.width(); }
+  int height() const { return m_spec.height(); }
+  gfx::Rect bounds() const { return m_spec.bounds(); }
+  color_t maskColor() const { return m_spec.maskColor(); }
+
+  // Number of chunks that were written (the others are empty).
+  int allocatedChunks() const;
+  int getMemSize() const;
+
+  // Pixel functions with bounds check (pixels outside the image are
+  // ignored).
+  color_t getPixel(int x, int y) const;
+  void putPixel(int x, int y, color_t color);
+  void fillRect(const gfx::Rect& rc, color_t color);
+
+  // Releases all chunks (all pixels will be the mask color).
+  void clear();
+
+private:
+  const ImageRef& chunk(int cx, int cy) const { return m_chunks[cy * m_cols + cx]; }
+
+  // Returns the chunk to be modified (allocating it if it's the
+  // empty chunk).
+  Image* writableChunk(int cx, int cy);
+
+  ImageSpec m_spec;
+  int m_cols;
+  int m_rows;
+  ImageRef m_emptyChunk;
+  std::vector<ImageRef> m_chunks;
+};
+
+} // namespace doc
+
+#endif
@@ -0,0 +1,102 @@
+// Aseprite Document Library
+// Copyright (c) 2025 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+  #include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/image.h"
+#include "doc/primitives.h"
+#include "doc/sparse_image.h"
+
+#include <memory>
+
+using namespace doc;
+
+TEST(SparseImage, EmptyChunksAreShared)
+{
+  SparseImage sparse(ImageSpec(ColorMode::RGB, 8192, 8192));
+  EXPECT_EQ(0, sparse.allocatedChunks());
+  EXPECT_LT(sparse.getMemSize(), 1024 * 1024);
+  EXPECT_EQ(0, sparse.getPixel(0, 0));
+  EXPECT_EQ(0, sparse.getPixel(8191, 8191));
+
+  // Writing the mask color doesn't allocate chunks
+  sparse.putPixel(100, 100, 0);
+  sparse.fillRect(gfx::Rect(0, 0, 1000, 1000), 0);
+  EXPECT_EQ(0, sparse.allocatedChunks());
+}
+
+TEST(SparseImage, AllocateChunksOnFirstWrite)
+{
+  SparseImage sparse(ImageSpec(ColorMode::RGB, 8192, 8192));
+  const color_t red = rgba(255, 0, 0, 255);
+
+  sparse.putPixel(5000, 7000, red);
+  EXPECT_EQ(1, sparse.allocatedChunks());
+  EXPECT_EQ(red, sparse.getPixel(5000, 7000));
+  EXPECT_EQ(0, sparse.getPixel(5001, 7000));
+  EXPECT_EQ(0, sparse.getPixel(5000, 7000 - SparseImage::kChunkSize));
+
+  // Same chunk
+  sparse.putPixel(5001, 7001, red);
+  EXPECT_EQ(1, sparse.allocatedChunks());
+
+  // Pixels outside the image are ignored
+  sparse.putPixel(-1, 0, red);
+  sparse.putPixel(8192, 0, red);
+  EXPECT_EQ(1, sparse.allocatedChunks());
+  EXPECT_EQ(0, sparse.getPixel(-1, 0));
+
+  // A rectangle of 2x2 chunks not aligned to the chunks grid
+  // touches 3x3 chunks
+  const int n = SparseImage::kChunkSize;
+  sparse.fillRect(gfx::Rect(n / 2, n / 2, 2 * n, 2 * n), red);
+  EXPECT_EQ(10, sparse.allocatedChunks());
+  EXPECT_EQ(red, sparse.getPixel(n / 2, n / 2));
+  EXPECT_EQ(red, sparse.getPixel(5 * n / 2 - 1, 5 * n / 2 - 1));
+  EXPECT_EQ(0, sparse.getPixel(5 * n / 2, 5 * n / 2));
+  EXPECT_EQ(0, sparse.getPixel(n / 2 - 1, n / 2));
+
+  sparse.clear();
+  EXPECT_EQ(0, sparse.allocatedChunks());
+  EXPECT_EQ(0, sparse.getPixel(5000, 7000));
+}
+
+TEST(SparseImage, ConvertFromAndToImage)
+{
+  const int n = SparseImage::kChunkSize;
+  for (const ColorMode colorMode : { ColorMode::RGB, ColorMode::GRAYSCALE, ColorMode::INDEXED }) {
+    ImageSpec spec(colorMode, 3 * n + 10, 2 * n + 5);
+    spec.setMaskColor(colorMode == ColorMode::INDEXED ? 2 : 0);
+
+    std::unique_ptr<Image> image(Image::create(spec));
+    clear_image(image.get(), image->maskColor());
+    put_pixel(image.get(), 3, 4, 1);                   // Chunk (0, 0)
+    put_pixel(image.get(), 3 * n + 9, 2 * n + 4, 5);   // Chunk (3, 2), in the image edge
+    fill_rect(image.get(), n + 10, 10, n + 20, 20, 7); // Chunk (1, 0)
+
+    std::unique_ptr<SparseImage> sparse(SparseImage::createFromImage(image.get()));
+    EXPECT_EQ(3, sparse->allocatedChunks());
+    EXPECT_EQ(image->maskColor(), sparse->maskColor());
+    EXPECT_EQ(1, sparse->getPixel(3, 4));
+    EXPECT_EQ(5, sparse->getPixel(3 * n + 9, 2 * n + 4));
+    EXPECT_EQ(7, sparse->getPixel(n + 15, 15));
+    EXPECT_EQ(image->maskColor(), sparse->getPixel(2 * n, n));
+
+    std::unique_ptr<Image> result(sparse->createImage());
+    EXPECT_EQ(image->spec(), result->spec());
+    EXPECT_TRUE(is_same_image(image.get(), result.get()));
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2019-2023  Igara Studio S.A.
+// Copyright (c) 2019-2025  Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -261,6 +261,11 @@ bool Tileset::findTileIndex(const ImageRef& tileImage, tile_index& ti)
   }
 }
 
+void Tileset::prepareHashTable()
+{
+  hashTable();
+}
+
 void Tileset::notifyTileContentChange(const tile_index ti)
 {
 #if 0 // TODO Try to do less work
@@ -296,9 +301,14 @@ void Tileset::notifyTileContentChange(const tile_index ti)
 
   (void)ti; // unused
 
-  if (ti >= 0 && ti < m_tiles.size() && m_tiles[ti].image)
+  if (ti >= 0 && ti < m_tiles.size() && m_tiles[ti].image) {
     preprocess_transparent_pixels(m_tiles[ti].image.get());
 
+    // Invalidate the cached hash of the tile image (the pixels could
+    // be modified directly without a cmd that increments its version)
+    m_tiles[ti].image->incrementVersion();
+  }
+
   rehash();
 
 #endif
@@ -310,8 +320,10 @@ void Tileset::notifyRegenerateEmptyTile()
     return;
 
   ImageRef image = get(doc::notile);
-  if (image)
+  if (image) {
     doc::clear_image(image.get(), image->maskColor());
+    image->incrementVersion();
+  }
   rehash();
 }
 
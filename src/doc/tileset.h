@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2019-2023  Igara Studio S.A.
+// Copyright (c) 2019-2025  Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -119,6 +119,12 @@ public:
   // before calling this function.
   bool findTileIndex(const ImageRef& tileImage, tile_index& ti);
 
+  // Creates the hash table used by findTileIndex() (if it's not
+  // already created). After this, findTileIndex() can be called from
+  // several threads at the same time while the tileset is not
+  // modified.
+  void prepareHashTable();
+
   // Must be called when a tile image was modified externally, so
   // the hash elements are re-calculated for that specific tile.
   void notifyTileContentChange(const tile_index ti);
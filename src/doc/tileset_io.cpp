@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -27,19 +27,33 @@ namespace doc {
 using namespace base::serialization;
 using namespace base::serialization::little_endian;
 
-bool write_tileset(std::ostream& os, const Tileset* tileset, CancelIO* cancel)
+bool write_tileset(std::ostream& os,
+                   const Tileset* tileset,
+                   CancelIO* cancel,
+                   const ImageCodec codec,
+                   const int compressionLevel)
 {
-  write32(os, tileset->id());
-  write32(os, tileset->size());
-  write_grid(os, tileset->grid());
+  write_tileset_header(os, tileset);
 
   for (tile_index ti = 0; ti < tileset->size(); ++ti) {
     if (cancel && cancel->isCanceled())
       return false;
 
-    write_image(os, tileset->get(ti).get(), cancel);
+    write_image(os, tileset->get(ti).get(), cancel, codec, compressionLevel);
   }
 
+  return write_tileset_footer(os, tileset, cancel);
+}
+
+void write_tileset_header(std::ostream& os, const Tileset* tileset)
+{
+  write32(os, tileset->id());
+  write32(os, tileset->size());
+  write_grid(os, tileset->grid());
+}
+
+bool write_tileset_footer(std::ostream& os, const Tileset* tileset, CancelIO* cancel)
+{
   write8(os, uint8_t(TilesetSerialFormat::LastVer));
   write_user_data(os, tileset->userData());
   write_string(os, tileset->name());
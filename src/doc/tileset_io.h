@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (C) 2019-2024  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -9,6 +9,7 @@
 #pragma once
 
 #include "base/ints.h"
+#include "doc/image_io.h"
 #include "doc/serial_format.h"
 
 #include <iosfwd>
@@ -38,7 +39,19 @@ class CancelIO;
 class Sprite;
 class Tileset;
 
-bool write_tileset(std::ostream& os, const Tileset* tileset, CancelIO* cancel = nullptr);
+// The codec and compressionLevel are used to save the tile images
+// (see write_image()).
+bool write_tileset(std::ostream& os,
+                   const Tileset* tileset,
+                   CancelIO* cancel = nullptr,
+                   ImageCodec codec = ImageCodec::Zlib,
+                   int compressionLevel = -1);
+
+// Writes the fields of the tileset that go before/after the tile
+// images in write_tileset(), so the tile images can be written later
+// with write_image() (e.g. from copies of the tiles).
+void write_tileset_header(std::ostream& os, const Tileset* tileset);
+bool write_tileset_footer(std::ostream& os, const Tileset* tileset, CancelIO* cancel = nullptr);
 
 Tileset* read_tileset(std::istream& is,
                       Sprite* sprite,
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 // Copyright (C) 2001-2015  David Capello
 //
 // This program is distributed under the terms of
@@ -28,6 +28,7 @@ public:
   void applyToRgba(FilterManager* filterMgr);
   void applyToGrayscale(FilterManager* filterMgr);
   void applyToIndexed(FilterManager* filterMgr);
+  bool canApplyToRowsInParallel() const { return true; }
 
 private:
   void generateMap();
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This program is distributed under the terms of
@@ -19,6 +19,11 @@
 #include "filters/filter_manager.h"
 #include "filters/neighboring_pixels.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <numeric>
+#include <vector>
+
 namespace filters {
 
 using namespace doc;
@@ -114,6 +119,262 @@ struct GetPixelsDelegateIndexed : public GetPixelsDelegate {
   }
 };
 
+// Returns true if the matrix can be expressed as the product of a
+// column vector and a row vector (value(x, y) = col[y] * row[x]).
+bool get_separable_weights(const ConvolutionMatrix& matrix,
+                           std::vector<int>& row,
+                           std::vector<int>& col)
+{
+  const int w = matrix.getWidth();
+  const int h = matrix.getHeight();
+
+  // Find the first row with a non-zero value
+  int y0 = 0;
+  int x0 = -1;
+  for (; y0 < h && x0 < 0; ++y0) {
+    for (int x = 0; x < w; ++x) {
+      if (matrix.value(x, y0) != 0) {
+        x0 = x;
+        break;
+      }
+    }
+  }
+  if (x0 < 0)
+    return false;
+  --y0;
+
+  // The row vector is that row divided by the GCD of its values, so
+  // the values of the column vector are integers.
+  int gcd = 0;
+  for (int x = 0; x < w; ++x)
+    gcd = std::gcd(gcd, matrix.value(x, y0));
+
+  row.resize(w);
+  col.resize(h);
+  for (int x = 0; x < w; ++x)
+    row[x] = matrix.value(x, y0) / gcd;
+  for (int y = 0; y < h; ++y) {
+    if (matrix.value(x0, y) % row[x0] != 0)
+      return false;
+    col[y] = matrix.value(x0, y) / row[x0];
+  }
+
+  for (int y = 0; y < h; ++y)
+    for (int x = 0; x < w; ++x)
+      if (matrix.value(x, y) != col[y] * row[x])
+        return false;
+
+  return true;
+}
+
+// Sums of a separable convolution for RGBA images: each pixel
+// contributes to r, g, b, a sums (only if it's not transparent), and
+// its weight is accumulated in the last sum if it's transparent (to
+// adjust the divisor, like GetPixelsDelegateRgba does).
+struct SeparableRgba {
+  using Traits = RgbTraits;
+  static constexpr int kSums = 5;
+
+  static void accumulate(const uint32_t* src,
+                         const int n,
+                         const int weight,
+                         int* sums,
+                         const int stride)
+  {
+    int* r = sums;
+    int* g = sums + stride;
+    int* b = sums + 2 * stride;
+    int* a = sums + 3 * stride;
+    int* t = sums + 4 * stride;
+
+    // Simple loop without branches so it can be vectorized
+    for (int i = 0; i < n; ++i) {
+      const uint32_t c = src[i];
+      const int alpha = rgba_geta(c);
+      const int w = (alpha ? weight : 0);
+      r[i] += w * int(rgba_getr(c));
+      g[i] += w * int(rgba_getg(c));
+      b[i] += w * int(rgba_getb(c));
+      a[i] += w * alpha;
+      t[i] += weight - w;
+    }
+  }
+
+  static uint32_t makeColor(const uint32_t color,
+                            const int* sums,
+                            const ConvolutionMatrix* matrix,
+                            const Target target)
+  {
+    const int div = matrix->getDiv() - sums[4];
+    if (div == 0)
+      return color;
+
+    const int bias = matrix->getBias();
+    return rgba((target & TARGET_RED_CHANNEL) ? std::clamp(sums[0] / div + bias, 0, 255) :
+                                                rgba_getr(color),
+                (target & TARGET_GREEN_CHANNEL) ? std::clamp(sums[1] / div + bias, 0, 255) :
+                                                  rgba_getg(color),
+                (target & TARGET_BLUE_CHANNEL) ? std::clamp(sums[2] / div + bias, 0, 255) :
+                                                 rgba_getb(color),
+                (target & TARGET_ALPHA_CHANNEL) ?
+                  std::clamp(sums[3] / matrix->getDiv() + bias, 0, 255) :
+                  rgba_geta(color));
+  }
+};
+
+struct SeparableGrayscale {
+  using Traits = GrayscaleTraits;
+  static constexpr int kSums = 3;
+
+  static void accumulate(const uint16_t* src,
+                         const int n,
+                         const int weight,
+                         int* sums,
+                         const int stride)
+  {
+    int* v = sums;
+    int* a = sums + stride;
+    int* t = sums + 2 * stride;
+
+    for (int i = 0; i < n; ++i) {
+      const uint16_t c = src[i];
+      const int alpha = graya_geta(c);
+      const int w = (alpha ? weight : 0);
+      v[i] += w * int(graya_getv(c));
+      a[i] += w * alpha;
+      t[i] += weight - w;
+    }
+  }
+
+  static uint16_t makeColor(const uint16_t color,
+                            const int* sums,
+                            const ConvolutionMatrix* matrix,
+                            const Target target)
+  {
+    const int div = matrix->getDiv() - sums[2];
+    if (div == 0)
+      return color;
+
+    const int bias = matrix->getBias();
+    return graya((target & TARGET_GRAY_CHANNEL) ? std::clamp(sums[0] / div + bias, 0, 255) :
+                                                  graya_getv(color),
+                 (target & TARGET_ALPHA_CHANNEL) ?
+                   std::clamp(sums[1] / matrix->getDiv() + bias, 0, 255) :
+                   graya_geta(color));
+  }
+};
+
+// Applies a separable matrix to the current row in two passes: first
+// a vertical pass (weighted sum of the rows of the window for each
+// source column), and then a horizontal pass over those sums. It
+// costs O(width+height) per pixel instead of O(width*height), and as
+// all the math is done with integers, the result is exactly the same
+// as the 2D version.
+template<typename Separable>
+void apply_separable_to_row(FilterManager* filterMgr,
+                            const ConvolutionMatrix* matrix,
+                            const std::vector<int>& rowWeights,
+                            const std::vector<int>& colWeights,
+                            const TiledMode tiledMode)
+{
+  using Traits = typename Separable::Traits;
+  using pixel_t = typename Traits::pixel_t;
+  constexpr int kSums = Separable::kSums;
+
+  const Image* src = filterMgr->getSourceImage();
+  const Target target = filterMgr->getTarget();
+  auto dst_address = (pixel_t*)filterMgr->getDestinationAddress();
+  const int x1 = filterMgr->x();
+  const int n = filterMgr->getWidth();
+  const int y = filterMgr->y();
+  auto& token = filterMgr->taskToken();
+
+  const int kw = matrix->getWidth();
+  const int kh = matrix->getHeight();
+  const int cx = matrix->getCenterX();
+  const int srcW = src->width();
+
+  // Range of source columns that can be read for this row
+  int lo, hi;
+  if (int(tiledMode) & int(TiledMode::X_AXIS)) {
+    lo = 0;
+    hi = srcW - 1;
+  }
+  else {
+    lo = std::clamp(x1 - cx, 0, srcW - 1);
+    hi = std::clamp(x1 + n - 1 - cx + kw - 1, 0, srcW - 1);
+  }
+  const int ncols = hi - lo + 1;
+
+  // Vertical pass
+  std::vector<int> rows(kh);
+  get_neighboring_rows(src, y, kh, matrix->getCenterY(), tiledMode, rows);
+
+  std::vector<int> vsums(kSums * ncols, 0);
+  for (int dy = 0; dy < kh; ++dy) {
+    if (colWeights[dy] != 0) {
+      Separable::accumulate((const pixel_t*)src->getPixelAddress(lo, rows[dy]),
+                            ncols,
+                            colWeights[dy],
+                            vsums.data(),
+                            ncols);
+    }
+  }
+
+  // Horizontal pass. Pixels where the whole window is inside the
+  // image read contiguous columns, so we can process all of them
+  // together (vectorizable loop).
+  std::vector<int> hsums(kSums * n, 0);
+  const int ia = std::clamp(cx - x1, 0, n);
+  const int ib = std::clamp(srcW - kw + cx - x1 + 1, ia, n);
+  if (ia < ib) {
+    for (int dx = 0; dx < kw; ++dx) {
+      const int weight = rowWeights[dx];
+      if (weight == 0)
+        continue;
+
+      for (int k = 0; k < kSums; ++k) {
+        const int* v = &vsums[k * ncols + (x1 + ia - cx + dx - lo)];
+        int* h = &hsums[k * n + ia];
+        for (int i = 0; i < ib - ia; ++i)
+          h[i] += weight * v[i];
+      }
+    }
+  }
+
+  // Pixels near the borders (or where the window wraps around in
+  // tiled mode) use the same columns as get_neighboring_pixels().
+  std::vector<int> cols(kw);
+  for (int i = 0; i < n; ++i) {
+    if (i == ia && ia < ib)
+      i = ib;
+    if (i >= n)
+      break;
+
+    get_neighboring_columns(src, x1 + i, kw, cx, tiledMode, cols);
+    for (int dx = 0; dx < kw; ++dx) {
+      const int weight = rowWeights[dx];
+      const int col = cols[dx] - lo;
+      for (int k = 0; k < kSums; ++k)
+        hsums[k * n + i] += weight * vsums[k * ncols + col];
+    }
+  }
+
+  for (int i = 0; i < n && !token.canceled(); ++i, ++dst_address) {
+    if (filterMgr->skipPixel())
+      continue;
+
+    int sums[kSums];
+    for (int k = 0; k < kSums; ++k)
+      sums[k] = hsums[k * n + i];
+
+    *dst_address = Separable::makeColor(get_pixel_fast<Traits>(src, x1 + i, y),
+                                        sums,
+                                        matrix,
+                                        target);
+  }
+}
+
 } // namespace
 
 ConvolutionMatrixFilter::ConvolutionMatrixFilter() : m_matrix(NULL), m_tiledMode(TiledMode::NONE)
@@ -123,6 +384,11 @@ ConvolutionMatrixFilter::ConvolutionMatrixFilter() : m_matrix(NULL), m_tiledMode
 void ConvolutionMatrixFilter::setMatrix(const std::shared_ptr<ConvolutionMatrix>& matrix)
 {
   m_matrix = matrix;
+
+  if (!m_matrix || !get_separable_weights(*m_matrix, m_rowWeights, m_colWeights)) {
+    m_rowWeights.clear();
+    m_colWeights.clear();
+  }
 }
 
 void ConvolutionMatrixFilter::setTiledMode(TiledMode tiledMode)
@@ -135,11 +401,26 @@ const char* ConvolutionMatrixFilter::getName()
   return "Convolution Matrix";
 }
 
+bool ConvolutionMatrixFilter::isSeparable() const
+{
+  return (m_matrix && !m_rowWeights.empty() && int(m_rowWeights.size()) == m_matrix->getWidth() &&
+          int(m_colWeights.size()) == m_matrix->getHeight());
+}
+
 void ConvolutionMatrixFilter::applyToRgba(FilterManager* filterMgr)
 {
   if (!m_matrix)
     return;
 
+  if (isSeparable()) {
+    apply_separable_to_row<SeparableRgba>(filterMgr,
+                                          m_matrix.get(),
+                                          m_rowWeights,
+                                          m_colWeights,
+                                          m_tiledMode);
+    return;
+  }
+
   const Image* src = filterMgr->getSourceImage();
   uint32_t color;
   GetPixelsDelegateRgba delegate;
@@ -201,6 +482,15 @@ void ConvolutionMatrixFilter::applyToGrayscale(FilterManager* filterMgr)
   if (!m_matrix)
     return;
 
+  if (isSeparable()) {
+    apply_separable_to_row<SeparableGrayscale>(filterMgr,
+                                               m_matrix.get(),
+                                               m_rowWeights,
+                                               m_colWeights,
+                                               m_tiledMode);
+    return;
+  }
+
   const Image* src = filterMgr->getSourceImage();
   uint16_t color;
   GetPixelsDelegateGrayscale delegate;
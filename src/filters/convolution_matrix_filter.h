@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This program is distributed under the terms of
@@ -13,6 +13,7 @@
 #include "filters/tiled_mode.h"
 
 #include <memory>
+#include <vector>
 
 namespace filters {
 
@@ -33,10 +34,20 @@ public:
   void applyToRgba(FilterManager* filterMgr);
   void applyToGrayscale(FilterManager* filterMgr);
   void applyToIndexed(FilterManager* filterMgr);
+  bool canApplyToRowsInParallel() const { return true; }
 
 private:
+  bool isSeparable() const;
+
   std::shared_ptr<ConvolutionMatrix> m_matrix;
   TiledMode m_tiledMode;
+
+  // If the matrix is separable, i.e. value(x, y) = m_colWeights[y] *
+  // m_rowWeights[x] (e.g. box or gaussian blurs), we apply it as two
+  // 1D passes. These vectors are empty if the matrix is not
+  // separable.
+  std::vector<int> m_rowWeights;
+  std::vector<int> m_colWeights;
 };
 
 } // namespace filters
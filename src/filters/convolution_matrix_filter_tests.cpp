@@ -0,0 +1,237 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "doc/image.h"
+#include "doc/image_ref.h"
+#include "doc/primitives.h"
+#include "filters/convolution_matrix.h"
+#include "filters/convolution_matrix_filter.h"
+#include "filters/neighboring_pixels.h"
+#include "filters/test_filter_manager.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+using namespace doc;
+using namespace filters;
+
+namespace {
+
+// Old implementation of the convolution matrix filter, which
+// iterates all the matrix values for each pixel.
+void apply_matrix_2d(const Image* src,
+                     Image* dst,
+                     const gfx::Rect& bounds,
+                     const ConvolutionMatrix& matrix,
+                     const TiledMode tiledMode,
+                     const Target target)
+{
+  const int bias = matrix.getBias();
+  auto channel = [bias](const int value, const int div) {
+    return std::clamp(value / div + bias, 0, 255);
+  };
+
+  for (int y = bounds.y; y < bounds.y2(); ++y) {
+    for (int x = bounds.x; x < bounds.x2(); ++x) {
+      const color_t color = get_pixel(src, x, y);
+      const int* matrixData = &matrix.value(0, 0);
+      int div = matrix.getDiv();
+      int r = 0, g = 0, b = 0, a = 0;
+
+      if (src->pixelFormat() == IMAGE_RGB) {
+        auto delegate = [&](const RgbTraits::pixel_t c) {
+          if (*matrixData) {
+            if (rgba_geta(c) == 0)
+              div -= *matrixData;
+            else {
+              r += rgba_getr(c) * (*matrixData);
+              g += rgba_getg(c) * (*matrixData);
+              b += rgba_getb(c) * (*matrixData);
+              a += rgba_geta(c) * (*matrixData);
+            }
+          }
+          ++matrixData;
+        };
+        get_neighboring_pixels<RgbTraits>(src,
+                                          x,
+                                          y,
+                                          matrix.getWidth(),
+                                          matrix.getHeight(),
+                                          matrix.getCenterX(),
+                                          matrix.getCenterY(),
+                                          tiledMode,
+                                          delegate);
+        if (div == 0)
+          continue;
+
+        put_pixel(dst,
+                  x,
+                  y,
+                  rgba(target & TARGET_RED_CHANNEL ? channel(r, div) : rgba_getr(color),
+                       target & TARGET_GREEN_CHANNEL ? channel(g, div) : rgba_getg(color),
+                       target & TARGET_BLUE_CHANNEL ? channel(b, div) : rgba_getb(color),
+                       target & TARGET_ALPHA_CHANNEL ? channel(a, matrix.getDiv()) :
+                                                       rgba_geta(color)));
+      }
+      else {
+        auto delegate = [&](const GrayscaleTraits::pixel_t c) {
+          if (*matrixData) {
+            if (graya_geta(c) == 0)
+              div -= *matrixData;
+            else {
+              r += graya_getv(c) * (*matrixData);
+              a += graya_geta(c) * (*matrixData);
+            }
+          }
+          ++matrixData;
+        };
+        get_neighboring_pixels<GrayscaleTraits>(src,
+                                                x,
+                                                y,
+                                                matrix.getWidth(),
+                                                matrix.getHeight(),
+                                                matrix.getCenterX(),
+                                                matrix.getCenterY(),
+                                                tiledMode,
+                                                delegate);
+        if (div == 0)
+          continue;
+
+        put_pixel(dst,
+                  x,
+                  y,
+                  graya(target & TARGET_GRAY_CHANNEL ? channel(r, div) : graya_getv(color),
+                        target & TARGET_ALPHA_CHANNEL ? channel(a, matrix.getDiv()) :
+                                                        graya_geta(color)));
+      }
+    }
+  }
+}
+
+ImageRef make_random_image(const PixelFormat pf, const int w, const int h)
+{
+  ImageRef image(Image::create(pf, w, h));
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      const int alpha = ((std::rand() % 4) == 0 ? 0 : std::rand() % 256);
+      put_pixel(image.get(),
+                x,
+                y,
+                pf == IMAGE_RGB ?
+                  rgba(std::rand() % 256, std::rand() % 256, std::rand() % 256, alpha) :
+                  graya(std::rand() % 256, alpha));
+    }
+  }
+  return image;
+}
+
+// Creates a matrix with value(x, y) = colWeights[y] * rowWeights[x]
+std::shared_ptr<ConvolutionMatrix> make_separable_matrix(const std::vector<int>& rowWeights,
+                                                         const std::vector<int>& colWeights,
+                                                         const int cx,
+                                                         const int cy,
+                                                         const int div,
+                                                         const int bias)
+{
+  auto matrix = std::make_shared<ConvolutionMatrix>(int(rowWeights.size()),
+                                                    int(colWeights.size()));
+  for (int y = 0; y < matrix->getHeight(); ++y)
+    for (int x = 0; x < matrix->getWidth(); ++x)
+      matrix->value(x, y) = colWeights[y] * rowWeights[x];
+  matrix->setCenterX(cx);
+  matrix->setCenterY(cy);
+  matrix->setDiv(div);
+  matrix->setBias(bias);
+  return matrix;
+}
+
+void check_matrix(const Image* src,
+                  const gfx::Rect& bounds,
+                  const std::shared_ptr<ConvolutionMatrix>& matrix,
+                  const TiledMode tiledMode,
+                  const Target target)
+{
+  ImageRef expected(Image::createCopy(src));
+  apply_matrix_2d(src, expected.get(), bounds, *matrix, tiledMode, target);
+
+  ConvolutionMatrixFilter filter;
+  filter.setMatrix(matrix);
+  filter.setTiledMode(tiledMode);
+
+  ImageRef result(Image::createCopy(src));
+  TestFilterManager filterMgr(src, result.get(), target);
+  filterMgr.setBounds(bounds);
+  filterMgr.applyFilter(&filter);
+
+  EXPECT_TRUE(is_same_image(expected.get(), result.get()))
+    << "matrix=" << matrix->getWidth() << "x" << matrix->getHeight()
+    << " tiledMode=" << int(tiledMode) << " target=" << target << " bounds=" << bounds.x << ","
+    << bounds.y << "," << bounds.w << "," << bounds.h;
+}
+
+void check_matrices(const Image* src, const gfx::Rect& subBounds, const Target target)
+{
+  std::vector<std::shared_ptr<ConvolutionMatrix>> matrices = {
+    // Gaussian blur 3x3
+    make_separable_matrix({ 1, 2, 1 }, { 1, 2, 1 }, 1, 1, 16, 0),
+    // Box blur 5x3 with an off-center pixel and bias
+    make_separable_matrix({ 1, 1, 1, 1, 1 }, { 1, 1, 1 }, 1, 2, 15, 8),
+    // Negative weights (edge detection)
+    make_separable_matrix({ -1, 0, 1 }, { 1, 2, 1 }, 1, 1, 1, 128),
+    // Matrix bigger than the image
+    make_separable_matrix(std::vector<int>(31, 1), { 1, 3, 1 }, 15, 1, 155, 0),
+    // 1D matrices
+    make_separable_matrix({ 1, 4, 6, 4, 1 }, { 1 }, 2, 0, 16, 0),
+    make_separable_matrix({ 1 }, { 1, 4, 6, 4, 1 }, 0, 4, 16, 0),
+  };
+
+  // Non-separable matrix (sharpen)
+  auto sharpen = std::make_shared<ConvolutionMatrix>(3, 3);
+  const int sharpenValues[] = { 0, -1, 0, -1, 5, -1, 0, -1, 0 };
+  for (int i = 0; i < 9; ++i)
+    sharpen->value(i % 3, i / 3) = sharpenValues[i];
+  sharpen->setCenterX(1);
+  sharpen->setCenterY(1);
+  sharpen->setDiv(1);
+  matrices.push_back(sharpen);
+
+  for (const auto& matrix : matrices) {
+    for (const TiledMode tiledMode :
+         { TiledMode::NONE, TiledMode::X_AXIS, TiledMode::Y_AXIS, TiledMode::BOTH }) {
+      check_matrix(src, src->bounds(), matrix, tiledMode, TARGET_ALL_CHANNELS);
+      check_matrix(src, subBounds, matrix, tiledMode, target);
+    }
+  }
+}
+
+} // anonymous namespace
+
+TEST(ConvolutionMatrixFilter, Rgba)
+{
+  std::srand(1);
+  ImageRef src = make_random_image(IMAGE_RGB, 25, 18);
+  check_matrices(src.get(),
+                 gfx::Rect(2, 3, 15, 11),
+                 TARGET_GREEN_CHANNEL | TARGET_BLUE_CHANNEL | TARGET_ALPHA_CHANNEL);
+}
+
+TEST(ConvolutionMatrixFilter, Grayscale)
+{
+  std::srand(2);
+  ImageRef src = make_random_image(IMAGE_GRAYSCALE, 17, 22);
+  check_matrices(src.get(), gfx::Rect(0, 10, 17, 12), TARGET_GRAY_CHANNEL);
+}
+
+TEST(ConvolutionMatrixFilter, SmallImage)
+{
+  std::srand(3);
+  ImageRef src = make_random_image(IMAGE_RGB, 2, 3);
+  check_matrices(src.get(), gfx::Rect(1, 1, 1, 2), TARGET_RED_CHANNEL);
+}
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019  Igara Studio S.A.
+// Copyright (C) 2019-2025  Igara Studio S.A.
 // Copyright (C) 2001-2015  David Capello
 //
 // This program is distributed under the terms of
@@ -44,6 +44,13 @@ public:
 
   // Applies the filter to the color palette.
   virtual void applyToPalette(FilterManager* filterMgr) {}
+
+  // Returns true if applyToRgba/Grayscale/Indexed() can be called
+  // from several threads at the same time, each one with its own
+  // FilterManager to process a different row. In that case the
+  // filter cannot modify its own state in those functions, and
+  // cannot depend on the order in which the rows are processed.
+  virtual bool canApplyToRowsInParallel() const { return false; }
 };
 
 // Filter that support applying it only to palette colors.
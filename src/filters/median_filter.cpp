@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2020  Igara Studio S.A.
+// Copyright (C) 2020-2025  Igara Studio S.A.
 // Copyright (C) 2001-2017  David Capello
 //
 // This program is distributed under the terms of
@@ -21,86 +21,272 @@
 #include "filters/tiled_mode.h"
 
 #include <algorithm>
+#include <memory>
+#include <vector>
 
 namespace filters {
 
 using namespace doc;
 
 namespace {
-struct GetPixelsDelegateRgba {
-  std::vector<std::vector<uint8_t>>& channel;
-  int c;
 
-  GetPixelsDelegateRgba(std::vector<std::vector<uint8_t>>& channel) : channel(channel) {}
+// Histograms of the values of each channel in the current window of
+// pixels. Each histogram has 256 bins and 16 coarse bins (sum of 16
+// consecutive bins) to find the median quickly.
+class Histograms {
+public:
+  static constexpr int kMaxChannels = 4;
 
-  void reset() { c = 0; }
+  void clear()
+  {
+    std::fill(&m_fine[0][0], &m_fine[0][0] + sizeof(m_fine) / sizeof(int), 0);
+    std::fill(&m_coarse[0][0], &m_coarse[0][0] + sizeof(m_coarse) / sizeof(int), 0);
+  }
+
+  void add(const int ch, const int v)
+  {
+    ++m_fine[ch][v];
+    ++m_coarse[ch][v >> 4];
+  }
 
-  void operator()(RgbTraits::pixel_t color)
+  void remove(const int ch, const int v)
   {
-    channel[0][c] = rgba_getr(color);
-    channel[1][c] = rgba_getg(color);
-    channel[2][c] = rgba_getb(color);
-    channel[3][c] = rgba_geta(color);
-    c++;
+    --m_fine[ch][v];
+    --m_coarse[ch][v >> 4];
   }
+
+  // Returns the n-th value (starting from 0) of the sorted list of
+  // values in the given channel.
+  int nth(const int ch, const int n) const
+  {
+    int sum = 0;
+    int i = 0;
+    for (; i < 15 && sum + m_coarse[ch][i] <= n; ++i)
+      sum += m_coarse[ch][i];
+
+    const int* fine = &m_fine[ch][i << 4];
+    int j = 0;
+    for (; j < 15 && sum + fine[j] <= n; ++j)
+      sum += fine[j];
+
+    return (i << 4) + j;
+  }
+
+private:
+  int m_fine[kMaxChannels][256];
+  int m_coarse[kMaxChannels][16];
 };
 
-struct GetPixelsDelegateGrayscale {
-  std::vector<std::vector<uint8_t>>& channel;
-  int c;
+struct MedianDelegateRgba {
+  using Traits = RgbTraits;
+  bool active[Histograms::kMaxChannels];
 
-  GetPixelsDelegateGrayscale(std::vector<std::vector<uint8_t>>& channel) : channel(channel) {}
+  MedianDelegateRgba(Target target)
+    : active{ (target & TARGET_RED_CHANNEL) != 0,
+              (target & TARGET_GREEN_CHANNEL) != 0,
+              (target & TARGET_BLUE_CHANNEL) != 0,
+              (target & TARGET_ALPHA_CHANNEL) != 0 }
+  {
+  }
 
-  void reset() { c = 0; }
+  void getChannels(RgbTraits::pixel_t color, int* v) const
+  {
+    v[0] = rgba_getr(color);
+    v[1] = rgba_getg(color);
+    v[2] = rgba_getb(color);
+    v[3] = rgba_geta(color);
+  }
 
-  void operator()(GrayscaleTraits::pixel_t color)
+  RgbTraits::pixel_t makeColor(RgbTraits::pixel_t color, const int* v) const
   {
-    channel[0][c] = graya_getv(color);
-    channel[1][c] = graya_geta(color);
-    c++;
+    return rgba(active[0] ? v[0] : rgba_getr(color),
+                active[1] ? v[1] : rgba_getg(color),
+                active[2] ? v[2] : rgba_getb(color),
+                active[3] ? v[3] : rgba_geta(color));
   }
 };
 
-struct GetPixelsDelegateIndexed {
+struct MedianDelegateGrayscale {
+  using Traits = GrayscaleTraits;
+  bool active[Histograms::kMaxChannels];
+
+  MedianDelegateGrayscale(Target target)
+    : active{ (target & TARGET_GRAY_CHANNEL) != 0, (target & TARGET_ALPHA_CHANNEL) != 0, false, false }
+  {
+  }
+
+  void getChannels(GrayscaleTraits::pixel_t color, int* v) const
+  {
+    v[0] = graya_getv(color);
+    v[1] = graya_geta(color);
+  }
+
+  GrayscaleTraits::pixel_t makeColor(GrayscaleTraits::pixel_t color, const int* v) const
+  {
+    return graya(active[0] ? v[0] : graya_getv(color), active[1] ? v[1] : graya_geta(color));
+  }
+};
+
+struct MedianDelegateIndexed {
+  using Traits = IndexedTraits;
   const Palette* pal;
-  std::vector<std::vector<uint8_t>>& channel;
-  Target target;
-  int c;
+  const RgbMap* rgbmap;
+  bool indexChannel;
+  bool active[Histograms::kMaxChannels];
 
-  GetPixelsDelegateIndexed(const Palette* pal,
-                           std::vector<std::vector<uint8_t>>& channel,
-                           Target target)
+  MedianDelegateIndexed(const Palette* pal, const RgbMap* rgbmap, Target target)
     : pal(pal)
-    , channel(channel)
-    , target(target)
+    , rgbmap(rgbmap)
+    , indexChannel((target & TARGET_INDEX_CHANNEL) != 0)
+    , active{ indexChannel || (target & TARGET_RED_CHANNEL) != 0,
+              !indexChannel && (target & TARGET_GREEN_CHANNEL) != 0,
+              !indexChannel && (target & TARGET_BLUE_CHANNEL) != 0,
+              !indexChannel && (target & TARGET_ALPHA_CHANNEL) != 0 }
   {
   }
 
-  void reset() { c = 0; }
-
-  void operator()(IndexedTraits::pixel_t color)
+  void getChannels(IndexedTraits::pixel_t color, int* v) const
   {
-    if (target & TARGET_INDEX_CHANNEL) {
-      channel[0][c] = color;
+    if (indexChannel) {
+      v[0] = color;
     }
     else {
-      color_t rgb = pal->getEntry(color);
-      channel[0][c] = rgba_getr(rgb);
-      channel[1][c] = rgba_getg(rgb);
-      channel[2][c] = rgba_getb(rgb);
-      channel[3][c] = rgba_geta(rgb);
+      const color_t rgb = pal->getEntry(color);
+      v[0] = rgba_getr(rgb);
+      v[1] = rgba_getg(rgb);
+      v[2] = rgba_getb(rgb);
+      v[3] = rgba_geta(rgb);
     }
-    c++;
+  }
+
+  IndexedTraits::pixel_t makeColor(IndexedTraits::pixel_t color, const int* v) const
+  {
+    if (indexChannel)
+      return v[0];
+
+    const color_t rgb = pal->getEntry(color);
+    return rgbmap->mapColor(active[0] ? v[0] : rgba_getr(rgb),
+                            active[1] ? v[1] : untargetedGreen(rgb),
+                            active[2] ? v[2] : rgba_getb(rgb),
+                            active[3] ? v[3] : rgba_geta(rgb));
+  }
+
+  // The sorting implementation of this filter took the untargeted
+  // green channel from pal->getEntry(rgb), i.e. it used the RGBA
+  // value as a palette index (so it's 0 for almost all colors). We
+  // keep the same result so the filter output doesn't change.
+  int untargetedGreen(const color_t rgb) const
+  {
+    const int i = int(rgb);
+    return (i >= 0 && i < pal->size() ? rgba_getg(pal->getEntry(i)) : 0);
   }
 };
-}; // namespace
+
+// Applies the median filter to the current row of the FilterManager
+// using a sliding histogram (Huang's algorithm): when we move to the
+// next pixel, the values of the column that leaves the window are
+// removed from the histograms, and the values of the new column are
+// added. So each pixel costs O(height) instead of sorting
+// width*height values.
+//
+// The window contains exactly the same pixels that
+// get_neighboring_pixels() would visit (including the tiled mode
+// handling), so the result is the same.
+template<typename Delegate>
+void apply_median_to_row(FilterManager* filterMgr,
+                         const int width,
+                         const int height,
+                         const TiledMode tiledMode,
+                         const Delegate& delegate)
+{
+  using Traits = typename Delegate::Traits;
+  using pixel_t = typename Traits::pixel_t;
+
+  const Image* src = filterMgr->getSourceImage();
+  auto dst_address = (pixel_t*)filterMgr->getDestinationAddress();
+  int x = filterMgr->x();
+  const int x2 = x + filterMgr->getWidth();
+  const int y = filterMgr->y();
+  const int centerX = width / 2;
+  const int n = width * height / 2;
+  auto& token = filterMgr->taskToken();
+
+  std::vector<int> rows(height);
+  get_neighboring_rows(src, y, height, height / 2, tiledMode, rows);
+
+  std::vector<const pixel_t*> rowAddresses(height);
+  for (int dy = 0; dy < height; ++dy)
+    rowAddresses[dy] = (const pixel_t*)src->getPixelAddress(0, rows[dy]);
+
+  auto addColumn = [&](Histograms& hist, const int col, const bool add) {
+    int v[Histograms::kMaxChannels];
+    for (const pixel_t* address : rowAddresses) {
+      delegate.getChannels(address[col], v);
+      for (int ch = 0; ch < Histograms::kMaxChannels; ++ch) {
+        if (delegate.active[ch]) {
+          if (add)
+            hist.add(ch, v[ch]);
+          else
+            hist.remove(ch, v[ch]);
+        }
+      }
+    }
+  };
+
+  auto hist = std::make_unique<Histograms>();
+  std::vector<int> cols(width);
+  std::vector<int> nextCols(width);
+  int histX = 0;
+  bool validHist = false;
+
+  for (; x < x2 && !token.canceled(); ++x, ++dst_address) {
+    if (filterMgr->skipPixel())
+      continue;
+
+    // Slide the current histogram to the new position
+    if (validHist && x - histX < width) {
+      for (; histX < x; ++histX) {
+        get_neighboring_columns(src, histX + 1, width, centerX, tiledMode, nextCols);
+
+        if (std::equal(cols.begin() + 1, cols.end(), nextCols.begin())) {
+          addColumn(*hist, cols[0], false);
+          addColumn(*hist, nextCols[width - 1], true);
+        }
+        // The window doesn't move as a whole (e.g. it's wider than
+        // the image), we have to re-create the histogram.
+        else {
+          hist->clear();
+          for (int col : nextCols)
+            addColumn(*hist, col, true);
+        }
+        std::swap(cols, nextCols);
+      }
+    }
+    // Create the histogram from scratch
+    else {
+      get_neighboring_columns(src, x, width, centerX, tiledMode, cols);
+      hist->clear();
+      for (int col : cols)
+        addColumn(*hist, col, true);
+      histX = x;
+      validHist = true;
+    }
+
+    int v[Histograms::kMaxChannels];
+    for (int ch = 0; ch < Histograms::kMaxChannels; ++ch) {
+      if (delegate.active[ch])
+        v[ch] = hist->nth(ch, n);
+    }
+    *dst_address = delegate.makeColor(get_pixel_fast<Traits>(src, x, y), v);
+  }
+}
+
+} // anonymous namespace
 
 MedianFilter::MedianFilter()
   : m_tiledMode(TiledMode::NONE)
   , m_width(1)
   , m_height(1)
-  , m_ncolors(0)
-  , m_channel(4)
 {
 }
 
@@ -116,10 +302,6 @@ void MedianFilter::setSize(int width, int height)
 
   m_width = std::max(1, width);
   m_height = std::max(1, height);
-  m_ncolors = width * height;
-
-  for (int c = 0; c < 4; ++c)
-    m_channel[c].resize(m_ncolors);
 }
 
 const char* MedianFilter::getName()
@@ -129,159 +311,31 @@ const char* MedianFilter::getName()
 
 void MedianFilter::applyToRgba(FilterManager* filterMgr)
 {
-  const Image* src = filterMgr->getSourceImage();
-  int color, r, g, b, a;
-  GetPixelsDelegateRgba delegate(m_channel);
-
-  FILTER_LOOP_THROUGH_ROW_BEGIN(uint32_t)
-  {
-    delegate.reset();
-    get_neighboring_pixels<RgbTraits>(src,
-                                      x,
-                                      y,
-                                      m_width,
-                                      m_height,
-                                      m_width / 2,
-                                      m_height / 2,
-                                      m_tiledMode,
-                                      delegate);
-
-    color = get_pixel_fast<RgbTraits>(src, x, y);
-
-    if (target & TARGET_RED_CHANNEL) {
-      std::sort(m_channel[0].begin(), m_channel[0].end());
-      r = m_channel[0][m_ncolors / 2];
-    }
-    else
-      r = rgba_getr(color);
-
-    if (target & TARGET_GREEN_CHANNEL) {
-      std::sort(m_channel[1].begin(), m_channel[1].end());
-      g = m_channel[1][m_ncolors / 2];
-    }
-    else
-      g = rgba_getg(color);
-
-    if (target & TARGET_BLUE_CHANNEL) {
-      std::sort(m_channel[2].begin(), m_channel[2].end());
-      b = m_channel[2][m_ncolors / 2];
-    }
-    else
-      b = rgba_getb(color);
-
-    if (target & TARGET_ALPHA_CHANNEL) {
-      std::sort(m_channel[3].begin(), m_channel[3].end());
-      a = m_channel[3][m_ncolors / 2];
-    }
-    else
-      a = rgba_geta(color);
-
-    *dst_address = rgba(r, g, b, a);
-  }
-  FILTER_LOOP_THROUGH_ROW_END()
+  apply_median_to_row(filterMgr,
+                      m_width,
+                      m_height,
+                      m_tiledMode,
+                      MedianDelegateRgba(filterMgr->getTarget()));
 }
 
 void MedianFilter::applyToGrayscale(FilterManager* filterMgr)
 {
-  const Image* src = filterMgr->getSourceImage();
-  int color, k, a;
-  GetPixelsDelegateGrayscale delegate(m_channel);
-
-  FILTER_LOOP_THROUGH_ROW_BEGIN(uint16_t)
-  {
-    delegate.reset();
-    get_neighboring_pixels<GrayscaleTraits>(src,
-                                            x,
-                                            y,
-                                            m_width,
-                                            m_height,
-                                            m_width / 2,
-                                            m_height / 2,
-                                            m_tiledMode,
-                                            delegate);
-
-    color = get_pixel_fast<GrayscaleTraits>(src, x, y);
-
-    if (target & TARGET_GRAY_CHANNEL) {
-      std::sort(m_channel[0].begin(), m_channel[0].end());
-      k = m_channel[0][m_ncolors / 2];
-    }
-    else
-      k = graya_getv(color);
-
-    if (target & TARGET_ALPHA_CHANNEL) {
-      std::sort(m_channel[1].begin(), m_channel[1].end());
-      a = m_channel[1][m_ncolors / 2];
-    }
-    else
-      a = graya_geta(color);
-
-    *dst_address = graya(k, a);
-  }
-  FILTER_LOOP_THROUGH_ROW_END()
+  apply_median_to_row(filterMgr,
+                      m_width,
+                      m_height,
+                      m_tiledMode,
+                      MedianDelegateGrayscale(filterMgr->getTarget()));
 }
 
 void MedianFilter::applyToIndexed(FilterManager* filterMgr)
 {
-  const Image* src = filterMgr->getSourceImage();
   const Palette* pal = filterMgr->getIndexedData()->getPalette();
   const RgbMap* rgbmap = filterMgr->getIndexedData()->getRgbMap();
-  int color, r, g, b, a;
-  GetPixelsDelegateIndexed delegate(pal, m_channel, filterMgr->getTarget());
-
-  FILTER_LOOP_THROUGH_ROW_BEGIN(uint8_t)
-  {
-    delegate.reset();
-    get_neighboring_pixels<IndexedTraits>(src,
-                                          x,
-                                          y,
-                                          m_width,
-                                          m_height,
-                                          m_width / 2,
-                                          m_height / 2,
-                                          m_tiledMode,
-                                          delegate);
-
-    if (target & TARGET_INDEX_CHANNEL) {
-      std::sort(m_channel[0].begin(), m_channel[0].end());
-      *dst_address = m_channel[0][m_ncolors / 2];
-    }
-    else {
-      color = get_pixel_fast<IndexedTraits>(src, x, y);
-      color = pal->getEntry(color);
-
-      if (target & TARGET_RED_CHANNEL) {
-        std::sort(m_channel[0].begin(), m_channel[0].end());
-        r = m_channel[0][m_ncolors / 2];
-      }
-      else
-        r = rgba_getr(color);
-
-      if (target & TARGET_GREEN_CHANNEL) {
-        std::sort(m_channel[1].begin(), m_channel[1].end());
-        g = m_channel[1][m_ncolors / 2];
-      }
-      else
-        g = rgba_getg(pal->getEntry(color));
-
-      if (target & TARGET_BLUE_CHANNEL) {
-        std::sort(m_channel[2].begin(), m_channel[2].end());
-        b = m_channel[2][m_ncolors / 2];
-      }
-      else
-        b = rgba_getb(color);
-
-      if (target & TARGET_ALPHA_CHANNEL) {
-        std::sort(m_channel[3].begin(), m_channel[3].end());
-        a = m_channel[3][m_ncolors / 2];
-      }
-      else
-        a = rgba_geta(color);
-
-      *dst_address = rgbmap->mapColor(r, g, b, a);
-    }
-  }
-  FILTER_LOOP_THROUGH_ROW_END()
+  apply_median_to_row(filterMgr,
+                      m_width,
+                      m_height,
+                      m_tiledMode,
+                      MedianDelegateIndexed(pal, rgbmap, filterMgr->getTarget()));
 }
 
 } // namespace filters
@@ -0,0 +1,278 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "doc/image.h"
+#include "doc/image_ref.h"
+#include "doc/palette.h"
+#include "doc/primitives.h"
+#include "doc/rgbmap_rgb5a3.h"
+#include "filters/median_filter.h"
+#include "filters/neighboring_pixels.h"
+#include "filters/test_filter_manager.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+using namespace doc;
+using namespace filters;
+
+namespace {
+
+// Old implementation of the median filter, which sorts all the
+// neighboring values of each pixel.
+void apply_median_sorting(const Image* src,
+                          Image* dst,
+                          const gfx::Rect& bounds,
+                          const int w,
+                          const int h,
+                          const TiledMode tiledMode,
+                          const Target target,
+                          const Palette* pal,
+                          const RgbMap* rgbmap)
+{
+  const int n = w * h;
+  std::vector<std::vector<uint8_t>> channel(4, std::vector<uint8_t>(n));
+  auto median = [&channel, n](const int c) {
+    std::sort(channel[c].begin(), channel[c].end());
+    return int(channel[c][n / 2]);
+  };
+
+  for (int y = bounds.y; y < bounds.y2(); ++y) {
+    for (int x = bounds.x; x < bounds.x2(); ++x) {
+      int i = 0;
+      const color_t color = get_pixel(src, x, y);
+
+      switch (src->pixelFormat()) {
+        case IMAGE_RGB: {
+          auto delegate = [&](const RgbTraits::pixel_t c) {
+            channel[0][i] = rgba_getr(c);
+            channel[1][i] = rgba_getg(c);
+            channel[2][i] = rgba_getb(c);
+            channel[3][i] = rgba_geta(c);
+            ++i;
+          };
+          get_neighboring_pixels<RgbTraits>(src, x, y, w, h, w / 2, h / 2, tiledMode, delegate);
+          put_pixel(dst,
+                    x,
+                    y,
+                    rgba(target & TARGET_RED_CHANNEL ? median(0) : rgba_getr(color),
+                         target & TARGET_GREEN_CHANNEL ? median(1) : rgba_getg(color),
+                         target & TARGET_BLUE_CHANNEL ? median(2) : rgba_getb(color),
+                         target & TARGET_ALPHA_CHANNEL ? median(3) : rgba_geta(color)));
+          break;
+        }
+
+        case IMAGE_GRAYSCALE: {
+          auto delegate = [&](const GrayscaleTraits::pixel_t c) {
+            channel[0][i] = graya_getv(c);
+            channel[1][i] = graya_geta(c);
+            ++i;
+          };
+          get_neighboring_pixels<GrayscaleTraits>(src,
+                                                  x,
+                                                  y,
+                                                  w,
+                                                  h,
+                                                  w / 2,
+                                                  h / 2,
+                                                  tiledMode,
+                                                  delegate);
+          put_pixel(dst,
+                    x,
+                    y,
+                    graya(target & TARGET_GRAY_CHANNEL ? median(0) : graya_getv(color),
+                          target & TARGET_ALPHA_CHANNEL ? median(1) : graya_geta(color)));
+          break;
+        }
+
+        case IMAGE_INDEXED: {
+          auto delegate = [&](const IndexedTraits::pixel_t c) {
+            if (target & TARGET_INDEX_CHANNEL) {
+              channel[0][i] = c;
+            }
+            else {
+              const color_t rgb = pal->getEntry(c);
+              channel[0][i] = rgba_getr(rgb);
+              channel[1][i] = rgba_getg(rgb);
+              channel[2][i] = rgba_getb(rgb);
+              channel[3][i] = rgba_geta(rgb);
+            }
+            ++i;
+          };
+          get_neighboring_pixels<IndexedTraits>(src,
+                                                x,
+                                                y,
+                                                w,
+                                                h,
+                                                w / 2,
+                                                h / 2,
+                                                tiledMode,
+                                                delegate);
+          if (target & TARGET_INDEX_CHANNEL) {
+            put_pixel(dst, x, y, median(0));
+          }
+          else {
+            // The green channel used the RGBA value as a palette index
+            const color_t rgb = pal->getEntry(color);
+            const int i = int(rgb);
+            const int g = (i >= 0 && i < pal->size() ? rgba_getg(pal->getEntry(i)) : 0);
+            put_pixel(dst,
+                      x,
+                      y,
+                      rgbmap->mapColor(target & TARGET_RED_CHANNEL ? median(0) : rgba_getr(rgb),
+                                       target & TARGET_GREEN_CHANNEL ? median(1) : g,
+                                       target & TARGET_BLUE_CHANNEL ? median(2) : rgba_getb(rgb),
+                                       target & TARGET_ALPHA_CHANNEL ? median(3) :
+                                                                       rgba_geta(rgb)));
+          }
+          break;
+        }
+      }
+    }
+  }
+}
+
+ImageRef make_random_image(const PixelFormat pf, const int w, const int h, const int ncolors)
+{
+  ImageRef image(Image::create(pf, w, h));
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      color_t c;
+      switch (pf) {
+        case IMAGE_RGB:
+          c = rgba(std::rand() % 256,
+                   std::rand() % 256,
+                   std::rand() % 256,
+                   (std::rand() % 4) == 0 ? 0 : std::rand() % 256);
+          break;
+        case IMAGE_GRAYSCALE:
+          c = graya(std::rand() % 256, (std::rand() % 4) == 0 ? 0 : std::rand() % 256);
+          break;
+        default: c = std::rand() % ncolors; break;
+      }
+      put_pixel(image.get(), x, y, c);
+    }
+  }
+  return image;
+}
+
+void check_median(const Image* src,
+                  const gfx::Rect& bounds,
+                  const int w,
+                  const int h,
+                  const TiledMode tiledMode,
+                  const Target target,
+                  const Palette* pal = nullptr,
+                  const RgbMap* rgbmap = nullptr)
+{
+  ImageRef expected(Image::createCopy(src));
+  apply_median_sorting(src, expected.get(), bounds, w, h, tiledMode, target, pal, rgbmap);
+
+  MedianFilter filter;
+  filter.setSize(w, h);
+  filter.setTiledMode(tiledMode);
+
+  ImageRef result(Image::createCopy(src));
+  TestFilterManager filterMgr(src, result.get(), target, pal, rgbmap);
+  filterMgr.setBounds(bounds);
+  filterMgr.applyFilter(&filter);
+
+  EXPECT_TRUE(is_same_image(expected.get(), result.get()))
+    << "size=" << w << "x" << h << " tiledMode=" << int(tiledMode) << " target=" << target
+    << " bounds=" << bounds.x << "," << bounds.y << "," << bounds.w << "," << bounds.h;
+}
+
+const TiledMode kTiledModes[] = { TiledMode::NONE,
+                                  TiledMode::X_AXIS,
+                                  TiledMode::Y_AXIS,
+                                  TiledMode::BOTH };
+
+// Window sizes (including even sizes, and windows bigger than the
+// image)
+const gfx::Size kSizes[] = { gfx::Size(1, 1), gfx::Size(3, 3), gfx::Size(2, 4),
+                             gfx::Size(5, 1), gfx::Size(7, 7), gfx::Size(30, 3),
+                             gfx::Size(3, 25) };
+
+} // anonymous namespace
+
+TEST(MedianFilter, Rgba)
+{
+  std::srand(1);
+  ImageRef src = make_random_image(IMAGE_RGB, 23, 17, 0);
+  for (const TiledMode tiledMode : kTiledModes) {
+    for (const gfx::Size& size : kSizes) {
+      check_median(src.get(), src->bounds(), size.w, size.h, tiledMode, TARGET_ALL_CHANNELS);
+      check_median(src.get(),
+                   gfx::Rect(3, 2, 12, 9),
+                   size.w,
+                   size.h,
+                   tiledMode,
+                   TARGET_RED_CHANNEL | TARGET_ALPHA_CHANNEL);
+    }
+  }
+}
+
+TEST(MedianFilter, Grayscale)
+{
+  std::srand(2);
+  ImageRef src = make_random_image(IMAGE_GRAYSCALE, 19, 21, 0);
+  for (const TiledMode tiledMode : kTiledModes) {
+    for (const gfx::Size& size : kSizes) {
+      check_median(src.get(), src->bounds(), size.w, size.h, tiledMode, TARGET_ALL_CHANNELS);
+      check_median(src.get(),
+                   gfx::Rect(0, 5, 19, 4),
+                   size.w,
+                   size.h,
+                   tiledMode,
+                   TARGET_GRAY_CHANNEL);
+    }
+  }
+}
+
+TEST(MedianFilter, Indexed)
+{
+  std::srand(3);
+  const int ncolors = 32;
+  Palette pal(frame_t(0), ncolors);
+  for (int i = 0; i < ncolors; ++i)
+    pal.setEntry(i, rgba(8 * i, 255 - 8 * i, (i * 37) % 256, i == 0 ? 0 : 255));
+  RgbMapRGB5A3 rgbmap;
+  rgbmap.regenerateMap(&pal, 0);
+
+  ImageRef src = make_random_image(IMAGE_INDEXED, 20, 16, ncolors);
+  for (const TiledMode tiledMode : kTiledModes) {
+    for (const gfx::Size& size : kSizes) {
+      check_median(src.get(), src->bounds(), size.w, size.h, tiledMode, TARGET_INDEX_CHANNEL);
+      check_median(src.get(),
+                   src->bounds(),
+                   size.w,
+                   size.h,
+                   tiledMode,
+                   TARGET_ALL_CHANNELS,
+                   &pal,
+                   &rgbmap);
+      check_median(src.get(),
+                   gfx::Rect(4, 4, 8, 8),
+                   size.w,
+                   size.h,
+                   tiledMode,
+                   TARGET_GREEN_CHANNEL,
+                   &pal,
+                   &rgbmap);
+      check_median(src.get(),
+                   gfx::Rect(2, 3, 15, 10),
+                   size.w,
+                   size.h,
+                   tiledMode,
+                   TARGET_RED_CHANNEL | TARGET_BLUE_CHANNEL,
+                   &pal,
+                   &rgbmap);
+    }
+  }
+}
@@ -1,4 +1,5 @@
 // Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
 // Copyright (C) 2001-2015  David Capello
 //
 // This program is distributed under the terms of
@@ -102,6 +103,94 @@ inline void get_neighboring_pixels(const doc::Image* sourceImage,
   }
 }
 
+// Fills "cols" with the columns that get_neighboring_pixels() reads
+// for the window centered at "x" (in the same order).
+inline void get_neighboring_columns(const doc::Image* src,
+                                    const int x,
+                                    const int width,
+                                    const int centerX,
+                                    const TiledMode tiledMode,
+                                    std::vector<int>& cols)
+{
+  const int w = src->width();
+  const bool tiled = (int(tiledMode) & int(TiledMode::X_AXIS));
+  int getx = x - centerX;
+  int addx = 0;
+  if (getx < 0) {
+    if (tiled)
+      getx = w - (-(getx + 1) % w) - 1;
+    else {
+      addx = -getx;
+      getx = 0;
+    }
+  }
+  else if (getx >= w) {
+    if (tiled)
+      getx = getx % w;
+    else
+      getx = w - 1;
+  }
+
+  int srcx = getx;
+  for (int dx = 0; dx < width; ++dx) {
+    cols[dx] = srcx;
+
+    if (getx < w - 1) {
+      ++getx;
+      if (addx == 0)
+        ++srcx;
+      else
+        --addx;
+    }
+    else if (tiled) {
+      getx = 0;
+      srcx = 0;
+    }
+  }
+}
+
+// Fills "rows" with the rows that get_neighboring_pixels() reads for
+// the window centered at "y".
+inline void get_neighboring_rows(const doc::Image* src,
+                                 const int y,
+                                 const int height,
+                                 const int centerY,
+                                 const TiledMode tiledMode,
+                                 std::vector<int>& rows)
+{
+  const int h = src->height();
+  const bool tiled = (int(tiledMode) & int(TiledMode::Y_AXIS));
+  int gety = y - centerY;
+  int addy = 0;
+  if (gety < 0) {
+    if (tiled)
+      gety = h - (-(gety + 1) % h) - 1;
+    else {
+      addy = -gety;
+      gety = 0;
+    }
+  }
+  else if (gety >= h) {
+    if (tiled)
+      gety = gety % h;
+    else
+      gety = h - 1;
+  }
+
+  for (int dy = 0; dy < height; ++dy) {
+    rows[dy] = gety;
+
+    if (gety < h - 1) {
+      if (addy == 0)
+        ++gety;
+      else
+        --addy;
+    }
+    else if (tiled)
+      gety = 0;
+  }
+}
+
 } // namespace filters
 
 #endif
@@ -0,0 +1,89 @@
+// Aseprite
+// Copyright (C) 2025  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef FILTERS_TEST_FILTER_MANAGER_H_INCLUDED
+#define FILTERS_TEST_FILTER_MANAGER_H_INCLUDED
+#pragma once
+
+#include "base/task.h"
+#include "doc/image.h"
+#include "doc/palette_picks.h"
+#include "filters/filter.h"
+#include "filters/filter_indexed_data.h"
+#include "filters/filter_manager.h"
+#include "gfx/rect.h"
+
+namespace filters {
+
+// FilterManager used in tests to apply a filter to the given bounds
+// of an image, row by row (without selection).
+class TestFilterManager : public FilterManager,
+                          public FilterIndexedData {
+public:
+  TestFilterManager(const doc::Image* src,
+                    doc::Image* dst,
+                    const Target target,
+                    const doc::Palette* palette = nullptr,
+                    const doc::RgbMap* rgbmap = nullptr)
+    : m_src(src)
+    , m_dst(dst)
+    , m_target(target)
+    , m_palette(palette)
+    , m_rgbmap(rgbmap)
+    , m_bounds(src->bounds())
+    , m_y(0)
+  {
+  }
+
+  void setBounds(const gfx::Rect& bounds) { m_bounds = bounds; }
+
+  void applyFilter(Filter* filter)
+  {
+    for (m_y = m_bounds.y; m_y < m_bounds.y2(); ++m_y) {
+      switch (m_src->pixelFormat()) {
+        case doc::IMAGE_RGB:       filter->applyToRgba(this); break;
+        case doc::IMAGE_GRAYSCALE: filter->applyToGrayscale(this); break;
+        case doc::IMAGE_INDEXED:   filter->applyToIndexed(this); break;
+        default:                   break;
+      }
+    }
+  }
+
+  // FilterManager impl
+  doc::PixelFormat pixelFormat() const override { return m_src->pixelFormat(); }
+  const void* getSourceAddress() override { return m_src->getPixelAddress(m_bounds.x, m_y); }
+  void* getDestinationAddress() override { return m_dst->getPixelAddress(m_bounds.x, m_y); }
+  int getWidth() override { return m_bounds.w; }
+  Target getTarget() override { return m_target; }
+  FilterIndexedData* getIndexedData() override { return this; }
+  bool skipPixel() override { return false; }
+  const doc::Image* getSourceImage() override { return m_src; }
+  int x() const override { return m_bounds.x; }
+  int y() const override { return m_y; }
+  bool isFirstRow() const override { return m_y == m_bounds.y; }
+  bool isMaskActive() const override { return false; }
+  base::task_token& taskToken() const override { return m_token; }
+
+  // FilterIndexedData impl
+  const doc::Palette* getPalette() const override { return m_palette; }
+  const doc::RgbMap* getRgbMap() const override { return m_rgbmap; }
+  doc::Palette* getNewPalette() override { return nullptr; }
+  doc::PalettePicks getPalettePicks() override { return doc::PalettePicks(); }
+
+private:
+  const doc::Image* m_src;
+  doc::Image* m_dst;
+  Target m_target;
+  const doc::Palette* m_palette;
+  const doc::RgbMap* m_rgbmap;
+  gfx::Rect m_bounds;
+  int m_y;
+  mutable base::task_token m_token;
+};
+
+} // namespace filters
+
+#endif
@@ -14,9 +14,11 @@
 #include "base/gcd.h"
 #include "doc/blend_internals.h"
 #include "doc/blend_mode.h"
+#include "doc/blend_row.h"
 #include "doc/doc.h"
 #include "doc/image_impl.h"
 #include "doc/layer_tilemap.h"
+#include "doc/parallel_for.h"
 #include "doc/playback.h"
 #include "doc/render_plan.h"
 #include "doc/tileset.h"
@@ -24,7 +26,11 @@
 #include "gfx/clip.h"
 #include "gfx/region.h"
 
+#include <algorithm>
 #include <cmath>
+#include <numeric>
+#include <type_traits>
+#include <vector>
 
 #define TRACE_RENDER_CEL(...) // TRACE
 
@@ -64,6 +70,20 @@ void composite_image_without_scale(Image* dst,
 
   ASSERT(!srcBounds.isEmpty());
 
+  // Use the vectorized row blenders for the most common RGBA modes
+  if constexpr (std::is_same_v<DstTraits, RgbTraits> && std::is_same_v<SrcTraits, RgbTraits>) {
+    if (BlendRowFunc blendRow = get_rgba_row_blender(blendMode, newBlend)) {
+      for (int y = 0; y < srcBounds.h; ++y) {
+        blendRow((color_t*)dst->getPixelAddress(dstBounds.x, dstBounds.y + y),
+                 (const color_t*)src->getPixelAddress(srcBounds.x, srcBounds.y + y),
+                 srcBounds.w,
+                 opacity,
+                 src->maskColor());
+      }
+      return;
+    }
+  }
+
   // Lock all necessary bits
   const LockImageBits<SrcTraits> srcBits(src, srcBounds);
   LockImageBits<DstTraits> dstBits(dst, dstBounds);
@@ -528,10 +548,76 @@ bool has_visible_reference_layers(const LayerGroup* group)
   return false;
 }
 
+// Returns true if all the pixels of the image are opaque or fully
+// transparent. With the NORMAL blend mode these pixels replace the
+// backdrop or keep it as it is, so the result doesn't depend on the
+// backdrop alpha (and we can composite them in advance).
+bool is_opaque_or_transparent(const Image* image, const Palette* pal, const color_t maskColor)
+{
+  switch (image->pixelFormat()) {
+    case IMAGE_RGB: {
+      const LockImageBits<RgbTraits> bits(image);
+      for (const auto& c : bits) {
+        const int a = rgba_geta(c);
+        if (a != 0 && a != 255)
+          return false;
+      }
+      return true;
+    }
+    case IMAGE_GRAYSCALE: {
+      const LockImageBits<GrayscaleTraits> bits(image);
+      for (const auto& c : bits) {
+        const int a = graya_geta(c);
+        if (a != 0 && a != 255)
+          return false;
+      }
+      return true;
+    }
+    case IMAGE_INDEXED: {
+      const LockImageBits<IndexedTraits> bits(image);
+      for (const auto& c : bits) {
+        if (c == maskColor)
+          continue;
+        const int a = rgba_geta(pal->getEntry(c));
+        if (a != 0 && a != 255)
+          return false;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns the color used to clear the destination image before
+// rendering the layers of the sprite.
+color_t get_bg_color(const Sprite* sprite, const PixelFormat dstFormat, const frame_t frame)
+{
+  if (sprite->pixelFormat() == IMAGE_INDEXED) {
+    const LayerImage* bgLayer = sprite->backgroundLayer();
+    switch (dstFormat) {
+      case IMAGE_RGB:
+      case IMAGE_GRAYSCALE:
+        if (bgLayer && bgLayer->isVisible())
+          return sprite->palette(frame)->getEntry(sprite->transparentColor());
+        break;
+      case IMAGE_INDEXED: return sprite->transparentColor();
+    }
+  }
+  return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Parallel rendering
+
+// Minimum number of rows of each band rendered in parallel (to avoid
+// the overhead of using threads for small areas).
+const int kMinBandRows = 32;
+
 } // anonymous namespace
 
 Render::Render()
   : m_flags(0)
+  , m_threads(doc::parallel_for_threads())
   , m_nonactiveLayersOpacity(255)
   , m_sprite(nullptr)
   , m_currentLayer(nullptr)
@@ -548,6 +634,10 @@ Render::Render()
   , m_previewTileset(nullptr)
   , m_previewBlendMode(BlendMode::NORMAL)
   , m_onionskin(OnionskinType::NONE)
+  , m_cacheLayer(nullptr)
+  , m_cacheFrame(-1)
+  , m_cacheBelowImage(nullptr)
+  , m_cacheAboveImage(nullptr)
 {
 }
 
@@ -569,6 +659,11 @@ void Render::setNewBlend(const bool newBlend)
   m_newBlendMethod = newBlend;
 }
 
+void Render::setThreads(const int threads)
+{
+  m_threads = std::max(1, threads);
+}
+
 void Render::setProjection(const Projection& projection)
 {
   m_proj = projection;
@@ -636,6 +731,146 @@ void Render::disableOnionskin()
   m_onionskin.type(OnionskinType::NONE);
 }
 
+bool Render::renderLayersCache(Image* belowImage,
+                               Image* aboveImage,
+                               const Sprite* sprite,
+                               const Layer* layer,
+                               frame_t frame,
+                               const gfx::Rect& bounds)
+{
+  ASSERT(belowImage->pixelFormat() == IMAGE_RGB);
+  ASSERT(aboveImage->pixelFormat() == IMAGE_RGB);
+  ASSERT(belowImage->size() == bounds.size());
+  ASSERT(aboveImage->size() == bounds.size());
+
+  // Compositing the layers in advance gives the same result only
+  // with the new blending method.
+  if (!m_newBlendMethod)
+    return false;
+
+  doc::RenderPlan plan;
+  plan.addLayer(sprite->root(), frame);
+
+  // The background layer and the layers below the given one are
+  // composited in the same order as renderSpriteLayers() does, so
+  // belowImage is exact for any blend mode and alpha. The layers
+  // above are composited over a transparent image, and then this
+  // image over the backdrop. This is the same as compositing them
+  // one by one over the backdrop only for the NORMAL blend mode and
+  // opaque or fully transparent pixels.
+  bool found = false;
+  for (const auto& item : plan.items()) {
+    if (item.layer == layer) {
+      found = true;
+      continue;
+    }
+    if (!found)
+      continue;
+    if (static_cast<const LayerImage*>(item.layer)->blendMode() != BlendMode::NORMAL)
+      return false;
+    if (!isOpaqueOrTransparentCel(item.layer, item.cel, sprite, frame))
+      return false;
+  }
+  if (!found)
+    return false;
+
+  // Use a copy of this Render with the same options (e.g. non-active
+  // layers opacity) but without zoom and temporary images.
+  Render render(*this);
+  render.m_sprite = sprite;
+  render.m_threads = 1;
+  render.m_proj = Projection();
+  render.m_globalOpacity = 255;
+  render.m_tmpBuf.reset();
+  render.removePreviewImage();
+  render.removeExtraImage();
+  render.disableOnionskin();
+  render.removeLayersCache();
+
+  CompositeImageFunc compositeImage =
+    render.getImageComposition(IMAGE_RGB, sprite->pixelFormat(), sprite->root());
+  if (!compositeImage)
+    return false;
+
+  clear_image(belowImage, get_bg_color(sprite, IMAGE_RGB, frame));
+  clear_image(aboveImage, 0);
+
+  const gfx::Clip area(0, 0, bounds);
+  Image* dstImage = belowImage;
+  for (const auto& item : plan.items()) {
+    if (item.layer == layer) {
+      dstImage = aboveImage;
+      continue;
+    }
+
+    doc::RenderPlan itemPlan;
+    itemPlan.addLayer(item.layer, frame);
+    render.renderPlan(itemPlan,
+                      dstImage,
+                      area,
+                      frame,
+                      compositeImage,
+                      true,
+                      true,
+                      BlendMode::UNSPECIFIED);
+  }
+  return true;
+}
+
+bool Render::isOpaqueOrTransparentCel(const Layer* layer,
+                                      const Cel* cel,
+                                      const Sprite* sprite,
+                                      const frame_t frame) const
+{
+  if (!cel)
+    return true;
+
+  int t;
+  int opacity = MUL_UN8(cel->opacity(), static_cast<const LayerImage*>(layer)->opacity(), t);
+  if (m_selectedLayerForOpacity != layer)
+    opacity = MUL_UN8(opacity, m_nonactiveLayersOpacity, t);
+  if (opacity != 255)
+    return false;
+
+  const Palette* pal = sprite->palette(frame);
+  const color_t maskColor = sprite->transparentColor();
+  if (layer->isTilemap()) {
+    const Tileset* tileset = static_cast<const LayerTilemap*>(layer)->tileset();
+    if (!tileset)
+      return false;
+    for (tile_index i = 0; i < tileset->size(); ++i) {
+      const ImageRef tile = tileset->get(i);
+      if (tile && !is_opaque_or_transparent(tile.get(), pal, maskColor))
+        return false;
+    }
+    return true;
+  }
+  return is_opaque_or_transparent(cel->image(), pal, maskColor);
+}
+
+void Render::setLayersCache(const Layer* layer,
+                            frame_t frame,
+                            const Image* belowImage,
+                            const Image* aboveImage,
+                            const gfx::Point& origin)
+{
+  ASSERT(belowImage->size() == aboveImage->size());
+  m_cacheLayer = layer;
+  m_cacheFrame = frame;
+  m_cacheBelowImage = belowImage;
+  m_cacheAboveImage = aboveImage;
+  m_cacheBounds = gfx::Rect(origin, belowImage->size());
+}
+
+void Render::removeLayersCache()
+{
+  m_cacheLayer = nullptr;
+  m_cacheFrame = -1;
+  m_cacheBelowImage = nullptr;
+  m_cacheAboveImage = nullptr;
+  m_cacheBounds = gfx::Rect();
+}
+
 void Render::renderSprite(Image* dstImage, const Sprite* sprite, frame_t frame)
 {
   renderSprite(dstImage, sprite, frame, gfx::ClipF(sprite->bounds()));
@@ -672,6 +907,62 @@ void Render::renderSprite(Image* dstImage,
                           const Sprite* sprite,
                           frame_t frame,
                           const gfx::ClipF& area)
+{
+  // Each band must start in the same sub-pixel position (in sprite
+  // coordinates) as the whole area to get the same result, so we can
+  // split the area only with integer vertical scales (and without
+  // reference layers, which can be scaled to any size). Bands must
+  // also start in a checkered background tile with the same parity
+  // as the first one.
+  const double sy = m_proj.scaleY();
+  const int rows = int(area.size.h);
+  int nbands = 1;
+  int bandRows = rows;
+  if (m_threads > 1 && sy >= 1.0 && std::floor(sy) == sy &&
+      !has_visible_reference_layers(sprite->root())) {
+    int tile_h = m_bg.stripeSize.h;
+    if (m_bg.zoom)
+      tile_h = m_proj.zoom().apply(tile_h);
+    tile_h = std::max(1, tile_h);
+
+    const int step = std::lcm(int(sy), 2 * tile_h);
+    bandRows = std::max(kMinBandRows, (rows + m_threads - 1) / m_threads);
+    bandRows = ((bandRows + step - 1) / step) * step;
+    nbands = (rows + bandRows - 1) / bandRows;
+  }
+
+  if (nbands <= 1) {
+    renderSpriteArea(dstImage, sprite, frame, area);
+    return;
+  }
+
+  std::vector<gfx::ClipF> bands(nbands);
+  for (int i = 0; i < nbands; ++i) {
+    const int y = i * bandRows;
+    bands[i] = gfx::ClipF(area.dst.x,
+                          area.dst.y + y,
+                          area.src.x,
+                          area.src.y + y,
+                          area.size.w,
+                          (i < nbands - 1 ? bandRows : area.size.h - y));
+  }
+
+  // Each band is rendered with its own copy of this Render instance
+  // as the rendering process modifies some member variables.
+  doc::parallel_for(nbands, [this, dstImage, sprite, frame, &bands](const int i) {
+    Render render(*this);
+    render.m_threads = 1;
+    render.m_tmpBuf.reset();
+    render.renderSpriteArea(dstImage, sprite, frame, bands[i]);
+  });
+
+  m_sprite = sprite;
+}
+
+void Render::renderSpriteArea(Image* dstImage,
+                              const Sprite* sprite,
+                              frame_t frame,
+                              const gfx::ClipF& area)
 {
   m_sprite = sprite;
 
@@ -681,17 +972,7 @@ void Render::renderSprite(Image* dstImage,
     return;
 
   const LayerImage* bgLayer = m_sprite->backgroundLayer();
-  color_t bg_color = 0;
-  if (m_sprite->pixelFormat() == IMAGE_INDEXED) {
-    switch (dstImage->pixelFormat()) {
-      case IMAGE_RGB:
-      case IMAGE_GRAYSCALE:
-        if (bgLayer && bgLayer->isVisible())
-          bg_color = m_sprite->palette(frame)->getEntry(m_sprite->transparentColor());
-        break;
-      case IMAGE_INDEXED: bg_color = m_sprite->transparentColor(); break;
-    }
-  }
+  const color_t bg_color = get_bg_color(m_sprite, dstImage->pixelFormat(), frame);
 
   // New Blending Method:
   if (m_newBlendMethod) {
@@ -706,21 +987,46 @@ void Render::renderSprite(Image* dstImage,
     // In case that we need a special background (e.g. like the
     // checkered pattern), we can draw the background in a temporal
     // image and then merge this temporal image with the dstImage.
-    if (!isSolidBackground(bgLayer, bg_color)) {
+    const gfx::Clip bgArea(area);
+    if (!isSolidBackground(bgLayer, bg_color) && !bgArea.size.isEmpty()) {
       if (!m_tmpBuf)
         m_tmpBuf.reset(new doc::ImageBuffer);
-      ImageRef tmpBackground(Image::create(dstImage->spec(), m_tmpBuf));
-      renderBackground(tmpBackground.get(), bgLayer, bg_color, area);
+
+      // The temporal image has the size of the area only (e.g. a band
+      // of the sprite when it's rendered in several threads). The
+      // source position is moved to draw the checkered pattern in the
+      // same place as if it were rendered directly in dstImage.
+      ImageSpec spec = dstImage->spec();
+      spec.setSize(bgArea.size);
+      ImageRef tmpBackground(Image::create(spec, m_tmpBuf));
+      renderBackground(tmpBackground.get(),
+                       bgLayer,
+                       bg_color,
+                       gfx::ClipF(0,
+                                  0,
+                                  bgArea.src.x + bgArea.dst.x,
+                                  bgArea.src.y + bgArea.dst.y,
+                                  bgArea.size.w,
+                                  bgArea.size.h));
 
       // Draws dstImage over the background on each pixel of dstImage
-      // with opacity is < 255 (the result is left on dstImage itself)
-      composite_image(dstImage,
-                      tmpBackground.get(),
-                      sprite->palette(frame),
-                      0,
-                      0,
-                      255,
-                      BlendMode::DST_OVER);
+      // with opacity is < 255 (the result is left on dstImage itself).
+      // Only the rendered area is modified (the background was
+      // rendered in this area only).
+      CompositeImageFunc compositeBackground =
+        Render().getImageComposition(dstImage->pixelFormat(), tmpBackground->pixelFormat(), nullptr);
+      if (compositeBackground) {
+        compositeBackground(dstImage,
+                            tmpBackground.get(),
+                            sprite->palette(frame),
+                            gfx::ClipF(bgArea.dst.x, bgArea.dst.y, 0, 0, bgArea.size.w, bgArea.size.h),
+                            255,
+                            BlendMode::DST_OVER,
+                            1.0,
+                            1.0,
+                            true,
+                            0);
+      }
     }
   }
   // Old Blending Method:
@@ -752,11 +1058,17 @@ void Render::renderSpriteLayers(Image* dstImage,
                                 frame_t frame,
                                 CompositeImageFunc compositeImage)
 {
+  // The layers cache contains the background layer too.
+  m_globalOpacity = 255;
+  if (canUseLayersCache(dstImage, area, frame)) {
+    renderLayersWithCache(dstImage, area, frame, compositeImage);
+    return;
+  }
+
   doc::RenderPlan plan;
   plan.addLayer(m_sprite->root(), frame);
 
   // Draw the background layer.
-  m_globalOpacity = 255;
   renderPlan(plan, dstImage, area, frame, compositeImage, true, false, BlendMode::UNSPECIFIED);
 
   // Draw onion skin behind the sprite.
@@ -768,6 +1080,77 @@ void Render::renderSpriteLayers(Image* dstImage,
   renderPlan(plan, dstImage, area, frame, compositeImage, false, true, BlendMode::UNSPECIFIED);
 }
 
+bool Render::canUseLayersCache(const Image* dstImage,
+                               const gfx::ClipF& area,
+                               const frame_t frame) const
+{
+  if (!m_cacheLayer)
+    return false;
+
+  // Sprite pixels needed to render the area (with an extra pixel to
+  // avoid rounding issues with zoom) must be inside the cache.
+  gfx::Rect spriteBounds(m_proj.remove(area.srcBounds()));
+  spriteBounds.enlarge(1);
+  spriteBounds &= m_sprite->bounds();
+
+  // The cached images give the same result only when each
+  // destination pixel is mapped to the same sprite pixel in all
+  // layers (integer zoom levels), and when the layers below the
+  // cached one are not composited over the onion skin.
+  const double sx = m_proj.scaleX();
+  const double sy = m_proj.scaleY();
+  if (sx < 1.0 || sy < 1.0 || std::floor(sx) != sx || std::floor(sy) != sy ||
+      (m_onionskin.type() != OnionskinType::NONE &&
+       m_onionskin.position() == OnionskinPosition::BEHIND))
+    return false;
+
+  return (m_cacheFrame == frame && m_newBlendMethod && m_cacheBounds.contains(spriteBounds) &&
+          dstImage->pixelFormat() == IMAGE_RGB &&
+          // Preview/extra images of other layers are not in the cache
+          (!m_previewImage || !m_selectedLayer || m_selectedLayer == m_cacheLayer) &&
+          (!m_extraCel || m_currentLayer == m_cacheLayer));
+}
+
+// Draws the layers using the images created with renderLayersCache():
+// the background and layers below the cached layer (copied as they
+// are), the cached layer itself (which can have a preview/extra
+// image), and the layers above it.
+void Render::renderLayersWithCache(Image* dstImage,
+                                   const gfx::Clip& area,
+                                   const frame_t frame,
+                                   const CompositeImageFunc compositeImage)
+{
+  const Palette* pal = m_sprite->palette(frame);
+  const gfx::RectF bounds(m_cacheBounds);
+  CompositeImageFunc compositeCache =
+    getImageComposition(dstImage->pixelFormat(), IMAGE_RGB, nullptr);
+  if (!compositeCache)
+    return;
+
+  renderImage(dstImage,
+              m_cacheBelowImage,
+              pal,
+              bounds,
+              area,
+              compositeCache,
+              255,
+              BlendMode::SRC);
+
+  // The cached layer can be the background layer too
+  doc::RenderPlan plan;
+  plan.addLayer(m_cacheLayer, frame);
+  renderPlan(plan, dstImage, area, frame, compositeImage, true, true, BlendMode::UNSPECIFIED);
+
+  renderImage(dstImage,
+              m_cacheAboveImage,
+              pal,
+              bounds,
+              area,
+              compositeCache,
+              255,
+              BlendMode::NORMAL);
+}
+
 void Render::renderBackground(Image* image,
                               const Layer* bgLayer,
                               const color_t bg_color,
@@ -1,5 +1,5 @@
 // Aseprite Render Library
-// Copyright (c) 2019-2023 Igara Studio S.A.
+// Copyright (c) 2019-2025 Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -18,6 +18,7 @@
 #include "doc/tile.h"
 #include "gfx/clip.h"
 #include "gfx/point.h"
+#include "gfx/rect.h"
 #include "gfx/size.h"
 #include "render/bg_options.h"
 #include "render/extra_type.h"
@@ -63,6 +64,12 @@ public:
   void setBgOptions(const BgOptions& bg);
   void setSelectedLayer(const Layer* layer);
 
+  // Number of horizontal bands of the given area that renderSprite()
+  // renders in parallel with doc::parallel_for() (1 = render in the
+  // calling thread only). By default it's doc::parallel_for_threads().
+  // The result is the same as the single-thread one.
+  void setThreads(const int threads);
+
   // Sets the preview image. This preview image is an alternative
   // image to be used for the given layer/frame.
   void setPreviewImage(const Layer* layer,
@@ -86,6 +93,32 @@ public:
   void setOnionskin(const OnionskinOptions& options);
   void disableOnionskin();
 
+  // Renders the given bounds (in sprite coordinates) of the layers
+  // below (including the background layer) and above the given layer
+  // (without the background pattern, onion skin, preview and extra
+  // images) in two RGB images of bounds size. Returns false if these
+  // layers cannot be composited in advance to get the same result
+  // (e.g. a layer above the given one uses a blend mode different
+  // than NORMAL, has semi-transparent pixels, or opacity < 255).
+  bool renderLayersCache(Image* belowImage,
+                         Image* aboveImage,
+                         const Sprite* sprite,
+                         const Layer* layer,
+                         frame_t frame,
+                         const gfx::Rect& bounds);
+
+  // Uses the images generated with renderLayersCache() to render the
+  // given frame, so renderSprite() composites these two images and
+  // only the given layer cel by cel. The origin is the position of
+  // the images in the sprite. Areas outside the cached bounds are
+  // rendered without the cache.
+  void setLayersCache(const Layer* layer,
+                      frame_t frame,
+                      const Image* belowImage,
+                      const Image* aboveImage,
+                      const gfx::Point& origin);
+  void removeLayersCache();
+
   void renderSprite(Image* dstImage, const Sprite* sprite, frame_t frame);
 
   void renderLayer(Image* dstImage, const Layer* layer, frame_t frame);
@@ -124,6 +157,11 @@ public:
                  const BlendMode blendMode);
 
 private:
+  void renderSpriteArea(Image* dstImage,
+                        const Sprite* sprite,
+                        frame_t frame,
+                        const gfx::ClipF& area);
+
   void renderSpriteLayers(Image* dstImage,
                           const gfx::ClipF& area,
                           frame_t frame,
@@ -136,6 +174,18 @@ private:
 
   bool isSolidBackground(const Layer* bgLayer, const color_t bg_color) const;
 
+  bool isOpaqueOrTransparentCel(const Layer* layer,
+                                const Cel* cel,
+                                const Sprite* sprite,
+                                const frame_t frame) const;
+  bool canUseLayersCache(const Image* dstImage,
+                         const gfx::ClipF& area,
+                         const frame_t frame) const;
+  void renderLayersWithCache(Image* dstImage,
+                             const gfx::Clip& area,
+                             const frame_t frame,
+                             const CompositeImageFunc compositeImage);
+
   void renderOnionskin(Image* image,
                        const gfx::Clip& area,
                        const frame_t frame,
@@ -179,6 +229,7 @@ private:
   bool checkIfWeShouldUsePreview(const Cel* cel) const;
 
   int m_flags;
+  int m_threads;
   int m_nonactiveLayersOpacity;
   const Sprite* m_sprite;
   const Layer* m_currentLayer;
@@ -199,6 +250,11 @@ private:
   gfx::Point m_previewPos;
   BlendMode m_previewBlendMode;
   OnionskinOptions m_onionskin;
+  const Layer* m_cacheLayer;
+  frame_t m_cacheFrame;
+  const Image* m_cacheBelowImage;
+  const Image* m_cacheAboveImage;
+  gfx::Rect m_cacheBounds;
   ImageBufferPtr m_tmpBuf;
 };
 
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2019-2022 Igara Studio S.A.
+// Copyright (c) 2019-2025 Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -10,15 +10,21 @@
 
 #include "render/render.h"
 
+#include "base/thread_pool.h"
 #include "doc/cel.h"
 #include "doc/image.h"
 #include "doc/layer.h"
 #include "doc/palette.h"
+#include "doc/parallel_for.h"
 #include "doc/primitives.h"
 #include "doc/sprite.h"
 
 #include <benchmark/benchmark.h>
 
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
 using namespace doc;
 using namespace render;
 
@@ -69,6 +75,75 @@ static void Bm_Render(benchmark::State& state)
   }
 }
 
+static void Bm_RenderLayers(benchmark::State& state)
+{
+  const int w = state.range(0);
+  const int h = state.range(1);
+  const int nlayers = state.range(2);
+  const int threads = state.range(3);
+
+  std::unique_ptr<Sprite> spr(Sprite::MakeStdSprite(ImageSpec(ColorMode::RGB, w, h)));
+  clear_image(static_cast<LayerImage*>(spr->root()->firstLayer())->cel(0)->image(), 0);
+
+  for (int i = 1; i < nlayers; ++i) {
+    LayerImage* lay = new LayerImage(spr.get());
+    lay->setBlendMode(i % 2 ? BlendMode::NORMAL : BlendMode::MULTIPLY);
+    spr->root()->addLayer(lay);
+
+    ImageRef img(Image::create(spr->pixelFormat(), w, h));
+    clear_image(img.get(), 0);
+    fill_rect(img.get(),
+              (i * 16) % (w / 2),
+              (i * 16) % (h / 2),
+              w - 1 - (i * 8) % (w / 2),
+              h - 1 - (i * 8) % (h / 2),
+              rgba((i * 40) % 256, 128, (255 - i * 30) % 256, 128));
+    lay->addCel(new Cel(frame_t(0), img));
+  }
+
+  std::unique_ptr<Image> dst(Image::create(spr->pixelFormat(), w, h));
+
+  Render render;
+  BgOptions bg;
+  bg.type = BgType::CHECKERED;
+  bg.zoom = true;
+  bg.color1 = rgba(100, 100, 100, 255);
+  bg.color2 = rgba(200, 200, 200, 255);
+  bg.stripeSize = gfx::Size(16, 16);
+  render.setBgOptions(bg);
+  render.setThreads(threads);
+
+  // Render the bands in a pool of threads (like the app does with its
+  // task scheduler)
+  base::thread_pool pool(threads);
+  doc::set_parallel_for(
+    [&pool](const int n, const std::function<void(int)>& func) {
+      std::mutex mutex;
+      std::condition_variable cv;
+      int pending = n - 1;
+      for (int i = 1; i < n; ++i) {
+        pool.execute([&func, &mutex, &cv, &pending, i] {
+          func(i);
+
+          const std::lock_guard lock(mutex);
+          if (--pending == 0)
+            cv.notify_one();
+        });
+      }
+      func(0);
+
+      std::unique_lock lock(mutex);
+      cv.wait(lock, [&pending] { return pending == 0; });
+    },
+    threads);
+
+  while (state.KeepRunning()) {
+    render.renderSprite(dst.get(), spr.get(), frame_t(0), gfx::Clip(0, 0, 0, 0, w, h));
+  }
+
+  doc::set_parallel_for(nullptr, 1);
+}
+
 BENCHMARK(Bm_Render)
   ->Args({ 256, 256 })
   ->Args({ 1024, 256 })
@@ -77,4 +152,16 @@ BENCHMARK(Bm_Render)
   ->Args({ 4096, 4096 })
   ->Unit(benchmark::kMicrosecond);
 
+BENCHMARK(Bm_RenderLayers)
+  ->Args({ 1024, 1024, 50, 1 })
+  ->Args({ 1024, 1024, 50, 2 })
+  ->Args({ 1024, 1024, 50, 4 })
+  ->Args({ 1024, 1024, 50, 8 })
+  ->Args({ 3840, 2160, 50, 1 })
+  ->Args({ 3840, 2160, 50, 2 })
+  ->Args({ 3840, 2160, 50, 4 })
+  ->Args({ 3840, 2160, 50, 8 })
+  ->Unit(benchmark::kMicrosecond)
+  ->UseRealTime();
+
 BENCHMARK_MAIN();
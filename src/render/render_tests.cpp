@@ -1,5 +1,5 @@
 // Aseprite Render Library
-// Copyright (c) 2019-2023 Igara Studio S.A.
+// Copyright (c) 2019-2025 Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -21,6 +21,8 @@
 #include "doc/primitives.h"
 
 #include <memory>
+#include <string>
+#include <vector>
 
 using namespace doc;
 using namespace render;
@@ -251,6 +253,430 @@ TEST(Render, BugWithMultiplesOf3ZoomFactors)
   }
 }
 
+TEST(Render, ThreadsProduceSameResult)
+{
+  std::shared_ptr<Document> doc = std::make_shared<Document>();
+  Sprite* spr = Sprite::MakeStdSprite(ImageSpec(ColorMode::RGB, 200, 300));
+  doc->sprites().add(spr);
+  clear_image(spr->root()->firstLayer()->cel(0)->image(), 0);
+
+  for (int i = 0; i < 4; ++i) {
+    LayerImage* lay = new LayerImage(spr);
+    lay->setBlendMode(i % 2 ? BlendMode::NORMAL : BlendMode::MULTIPLY);
+    spr->root()->addLayer(lay);
+
+    ImageRef img(Image::create(IMAGE_RGB, 150, 250));
+    clear_image(img.get(), 0);
+    fill_rect(img.get(), i * 10, i * 20, 100 + i * 10, 200 + i * 5, rgba(64 * i, 128, 200, 100));
+    Cel* cel = new Cel(frame_t(0), img);
+    cel->setPosition(i * 13, i * 7);
+    lay->addCel(cel);
+  }
+
+  // Integer and non-integer zoom levels (with non-integer ones the
+  // area is rendered in one band)
+  const Zoom zooms[] = { Zoom(1, 1), Zoom(2, 1), Zoom(3, 1), Zoom(1, 2),
+                         Zoom(1, 3), Zoom(3, 2), Zoom(2, 3), Zoom(5, 3) };
+  for (const Zoom& zoom : zooms) {
+    const int w = zoom.apply(200);
+    const int h = zoom.apply(300);
+    std::unique_ptr<Image> dst1(Image::create(IMAGE_RGB, w, h));
+    std::unique_ptr<Image> dst2(Image::create(IMAGE_RGB, w, h));
+    clear_image(dst1.get(), 0);
+    clear_image(dst2.get(), 0);
+
+    Render render;
+    BgOptions bg;
+    bg.type = BgType::CHECKERED;
+    bg.zoom = false;
+    bg.colorPixelFormat = IMAGE_RGB;
+    bg.color1 = rgba(128, 128, 128, 255);
+    bg.color2 = rgba(64, 64, 64, 255);
+    bg.stripeSize = gfx::Size(8, 8);
+    render.setBgOptions(bg);
+    render.setProjection(Projection(PixelRatio(1, 1), zoom));
+
+    render.setThreads(1);
+    render.renderSprite(dst1.get(), spr, frame_t(0), gfx::Clip(0, 0, 0, 0, w, h));
+    render.setThreads(4);
+    render.renderSprite(dst2.get(), spr, frame_t(0), gfx::Clip(0, 0, 0, 0, w, h));
+
+    EXPECT_TRUE(is_same_image(dst1.get(), dst2.get()))
+      << " zoom=" << zoom.scale();
+  }
+}
+
+// Renders a 6x4 cel in (1,2) with non-integer zoom levels. The whole
+// sprite and the sprite without its first row/column are rendered.
+// The expected pixels ('.' for index 0, 'a' for index 1, etc.) were
+// generated with the single-band renderer (before the area could be
+// split in bands), so this checks that the single-thread output
+// doesn't change.
+TEST(Render, NonIntegerZoomLevels)
+{
+  std::shared_ptr<Document> doc = std::make_shared<Document>();
+  Sprite* spr = Sprite::MakeStdSprite(ImageSpec(ColorMode::INDEXED, 9, 7));
+  doc->sprites().add(spr);
+  clear_image(spr->root()->firstLayer()->cel(0)->image(), 0);
+
+  LayerImage* lay = new LayerImage(spr);
+  spr->root()->addLayer(lay);
+
+  ImageRef img(Image::create(IMAGE_INDEXED, 6, 4));
+  for (int y = 0; y < img->height(); ++y)
+    for (int x = 0; x < img->width(); ++x)
+      put_pixel(img.get(), x, y, 1 + x + y * img->width());
+  Cel* cel = new Cel(frame_t(0), img);
+  cel->setPosition(1, 2);
+  lay->addCel(cel);
+
+  struct Case {
+    Zoom zoom;
+    gfx::Point src;
+    std::vector<std::string> expected;
+  };
+  const Case cases[] = {
+    { Zoom(1, 2), gfx::Point(0, 0), {
+        "....",
+        "ace.",
+        "moq.",
+      } },
+    { Zoom(1, 2), gfx::Point(1, 1), {
+        "ac..",
+        "mo..",
+        "....",
+      } },
+    { Zoom(1, 3), gfx::Point(0, 0), {
+        "ad.",
+        "...",
+      } },
+    { Zoom(1, 3), gfx::Point(1, 1), {
+        "a..",
+        "...",
+      } },
+    { Zoom(3, 2), gfx::Point(0, 0), {
+        ".............",
+        ".............",
+        ".............",
+        ".aabccdeef...",
+        ".aabccdeef...",
+        ".gghiijkkl...",
+        ".mmnoopqqr...",
+        ".mmnoopqqr...",
+        ".sstuuvwwx...",
+        ".............",
+      } },
+    { Zoom(3, 2), gfx::Point(1, 1), {
+        ".............",
+        ".............",
+        "aabccdeef....",
+        "aabccdeef....",
+        "gghiijkkl....",
+        "mmnoopqqr....",
+        "mmnoopqqr....",
+        "sstuuvwwx....",
+        ".............",
+        ".............",
+      } },
+    { Zoom(2, 3), gfx::Point(0, 0), {
+        "......",
+        "abde..",
+        "ghjk..",
+        "stvw..",
+      } },
+    { Zoom(2, 3), gfx::Point(1, 1), {
+        "acdf..",
+        "gijl..",
+        "suvx..",
+        "......",
+      } },
+    { Zoom(5, 3), gfx::Point(0, 0), {
+        "...............",
+        "...............",
+        "...............",
+        ".aabbcddeef....",
+        ".aabbcddeef....",
+        ".gghhijjkkl....",
+        ".gghhijjkkl....",
+        ".mmnnoppqqr....",
+        ".ssttuvvwwx....",
+        ".ssttuvvwwx....",
+        "...............",
+      } },
+    { Zoom(5, 3), gfx::Point(1, 1), {
+        "...............",
+        "...............",
+        "aabbcddeef.....",
+        "aabbcddeef.....",
+        "gghhijjkkl.....",
+        "gghhijjkkl.....",
+        "mmnnoppqqr.....",
+        "ssttuvvwwx.....",
+        "ssttuvvwwx.....",
+        "...............",
+        "...............",
+      } },
+  };
+
+  for (const Case& c : cases) {
+    const int w = c.zoom.apply(spr->width());
+    const int h = c.zoom.apply(spr->height());
+    std::unique_ptr<Image> dst(Image::create(IMAGE_INDEXED, w, h));
+    clear_image(dst.get(), 0);
+
+    Render render;
+    BgOptions bg;
+    bg.zoom = true;
+    render.setBgOptions(bg);
+    render.setProjection(Projection(PixelRatio(1, 1), c.zoom));
+    render.renderSprite(dst.get(),
+                        spr,
+                        frame_t(0),
+                        gfx::Clip(0, 0, c.src.x, c.src.y, w - c.src.x, h - c.src.y));
+
+    ASSERT_EQ(h, int(c.expected.size()));
+    for (int y = 0; y < h; ++y) {
+      ASSERT_EQ(w, int(c.expected[y].size()));
+      for (int x = 0; x < w; ++x) {
+        const char chr = c.expected[y][x];
+        const color_t expected = (chr == '.' ? 0 : chr - 'a' + 1);
+        EXPECT_EQ(expected, get_pixel(dst.get(), x, y))
+          << " zoom=" << c.zoom.scale() << " src=" << c.src.x << "," << c.src.y << " x=" << x
+          << " y=" << y;
+      }
+    }
+  }
+}
+
+TEST(Render, LayersCache)
+{
+  std::shared_ptr<Document> doc = std::make_shared<Document>();
+  Sprite* spr = Sprite::MakeStdSprite(ImageSpec(ColorMode::RGB, 64, 48));
+  doc->sprites().add(spr);
+  clear_image(spr->root()->firstLayer()->cel(0)->image(), 0);
+
+  std::vector<LayerImage*> layers;
+  for (int i = 0; i < 5; ++i) {
+    LayerImage* lay = new LayerImage(spr);
+    spr->root()->addLayer(lay);
+    layers.push_back(lay);
+
+    ImageRef img(Image::create(IMAGE_RGB, 40, 30));
+    clear_image(img.get(), 0);
+    fill_rect(img.get(), i, i * 2, 20 + i * 3, 25, rgba(50 * i, 100, 255 - 40 * i, 255));
+    Cel* cel = new Cel(frame_t(0), img);
+    cel->setPosition(i * 5, i * 3);
+    lay->addCel(cel);
+  }
+
+  const LayerImage* activeLayer = layers[2];
+  ImageRef below(Image::create(IMAGE_RGB, 64, 48));
+  ImageRef above(Image::create(IMAGE_RGB, 64, 48));
+
+  for (int zoom : { 1, 3 }) {
+    const int w = 64 * zoom;
+    const int h = 48 * zoom;
+    std::unique_ptr<Image> dst1(Image::create(IMAGE_RGB, w, h));
+    std::unique_ptr<Image> dst2(Image::create(IMAGE_RGB, w, h));
+    clear_image(dst1.get(), 0);
+    clear_image(dst2.get(), 0);
+
+    Render render;
+    render.setSelectedLayer(activeLayer);
+    render.setNonactiveLayersOpacity(255);
+    render.setProjection(Projection(PixelRatio(1, 1), Zoom(zoom, 1)));
+    render.renderSprite(dst1.get(), spr, frame_t(0), gfx::Clip(0, 0, 0, 0, w, h));
+
+    EXPECT_TRUE(render.renderLayersCache(below.get(),
+                                         above.get(),
+                                         spr,
+                                         activeLayer,
+                                         frame_t(0),
+                                         spr->bounds()));
+    render.setLayersCache(activeLayer, frame_t(0), below.get(), above.get(), gfx::Point(0, 0));
+    render.renderSprite(dst2.get(), spr, frame_t(0), gfx::Clip(0, 0, 0, 0, w, h));
+    render.removeLayersCache();
+
+    EXPECT_TRUE(is_same_image(dst1.get(), dst2.get())) << " zoom=" << zoom;
+
+    // Cache only a part of the sprite, areas outside the cached
+    // bounds are rendered without the cache.
+    const gfx::Rect partBounds(10, 8, 30, 20);
+    ImageRef partBelow(Image::create(IMAGE_RGB, partBounds.w, partBounds.h));
+    ImageRef partAbove(Image::create(IMAGE_RGB, partBounds.w, partBounds.h));
+    EXPECT_TRUE(render.renderLayersCache(partBelow.get(),
+                                         partAbove.get(),
+                                         spr,
+                                         activeLayer,
+                                         frame_t(0),
+                                         partBounds));
+    render.setLayersCache(activeLayer,
+                          frame_t(0),
+                          partBelow.get(),
+                          partAbove.get(),
+                          partBounds.origin());
+    clear_image(dst2.get(), 0);
+    render.renderSprite(dst2.get(), spr, frame_t(0), gfx::Clip(0, 0, 0, 0, w, h));
+    EXPECT_TRUE(is_same_image(dst1.get(), dst2.get())) << " zoom=" << zoom;
+
+    clear_image(dst2.get(), 0);
+    const gfx::Rect inside(12 * zoom, 10 * zoom, 20 * zoom, 15 * zoom);
+    render.renderSprite(dst2.get(), spr, frame_t(0), gfx::Clip(inside.x, inside.y, inside));
+    for (int y = inside.y; y < inside.y2(); ++y)
+      for (int x = inside.x; x < inside.x2(); ++x)
+        ASSERT_EQ(get_pixel(dst1.get(), x, y), get_pixel(dst2.get(), x, y))
+          << x << "," << y << " zoom=" << zoom;
+    render.removeLayersCache();
+  }
+
+  // Layers with other blend modes cannot be cached
+  layers[4]->setBlendMode(BlendMode::MULTIPLY);
+  Render render;
+  EXPECT_FALSE(render.renderLayersCache(below.get(),
+                                        above.get(),
+                                        spr,
+                                        activeLayer,
+                                        frame_t(0),
+                                        spr->bounds()));
+}
+
+// Renders the sprite with and without the layers cache of the given
+// layer, and checks that the result is the same. Returns false if
+// the cache cannot be used.
+static bool render_with_layers_cache(Sprite* spr, const Layer* activeLayer, const int zoom)
+{
+  const int w = spr->width() * zoom;
+  const int h = spr->height() * zoom;
+  std::unique_ptr<Image> dst1(Image::create(IMAGE_RGB, w, h));
+  std::unique_ptr<Image> dst2(Image::create(IMAGE_RGB, w, h));
+  clear_image(dst1.get(), 0);
+  clear_image(dst2.get(), 0);
+
+  Render render;
+  render.setSelectedLayer(activeLayer);
+  render.setNonactiveLayersOpacity(255);
+  render.setProjection(Projection(PixelRatio(1, 1), Zoom(zoom, 1)));
+  render.renderSprite(dst1.get(), spr, frame_t(0), gfx::Clip(0, 0, 0, 0, w, h));
+
+  ImageRef below(Image::create(IMAGE_RGB, spr->width(), spr->height()));
+  ImageRef above(Image::create(IMAGE_RGB, spr->width(), spr->height()));
+  if (!render.renderLayersCache(below.get(),
+                                above.get(),
+                                spr,
+                                activeLayer,
+                                frame_t(0),
+                                spr->bounds()))
+    return false;
+
+  render.setLayersCache(activeLayer, frame_t(0), below.get(), above.get(), gfx::Point(0, 0));
+  render.renderSprite(dst2.get(), spr, frame_t(0), gfx::Clip(0, 0, 0, 0, w, h));
+  render.removeLayersCache();
+
+  EXPECT_TRUE(is_same_image(dst1.get(), dst2.get())) << " zoom=" << zoom;
+  return true;
+}
+
+// Makes opaque all the non-transparent pixels of the image
+static void make_opaque(Image* image)
+{
+  for (int y = 0; y < image->height(); ++y) {
+    for (int x = 0; x < image->width(); ++x) {
+      const color_t c = get_pixel(image, x, y);
+      if (rgba_geta(c) > 0)
+        put_pixel(image, x, y, c | rgba_a_mask);
+    }
+  }
+}
+
+TEST(Render, LayersCacheWithSemiTransparentLayers)
+{
+  std::shared_ptr<Document> doc = std::make_shared<Document>();
+  Sprite* spr = Sprite::MakeStdSprite(ImageSpec(ColorMode::RGB, 32, 24));
+  doc->sprites().add(spr);
+  clear_image(spr->root()->firstLayer()->cel(0)->image(), 0);
+
+  // Semi-transparent layers overlapping each other
+  std::vector<LayerImage*> layers;
+  std::vector<Image*> images;
+  for (int i = 0; i < 5; ++i) {
+    LayerImage* lay = new LayerImage(spr);
+    spr->root()->addLayer(lay);
+    layers.push_back(lay);
+
+    ImageRef img(Image::create(IMAGE_RGB, 20, 16));
+    clear_image(img.get(), 0);
+    fill_rect(img.get(), i, i, 12 + i, 10, rgba(60 * i, 200 - 30 * i, 90, 70 + 30 * i));
+    fill_rect(img.get(), 2, 8, 18, 14, rgba(255 - 40 * i, 20 * i, 180, 255));
+    images.push_back(img.get());
+    Cel* cel = new Cel(frame_t(0), img);
+    cel->setPosition(i * 3, i * 2);
+    lay->addCel(cel);
+  }
+  const LayerImage* activeLayer = layers[2];
+
+  // Semi-transparent pixels above the active layer
+  for (int zoom : { 1, 2 })
+    EXPECT_FALSE(render_with_layers_cache(spr, activeLayer, zoom));
+
+  // Layers below can have semi-transparent pixels when there is no
+  // background layer (they are composited over a transparent image
+  // anyway), layers above can have only opaque/transparent pixels
+  make_opaque(images[3]);
+  make_opaque(images[4]);
+  for (int zoom : { 1, 2, 3 })
+    EXPECT_TRUE(render_with_layers_cache(spr, activeLayer, zoom));
+
+  // Layer with opacity < 255 above the active layer
+  layers[4]->setOpacity(128);
+  EXPECT_FALSE(render_with_layers_cache(spr, activeLayer, 1));
+  layers[4]->setOpacity(255);
+
+  // With a background layer, the background and the semi-transparent
+  // layers below are composited in the cache in the same order
+  LayerImage* bgLayer = static_cast<LayerImage*>(spr->root()->firstLayer());
+  bgLayer->setBackground(true);
+  clear_image(bgLayer->cel(0)->image(), rgba(32, 64, 128, 255));
+  for (int zoom : { 1, 2 })
+    EXPECT_TRUE(render_with_layers_cache(spr, activeLayer, zoom));
+
+  // Layers below can use any blend mode
+  layers[0]->setBlendMode(BlendMode::MULTIPLY);
+  layers[1]->setOpacity(128);
+  for (int zoom : { 1, 2 })
+    EXPECT_TRUE(render_with_layers_cache(spr, activeLayer, zoom));
+  layers[0]->setBlendMode(BlendMode::NORMAL);
+  layers[1]->setOpacity(255);
+
+  // The background layer as the active layer
+  make_opaque(images[0]);
+  make_opaque(images[1]);
+  EXPECT_FALSE(render_with_layers_cache(spr, bgLayer, 1));
+  make_opaque(images[2]);
+  for (int zoom : { 1, 2 })
+    EXPECT_TRUE(render_with_layers_cache(spr, bgLayer, zoom));
+
+  // Non-integer zoom levels cannot use the cache
+  Render render;
+  ImageRef below(Image::create(IMAGE_RGB, spr->width(), spr->height()));
+  ImageRef above(Image::create(IMAGE_RGB, spr->width(), spr->height()));
+  render.setSelectedLayer(activeLayer);
+  render.setNonactiveLayersOpacity(255);
+  render.setProjection(Projection(PixelRatio(1, 1), Zoom(3, 2)));
+  EXPECT_TRUE(render.renderLayersCache(below.get(),
+                                       above.get(),
+                                       spr,
+                                       activeLayer,
+                                       frame_t(0),
+                                       spr->bounds()));
+  render.setLayersCache(activeLayer, frame_t(0), below.get(), above.get(), gfx::Point(0, 0));
+  std::unique_ptr<Image> dst1(Image::create(IMAGE_RGB, 48, 36));
+  std::unique_ptr<Image> dst2(Image::create(IMAGE_RGB, 48, 36));
+  render.renderSprite(dst1.get(), spr, frame_t(0), gfx::Clip(0, 0, 0, 0, 48, 36));
+  render.removeLayersCache();
+  render.renderSprite(dst2.get(), spr, frame_t(0), gfx::Clip(0, 0, 0, 0, 48, 36));
+  EXPECT_TRUE(is_same_image(dst1.get(), dst2.get()));
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);